@@ -0,0 +1,43 @@
+// Gabo Bernardino - feed process publishing prices and order books on the shared memory feed
+
+#include <iostream>
+#include <iomanip>
+#include "tradingsystem/Bond/BondPricingService.hpp"
+#include "tradingsystem/Bond/BondMarketDataService.hpp"
+#include "tradingsystem/Bond/BondMarketDataFeed.hpp"
+#include "tradingsystem/flowscheduler.hpp"
+
+// Usage: FeedPublisherExe [prices file] [market data file] [feed name]
+// Start `TradingSystemExe --feed` first: its readers wait for the feed, and read it to the end.
+// The feed is removed from /dev/shm when this exits, so readers started later do not find it
+int main(int argc, char* argv[]) {
+  const char* prices_file = (argc > 1) ? argv[1] : "Data/prices.txt";
+  const char* mktdata_file = (argc > 2) ? argv[2] : "Data/mktdata.txt";
+  const char* feed_name = (argc > 3) ? argv[3] : defaultFeedName;
+
+  std::cout << std::fixed << std::setprecision(8);
+  std::cout << PrintTimeStamp() << " Publishing " << prices_file << " and " << mktdata_file << " on " << feed_name << std::endl;
+
+  BondFeedPublisher publisher(feed_name);
+
+  // the services only forward what the connectors read to the publisher
+  BondPricingService price_service;
+  price_service.AddListener(&publisher);
+  BondMarketDataService mkt_service;
+  mkt_service.AddListener(&publisher);
+
+  BondPricingConnector price_connector(&price_service);
+  BondMarketDataConnector mkt_connector(&mkt_service);
+
+  FlowScheduler scheduler;
+  scheduler.AddFlow("Prices", [&]() { price_connector.Subscribe(prices_file, false); });
+  scheduler.AddFlow("Market data", [&]() { mkt_connector.Subscribe(mktdata_file, false); });
+  scheduler.Start();
+  scheduler.Join();
+  publisher.Close();
+  publisher.Unlink();  // the segment goes once the last reader unmaps it
+
+  std::cout << PrintTimeStamp() << " Published " << publisher.GetPublishedCount() << " messages" << std::endl;
+  scheduler.Report(std::cout);
+  return 0;
+}
@@ -0,0 +1,96 @@
+// Gabo Bernardino - point-in-time lookups on the historical files written with `TradingSystemExe --index`,
+// and reading back the files written with `--compress`
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <iostream>
+#include <string>
+#include "tradingsystem/timeindex.hpp"
+#include "tradingsystem/framecodec.hpp"
+
+// Complete a time given as "YYYY-MM-DD hh:mm:ss.mmm" or a prefix of "hh:mm:ss.mmm",
+// taking the date of the file's first record
+std::int64_t ParseQueryTime(std::string text, std::int64_t first) {
+  const std::string zero = "0000-00-00 00:00:00.000";
+  if (text.size() > 4 && text[4] != '-') {
+    std::string date = std::to_string(first / 1000000000LL);  // YYYYMMDD
+    if (first < 0 || date.size() != 8) return -1;
+    text = date.substr(0, 4) + "-" + date.substr(4, 2) + "-" + date.substr(6, 2) + " " + text;
+  }
+  if (text.size() < zero.size()) text += zero.substr(text.size());
+  return ParseIndexTime(text.data(), text.data() + text.size());
+}
+
+// Write the content of a compressed file to the output - false if a frame is corrupt
+bool PrintFrames(const char* filename, std::ostream& output) {
+  std::ifstream in(filename, std::ios::binary);
+  if (!in) throw std::runtime_error(std::string("cannot open ") + filename);
+  std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  std::string raw;
+  std::size_t position = 0;
+  std::uint32_t raw_length, block_length;
+  std::uint64_t offset;
+  while (data.size() - position >= frameHeaderSize && FrameHeader(data.data() + position, raw_length, block_length, offset)) {
+    if (data.size() - position - frameHeaderSize < block_length) break;  // cut by a crash
+    if (!FrameIntact(data.data() + position, block_length)
+      || !FrameDecode(data.data() + position + frameHeaderSize, block_length, raw_length, raw)) return false;
+    output << raw;
+    position += frameHeaderSize + block_length;
+  }
+  return true;
+}
+
+// Usage: HistoryLookupExe <historical file> <product, sector or inquiry id> <time>
+//        HistoryLookupExe --cat <compressed historical file>
+// e.g. HistoryLookupExe Data/positions.txt 91282CJL6 14:32
+int main(int argc, char* argv[]) {
+  if (argc == 3 && std::string(argv[1]) == "--cat") {
+    try {
+      if (PrintFrames(argv[2], std::cout)) return 0;
+      std::cout << "An error occurred: corrupt frame in " << argv[2] << std::endl;
+    }
+    catch (std::exception& e) {
+      std::cout << "An error occurred: " << e.what() << std::endl;
+    }
+    return 1;
+  }
+  if (argc < 4) {
+    std::cout << "Usage: HistoryLookupExe <historical file> <product, sector or inquiry id> <time>" << std::endl;
+    std::cout << "       HistoryLookupExe --cat <compressed historical file>" << std::endl;
+    return 1;
+  }
+
+  try {
+    TimeIndexedFile file(argv[1]);
+    std::int64_t time = ParseQueryTime(argv[3], file.GetFirstTime());
+    if (time < 0) {
+      std::cout << "An error occurred: cannot read the time " << argv[3] << std::endl;
+      return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::string found = file.Find(argv[2], time);
+    std::chrono::duration<double, std::micro> first = std::chrono::steady_clock::now() - start;
+
+    // the same lookup again, with the pages already mapped
+    const int repeats = 10000;
+    start = std::chrono::steady_clock::now();
+    volatile std::size_t sink = 0;  // keeps the loop
+    for (int i = 0; i < repeats; ++i) sink = sink + file.Find(argv[2], time).size();
+    std::chrono::duration<double, std::micro> warm = std::chrono::steady_clock::now() - start;
+
+    if (found.empty()) std::cout << "No record of " << argv[2] << " at or before " << argv[3] << std::endl;
+    else std::cout << found << std::endl;
+    std::cout << "Lookup: " << first.count() << "us, then " << warm.count() / repeats << "us on average ("
+      << file.GetFileSize() << " bytes, " << file.GetEntryCount() << " index entries";
+    if (file.GetFrameCount() > 0) std::cout << ", " << file.GetFrameCount() << " frames";
+    std::cout << ")" << std::endl;
+  }
+  catch (std::exception& e) {
+    std::cout << "An error occurred: " << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,65 @@
+// Gabo Bernardino - cost of hashing, comparing and copying ids as std::string and as FixedString
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "tradingsystem/fixedstring.hpp"
+
+// Time `rounds` passes of `f` over the ids, in nanoseconds per id
+template <typename F>
+double NanosPerId(std::size_t ids, long rounds, F f) {
+  auto start = std::chrono::steady_clock::now();
+  for (long round = 0; round < rounds; ++round) f();
+  std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / (static_cast<double>(ids) * rounds);
+}
+
+// Hash, map lookup, equality and copy of every id, for one id type
+template <typename Id>
+void Measure(const char* name, const std::vector<std::string>& source, long rounds) {
+  std::vector<Id> ids(source.begin(), source.end());
+  std::vector<Id> probes(source.rbegin(), source.rend());  // same ids, other objects
+  std::unordered_map<Id, long> map;
+  for (std::size_t i = 0; i < ids.size(); ++i) map[ids[i]] = static_cast<long>(i);
+  std::vector<Id> copies(ids.size());
+
+  std::size_t sink = 0;
+  std::hash<Id> hasher;
+  double hash = NanosPerId(ids.size(), rounds, [&]() { for (const Id& id : probes) sink += hasher(id); });
+  double lookup = NanosPerId(ids.size(), rounds, [&]() { for (const Id& id : probes) sink += map.find(id)->second; });
+  double equal = NanosPerId(ids.size(), rounds, [&]() {
+    for (std::size_t i = 0; i < ids.size(); ++i) sink += (ids[i] == probes[ids.size() - 1 - i]);
+  });
+  double copy = NanosPerId(ids.size(), rounds, [&]() {
+    for (std::size_t i = 0; i < ids.size(); ++i) copies[i] = ids[i];
+    sink += copies.back() == ids.back();
+  });
+
+  std::cout << std::setw(16) << name << ": hash " << hash << "ns, lookup " << lookup << "ns, equality " << equal
+    << "ns, copy " << copy << "ns (" << sink % 10 << ")" << std::endl;
+}
+
+// Usage: IdBenchExe [ids] [rounds]
+// The ids look like the order ids of the system, e.g. US10Y57747FFC1234, longer than the small string buffer
+int main(int argc, char* argv[]) {
+  std::size_t count = (argc > 1) ? std::stoul(argv[1]) : 4096;
+  long rounds = (argc > 2) ? std::stol(argv[2]) : 2000;
+
+  std::vector<std::string> source;
+  for (std::size_t i = 0; i < count; ++i) {
+    char id[48];  // room for the largest size_t
+    std::snprintf(id, sizeof(id), "US10Y57747FFC%06zu", i);
+    source.push_back(id);
+  }
+
+  std::cout << std::fixed << std::setprecision(2);
+  std::cout << count << " ids, " << rounds << " rounds" << std::endl;
+  Measure<std::string>("std::string", source, rounds);
+  Measure<FixedString<32>>("FixedString<32>", source, rounds);
+
+  return 0;
+}
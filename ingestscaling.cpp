@@ -0,0 +1,53 @@
+// Gabo Bernardino - scaling of the chunked market data reader with the number of parsing threads
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include "tradingsystem/utils.hpp"
+#include "tradingsystem/Bond/BondMarketDataService.hpp"
+
+// Usage: IngestScalingExe [market data file] [megabytes to generate if the file does not exist]
+int main(int argc, char* argv[]) {
+  const char* filename = (argc > 1) ? argv[1] : "Data/scaling_mktdata.txt";
+  long megabytes = (argc > 2) ? std::stol(argv[2]) : 256;
+
+  if (!std::ifstream(filename)) {
+    // repeat the 7 bonds' books of 5 bids and 5 offers until the file is big enough
+    std::cout << "Generating " << megabytes << "MB of market data in " << filename << std::endl;
+    const char* cusips[] = { "91282CJL6", "91282CJK8", "91282CJN2", "91282CJM4", "91282CJJ1", "912810TW8", "912810TV0" };
+    std::ofstream out(filename);
+    long written = 0, row = 0;
+    while (written < megabytes * (1L << 20)) {
+      char line[64];
+      int level = row % 10;
+      bool bid = (level % 2 == 0);
+      int n = std::snprintf(line, sizeof(line), "%s,99-%02d%c,%d0000000,%s\n", cusips[(row / 10) % 7],
+        bid ? 15 - level / 2 : 16 + level / 2, "0123+567"[row % 8], level / 2 + 1, bid ? "BID" : "OFFER");
+      out.write(line, n);
+      written += n;
+      row++;
+    }
+  }
+
+  // lines are grouped into books like the connector does, but books are only counted
+  std::cout << std::fixed << std::setprecision(3);
+  double serial = 0.;
+  for (std::size_t threads : { 1, 2, 4, 8, 16 }) {
+    WorkStealingPool pool(threads);
+    ChunkedFileReader<MarketDataLine> reader(&pool);
+    long lines = 0, books = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    reader.Read(filename, false, BondMarketDataConnector::ParseLine,
+      [&](MarketDataLine& line) { if (++lines % 10 == 0) books++; });
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    if (threads == 1) serial = elapsed.count();
+    std::cout << threads << " threads: " << lines << " lines, " << books << " books in " << elapsed.count()
+      << "s, " << lines / elapsed.count() / 1e6 << "M lines/s, speedup " << serial / elapsed.count() << std::endl;
+  }
+
+  return 0;
+}
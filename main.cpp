@@ -1,7 +1,14 @@
 // Gabo Bernardino - main file for MTH9815 final project
 
+#include <array>
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <iomanip>
+#include <limits>
 #include "tradingsystem/Bond/BondPricingService.hpp"
 #include "tradingsystem/Bond/BondTradeBookingService.hpp"
 #include "tradingsystem/Bond/BondPositionService.hpp"
@@ -13,9 +20,68 @@
 #include "tradingsystem/Bond/BondExecutionService.hpp"
 #include "tradingsystem/Bond/BondStreamingService.hpp"
 #include "tradingsystem/Bond/BondInquiryService.hpp"
+#include "tradingsystem/Bond/BondQuotingEngine.hpp"
 #include "tradingsystem/Bond/BondHistoricalDataConnectors.hpp"
+#include "tradingsystem/Bond/BondMarketDataFeed.hpp"
+#include "tradingsystem/Bond/BondSnapshotService.hpp"
+#include "tradingsystem/Bond/BondShardedExecution.hpp"
+#include "tradingsystem/pipeline.hpp"
+#include "tradingsystem/flowscheduler.hpp"
+#include "tradingsystem/workstealingpool.hpp"
+#include "tradingsystem/timerwheel.hpp"
+#include "tradingsystem/uringwriter.hpp"
 
-int main() {
+// raised by Ctrl-C to end a live run (tail, feed or socket mode)
+std::atomic<bool> interrupted(false);
+
+// Run with `--tail` to follow the input files as they are written, until Ctrl-C,
+// with `--feed` to take prices and market data from the shared memory feed of `FeedPublisherExe`,
+// with `--socket` to take trades and inquiries from clients on Unix sockets (see `WireClientExe`),
+// with `--uring` to write the historical files from one I/O thread with io_uring,
+// with `--compress` to have that thread also compress them into frames (`positions.txt.lz`, ...),
+// with `--index` to write a sparse time index next to each historical file (see `HistoryLookupExe`),
+// with `--store` to also keep positions, risk, executions, streams and inquiries in an in-process columnar store,
+// holding the last `--store-retention=<minutes>` of each (60 by default, 0 keeps the whole run),
+// with `--journal` to journal the trades booked, synced by group commit every `--journal-window=<us>` (1000 by default, 0 syncs every trade),
+// with `--shards=<n>` to run the market data down the execution chains of n product shards instead of the shared services
+// (their executions, positions and risk stay in the shards, so not with `--journal`, `--snapshot` or `--restore`),
+// with `--conflate` to drop the price streams identical to the last one published for their product,
+// with `--conflate-window=<ms>` to publish only the latest price stream of each product every window instead,
+// with `--replay=<us>` to drive the timers (GUI refresh, conflation window, snapshots) by a replay clock moved <us> per price instead of the wall clock,
+// with `--snapshot` to also snapshot the state of the services,
+// and with `--restore` to start again from the last snapshot and the trades journaled after it
+int main(int argc, char* argv[]) {
+
+  bool tail = false, feed = false, sockets = false, uring = false, compress = false, index = false, store = false, journal = false, snapshots = false, restore = false;
+  long journal_window = 1000;  // microseconds
+  long store_retention = 60;  // minutes, 0 for the whole run
+  long shards = 0;
+  bool conflate = false;
+  long conflate_window = 0;  // milliseconds, 0 for no window
+  long replay_step = 0;  // microseconds of replayed time per price, 0 for the wall clock
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--tail") == 0) tail = true;
+    if (std::strcmp(argv[i], "--feed") == 0) feed = true;
+    if (std::strcmp(argv[i], "--socket") == 0) sockets = true;
+    if (std::strcmp(argv[i], "--uring") == 0) uring = true;
+    if (std::strcmp(argv[i], "--compress") == 0) uring = compress = true;
+    if (std::strcmp(argv[i], "--index") == 0) index = true;
+    if (std::strcmp(argv[i], "--store") == 0) store = true;
+    if (std::strncmp(argv[i], "--store-retention=", 18) == 0) store_retention = std::atol(argv[i] + 18);
+    if (std::strcmp(argv[i], "--journal") == 0) journal = true;
+    if (std::strncmp(argv[i], "--journal-window=", 17) == 0) journal_window = std::atol(argv[i] + 17);
+    if (std::strncmp(argv[i], "--shards=", 9) == 0) shards = std::atol(argv[i] + 9);
+    if (std::strcmp(argv[i], "--conflate") == 0) conflate = true;
+    if (std::strncmp(argv[i], "--conflate-window=", 18) == 0) conflate_window = std::atol(argv[i] + 18);
+    if (std::strncmp(argv[i], "--replay=", 9) == 0) replay_step = std::atol(argv[i] + 9);
+    if (std::strcmp(argv[i], "--snapshot") == 0) journal = snapshots = true;
+    if (std::strcmp(argv[i], "--restore") == 0) journal = snapshots = restore = true;
+  }
+  if (shards > 0 && journal) {
+    // the shards book their executions on their own services, which the journal and the snapshots never see
+    std::cout << "An error occurred: --shards cannot be combined with --journal, --snapshot or --restore; running without shards" << std::endl;
+    shards = 0;
+  }
 
   std::cout << std::fixed << std::setprecision(8);
 
@@ -25,7 +91,8 @@ int main() {
 
   std::cout << PrintTimeStamp() << " Creating services" << std::endl;
 
-  BondPricingService price_service;  // service receiving Price objects from `prices.txt`
+  // service receiving Price objects from `prices.txt`, statically wired to the GUI and algo streaming listeners
+  Pipeline<BondPricingService, BondGUIListener, BondAlgoStreamingListener> price_service;
   BondAlgoStreamingService algo_stream_service;  // service receiving Price objects from `price_service`
   BondStreamingService stream_service;  // service receiving PriceStreams from `algo_stream_service`
   BondGUIService gui_service(300);  // service publishing Price information from `price_Service`
@@ -45,17 +112,22 @@ int main() {
   BondInquiryService inquiry_service;  // service receiving Inquiry objects from `inquiries.txt`
   HistoricalDataService<Inquiry<Bond>> inquiry_historical_service;    // service receiving data to persist in `allinquiries.txt`
 
+  WorkStealingPool task_pool;  // shared by the connectors to parse their files in chunks
+  WallClock wall_clock;
+  ReplayClock replay_clock;  // moved by the prices with `--replay`
+  const Clock& timer_clock = (replay_step > 0) ? static_cast<const Clock&>(replay_clock) : wall_clock;
+  TimerService timer_service(timer_clock);  // throttles, heartbeats and timeouts, 1ms resolution
+  ReplayDriver<Price<Bond>> replay_driver(replay_clock, timer_service, std::chrono::microseconds(replay_step));
+
   std::cout << PrintTimeStamp() << " Services created" << std::endl;
 
   std::cout << PrintTimeStamp() << " Linking services" << std::endl;
 
   BondGUIListener gui_listener(&gui_service);  // listens to Price<Bond>
-  price_service.AddListener(&gui_listener);
-
   BondStreamingListener stream_listener(&stream_service);  // listens to AlgoStream<Bond>
   algo_stream_service.AddListener(&stream_listener);
   BondAlgoStreamingListener algo_stream_listener(&algo_stream_service);  // listens to Price<Bond>
-  price_service.AddListener(&algo_stream_listener);
+  price_service.SetStages(&gui_listener, &algo_stream_listener);  // compile-time wiring, no virtual hop
 
   HistoricalDataListener<PriceStream<Bond>> stream_hist_listener(&stream_historical_service);  // listens to PriceStream<Bond>
   stream_service.AddListener(&stream_hist_listener);
@@ -68,6 +140,17 @@ int main() {
   execution_service.AddListener(&trade_listener);
   BondExecutionListener execution_listener(&execution_service);  // listens to AlgoExecution<Bond>
   algo_service.AddListener(&execution_listener);
+  BondSmartOrderRouter router;  // splits execution orders across venues
+  execution_service.SetRouter(&router);
+  mkt_service.AddListener(&router);  // venues see each book before the algo trades on it
+  std::array<BondMatchingEngine, 3> venue_engines;  // per market: fill the children on the venue the router picked
+  for (const VenueParams& venue : BondSmartOrderRouter::DefaultVenues()) {
+    BondMatchingEngine& engine = venue_engines[venue.market];
+    engine.SetVenue(BondSmartOrderRouter::MarketName(venue.market), venue.share, venue.priceOffset);
+    trade_listener.SetVenueEngine(venue.market, &engine);
+    mkt_service.AddListener(&engine);  // the engines also see each book before the algo trades on it
+  }
+  router.SetSimulateFills(false);  // the engines fill the children: the router only prices them
   BondAlgoExecutionListener algo_listener(&algo_service);  // listens to OrderBook<Bond>
   mkt_service.AddListener(&algo_listener);
 
@@ -78,13 +161,26 @@ int main() {
   HistoricalDataListener<Position<Bond>> position_hist_listener(&position_history_service);
   pos_service.AddListener(&position_hist_listener);
 
-  BondInquiryListener inquiry_listener(&inquiry_service);  // listens to Inqury<Bond>
-  inquiry_service.AddListener(&inquiry_listener);
+  BondQuotingEngine quoting_engine(&inquiry_service);  // listens to Inqury<Bond>, quotes off the live mid and positions
+  inquiry_service.AddListener(&quoting_engine);
+  BondQuotingPriceListener quoting_price_listener(&quoting_engine);  // listens to Price<Bond>
+  price_service.AddListener(&quoting_price_listener);
+  BondQuotingPositionListener quoting_position_listener(&quoting_engine);  // listens to Position<Bond>
+  pos_service.AddListener(&quoting_position_listener);
   HistoricalDataListener<Inquiry<Bond>> inquiry_hist_listener(&inquiry_historical_service);
-  inquiry_service.AddListener(&inquiry_hist_listener);
+  inquiry_service.SetHistoricalListener(&inquiry_hist_listener);  // one batch of records per run of transitions
 
   std::cout << PrintTimeStamp() << " Services linked" << std::endl;
 
+  // each of the four flows below runs its connector on its own thread
+  FlowScheduler scheduler;
+  std::function<bool()> stopped = [&scheduler]() { return scheduler.StopRequested() || interrupted; };
+  if (tail || feed || sockets) std::signal(SIGINT, [](int) { interrupted = true; });
+
+  // each flow reading the feed has its own cursor on it
+  BondFeedReader price_feed(defaultFeedName, FeedMessage::PRICE);
+  BondFeedReader mkt_feed(defaultFeedName, FeedMessage::ORDER_BOOK);
+
   std::cout << "*************** Pricing and GUI Services ***************" << std::endl << std::endl;
   
   std::cout << PrintTimeStamp() << " Creating connector for price data" << std::endl;
@@ -97,7 +193,14 @@ int main() {
   gui_service.SetConnector(&gui_connector);
 
   BondPricingConnector price_connector(&price_service);
-  price_connector.Subscribe("Data/prices.txt", false);
+  price_connector.SetTaskPool(&task_pool);  // the file is parsed in chunks on the pool
+  std::atomic<bool> pricing_done(false);
+  scheduler.AddFlow("Pricing and GUI", [&]() {
+    if (feed) price_connector.SubscribeFeed(price_feed, stopped);
+    else if (tail) price_connector.Tail("Data/prices.txt", stopped, false);
+    else price_connector.Subscribe("Data/prices.txt", false);
+    pricing_done = true;
+  });
   std::cout << PrintTimeStamp() << " Created connector for price data" << std::endl;
 
   std::cout << "\n*************** Trade and Risk Services ***************" << endl << std::endl;
@@ -111,16 +214,33 @@ int main() {
   BondHistoricalRiskConnector risk_history_conn(&risk_service);
   risk_history_service.SetConnector(&risk_history_conn);
 
+  // trades evicted from the booking service's retention window are journaled
+  BondHistoricalTradeConnector trade_journal_conn;
+  trade_service.SetEvictionConnector(&trade_journal_conn);
+
   BondTradeBookingConnector trade_connector(&trade_service);
-  trade_connector.Subscribe("Data/trades.txt", false);
+  trade_connector.SetTaskPool(&task_pool);
+  scheduler.AddFlow("Trade and Risk", [&]() {
+    if (sockets) trade_connector.ServeSocket(defaultTradeSocket, stopped);
+    else if (tail) trade_connector.Tail("Data/trades.txt", stopped, false);
+    else trade_connector.Subscribe("Data/trades.txt", false);
+  });
   std::cout << PrintTimeStamp() << " Created connector for trade data" << std::endl;
 
   std::cout << "\n*************** Market Data and Algo Services ***************" << endl<< std::endl;
   
   std::cout << PrintTimeStamp() << " Creating connector for market data" << std::endl;
 
-  BondMarketDataConnector mkt_connector(&mkt_service);
-  mkt_connector.Subscribe("Data/toy_mktdata.txt", false);
+  // with shards, each product's books go down the chain of the shard owning it rather than thru `mkt_service`
+  std::unique_ptr<BondShardedMarketDataService> sharded_service;
+  if (shards > 0) sharded_service = std::make_unique<BondShardedMarketDataService>(static_cast<int>(shards));
+  BondMarketDataConnector mkt_connector(shards > 0 ? sharded_service.get() : &mkt_service);
+  mkt_connector.SetTaskPool(&task_pool);  // the file is parsed in chunks on the pool
+  scheduler.AddFlow("Market Data and Algo", [&]() {
+    if (feed) mkt_connector.SubscribeFeed(mkt_feed, stopped);
+    else if (tail) mkt_connector.Tail("Data/toy_mktdata.txt", stopped, false);
+    else mkt_connector.Subscribe("Data/toy_mktdata.txt", false);
+  });
   std::cout << PrintTimeStamp() << " Created connector for market data" << std::endl;
 
   std::cout << "\n*************** Inquiry Service ***************" << endl << std::endl;
@@ -131,13 +251,138 @@ int main() {
   inquiry_historical_service.SetConnector(&inquiry_history_conn);
 
   BondInquiryConnector inquiry_connector(&inquiry_service);
+  inquiry_connector.SetTaskPool(&task_pool);
   inquiry_service.SetConnector(&inquiry_connector);
-  inquiry_connector.Subscribe("Data/inquiries.txt", false);
-  std::cout << PrintTimeStamp() << " Created connector for market data" << std::endl;
+  scheduler.AddFlow("Inquiry", [&]() {
+    // inquiries are quoted off the price cached when they arrive: open quoting once every bond has one
+    long universe = static_cast<long>(PV_Map().size());
+    while (quoting_engine.GetPricedCount() < universe && !pricing_done && !stopped()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if (sockets) inquiry_connector.ServeSocket(defaultInquirySocket, stopped);
+    else if (tail) inquiry_connector.Tail("Data/inquiries.txt", stopped, false);
+    else inquiry_connector.Subscribe("Data/inquiries.txt", false);
+  });
+  std::cout << PrintTimeStamp() << " Created connector for inquiries" << std::endl;
+
+  // historical files are written by the I/O thread of the writer rather than by the flows
+  UringFileWriter history_writer;
+  if (uring) {
+    stream_history_conn.SetFileWriter(&history_writer, compress);
+    exec_history_conn.SetFileWriter(&history_writer, compress);
+    pos_history_conn.SetFileWriter(&history_writer, compress);
+    risk_history_conn.SetFileWriter(&history_writer, compress);
+    trade_journal_conn.SetFileWriter(&history_writer);  // read back like trades.txt
+    inquiry_history_conn.SetFileWriter(&history_writer, compress);
+    history_writer.Start();
+  }
+
+  // point-in-time lookups on the historical files go through their index rather than a scan
+  if (index) {
+    stream_history_conn.SetIndex(64);
+    exec_history_conn.SetIndex(64);
+    pos_history_conn.SetIndex(64);
+    risk_history_conn.SetIndex(64);
+    inquiry_history_conn.SetIndex(64);
+  }
+
+  // the historical records can also be queried in process, by product and time
+  BondHistoricalStore history_store(std::chrono::minutes(1), store_retention);
+  if (store) {
+    stream_history_conn.SetStore(&history_store);
+    exec_history_conn.SetStore(&history_store);
+    pos_history_conn.SetStore(&history_store);
+    risk_history_conn.SetStore(&history_store);
+    inquiry_history_conn.SetStore(&history_store);
+  }
+
+  // the journal holds every trade booked in the day, a snapshot a point in it
+  BondSnapshotService snapshot_service(&trade_service, &pos_service, &risk_service, &mkt_service, &inquiry_service);
+  std::unique_ptr<BondTradeJournal> trade_journal;
+  bool restored = false;
+  if (restore) {
+    try {
+      auto restore_start = std::chrono::steady_clock::now();
+      long replayed = snapshot_service.Restore("Data/booked_trades.txt");
+      std::chrono::duration<double, std::milli> restore_time = std::chrono::steady_clock::now() - restore_start;
+      std::cout << PrintTimeStamp() << " Restored the state and replayed " << replayed << " journaled trades in "
+        << restore_time.count() << "ms" << std::endl;
+      // trades received or executed before the restart are not booked again
+      trade_connector.SetResumePoint(trade_service.GetReceivedCount());
+      trade_listener.SetResumePoint(trade_service.GetBookedCount() - trade_service.GetReceivedCount());
+      restored = true;
+    }
+    catch (std::exception& e) {
+      std::cout << "An error occurred: " << e.what() << "; starting the day from scratch" << std::endl;
+    }
+  }
+  if (journal) {
+    // a new day starts a new journal, and the snapshots of the previous one no longer apply
+    if (!restored) std::remove("Data/state.snap");
+    trade_journal = std::make_unique<BondTradeJournal>("Data/booked_trades.txt", !restored,
+      std::chrono::microseconds(journal_window));
+    trade_service.SetJournal(trade_journal.get());
+  }
+
+  std::cout << "\n*************** Running flows ***************" << endl << std::endl;
+
+  if (replay_step > 0) price_service.AddListener(&replay_driver);  // each price fires the timers due
+  else timer_service.Start();
+  gui_service.Start(&timer_service);  // GUI refreshes every 300ms with the latest prices
+  if (conflate_window > 0) {
+    stream_service.SetConflation(StreamConflation::WINDOW, std::chrono::milliseconds(conflate_window), &timer_service);
+  }
+  else if (conflate) stream_service.SetConflation(StreamConflation::SUPPRESS_UNCHANGED);
+  if (snapshots) snapshot_service.Start(timer_service, std::chrono::milliseconds(100));
+  if (shards > 0) sharded_service->Start();
+  scheduler.Start();
+  scheduler.Join();
+  if (shards > 0) sharded_service->Stop();  // drains what the market data flow queued
+  if (journal) trade_service.SyncJournal();  // books the trades of the last window
+  if (snapshots) {
+    snapshot_service.Stop();
+    snapshot_service.TakeSnapshot();  // the next run starts from the end of this one
+  }
+  stream_service.Flush();  // publishes the streams held by the last window
+  history_writer.Stop();
+  gui_service.Stop();
+  timer_service.Stop();
 
   auto end = std::chrono::system_clock::now();
   chrono::duration<double> elapsed_time = end - start;
   std::cout << "\n\nTotal elapsed time: " << elapsed_time.count() << "s\n";
+  scheduler.Report(std::cout);
+  stream_service.Report(std::cout);
+  router.Report(std::cout);
+  for (const BondMatchingEngine& engine : venue_engines) engine.Report(std::cout);
+  inquiry_service.Report(std::cout);
+  quoting_engine.Report(std::cout);
+  if (uring) history_writer.Report(std::cout);
+  if (store) {
+    history_store.Report(std::cout);
+    // range of the bid streamed for a product over the run, straight from the columns
+    double low = std::numeric_limits<double>::max(), high = std::numeric_limits<double>::lowest();
+    std::size_t ticks = history_store.GetStreams().Scan("91282CJL6", 0, std::numeric_limits<std::int64_t>::max(),
+      [&low, &high](const TimeSeriesRow<6>& row) {
+        low = std::min(low, row.GetValue(BondHistoricalStore::STREAM_BID));
+        high = std::max(high, row.GetValue(BondHistoricalStore::STREAM_BID));
+      });
+    if (ticks > 0) std::cout << "Bids streamed for 91282CJL6: " << ticks << ", from " << PriceToString(low) << " to "
+      << PriceToString(high) << std::endl;
+  }
+  if (shards > 0) sharded_service->Report(std::cout);
+  if (journal) trade_journal->Report(std::cout);
+  if (snapshots) snapshot_service.Report(std::cout);
+  if (feed) {
+    price_feed.GetLatency().Report(std::cout, "Feed delivery latency, prices");
+    mkt_feed.GetLatency().Report(std::cout, "Feed delivery latency, order books");
+    std::cout << "Feed messages lost: " << price_feed.GetLostCount() << " by the pricing flow, "
+      << mkt_feed.GetLostCount() << " by the market data flow" << std::endl;
+  }
+  std::cout << "GUI prices received: " << gui_service.GetReceivedCount() << ", printed: " << gui_service.GetPublishedCount() << std::endl;
+
+  std::cout << "Object pool high-water marks: AlgoExecution " << algo_service.GetPool().GetHighWaterMark();
+  std::cout << ", ExecutionOrder " << execution_service.GetPool().GetHighWaterMark() << std::endl;
 
   return 0;
 }
@@ -0,0 +1,81 @@
+// Gabo Bernardino - orders per second thru the matching engine, with every order type and two sources
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <iomanip>
+#include "tradingsystem/utils.hpp"
+#include "tradingsystem/Bond/BondMatchingEngine.hpp"
+
+// Usage: MatchBenchExe [orders] [products]
+// Each product gets a new 5-level book every 8 orders; the orders cycle thru resting LIMITs, MARKET, IOC, FOK,
+// crossing LIMITs and STOPs, from two sources, so some of them meet resting orders of their own source
+int main(int argc, char* argv[]) {
+  long orders = (argc > 1) ? std::stol(argv[1]) : 1000000;
+  long products = (argc > 2) ? std::stol(argv[2]) : 64;
+
+  std::vector<Bond> bonds;
+  for (long i = 0; i < products; ++i) {
+    char cusip[32];
+    std::snprintf(cusip, sizeof(cusip), "MATCH%04ld", i);
+    bonds.push_back(Bond(cusip, CUSIP, "US10Y", 0.045f, boost::gregorian::from_string("2033/11/15")));
+  }
+  std::vector<OrderBook<Bond>> books;
+  for (const Bond& bond : bonds) {
+    std::vector<Order> bids, offers;
+    for (long level = 0; level < 5; ++level) {
+      bids.push_back(Order(100. - level / 256., (level + 1) * 1000000, BID));
+      offers.push_back(Order(100. + (level + 1) / 256., (level + 1) * 1000000, OFFER));
+    }
+    books.push_back(OrderBook<Bond>(bond, bids, offers));
+  }
+
+  // order type, side and price around the book, in 1/256ths from 100
+  struct Template {
+    OrderType type;
+    PricingSide side;
+    long ticks;
+  };
+  const Template templates[] = {
+    { LIMIT, BID, 3 },     // sell resting above the bid
+    { LIMIT, OFFER, -2 },  // buy resting below the offer
+    { MARKET, OFFER, 0 },
+    { IOC, BID, -1 },
+    { FOK, OFFER, 2 },
+    { LIMIT, OFFER, 3 },   // buy crossing the offers, and the resting sells
+    { STOP, BID, -1 },
+    { MARKET, BID, 0 }
+  };
+  const long n_templates = sizeof(templates) / sizeof(templates[0]);
+
+  std::vector<ExecutionOrder<Bond>> generated;
+  generated.reserve(orders);
+  for (long i = 0; i < orders; ++i) {
+    const Template& t = templates[i % n_templates];
+    char id[32];
+    std::snprintf(id, sizeof(id), "MB%09ld", i);
+    generated.push_back(ExecutionOrder<Bond>(bonds[(i / n_templates) % products], t.side, OrderId(id), t.type,
+      100. + t.ticks / 256., 1000000 * (1 + i % 3), 0, "", false));
+  }
+
+  BondMatchingEngine engine;
+  for (OrderBook<Bond>& book : books) engine.OnBook(book);
+
+  auto start = std::chrono::steady_clock::now();
+  long refreshes = 0;
+  for (long i = 0; i < orders; ++i) {
+    if (i % n_templates == 0) {
+      engine.OnBook(books[(i / n_templates) % products]);
+      refreshes++;
+    }
+    engine.Submit(generated[i], static_cast<int>((i / 3) % 2));
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  std::cout << std::fixed << std::setprecision(3);
+  std::cout << orders << " orders and " << refreshes << " books on " << products << " products in " << elapsed.count() << "s, "
+    << orders / elapsed.count() / 1e3 << "k orders/s" << std::endl;
+  engine.Report(std::cout);
+
+  return 0;
+}
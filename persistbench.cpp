@@ -0,0 +1,99 @@
+// Gabo Bernardino - cost of writing historical records: ofstream per record, write(2), buffered write(2) and io_uring
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "tradingsystem/latencystats.hpp"
+#include "tradingsystem/uringwriter.hpp"
+
+const int files = 5;  // as many as the historical connectors write
+
+std::string FileName(int i) {
+  return "Data/persist_bench_" + std::to_string(i) + ".txt";
+}
+
+// Time `write(record, file)` over every record, and the whole run including `finish`
+void Measure(const std::string& name, const std::vector<std::string>& records,
+  const std::function<void(const std::string&, int)>& write, const std::function<void()>& finish) {
+  for (int i = 0; i < files; ++i) std::remove(FileName(i).c_str());
+  LatencyStats latency;
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t r = 0; r < records.size(); ++r) {
+    auto before = std::chrono::steady_clock::now();
+    write(records[r], static_cast<int>(r % files));
+    latency.Record(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - before).count());
+  }
+  finish();
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  std::cout << name << ": " << records.size() / elapsed.count() / 1e3 << "k records/s" << std::endl;
+  latency.Report(std::cout, "  per record on the calling thread");
+  for (int i = 0; i < files; ++i) std::remove(FileName(i).c_str());
+}
+
+// Usage: PersistBenchExe [records]
+int main(int argc, char* argv[]) {
+  long n = (argc > 1) ? std::stol(argv[1]) : 200000;
+
+  // records shaped like the lines of positions.txt
+  std::vector<std::string> records;
+  for (long i = 0; i < n; ++i) {
+    char line[128];
+    int length = std::snprintf(line, sizeof(line), "2023-12-20 10:15:%02ld.%03ld,91282CJL6,TRSY1,%ld,TRSY2,%ld,TRSY3,%ld,AGGREGATE,%ld\n",
+      (i / 1000) % 60, i % 1000, i * 1000000, -i * 2000000, i * 3000000, i * 2000000);
+    records.emplace_back(line, length);
+  }
+  std::cout << std::fixed << std::setprecision(1);
+  std::cout << n << " records over " << files << " files" << std::endl;
+
+  Measure("ofstream opened for each record", records, [](const std::string& record, int file) {
+    std::ofstream out;
+    out.open(FileName(file), std::ios::app);
+    out << record;
+    out.close();
+  }, []() {});
+
+  std::vector<int> fds(files);
+  auto open_all = [&fds]() { for (int i = 0; i < files; ++i) fds[i] = open(FileName(i).c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644); };
+  auto close_all = [&fds]() { for (int fd : fds) close(fd); };
+
+  open_all();
+  Measure("write(2) for each record", records, [&fds](const std::string& record, int file) {
+    if (write(fds[file], record.data(), record.size()) < 0) std::perror("write");
+  }, close_all);
+
+  // 64KB per file in user space, written when full
+  std::vector<std::string> buffers(files);
+  open_all();
+  Measure("buffered write(2)", records, [&](const std::string& record, int file) {
+    buffers[file] += record;
+    if (buffers[file].size() >= (1 << 16)) {
+      if (write(fds[file], buffers[file].data(), buffers[file].size()) < 0) std::perror("write");
+      buffers[file].clear();
+    }
+  }, [&]() {
+    for (int i = 0; i < files; ++i) if (write(fds[i], buffers[i].data(), buffers[i].size()) < 0) std::perror("write");
+    close_all();
+  });
+
+  UringFileWriter writer;
+  std::vector<int> handles;
+  for (int i = 0; i < files; ++i) {
+    std::remove(FileName(i).c_str());
+    handles.push_back(writer.Open(FileName(i)));
+  }
+  writer.Start();
+  Measure("UringFileWriter", records, [&](const std::string& record, int file) {
+    writer.Append(handles[file], record);
+  }, [&writer]() { writer.Stop(); });
+  writer.Report(std::cout);
+
+  return 0;
+}
@@ -0,0 +1,87 @@
+// Gabo Bernardino - prices per second thru listeners added at run time and thru the compile-time Pipeline and StaticFanOut
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include "tradingsystem/utils.hpp"
+#include "tradingsystem/pipeline.hpp"
+#include "tradingsystem/Bond/BondPricingService.hpp"
+#include "tradingsystem/Bond/BondGUIService.hpp"
+#include "tradingsystem/Bond/BondAlgoStreamingService.hpp"
+#include "tradingsystem/Bond/BondStreamingService.hpp"
+
+// Stage doing next to nothing, so that the dispatch is most of the cost
+template <int I>
+class SumListener final : public ServiceListener<Price<Bond>> {
+public:
+  double sum = 0.;
+
+  virtual void ProcessAdd(Price<Bond>& data) override { sum += data.GetMid(); }
+  virtual void ProcessRemove(Price<Bond>& data) override {}
+  virtual void ProcessUpdate(Price<Bond>& data) override {}
+};
+
+// Feed the prices to a service `rounds` times, in nanoseconds per price
+double NanosPerPrice(Service<std::string, Price<Bond>>& service, std::vector<Price<Bond>>& prices, long rounds) {
+  auto start = std::chrono::steady_clock::now();
+  for (long round = 0; round < rounds; ++round) {
+    for (Price<Bond>& price : prices) service.OnMessage(price);
+  }
+  std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / (static_cast<double>(prices.size()) * rounds);
+}
+
+// Usage: PipelineBenchExe [rounds]
+// Each round sends a price of each of the 7 bonds; the trivial stages measure the dispatch alone,
+// the system's stages (GUI and algo streaming, down to the streaming service) what it weighs in the chain
+int main(int argc, char* argv[]) {
+  long rounds = (argc > 1) ? std::stol(argv[1]) : 200000;
+
+  std::vector<Price<Bond>> prices;
+  for (const char* cusip : { "91282CJL6", "91282CJK8", "91282CJN2", "91282CJM4", "91282CJJ1", "912810TW8", "912810TV0" }) {
+    prices.push_back(Price<Bond>(MakeBond(cusip), 99.5, 1. / 128));
+  }
+
+  // trivial stages, registered at run time, statically wired to the service, or behind one StaticFanOut
+  SumListener<0> sum0;
+  SumListener<1> sum1;
+  BondPricingService dynamic_service;
+  dynamic_service.AddListener(&sum0);
+  dynamic_service.AddListener(&sum1);
+  Pipeline<BondPricingService, SumListener<0>, SumListener<1>> static_service;
+  static_service.SetStages(&sum0, &sum1);
+  StaticFanOut<Price<Bond>, SumListener<0>, SumListener<1>> fan_out(&sum0, &sum1);
+  BondPricingService fan_out_service;
+  fan_out_service.AddListener(&fan_out);
+
+  // the system's stages, wired both ways
+  BondStreamingService stream_service;
+  BondAlgoStreamingService algo_stream_service;
+  BondStreamingListener stream_listener(&stream_service);
+  algo_stream_service.AddListener(&stream_listener);
+  BondGUIService gui_service(300);
+  BondGUIListener gui_listener(&gui_service);
+  BondAlgoStreamingListener algo_stream_listener(&algo_stream_service);
+  BondPricingService dynamic_chain;
+  dynamic_chain.AddListener(&gui_listener);
+  dynamic_chain.AddListener(&algo_stream_listener);
+  Pipeline<BondPricingService, BondGUIListener, BondAlgoStreamingListener> static_chain;
+  static_chain.SetStages(&gui_listener, &algo_stream_listener);
+
+  // the services log every step: silence the console so the measurement is of the dispatch, not of the log
+  std::cout.setstate(std::ios::badbit);
+  double dynamic_ns = NanosPerPrice(dynamic_service, prices, rounds);
+  double static_ns = NanosPerPrice(static_service, prices, rounds);
+  double fan_out_ns = NanosPerPrice(fan_out_service, prices, rounds);
+  double dynamic_chain_ns = NanosPerPrice(dynamic_chain, prices, rounds / 10);
+  double static_chain_ns = NanosPerPrice(static_chain, prices, rounds / 10);
+  std::cout.clear();
+
+  std::cout << std::fixed << std::setprecision(2);
+  std::cout << "Two trivial stages: AddListener " << dynamic_ns << "ns, Pipeline " << static_ns << "ns, StaticFanOut "
+    << fan_out_ns << "ns per price (" << (sum0.sum + sum1.sum > 0.) << ")" << std::endl;
+  std::cout << "GUI and algo streaming: AddListener " << dynamic_chain_ns << "ns, Pipeline " << static_chain_ns
+    << "ns per price" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,70 @@
+// Gabo Bernardino - inquiries per second thru the inquiry service, its connector and the quoting engine
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include "tradingsystem/Bond/BondRiskService.hpp"
+#include "tradingsystem/Bond/BondQuotingEngine.hpp"
+#include "tradingsystem/Bond/BondHistoricalDataConnectors.hpp"
+
+// Usage: QuoteBenchExe [inquiries] [--history | --uring]
+// `--history` also writes Data/allinquiries.txt (removed afterwards) with an ofstream, `--uring` thru the io_uring writer
+int main(int argc, char* argv[]) {
+  long inquiries = (argc > 1) ? std::stol(argv[1]) : 1000000;
+  bool history = (argc > 2), uring = (argc > 2 && std::strcmp(argv[2], "--uring") == 0);
+
+  BondInquiryService inquiry_service;
+  BondInquiryConnector inquiry_connector(&inquiry_service);
+  inquiry_service.SetConnector(&inquiry_connector);
+  BondQuotingEngine quoting_engine(&inquiry_service);
+  inquiry_service.AddListener(&quoting_engine);
+
+  HistoricalDataService<Inquiry<Bond>> inquiry_historical_service;
+  BondHistoricalInquiryConnector inquiry_history_conn;
+  inquiry_historical_service.SetConnector(&inquiry_history_conn);
+  HistoricalDataListener<Inquiry<Bond>> inquiry_hist_listener(&inquiry_historical_service);
+  UringFileWriter history_writer;
+  if (history) {
+    std::remove("Data/allinquiries.txt");
+    inquiry_service.SetHistoricalListener(&inquiry_hist_listener);
+  }
+  if (uring) {
+    inquiry_history_conn.SetFileWriter(&history_writer);
+    history_writer.Start();
+  }
+
+  // every bond has a price and a position before the inquiries come, so each one is quoted
+  const char* cusips[] = { "91282CJL6", "91282CJK8", "91282CJN2", "91282CJM4", "91282CJJ1", "912810TW8", "912810TV0" };
+  for (const char* cusip : cusips) {
+    Price<Bond> price(MakeBond(cusip), 99.5, 1. / 128);
+    quoting_engine.AddPrice(price);
+    quoting_engine.AddPosition(ProductId(cusip), 30000000);
+  }
+  std::vector<Inquiry<Bond>> received;
+  received.reserve(inquiries);
+  for (long i = 0; i < inquiries; ++i) {
+    char id[32];
+    std::snprintf(id, sizeof(id), "QB%09ld", i);
+    received.push_back(Inquiry<Bond>(InquiryId(id), MakeBond(cusips[i % 7]), (i % 2) ? SELL : BUY,
+      10000000L * (1 + i % 5), 0., RECEIVED));
+  }
+
+  // the services log every step: silence the console so the measurement is of the services, not of the log
+  std::cout.setstate(std::ios::badbit);
+  auto start = std::chrono::steady_clock::now();
+  for (Inquiry<Bond>& inquiry : received) inquiry_service.OnMessage(inquiry);
+  if (uring) history_writer.Stop();
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  std::cout.clear();
+
+  std::cout << std::fixed << std::setprecision(3);
+  std::cout << inquiries << " inquiries in " << elapsed.count() << "s, " << inquiries / elapsed.count() / 1e3
+    << "k inquiries/s" << (uring ? " (allinquiries thru io_uring)" : history ? " (allinquiries thru ofstream)" : "") << std::endl;
+  inquiry_service.Report(std::cout);
+  quoting_engine.Report(std::cout);
+  if (history) std::remove("Data/allinquiries.txt");
+
+  return 0;
+}
@@ -0,0 +1,56 @@
+// Gabo Bernardino - scaling of the sharded execution chain with the number of shards
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <iomanip>
+#include "tradingsystem/utils.hpp"
+#include "tradingsystem/Bond/BondShardedExecution.hpp"
+
+// Usage: ShardScalingExe [products] [books per product]
+int main(int argc, char* argv[]) {
+  long products = (argc > 1) ? std::stol(argv[1]) : 512;
+  long rounds = (argc > 2) ? std::stol(argv[2]) : 200;
+
+  // more products per shard than the 64 objects each pool starts with, and books crossed by 1/128th so the algo trades each one
+  std::vector<Bond> bonds;
+  for (long i = 0; i < products; ++i) {
+    char cusip[32];
+    std::snprintf(cusip, sizeof(cusip), "SHARD%04ld", i);
+    bonds.push_back(Bond(cusip, CUSIP, "US10Y", 0.045f, boost::gregorian::from_string("2033/11/15")));
+  }
+  std::vector<OrderBook<Bond>> books;
+  for (long round = 0; round < rounds; ++round) {
+    for (const Bond& bond : bonds) {
+      std::vector<Order> bids, offers;
+      for (long level = 0; level < 5; ++level) {
+        bids.push_back(Order(100. + 1. / 128 - level / 256., (level + 1) * 1000000, BID));
+        offers.push_back(Order(100. + level / 256., (level + 1) * 1000000, OFFER));
+      }
+      books.push_back(OrderBook<Bond>(bond, bids, offers));
+    }
+  }
+
+  // the services log every step: silence the console so the measurement is of the chain, not of the log
+
+  std::cout << std::fixed << std::setprecision(3);
+  double serial = 0.;
+  for (int shards : { 1, 2, 4, 8 }) {
+    BondShardedMarketDataService service(shards);
+    std::cout.setstate(std::ios::badbit);
+
+    auto start = std::chrono::steady_clock::now();
+    service.Start();
+    for (OrderBook<Bond>& book : books) service.OnMessage(book);
+    service.Stop();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::cout.clear();
+    if (shards == 1) serial = elapsed.count();
+    std::cout << shards << " shards: " << books.size() << " books of " << products << " products in " << elapsed.count()
+      << "s, " << books.size() / elapsed.count() / 1e3 << "k books/s, speedup " << serial / elapsed.count() << std::endl;
+    service.Report(std::cout);
+  }
+
+  return 0;
+}
@@ -0,0 +1,114 @@
+// Gabo Bernardino - no heap allocation per tick on the steady-state event paths
+
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include "check.hpp"
+#include "../tradingsystem/utils.hpp"
+#include "../tradingsystem/pipeline.hpp"
+#include "../tradingsystem/Bond/BondPricingService.hpp"
+#include "../tradingsystem/Bond/BondGUIService.hpp"
+#include "../tradingsystem/Bond/BondAlgoStreamingService.hpp"
+#include "../tradingsystem/Bond/BondStreamingService.hpp"
+#include "../tradingsystem/Bond/BondMarketDataService.hpp"
+#include "../tradingsystem/Bond/BondExecutionService.hpp"
+#include "../tradingsystem/Bond/BondPositionService.hpp"
+#include "../tradingsystem/Bond/BondRiskService.hpp"
+
+// every allocation of the program goes thru these
+std::atomic<long> allocations(0);
+
+void* operator new(std::size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = std::malloc(size == 0 ? 1 : size)) return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+  std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+  std::free(p);
+}
+
+// Allocations made by `ticks` calls of `tick`, after as many calls to warm the maps and pools up
+template <typename F>
+long AllocationsPerTicks(long ticks, F tick) {
+  for (long i = 0; i < ticks; ++i) tick(i);
+  long before = allocations.load();
+  for (long i = 0; i < ticks; ++i) tick(i);
+  return allocations.load() - before;
+}
+
+int main() {
+  const char* cusips[] = { "91282CJL6", "91282CJK8", "91282CJN2", "91282CJM4", "91282CJJ1", "912810TW8", "912810TV0" };
+
+  // price ticks: pricing, statically wired to the GUI and algo streaming, then streaming
+  Pipeline<BondPricingService, BondGUIListener, BondAlgoStreamingListener> price_service;
+  BondAlgoStreamingService algo_stream_service;
+  BondStreamingService stream_service;
+  BondGUIService gui_service(300);
+  BondStreamingListener stream_listener(&stream_service);
+  algo_stream_service.AddListener(&stream_listener);
+  BondGUIListener gui_listener(&gui_service);
+  BondAlgoStreamingListener algo_stream_listener(&algo_stream_service);
+  price_service.SetStages(&gui_listener, &algo_stream_listener);
+
+  std::vector<Price<Bond>> prices;
+  for (const char* cusip : cusips) prices.push_back(Price<Bond>(MakeBond(cusip), 99.5, 1. / 128));
+
+  // order book ticks: market data, algo execution, routing, matching, booking, positions and risk
+  BondMarketDataService mkt_service;
+  BondAlgoExecutionService algo_service;
+  BondExecutionService execution_service;
+  BondTradeBookingService trade_service;
+  BondPositionService pos_service;
+  BondRiskService risk_service;
+  BondRiskListener risk_listener(&risk_service);
+  pos_service.AddListener(&risk_listener);
+  BondPositionListener pos_listener(&pos_service);
+  trade_service.AddListener(&pos_listener);
+  BondTradeBookingListener trade_listener(&trade_service);
+  execution_service.AddListener(&trade_listener);
+  BondExecutionListener execution_listener(&execution_service);
+  algo_service.AddListener(&execution_listener);
+  BondSmartOrderRouter router;
+  execution_service.SetRouter(&router);
+  mkt_service.AddListener(&router);
+  std::array<BondMatchingEngine, 3> venue_engines;
+  for (const VenueParams& venue : BondSmartOrderRouter::DefaultVenues()) {
+    venue_engines[venue.market].SetVenue(BondSmartOrderRouter::MarketName(venue.market), venue.share, venue.priceOffset);
+    trade_listener.SetVenueEngine(venue.market, &venue_engines[venue.market]);
+    mkt_service.AddListener(&venue_engines[venue.market]);
+  }
+  router.SetSimulateFills(false);
+  BondAlgoExecutionListener algo_listener(&algo_service);
+  mkt_service.AddListener(&algo_listener);
+
+  // books crossed by 1/128th, so that the algo sends an order for each of them
+  std::vector<OrderBook<Bond>> books;
+  for (const char* cusip : cusips) {
+    std::vector<Order> bids, offers;
+    for (long level = 0; level < 5; ++level) {
+      bids.push_back(Order(100. + 1. / 128 - level / 256., (level + 1) * 1000000, BID));
+      offers.push_back(Order(100. + level / 256., (level + 1) * 1000000, OFFER));
+    }
+    books.push_back(OrderBook<Bond>(MakeBond(cusip), bids, offers));
+  }
+
+  // the services log every step: what the console does is not the services' business
+  std::cout.setstate(std::ios::badbit);
+  long price_allocations = AllocationsPerTicks(7000, [&](long i) { price_service.OnMessage(prices[i % 7]); });
+  long book_allocations = AllocationsPerTicks(7000, [&](long i) { mkt_service.OnMessage(books[i % 7]); });
+  std::cout.clear();
+
+  Check(price_allocations == 0, "no allocation for 7000 price ticks, found " + std::to_string(price_allocations));
+  Check(book_allocations == 0, "no allocation for 7000 order book ticks, found " + std::to_string(book_allocations));
+  long matched = 0;
+  for (const BondMatchingEngine& engine : venue_engines) matched += engine.GetMatchLatency().GetCount();
+  Check(matched > 0, "the order book ticks reach the matching engines");
+
+  return Checked("allocation_test");
+}
@@ -0,0 +1,40 @@
+/**
+* check.hpp
+*
+* Minimal checks for the test programs in tests/: each failed check is printed,
+* and Checked() reports the count and gives the exit code
+*
+* @author: Gabo Bernardino
+*/
+
+#ifndef CHECK_HPP
+#define CHECK_HPP
+
+#include <iostream>
+#include <string>
+
+struct CheckCounts {
+  long run = 0;
+  long failed = 0;
+};
+
+CheckCounts& Checks() {
+  static CheckCounts counts;
+  return counts;
+}
+
+// Record a check; `what` says what was expected
+void Check(bool condition, const std::string& what) {
+  Checks().run++;
+  if (condition) return;
+  Checks().failed++;
+  std::cout << "FAILED: " << what << std::endl;
+}
+
+// Print the counts of a test program - returns its exit code
+int Checked(const std::string& name) {
+  std::cout << name << ": " << Checks().run - Checks().failed << "/" << Checks().run << " checks passed" << std::endl;
+  return (Checks().failed == 0) ? 0 : 1;
+}
+
+#endif // !CHECK_HPP
@@ -0,0 +1,83 @@
+// Gabo Bernardino - file tailer: a late file, partial lines, rotation and truncation
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "check.hpp"
+#include "../tradingsystem/filetailer.hpp"
+
+std::mutex linesMutex;
+std::vector<std::string> lines;
+
+// Wait until `count` lines have been handed over, for at most 5s
+bool WaitForLines(std::size_t count) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (std::chrono::steady_clock::now() < deadline) {
+    {
+      std::lock_guard<std::mutex> lock(linesMutex);
+      if (lines.size() >= count) return true;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return false;
+}
+
+// Lines handed over so far
+std::vector<std::string> Lines() {
+  std::lock_guard<std::mutex> lock(linesMutex);
+  return lines;
+}
+
+// Append to a file, flushed when it returns
+void Append(const std::string& path, const std::string& data) {
+  std::ofstream(path, std::ios::binary | std::ios::app) << data;
+}
+
+int main() {
+  const std::string path = "tests/filetailer_test" + std::to_string(getpid()) + ".txt";
+  const std::string rotated = path + ".new";
+  std::remove(path.c_str());
+  std::remove(rotated.c_str());
+
+  FileTailer tailer(path, std::chrono::milliseconds(5));
+  std::atomic<bool> done(false);
+  std::thread reader([&]() {
+    tailer.Run([](const char* begin, const char* end) {
+      std::lock_guard<std::mutex> lock(linesMutex);
+      lines.emplace_back(begin, end);
+    }, [&done]() { return done.load(); }, true);
+  });
+
+  // the file appears after the tailer started, its header skipped and its last line unfinished
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  Append(path, "header\nfirst\r\nsecond\nthi");
+  Check(WaitForLines(2), "the lines of a file created late are handed over");
+  std::this_thread::sleep_for(std::chrono::milliseconds(30));
+  Check(Lines() == std::vector<std::string>({ "first", "second" }), "the header and the unfinished line are held back");
+  Append(path, "rd\n");
+  Check(WaitForLines(3) && Lines().back() == "third", "a line written in two parts is handed over whole");
+
+  // rotation: the last lines of the old file come before those of the new one
+  Append(rotated, "header\nnew1\nnew2\n");
+  Append(path, "old-last\n");
+  std::rename(rotated.c_str(), path.c_str());
+  Check(WaitForLines(6), "the lines of the file rotated to are handed over");
+  Check(Lines() == std::vector<std::string>({ "first", "second", "third", "old-last", "new1", "new2" }),
+    "the rest of the old file is read before the new file, whose header is skipped");
+
+  // truncation in place: the file is read again from its start
+  std::ofstream(path, std::ios::binary | std::ios::trunc) << "h\nt1\n";
+  Check(WaitForLines(7) && Lines().back() == "t1", "a truncated file is read again from its start, past its header");
+
+  done = true;
+  reader.join();
+  std::remove(path.c_str());
+  Check(tailer.GetLineCount() == 7 && tailer.GetRotationCount() == 2, "7 lines over a rotation and a truncation");
+
+  return Checked("filetailer_test");
+}
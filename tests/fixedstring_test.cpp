@@ -0,0 +1,66 @@
+// Gabo Bernardino - FixedString: capacity errors, hashing, equality and order
+
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include "check.hpp"
+#include "../tradingsystem/utils.hpp"
+#include "../tradingsystem/fixedstring.hpp"
+#include "../tradingsystem/executionservice.hpp"
+
+int main() {
+  // content, size and hash
+  FixedString<15> cusip("91282CJL6");
+  Check(std::string(cusip) == "91282CJL6" && cusip.size() == 9, "a FixedString keeps its characters");
+  Check(cusip == FixedString<15>(std::string("91282CJL6")), "equal content compares equal");
+  Check(cusip.GetHash() == FixedString<15>("91282CJL6").GetHash(), "equal content hashes equal");
+  Check(cusip != FixedString<15>("91282CJL7"), "different content compares different");
+
+  // a string built in pieces hashes as the same string built at once
+  FixedString<32> built("US10Y");
+  built.Append("57747FFC").AppendNumber(-42);
+  Check(built == FixedString<32>("US10Y57747FFC-42"), "Append and AppendNumber build the same string");
+  Check(built.GetHash() == FixedString<32>("US10Y57747FFC-42").GetHash(), "the hash is continued by Append");
+
+  // filled to capacity, then past it
+  FixedString<8> full("12345678");
+  Check(full.size() == 8, "a string can hold exactly its capacity");
+  bool threw = false;
+  try {
+    full.Append("9");
+  }
+  catch (std::length_error&) {
+    threw = true;
+  }
+  Check(threw, "Append past the capacity throws std::length_error");
+  Check(full == FixedString<8>("12345678"), "a failed Append leaves the string unchanged");
+
+  threw = false;
+  try {
+    FixedString<4> cut("TRSY1");
+  }
+  catch (std::length_error&) {
+    threw = true;
+  }
+  Check(threw, "constructing from a string too long throws");
+
+  FixedString<4> book;
+  Check(!book.TryAppend("TRSY1", 5) && book.empty(), "TryAppend refuses a string too long and leaves it unchanged");
+  Check(book.TryAppend("TRSY", 4) && book == FixedString<4>("TRSY"), "TryAppend takes a string that fits");
+
+  // the longest order id generated: child of a sharded parent with the largest counter
+  OrderId child("US30Y");
+  child.Append("57747FFCS99-").AppendNumber(9223372036854775807L).Append("-").Append("BROKERTEC");
+  Check(child.size() <= OrderId::capacity(), "the longest child order id fits an OrderId");
+
+  // ordering and use as a key
+  std::set<FixedString<15>> ordered{ "91282CJN2", "91282CJK8", "91282CJL6" };
+  Check(std::string(*ordered.begin()) == "91282CJK8", "operator< is the lexicographic order");
+  std::unordered_map<FixedString<15>, int> map;
+  map["91282CJL6"] = 1;
+  map["91282CJK8"] = 2;
+  Check(map.at(cusip) == 1 && map.at("91282CJK8") == 2, "FixedString keys an unordered_map");
+
+  return Checked("fixedstring_test");
+}
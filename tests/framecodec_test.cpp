@@ -0,0 +1,70 @@
+// Gabo Bernardino - compressed frames: random round trips, checksums and damaged blocks
+
+#include <cstdio>
+#include <fcntl.h>
+#include <random>
+#include <string>
+#include <unistd.h>
+#include "check.hpp"
+#include "../tradingsystem/framecodec.hpp"
+
+// Random content of one of three kinds: noise, a small alphabet, or text repeating itself
+std::string RandomContent(std::mt19937& g, std::size_t length, int kind) {
+  std::string s(length, '\0');
+  for (std::size_t i = 0; i < length; ++i) {
+    if (kind == 0) s[i] = static_cast<char>(g());
+    else if (kind == 1) s[i] = "ab,\n0123"[g() % 8];
+    else s[i] = (i > 100 && g() % 10) ? s[i - 1 - g() % 100] : static_cast<char>(g());
+  }
+  return s;
+}
+
+int main() {
+  std::mt19937 g(1);
+
+  // round trips, from empty to past the 64KB window of the matches
+  long bad = 0;
+  for (int t = 0; t < 600; ++t) {
+    std::string content = RandomContent(g, g() % 70000, t % 3);
+    std::string frame;
+    FrameCompress(content.data(), content.size(), 7, frame);
+    std::uint32_t raw, block;
+    std::uint64_t offset;
+    std::string back;
+    if (!FrameHeader(frame.data(), raw, block, offset) || frame.size() != frameHeaderSize + block || offset != 7
+      || !FrameIntact(frame.data(), block) || !FrameDecode(frame.data() + frameHeaderSize, block, raw, back) || back != content) bad++;
+  }
+  Check(bad == 0, "600 random contents come back from their frame, failures " + std::to_string(bad));
+
+  // a damaged frame fails its checksum, and decoding it never reads or writes out of bounds
+  long undetected = 0;
+  for (int t = 0; t < 2000; ++t) {
+    std::string content = RandomContent(g, g() % 5000, 2);
+    std::string frame;
+    FrameCompress(content.data(), content.size(), 0, frame);
+    std::size_t block = frame.size() - frameHeaderSize;
+    std::size_t at = 4 + g() % (frame.size() - 4);  // anywhere past the magic
+    frame[at] = static_cast<char>(frame[at] ^ (1 + g() % 255));
+    if (FrameIntact(frame.data(), block)) undetected++;
+    std::string back;
+    FrameDecode(frame.data() + frameHeaderSize, block, content.size() + g() % 3 - 1, back);
+  }
+  Check(undetected == 0, "every damaged byte fails the checksum, undetected " + std::to_string(undetected));
+
+  // a file whose last frame was torn by a crash: the scan stops at the last whole frame
+  const char* path = "tests/framecodec_test.lz";
+  std::string file, first = RandomContent(g, 3000, 1), second = RandomContent(g, 3000, 1);
+  FrameCompress(first.data(), first.size(), 0, file);
+  std::size_t whole = file.size();
+  FrameCompress(second.data(), second.size(), first.size(), file);
+  file[whole + frameHeaderSize + 10] ^= 0x5A;  // a hole in the middle of the second block
+  int fd = open(path, O_CREAT | O_TRUNC | O_RDWR, 0644);
+  Check(fd >= 0 && write(fd, file.data(), file.size()) == static_cast<ssize_t>(file.size()), "the test file is written");
+  std::uint64_t valid = 0;
+  std::uint64_t raw = FrameScan(fd, valid);
+  close(fd);
+  std::remove(path);
+  Check(valid == whole && raw == first.size(), "the scan keeps the frames before the damaged one");
+
+  return Checked("framecodec_test");
+}
@@ -0,0 +1,73 @@
+// Gabo Bernardino - inquiry state machine: arrivals, refused transitions and the historical batch
+
+#include <sstream>
+#include <string>
+#include <vector>
+#include "check.hpp"
+#include "../tradingsystem/utils.hpp"
+#include "../tradingsystem/Bond/BondInquiryService.hpp"
+
+// Keeps the batches it is given
+class CapturingConnector : public BatchConnector<Inquiry<Bond>> {
+public:
+  std::vector<Inquiry<Bond>> published;
+  std::vector<std::chrono::system_clock::time_point> times;
+
+  virtual void Subscribe(const char* filename, const bool& header = false) override {}
+  virtual void Publish(Inquiry<Bond>& data) override { published.push_back(data); }
+  virtual void PublishBatch(std::vector<Inquiry<Bond>>& data, const std::vector<std::chrono::system_clock::time_point>& batch_times) override {
+    published.insert(published.end(), data.begin(), data.end());
+    times.insert(times.end(), batch_times.begin(), batch_times.end());
+  }
+};
+
+int main() {
+  BondInquiryService service;
+  BondInquiryConnector connector(&service);
+  service.SetConnector(&connector);
+  HistoricalDataService<Inquiry<Bond>> historical_service;
+  CapturingConnector history;
+  historical_service.SetConnector(&history);
+  HistoricalDataListener<Inquiry<Bond>> historical_listener(&historical_service);
+  service.SetHistoricalListener(&historical_listener);
+
+  const Bond& bond = MakeBond("91282CJL6");
+  Inquiry<Bond> first("INQ1", bond, BUY, 1000000, 99.5, RECEIVED);
+  Inquiry<Bond> second("INQ2", bond, SELL, 2000000, 99.25, RECEIVED);
+
+  std::cout.setstate(std::ios::badbit);  // the service narrates every step
+  service.OnMessage(first);
+  service.OnMessage(second);
+
+  // the same inquiry arriving again, or a new one arriving past RECEIVED, is refused
+  Inquiry<Bond> again("INQ1", bond, SELL, 5000000, 101., RECEIVED);
+  service.OnMessage(again);
+  Inquiry<Bond> late("INQ3", bond, BUY, 1000000, 99.5, DONE);
+  service.OnMessage(late);
+
+  // a quote is taken by the client thru the connector; a second quote is not allowed
+  service.SendQuote("INQ1", 99.75);
+  service.SendQuote("INQ1", 99.8);
+  service.RejectInquiry("INQ2");
+  std::cout.clear();
+
+  const Inquiry<Bond>& stored = service.GetData("INQ1");
+  Check(stored.GetSide() == BUY && stored.GetQuantity() == 1000000, "an arrival does not overwrite the stored inquiry");
+  Check(stored.GetState() == DONE && stored.GetPrice() == 99.75, "the quote moves the inquiry to QUOTED, then the client to DONE");
+  Check(service.GetData("INQ2").GetState() == REJECTED, "a rejection moves a received inquiry to REJECTED");
+
+  std::ostringstream report;
+  service.Report(report);
+  Check(report.str().find("3 refused by the state machine") != std::string::npos,
+    "the repeated arrival, the late arrival and the second quote are refused: " + report.str());
+
+  // RECEIVED, RECEIVED, QUOTED, DONE and REJECTED, each with its own time
+  Check(history.published.size() == 5 && history.times.size() == 5, "every applied transition reaches the historical connector");
+  bool ordered = true;
+  for (std::size_t i = 1; i < history.times.size(); ++i) ordered = ordered && history.times[i - 1] <= history.times[i];
+  Check(ordered, "the transitions are stamped in the order they are applied");
+  Check(historical_service.GetData("INQ1").GetState() == DONE && historical_service.GetData("INQ2").GetState() == REJECTED,
+    "the historical data keeps each inquiry of a product under its own id");
+
+  return Checked("inquiry_test");
+}
@@ -0,0 +1,97 @@
+// Gabo Bernardino - trade journal: failed commits are never counted durable and are written again whole
+
+#include <csignal>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include "check.hpp"
+#include "../tradingsystem/utils.hpp"
+#include "../tradingsystem/Bond/BondTradeBookingService.hpp"
+
+// A trade of 1M with its own id
+Trade<Bond> MakeTrade(long n) {
+  return Trade<Bond>(MakeBond("91282CJL6"), TradeId(("JT" + std::to_string(n)).c_str()), 99.5, BookId("TRSY1"), 1000000, BUY);
+}
+
+// Let the process write files up to `bytes` only: past it, writes fail with EFBIG
+void LimitFileSize(rlim_t bytes) {
+  struct rlimit limit;
+  getrlimit(RLIMIT_FSIZE, &limit);
+  limit.rlim_cur = bytes;
+  setrlimit(RLIMIT_FSIZE, &limit);
+}
+
+// Ids of the trades in a journal, in order
+std::vector<std::string> Journaled(const std::string& path) {
+  std::vector<std::string> ids;
+  BondTradeJournal::Replay(path, 0, BondTradeBookingConnector::ParseLine,
+    [&ids](Trade<Bond>& trade, bool received) { ids.push_back(trade.GetTradeId().c_str()); });
+  return ids;
+}
+
+std::int64_t FileSize(const std::string& path) {
+  struct stat info;
+  return (stat(path.c_str(), &info) == 0) ? info.st_size : -1;
+}
+
+int main() {
+  std::signal(SIGXFSZ, SIG_IGN);  // a write past the limit fails instead of killing the process
+  struct rlimit unlimited;
+  getrlimit(RLIMIT_FSIZE, &unlimited);
+  const std::string path = "tests/journal_test" + std::to_string(getpid()) + ".txt";
+
+  {
+    // group commit: a failed batch stays pending, and is written whole by the next commit
+    BondTradeJournal journal(path, true, std::chrono::seconds(30));  // committed by Sync only
+    for (long n = 1; n <= 3; ++n) journal.Append(MakeTrade(n), true);
+    journal.Sync();
+    std::int64_t offset = journal.GetDurableOffset();
+    Check(journal.GetDurableCount() == 3 && offset == FileSize(path), "three trades are synced");
+
+    LimitFileSize(offset + 10);  // the next batch is cut 10 bytes in
+    journal.Append(MakeTrade(4), true);
+    journal.Append(MakeTrade(5), false);
+    bool threw = false;
+    try {
+      journal.Sync();
+    }
+    catch (std::runtime_error& e) {
+      threw = true;
+    }
+    Check(threw && journal.GetDurableCount() == 3 && journal.GetDurableOffset() == offset,
+      "a failed commit leaves the durable count and offset where they were");
+    Check(FileSize(path) == offset + 10, "the failed commit wrote part of its lines");
+
+    setrlimit(RLIMIT_FSIZE, &unlimited);
+    journal.Append(MakeTrade(6), true);
+    journal.Sync();
+    Check(journal.GetDurableCount() == 6 && journal.GetEntryCount() == 6 && journal.GetDurableOffset() == FileSize(path),
+      "the next commit makes the failed batch and the new trade durable");
+  }
+  Check(Journaled(path) == std::vector<std::string>({ "JT1", "JT2", "JT3", "JT4", "JT5", "JT6" }),
+    "the journal holds every trade once, in order, without the cut lines");
+
+  {
+    // zero window: the failing Append takes its trade back
+    BondTradeJournal journal(path, true, std::chrono::microseconds(0));
+    journal.Append(MakeTrade(1), true);
+    LimitFileSize(journal.GetDurableOffset() + 10);
+    bool threw = false;
+    try {
+      journal.Append(MakeTrade(2), true);
+    }
+    catch (std::runtime_error& e) {
+      threw = true;
+    }
+    Check(threw && journal.GetEntryCount() == 1 && journal.GetDurableCount() == 1, "a failed Append is not counted");
+    setrlimit(RLIMIT_FSIZE, &unlimited);
+    Check(journal.Append(MakeTrade(3), true) == 2 && journal.GetDurableCount() == 2, "the next Append takes the next entry");
+  }
+  Check(Journaled(path) == std::vector<std::string>({ "JT1", "JT3" }), "the trade of the failed Append is not in the journal");
+
+  std::remove(path.c_str());
+  return Checked("journal_test");
+}
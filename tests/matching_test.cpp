@@ -0,0 +1,136 @@
+// Gabo Bernardino - matching engine: fills and leaves of each order type, uncross, stops and self-trade prevention
+
+#include <string>
+#include <vector>
+#include "check.hpp"
+#include "../tradingsystem/utils.hpp"
+#include "../tradingsystem/Bond/BondMatchingEngine.hpp"
+
+const double tick = 1. / 256.;
+
+// Keeps the fills it is given
+class FillRecorder : public ServiceListener<Fill<Bond>> {
+public:
+  std::vector<Fill<Bond>> fills;
+
+  virtual void ProcessAdd(Fill<Bond>& data) override { fills.push_back(data); }
+  virtual void ProcessRemove(Fill<Bond>& data) override {}
+  virtual void ProcessUpdate(Fill<Bond>& data) override {}
+
+  // The fills recorded since the last call
+  std::vector<Fill<Bond>> Take() {
+    std::vector<Fill<Bond>> taken;
+    taken.swap(fills);
+    return taken;
+  }
+};
+
+// Whether a fill is of `id` for `quantity` at `price`, leaving `leaves`
+bool IsFill(const Fill<Bond>& fill, const std::string& id, double price, long quantity, long leaves) {
+  return fill.GetOrderId() == OrderId(id) && fill.GetPrice() == price && fill.GetQuantity() == quantity && fill.GetLeaves() == leaves;
+}
+
+// Bids of 1M at 99-24 and 2M a tick below, offers of 1M at 100 and 2M a tick above, unless given
+OrderBook<Bond> MakeBook(const Bond& bond, std::vector<Order> bids = {}, std::vector<Order> offers = {}) {
+  if (bids.empty()) bids = { Order(99.75, 1000000, BID), Order(99.75 - tick, 2000000, BID) };
+  if (offers.empty()) offers = { Order(100., 1000000, OFFER), Order(100. + tick, 2000000, OFFER) };
+  return OrderBook<Bond>(bond, bids, offers);
+}
+
+// An order: side BID sells into the bids, side OFFER buys from the offers
+ExecutionOrder<Bond> MakeOrder(const Bond& bond, const std::string& id, PricingSide side, OrderType type, double price, long quantity) {
+  return ExecutionOrder<Bond>(bond, side, OrderId(id), type, price, quantity, 0, OrderId(""), false);
+}
+
+int main() {
+  BondMatchingEngine engine;
+  FillRecorder recorder;
+  engine.AddListener(&recorder);
+  std::vector<Fill<Bond>> fills;
+
+  // MARKET: walks the book, partial fills leaving the rest, and what the book cannot fill is cancelled
+  const Bond& market_bond = MakeBond("91282CJL6");
+  OrderBook<Bond> market_book = MakeBook(market_bond);
+  engine.OnBook(market_book);
+  long filled = engine.Submit(MakeOrder(market_bond, "MKT1", OFFER, MARKET, 0., 2500000));
+  fills = recorder.Take();
+  Check(filled == 2500000 && fills.size() == 2 && IsFill(fills[0], "MKT1", 100., 1000000, 1500000)
+    && IsFill(fills[1], "MKT1", 100. + tick, 1500000, 0), "a MARKET buy takes the best offer, then the next level");
+  filled = engine.Submit(MakeOrder(market_bond, "MKT2", OFFER, MARKET, 0., 2000000));
+  fills = recorder.Take();
+  Check(filled == 500000 && fills.size() == 1 && IsFill(fills[0], "MKT2", 100. + tick, 500000, 1500000),
+    "a MARKET buy larger than the book fills what is left and leaves the rest");
+  Check(engine.Submit(MakeOrder(market_bond, "MKT3", OFFER, MARKET, 0., 1000000)) == 0 && recorder.Take().empty(),
+    "the rest of a MARKET order does not rest: an empty side fills nothing");
+
+  // FOK: all or nothing at its price or better
+  const Bond& fok_bond = MakeBond("91282CJK8");
+  OrderBook<Bond> fok_book = MakeBook(fok_bond);
+  engine.OnBook(fok_book);
+  Check(engine.Submit(MakeOrder(fok_bond, "FOK1", OFFER, FOK, 100., 2000000)) == 0 && recorder.Take().empty(),
+    "a FOK for more than there is at its price is killed");
+  Check(engine.Submit(MakeOrder(fok_bond, "FOK2", OFFER, FOK, 100. + tick, 4000000)) == 0 && recorder.Take().empty(),
+    "a FOK for more than the whole book within its price is killed");
+  filled = engine.Submit(MakeOrder(fok_bond, "FOK3", OFFER, FOK, 100. + tick, 3000000));
+  fills = recorder.Take();
+  Check(filled == 3000000 && fills.size() == 2 && IsFill(fills[1], "FOK3", 100. + tick, 2000000, 0),
+    "a FOK the book can fill within its price fills in full");
+
+  // IOC: fills at its price or better, the rest is cancelled rather than resting
+  const Bond& ioc_bond = MakeBond("91282CJN2");
+  OrderBook<Bond> ioc_book = MakeBook(ioc_bond);
+  engine.OnBook(ioc_book);
+  filled = engine.Submit(MakeOrder(ioc_bond, "IOC1", BID, IOC, 99.75, 2500000));
+  fills = recorder.Take();
+  Check(filled == 1000000 && fills.size() == 1 && IsFill(fills[0], "IOC1", 99.75, 1000000, 1500000),
+    "an IOC sell hits the bids at its price and no lower");
+  OrderBook<Bond> higher_bids = MakeBook(ioc_bond, { Order(99.75 + tick, 1000000, BID) });
+  engine.OnBook(higher_bids);
+  Check(recorder.Take().empty(), "the leftover of an IOC is not on the book to trade with a new bid");
+
+  // LIMIT: rests what it cannot fill, and trades when a later book crosses it
+  const Bond& limit_bond = MakeBond("91282CJM4");
+  OrderBook<Bond> limit_book = MakeBook(limit_bond);
+  engine.OnBook(limit_book);
+  Check(engine.Submit(MakeOrder(limit_bond, "LMT1", OFFER, LIMIT, 100. - 2 * tick, 2000000)) == 0 && recorder.Take().empty(),
+    "a LIMIT buy below the offers does not trade");
+  OrderBook<Bond> crossing = MakeBook(limit_bond, {}, { Order(100. - 3 * tick, 500000, OFFER), Order(100. - 2 * tick, 1000000, OFFER) });
+  engine.OnBook(crossing);
+  fills = recorder.Take();
+  Check(fills.size() == 2 && IsFill(fills[0], "LMT1", 100. - 3 * tick, 500000, 1500000) && IsFill(fills[1], "LMT1", 100. - 2 * tick, 1000000, 500000),
+    "a new book crossing the resting buy fills it at the book's prices, best first");
+  filled = engine.Submit(MakeOrder(limit_bond, "SELL1", BID, MARKET, 0., 700000), 1);
+  fills = recorder.Take();
+  Check(filled == 700000 && fills.size() == 3 && IsFill(fills[0], "LMT1", 100. - 2 * tick, 500000, 0)
+    && IsFill(fills[1], "SELL1", 100. - 2 * tick, 500000, 200000) && IsFill(fills[2], "SELL1", 99.75, 200000, 0),
+    "the rest of the resting buy is first in line for a sell, ahead of the worse bids of the book");
+
+  // STOP: waits until the offer reaches its price, then buys at the market
+  const Bond& stop_bond = MakeBond("91282CJJ1");
+  OrderBook<Bond> stop_book = MakeBook(stop_bond);
+  engine.OnBook(stop_book);
+  Check(engine.Submit(MakeOrder(stop_bond, "STP1", OFFER, STOP, 100. + 2 * tick, 1500000)) == 0 && recorder.Take().empty(),
+    "a buy STOP above the offer waits");
+  OrderBook<Bond> rallied = MakeBook(stop_bond, {}, { Order(100. + 2 * tick, 1000000, OFFER), Order(100. + 3 * tick, 2000000, OFFER) });
+  engine.OnBook(rallied);
+  fills = recorder.Take();
+  Check(fills.size() == 2 && IsFill(fills[0], "STP1", 100. + 2 * tick, 1000000, 500000) && IsFill(fills[1], "STP1", 100. + 3 * tick, 500000, 0),
+    "once the offer reaches the stop, it buys at the market");
+  engine.OnBook(rallied);
+  Check(recorder.Take().empty(), "a triggered STOP is gone");
+
+  // self-trade prevention: a buy cancels the resting sell of its own source, then trades behind it
+  const Bond& self_bond = MakeBond("912810TW8");
+  OrderBook<Bond> self_book = MakeBook(self_bond);
+  engine.OnBook(self_book);
+  engine.Submit(MakeOrder(self_bond, "OWN1", BID, LIMIT, 100. - tick, 1000000), 1);
+  engine.Submit(MakeOrder(self_bond, "OTHER1", BID, LIMIT, 100. - tick, 1000000), 2);
+  Check(recorder.Take().empty(), "two LIMIT sells below the offers rest");
+  filled = engine.Submit(MakeOrder(self_bond, "OWN2", OFFER, MARKET, 0., 1500000), 1);
+  fills = recorder.Take();
+  Check(filled == 1500000 && engine.GetSelfTradeCancelled() == 1000000, "the resting sell of the same source is cancelled");
+  Check(fills.size() == 3 && IsFill(fills[0], "OTHER1", 100. - tick, 1000000, 0) && IsFill(fills[1], "OWN2", 100. - tick, 1000000, 500000)
+    && IsFill(fills[2], "OWN2", 100., 500000, 0), "the buy trades with the other source's sell, then the book");
+
+  return Checked("matching_test");
+}
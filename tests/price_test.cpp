@@ -0,0 +1,52 @@
+// Gabo Bernardino - fractional price fields: every 256th read back, malformed fields refused
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include "check.hpp"
+#include "../tradingsystem/utils.hpp"
+
+// Parse a field given as a C string
+bool TryParse(const char* field, double& price) {
+  return TryStringToPrice(field, field + std::strlen(field), price);
+}
+
+int main() {
+  // the layout: integer, '-', two digits of 32nds, one of 256ths with '+' for 4
+  double price = 0.;
+  Check(TryParse("99-000", price) && price == 99., "99-000 is 99");
+  Check(TryParse("99-00+", price) && price == 99. + 4. / 256., "'+' stands for 4/256");
+  Check(TryParse("100-317", price) && price == 100. + 31. / 32. + 7. / 256., "100-317 is the last 256th before 101");
+
+  // every 256th between 99 and 101 goes thru PriceToString and back
+  long mismatches = 0;
+  for (long n = 99 * 256; n < 101 * 256; ++n) {
+    std::string text = PriceToString(n / 256.);
+    if (!TryParse(text.c_str(), price) || price != n / 256.) mismatches++;
+  }
+  Check(mismatches == 0, "every 256th reads back from PriceToString, mismatches " + std::to_string(mismatches));
+
+  // malformed fields are refused and leave the price untouched
+  const char* malformed[] = { "", "99", "99-", "99-00", "99-0000", "-000", "9a-000", "99-a00", "99-0a0", "99-320",
+    "99-008", "99-00-", "99+000", " 99-000", "99-000 ", "1234567890-000" };
+  long accepted = 0;
+  for (const char* field : malformed) {
+    price = -1.;
+    if (TryParse(field, price) || price != -1.) {
+      accepted++;
+      std::cout << "accepted: '" << field << "'" << std::endl;
+    }
+  }
+  Check(accepted == 0, "every malformed field is refused");
+
+  bool threw = false;
+  try {
+    StringToPrice(std::string("99-3x0"));
+  }
+  catch (std::invalid_argument& e) {
+    threw = std::string(e.what()).find("99-3x0") != std::string::npos;
+  }
+  Check(threw, "StringToPrice throws std::invalid_argument naming the field");
+
+  return Checked("price_test");
+}
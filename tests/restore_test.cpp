@@ -0,0 +1,155 @@
+// Gabo Bernardino - restart: a snapshot, the journal after it and a full replay give the positions of one uninterrupted run
+
+#include <array>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "check.hpp"
+#include "../tradingsystem/utils.hpp"
+#include "../tradingsystem/Bond/BondAlgoExecutionService.hpp"
+#include "../tradingsystem/Bond/BondSnapshotService.hpp"
+
+const char* cusips[] = { "91282CJL6", "91282CJK8", "91282CJN2", "91282CJM4", "91282CJJ1", "912810TW8", "912810TV0" };
+
+// The services of main on the trade path, wired the same way: market data to the router, the venue engines and the algo,
+// the algo's orders thru execution and the venue engines to booking, and booked trades to positions and risk
+struct Desk {
+  BondMarketDataService mkt_service;
+  BondAlgoExecutionService algo_service;
+  BondExecutionService execution_service;
+  BondTradeBookingService trade_service;
+  BondPositionService pos_service;
+  BondRiskService risk_service;
+  BondInquiryService inquiry_service;
+  BondRiskListener risk_listener;
+  BondPositionListener pos_listener;
+  BondTradeBookingListener trade_listener;
+  BondExecutionListener execution_listener;
+  BondSmartOrderRouter router;
+  std::array<BondMatchingEngine, 3> venue_engines;
+  BondAlgoExecutionListener algo_listener;
+  BondTradeBookingConnector trade_connector;
+  BondSnapshotService snapshot_service;
+  std::unique_ptr<BondTradeJournal> journal;
+
+  Desk(const std::string& snapshot) :
+    risk_listener(&risk_service), pos_listener(&pos_service), trade_listener(&trade_service),
+    execution_listener(&execution_service), algo_listener(&algo_service), trade_connector(&trade_service),
+    snapshot_service(&trade_service, &pos_service, &risk_service, &mkt_service, &inquiry_service, snapshot)
+  {
+    pos_service.AddListener(&risk_listener);
+    trade_service.AddListener(&pos_listener);
+    execution_service.AddListener(&trade_listener);
+    algo_service.AddListener(&execution_listener);
+    execution_service.SetRouter(&router);
+    mkt_service.AddListener(&router);
+    for (const VenueParams& venue : BondSmartOrderRouter::DefaultVenues()) {
+      venue_engines[venue.market].SetVenue(BondSmartOrderRouter::MarketName(venue.market), venue.share, venue.priceOffset);
+      trade_listener.SetVenueEngine(venue.market, &venue_engines[venue.market]);
+      mkt_service.AddListener(&venue_engines[venue.market]);
+    }
+    router.SetSimulateFills(false);
+    mkt_service.AddListener(&algo_listener);
+  }
+
+  void Journal(const std::string& path, bool truncate) {
+    journal = std::make_unique<BondTradeJournal>(path, truncate, std::chrono::microseconds(0));
+    trade_service.SetJournal(journal.get());
+  }
+};
+
+// Books of the 7 bonds in turn, every other one at the tightest spread, more offered than bid
+std::vector<OrderBook<Bond>> MakeBooks(long count) {
+  std::vector<OrderBook<Bond>> books;
+  for (long i = 0; i < count; ++i) {
+    double mid = 99.5 + (i % 11) / 128.;
+    double half_spread = (i % 2 == 0) ? 1. / 256. : 1. / 64.;
+    std::vector<Order> bids, offers;
+    for (long level = 0; level < 5; ++level) {
+      bids.push_back(Order(mid - half_spread - level / 256., (level + 1) * 1000000, BID));
+      offers.push_back(Order(mid + half_spread + level / 256., (level + 1) * 3000000, OFFER));
+    }
+    books.push_back(OrderBook<Bond>(MakeBond(cusips[i % 7]), bids, offers));
+  }
+  return books;
+}
+
+// A trades file as `trades.txt`, with its header and the first `count` of a fixed list of trades
+void WriteTrades(const std::string& path, long count) {
+  std::ofstream file(path);
+  file << "CUSIP,TradeId,Price,Book,Quantity,Side\n";
+  const char* books[] = { "TRSY1", "TRSY2", "TRSY3" };
+  for (long i = 0; i < count; ++i) {
+    file << cusips[(i * 3) % 7] << ",RT" << i << ",99-" << (i % 32 < 10 ? "0" : "") << i % 32 << "0," << books[i % 3]
+      << "," << (i % 5 + 1) * 1000000 << ((i % 4 == 0) ? ",SELL\n" : ",BUY\n");
+  }
+}
+
+// Positions of every bond in every book
+std::vector<long> Positions(Desk& desk) {
+  std::vector<long> positions;
+  for (const char* cusip : cusips) {
+    Position<Bond>& position = desk.pos_service.GetData(cusip);
+    for (const char* book : { "TRSY1", "TRSY2", "TRSY3" }) positions.push_back(position.GetPosition(book));
+  }
+  return positions;
+}
+
+// Entries of the journal from executions
+long ExecutionEntries(const std::string& path) {
+  long entries = 0;
+  BondTradeJournal::Replay(path, 0, BondTradeBookingConnector::ParseLine,
+    [&entries](Trade<Bond>& trade, bool received) { if (!received) entries++; });
+  return entries;
+}
+
+int main() {
+  const std::string prefix = "tests/restore_test" + std::to_string(getpid());
+  const std::string snapshot = prefix + ".snap", journal = prefix + ".journal";
+  const std::string some_trades = prefix + "_some.txt", all_trades = prefix + "_all.txt";
+  WriteTrades(some_trades, 12);
+  WriteTrades(all_trades, 30);
+  std::vector<OrderBook<Bond>> books = MakeBooks(140);
+
+  std::cout.setstate(std::ios::badbit);  // the services narrate every step
+
+  // the day in one run
+  Desk single(snapshot + ".unused");
+  for (OrderBook<Bond>& book : books) single.mkt_service.OnMessage(book);
+  single.trade_connector.Subscribe(all_trades.c_str());
+  std::vector<long> expected = Positions(single);
+  long executions = single.trade_service.GetBookedCount() - single.trade_service.GetReceivedCount();
+
+  {
+    // a run stopped part way: a snapshot, then more trades journaled after it
+    Desk first(snapshot);
+    first.Journal(journal, true);
+    for (long i = 0; i < 60; ++i) first.mkt_service.OnMessage(books[i]);
+    first.trade_connector.Subscribe(some_trades.c_str());
+    first.snapshot_service.TakeSnapshot();
+    for (long i = 60; i < 100; ++i) first.mkt_service.OnMessage(books[i]);
+  }
+
+  // the restart, as main does it: restore, resume the connector and the executions, then the whole day again
+  Desk restarted(snapshot);
+  long replayed = restarted.snapshot_service.Restore(journal);
+  restarted.trade_connector.SetResumePoint(restarted.trade_service.GetReceivedCount());
+  restarted.trade_listener.SetResumePoint(restarted.trade_service.GetBookedCount() - restarted.trade_service.GetReceivedCount());
+  restarted.Journal(journal, false);
+  for (OrderBook<Bond>& book : books) restarted.mkt_service.OnMessage(book);
+  restarted.trade_connector.Subscribe(all_trades.c_str());
+  std::cout.clear();
+
+  Check(executions > 0 && replayed > 0, "the day has executions, and some were journaled after the snapshot");
+  bool flat = true;
+  for (long position : expected) flat = flat && position == 0;
+  Check(!flat, "the executions and trades do not net to flat positions");
+  Check(Positions(restarted) == expected, "the restarted day ends with the positions of the uninterrupted one");
+  Check(ExecutionEntries(journal) == executions, "each execution is journaled once over the two runs");
+  Check(restarted.trade_service.GetBookedCount() == single.trade_service.GetBookedCount(), "as many trades are booked as in one run");
+
+  for (const std::string& path : { snapshot, journal, some_trades, all_trades }) std::remove(path.c_str());
+  return Checked("restore_test");
+}
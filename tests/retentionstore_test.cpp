@@ -0,0 +1,101 @@
+// Gabo Bernardino - retention store: eviction to the connector, deletes across a wrapped probe run, lookups after eviction
+
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+#include "check.hpp"
+#include "../tradingsystem/utils.hpp"
+#include "../tradingsystem/retentionstore.hpp"
+
+// A key whose slot in the index is chosen by the test
+struct PlacedKey {
+  long id;
+  std::size_t home;
+
+  bool operator==(const PlacedKey& other) const { return id == other.id; }
+};
+
+namespace std {
+template <>
+struct hash<PlacedKey> {
+  std::size_t operator()(const PlacedKey& key) const { return key.home; }
+};
+}
+
+// Key of the crowded store: homes 13, 14, 15, 0 and 1
+PlacedKey Crowded(long id) {
+  return PlacedKey{ id, static_cast<std::size_t>(13 + id % 5) & 15 };
+}
+
+// Keeps the values it is given
+class EvictionJournal : public Connector<long> {
+public:
+  std::vector<long> published;
+
+  virtual void Publish(long& data) override { published.push_back(data); }
+  virtual void Subscribe(const char* filename, const bool& header = true) override {}
+};
+
+int main() {
+  // 4 values over 16 index slots: three keys at home in the last slot wrap round to the first ones
+  RetentionStore<PlacedKey, long> store(4);
+  EvictionJournal journal;
+  store.SetEvictionConnector(&journal);
+  PlacedKey a{ 1, 15 }, b{ 2, 15 }, c{ 3, 15 }, d{ 4, 0 }, e{ 5, 5 };
+  store.Insert(a, 10);
+  store.Insert(b, 20);
+  store.Insert(c, 30);
+  store.Insert(d, 40);
+  store.Insert(b, 21);  // an update stays in place
+  Check(store.Size() == 4 && store.GetEvictedCount() == 0 && journal.published.empty(), "updating a key retained evicts nothing");
+
+  // evicting `a` empties the head of the run: b, c and d shift back over the wrap
+  store.Insert(e, 50);
+  Check(journal.published == std::vector<long>({ 10 }) && store.GetEvictedCount() == 1, "the oldest value is published to the journal, then dropped");
+  Check(store.Find(a) == nullptr, "an evicted key is not found");
+  Check(store.Find(b) != nullptr && *store.Find(b) == 21 && store.Find(c) != nullptr && *store.Find(c) == 30
+    && store.Find(d) != nullptr && *store.Find(d) == 40 && store.Find(e) != nullptr && *store.Find(e) == 50,
+    "the keys shifted back across the wrap are all still found");
+
+  std::vector<long> oldest_first;
+  store.ForEach([&oldest_first](const PlacedKey& key, long value) { oldest_first.push_back(value); });
+  Check(oldest_first == std::vector<long>({ 21, 30, 40, 50 }), "the values retained are visited oldest first");
+
+  // random keys crowded around the wrap, against the last 8 keys inserted
+  RetentionStore<PlacedKey, long> crowded(8);
+  EvictionJournal crowded_journal;
+  crowded.SetEvictionConnector(&crowded_journal);
+  std::mt19937 g(1);
+  std::deque<long> retained;
+  long expected_evictions = 0, mismatches = 0;
+  for (long i = 0; i < 20000; ++i) {
+    long id = g() % 40;
+    crowded.Insert(Crowded(id), id * 100 + i % 7);
+    if (std::find(retained.begin(), retained.end(), id) == retained.end()) {
+      retained.push_back(id);
+      if (retained.size() > 8) {
+        retained.pop_front();
+        expected_evictions++;
+      }
+    }
+    for (long other = 0; other < 40; ++other) {
+      bool kept = std::find(retained.begin(), retained.end(), other) != retained.end();
+      long* value = crowded.Find(Crowded(other));
+      if ((value != nullptr) != kept || (value != nullptr && *value / 100 != other)) mismatches++;
+    }
+  }
+  Check(mismatches == 0, "after every insert the last 8 keys and only they are found, mismatches " + std::to_string(mismatches));
+  Check(crowded.GetEvictedCount() == expected_evictions && static_cast<long>(crowded_journal.published.size()) == expected_evictions,
+    "every eviction reaches the journal");
+
+  // a capacity of 0 still keeps the last value
+  RetentionStore<PlacedKey, long> empty(0);
+  empty.Insert(a, 1);
+  empty.Insert(b, 2);
+  Check(empty.Capacity() == 1 && empty.Find(a) == nullptr && empty.Find(b) != nullptr && *empty.Find(b) == 2, "a capacity of 0 is taken as 1");
+
+  return Checked("retentionstore_test");
+}
@@ -0,0 +1,107 @@
+// Gabo Bernardino - columnar store: random rows read back exactly, retention and inquiry rows
+
+#include <cmath>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+#include "check.hpp"
+#include "../tradingsystem/utils.hpp"
+#include "../tradingsystem/Bond/BondHistoricalStore.hpp"
+
+// A row as appended, values already at the precision of their column
+struct ExpectedRow {
+  std::int64_t time;
+  std::string product;
+  std::array<double, 3> values;
+};
+
+// Whether the rows a scan calls back are `expected`, in order
+bool SameRows(const std::vector<TimeSeriesRow<3>>& rows, const std::vector<const ExpectedRow*>& expected) {
+  if (rows.size() != expected.size()) return false;
+  for (std::size_t i = 0; i < rows.size(); ++i) {
+    if (rows[i].time != expected[i]->time || *rows[i].product != expected[i]->product) return false;
+    for (std::size_t c = 0; c < 3; ++c) {
+      if (rows[i].GetValue(c) != expected[i]->values[c]) return false;
+    }
+  }
+  return true;
+}
+
+int main() {
+  std::mt19937_64 g(1);
+  const std::int64_t never = std::numeric_limits<std::int64_t>::max();
+
+  // quantities, prices in 256ths and amounts in cents over 20 products,
+  // at regular ticks, bursts, gaps of many partitions and times going back
+  TimeSeriesStore<3> store("random", { "QUANTITY", "PRICE", "AMOUNT" }, { 0, 8, 2 }, std::chrono::microseconds(50));
+  std::vector<ExpectedRow> expected;
+  std::int64_t time = 1734690000000000000LL, last = time;
+  for (long i = 0; i < 50000; ++i) {
+    int kind = g() % 10;
+    if (kind < 6) time += 1000;
+    else if (kind < 8) time += g() % 3;
+    else if (kind < 9) time += g() % 1000000;
+    else time -= g() % 5000;
+    last = std::max(last, time);
+
+    ExpectedRow row;
+    row.time = last;
+    row.product = "P" + std::to_string(g() % 20);
+    row.values[0] = static_cast<double>(static_cast<std::int64_t>(g() % 2000000000000LL) - 1000000000000LL);
+    row.values[1] = (90 * 256 + static_cast<long>(g() % (20 * 256))) / 256.;
+    row.values[2] = (static_cast<std::int64_t>(g() % 20000000) - 10000000) / 100.;
+    store.Append(time, row.product, row.values);
+    expected.push_back(row);
+  }
+  Check(store.GetRowCount() == expected.size() && store.GetPartitionCount() > 100, "every row is held, over many partitions");
+
+  // every row of every product, then random ranges of products and of all of them
+  std::vector<TimeSeriesRow<3>> rows;
+  auto keep = [&rows](const TimeSeriesRow<3>& row) { rows.push_back(row); };
+  long mismatches = 0;
+  for (long t = 0; t < 200; ++t) {
+    std::string product = "P" + std::to_string(t % 20);
+    std::int64_t from = 0, to = never;
+    if (t >= 20) {
+      from = expected[g() % expected.size()].time;
+      to = from + static_cast<std::int64_t>(g() % 100000000);
+    }
+    bool all = t % 5 == 4;
+
+    std::vector<const ExpectedRow*> matching;
+    for (const ExpectedRow& row : expected) {
+      if (row.time >= from && row.time < to && (all || row.product == product)) matching.push_back(&row);
+    }
+    rows.clear();
+    std::size_t matched = all ? store.ScanAll(from, to, keep) : store.Scan(product, from, to, keep);
+    if (matched != matching.size() || !SameRows(rows, matching)) mismatches++;
+  }
+  Check(mismatches == 0, "200 scans read back exactly the rows appended, mismatches " + std::to_string(mismatches));
+  Check(store.Scan("P20", 0, never, keep) == 0, "a product never appended has no rows");
+
+  // ten partitions of ten rows, three of them kept
+  TimeSeriesStore<3> bounded("bounded", { "QUANTITY", "PRICE", "AMOUNT" }, { 0, 8, 2 }, std::chrono::nanoseconds(1000));
+  bounded.SetRetention(3);
+  for (long i = 0; i < 100; ++i) bounded.Append(i * 100, "P0", { static_cast<double>(i), 0., 0. });
+  rows.clear();
+  bounded.ScanAll(0, never, keep);
+  Check(bounded.GetPartitionCount() == 3 && bounded.GetRowCount() == 30 && bounded.GetDroppedCount() == 70,
+    "past the retention the oldest partitions are dropped");
+  Check(rows.size() == 30 && rows.front().time == 7000 && rows.front().GetValue(0) == 70., "the scans see the rows kept only");
+
+  // an inquiry row, under its bond and stamped at its transition
+  BondHistoricalStore history(std::chrono::minutes(1), 60);
+  Inquiry<Bond> inquiry("INQ1", MakeBond("91282CJL6"), SELL, 2000000, 99. + 5. / 256., QUOTED);
+  auto stamp = std::chrono::system_clock::time_point(std::chrono::nanoseconds(1734690000123456789LL));
+  history.Record(inquiry, stamp);
+  std::vector<TimeSeriesRow<4>> inquiries;
+  history.GetInquiries().Scan("91282CJL6", 0, never, [&inquiries](const TimeSeriesRow<4>& row) { inquiries.push_back(row); });
+  Check(inquiries.size() == 1 && inquiries[0].time == 1734690000123456789LL, "an inquiry is kept under its bond at its time");
+  Check(inquiries.size() == 1 && inquiries[0].GetValue(BondHistoricalStore::INQUIRY_SIDE) == SELL
+    && inquiries[0].GetValue(BondHistoricalStore::INQUIRY_QUANTITY) == 2000000.
+    && inquiries[0].GetValue(BondHistoricalStore::INQUIRY_PRICE) == 99. + 5. / 256.
+    && inquiries[0].GetValue(BondHistoricalStore::INQUIRY_STATE) == QUOTED, "the inquiry row holds its side, quantity, price and state");
+
+  return Checked("store_test");
+}
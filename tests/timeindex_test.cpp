@@ -0,0 +1,63 @@
+// Gabo Bernardino - time index lookups against a scan of the whole file, long keys included
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "check.hpp"
+#include "../tradingsystem/timeindex.hpp"
+
+// Last record of `key` at or before `time`, reading every record
+std::string ScanAll(const std::vector<std::string>& records, const std::string& key, std::int64_t time) {
+  std::string found;
+  for (const std::string& record : records) {
+    if (ParseIndexTime(record.data(), record.data() + record.size()) > time) break;
+    std::size_t begin = record.find(',') + 1;
+    if (record.compare(begin, record.find(',', begin) - begin, key) == 0) found = record.substr(0, record.size() - 1);
+  }
+  return found;
+}
+
+int main() {
+  const std::string path = "tests/timeindex_test.txt";
+  const std::vector<std::string> keys = { "91282CJL6", "912810TW8", "FrontEnd", "DJKCAVNFK01",
+    "AN-INQUIRY-ID-OF-EXACTLY-32-CHAR", "AN-INQUIRY-ID-LONGER-THAN-AN-INDEX-ENTRY-HOLDS" };
+
+  // 6000 records over 6 keys, a few per millisecond, indexed every 16 records of a key
+  TimeIndexer indexer(16);
+  indexer.Start(path, 0);
+  std::vector<std::string> records;
+  std::string file, index;
+  TimeIndexEntry entry;
+  std::cout.setstate(std::ios::badbit);  // the long key is reported
+  for (long i = 0; i < 6000; ++i) {
+    char time[32];
+    std::snprintf(time, sizeof(time), "2024-12-20 10:%02ld:%02ld.%03ld", i / 60000, (i / 1000) % 60, (i / 3) % 1000);
+    records.push_back(std::string(time) + "," + keys[(i * 7) % keys.size()] + "," + std::to_string(i) + "\n");
+    if (indexer.Add(records.back(), entry)) index.append(reinterpret_cast<const char*>(&entry), sizeof(entry));
+    file += records.back();
+  }
+  std::cout.clear();
+  std::ofstream(path, std::ios::binary) << file;
+  std::ofstream(path + timeIndexSuffix, std::ios::binary) << index;
+
+  Check(indexer.GetUnindexedCount() == 1000, "the records of the key too long for an entry are left out of the index");
+
+  TimeIndexedFile indexed(path);
+  Check(indexed.GetEntryCount() == 5 * (1000 / 16 + 1), "each indexed key has its first record and every 16th indexed");
+  long mismatches = 0;
+  for (const std::string& key : keys) {
+    for (long i = -1; i < 6000; i += 37) {
+      std::int64_t time = (i < 0) ? 20241220095959999LL : ParseIndexTime(records[i].data(), records[i].data() + records[i].size());
+      if (indexed.Find(key, time) != ScanAll(records, key, time)) mismatches++;
+    }
+  }
+  Check(mismatches == 0, "every lookup finds what a scan of the file finds, mismatches " + std::to_string(mismatches));
+  Check(!indexed.Find(keys.back(), 20241220110000000LL).empty(), "a key too long for the index is still found");
+  Check(indexed.Find("AN-INQUIRY-ID-LONGER-THAN-AN-INDEX-ENTRY", 20241220110000000LL).empty(), "a key sharing a prefix with a long key finds nothing");
+  Check(indexed.Find("91282CJN2", 20241220110000000LL).empty(), "a key not in the file finds nothing");
+
+  std::remove(path.c_str());
+  std::remove((path + timeIndexSuffix).c_str());
+  return Checked("timeindex_test");
+}
@@ -0,0 +1,106 @@
+// Gabo Bernardino - venue engines: each child order fills on the book of the venue the router picked
+
+#include <array>
+#include <string>
+#include <vector>
+#include "check.hpp"
+#include "../tradingsystem/utils.hpp"
+#include "../tradingsystem/Bond/BondExecutionService.hpp"
+#include "../tradingsystem/Bond/BondMarketDataService.hpp"
+
+const double tick = 1. / 256.;
+
+// Keeps the fills it is given
+class FillRecorder : public ServiceListener<Fill<Bond>> {
+public:
+  std::vector<Fill<Bond>> fills;
+
+  virtual void ProcessAdd(Fill<Bond>& data) override { fills.push_back(data); }
+  virtual void ProcessRemove(Fill<Bond>& data) override {}
+  virtual void ProcessUpdate(Fill<Bond>& data) override {}
+
+  long Filled() const {
+    long filled = 0;
+    for (const Fill<Bond>& fill : fills) filled += fill.GetQuantity();
+    return filled;
+  }
+};
+
+// Whether every fill is of an order whose id ends with `suffix`
+bool AllOf(const std::vector<Fill<Bond>>& fills, const std::string& suffix) {
+  for (const Fill<Bond>& fill : fills) {
+    std::string id = fill.GetOrderId().c_str();
+    if (id.size() < suffix.size() || id.compare(id.size() - suffix.size(), suffix.size(), suffix) != 0) return false;
+  }
+  return true;
+}
+
+// Bids of 1M at 99-24 and 2M a tick below, offers of 1M at 100 and 2M a tick above
+OrderBook<Bond> MakeBook(const Bond& bond) {
+  return OrderBook<Bond>(bond, { Order(99.75, 1000000, BID), Order(99.75 - tick, 2000000, BID) },
+    { Order(100., 1000000, OFFER), Order(100. + tick, 2000000, OFFER) });
+}
+
+int main() {
+  // a venue engine sees its share of the book, a tick worse
+  BondMatchingEngine cme;
+  FillRecorder cme_fills;
+  cme.AddListener(&cme_fills);
+  cme.SetVenue("CME", 0.2, tick);
+  const Bond& bond = MakeBond("91282CJL6");
+  cme.OnBook(MakeBook(bond));
+  long filled = cme.Submit(ExecutionOrder<Bond>(bond, OFFER, OrderId("BUY1"), MARKET, 0., 500000, 0, OrderId(""), false));
+  Check(filled == 500000 && cme_fills.fills.size() == 2 && cme_fills.fills[0].GetPrice() == 100. + tick
+    && cme_fills.fills[0].GetQuantity() == 200000 && cme_fills.fills[1].GetPrice() == 100. + 2 * tick,
+    "a venue engine offers 20% of each level, a tick higher");
+
+  // the desk of main: the router splits, each child fills on the engine of its venue
+  BondMarketDataService mkt_service;
+  BondExecutionService execution_service;
+  BondTradeBookingService trade_service;
+  BondTradeBookingListener trade_listener(&trade_service);
+  execution_service.AddListener(&trade_listener);
+  BondSmartOrderRouter router;
+  execution_service.SetRouter(&router);
+  mkt_service.AddListener(&router);
+  std::array<BondMatchingEngine, 3> venue_engines;
+  std::array<FillRecorder, 3> venue_fills;
+  for (const VenueParams& venue : BondSmartOrderRouter::DefaultVenues()) {
+    venue_engines[venue.market].SetVenue(BondSmartOrderRouter::MarketName(venue.market), venue.share, venue.priceOffset);
+    venue_engines[venue.market].AddListener(&venue_fills[venue.market]);
+    trade_listener.SetVenueEngine(venue.market, &venue_engines[venue.market]);
+    mkt_service.AddListener(&venue_engines[venue.market]);
+  }
+  router.SetSimulateFills(false);
+
+  std::cout.setstate(std::ios::badbit);  // the services narrate every step
+  OrderBook<Bond> book = MakeBook(bond);
+  mkt_service.OnMessage(book);
+  ExecutionOrder<Bond> parent(bond, OFFER, OrderId("PARENT1"), MARKET, 0., 2800000, 0, OrderId(""), false);
+  execution_service.ExecuteOrder(parent, BROKERTEC);
+  std::cout.clear();
+
+  long total = 0;
+  bool own_venue = true;
+  for (Market market : { BROKERTEC, ESPEED, CME }) {
+    total += venue_fills[market].Filled();
+    own_venue = own_venue && AllOf(venue_fills[market].fills, std::string("-") + BondSmartOrderRouter::MarketName(market));
+  }
+  Check(own_venue, "each venue engine fills only the children routed to its venue");
+  Check(total == 2800000 && trade_service.GetBookedCount() > 1, "the children fill the parent in full, over more than one venue");
+  Check(!venue_fills[CME].fills.empty() && venue_fills[CME].fills.front().GetPrice() == 100. + tick,
+    "the children routed to CME pay its price offset");
+
+  // an order executed on a market without the router fills on that market's engine only
+  execution_service.SetRouter(nullptr);
+  std::array<long, 3> before = { venue_fills[BROKERTEC].Filled(), venue_fills[ESPEED].Filled(), venue_fills[CME].Filled() };
+  ExecutionOrder<Bond> direct(bond, BID, OrderId("DIRECT1"), MARKET, 0., 100000, 0, OrderId(""), false);
+  std::cout.setstate(std::ios::badbit);
+  execution_service.ExecuteOrder(direct, ESPEED);
+  std::cout.clear();
+  Check(direct.GetMarket() == ESPEED && venue_fills[ESPEED].Filled() == before[ESPEED] + 100000
+    && venue_fills[BROKERTEC].Filled() == before[BROKERTEC] && venue_fills[CME].Filled() == before[CME],
+    "an order carries its market to the engine of that market");
+
+  return Checked("venue_test");
+}
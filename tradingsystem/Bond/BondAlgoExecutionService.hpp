@@ -11,6 +11,7 @@
 
 #include "../executionservice.hpp"
 #include "../marketdataservice.hpp"
+#include "../objectpool.hpp"
 
 /**
 * AlgoExecution should have a reference to an ExecutionOrderobject
@@ -23,9 +24,11 @@ private:
 
 public:
   AlgoExecution(const ExecutionOrder<T>& order);
+  AlgoExecution(ExecutionOrder<T>&& order);
   AlgoExecution() = default;
 
   const ExecutionOrder<T>& GetOrder() const;
+  ExecutionOrder<T>& GetOrder();
 };
 
 //*************************************************************************************************
@@ -35,11 +38,20 @@ template <typename T>
 AlgoExecution<T>::AlgoExecution(const ExecutionOrder<T>& order) :
   order_(order) {}
 
+template <typename T>
+AlgoExecution<T>::AlgoExecution(ExecutionOrder<T>&& order) :
+  order_(std::move(order)) {}
+
 template <typename T>
 const ExecutionOrder<T>& AlgoExecution<T>::GetOrder() const {
   return order_;
 }
 
+template <typename T>
+ExecutionOrder<T>& AlgoExecution<T>::GetOrder() {
+  return order_;
+}
+
 /**
  * Algo Execution Service class specialized for bonds;
  * stores a vector of listeners and a map of strings -> algo execution objects
@@ -58,14 +70,19 @@ public:
 class BondAlgoExecutionService : public AlgoExecutionService<Bond> {
 private:
   std::vector<ServiceListener<AlgoExecution<Bond>>*> listeners_;
-  std::unordered_map<std::string, AlgoExecution<Bond>> algo_execs_;  // keyed on product id/
+  std::unordered_map<ProductId, AlgoExecution<Bond>*> algo_execs_;  // keyed on product id/
+
+  // preallocated algo executions, so sending an order never allocates - one per product, overwritten by each order
+  ObjectPool<AlgoExecution<Bond>> pool_;
+  AlgoExecution<Bond> empty_;  // returned for a product without an execution, not stored
 
   // keep track of which side of the book we are on (even -> BID, odd -> offer)
   long counter_;
+  std::string idTag_;  // goes between ticker and counter in order ids
 
 public:
   //ctor
-  BondAlgoExecutionService();
+  BondAlgoExecutionService(std::size_t pool_capacity = 64);
 
   // Get data on our service given a key
   virtual AlgoExecution<Bond>& GetData(std::string key) override;
@@ -82,6 +99,12 @@ public:
 
   // Send an order to the book
   virtual void SendOrder(OrderBook<Bond>& orderBook) override;
+
+  // Pool of algo executions
+  const ObjectPool<AlgoExecution<Bond>>& GetPool() const;
+
+  // Set the tag used to build order ids, e.g. to keep ids of different shards apart
+  void SetIdTag(const std::string& _tag);
 };
 
 /**
@@ -112,13 +135,17 @@ public:
 //*************************************************************************************************
 // BondAlgoExecutionService implementations
 //*************************************************************************************************
-BondAlgoExecutionService::BondAlgoExecutionService() {
-  algo_execs_ = std::unordered_map<std::string, AlgoExecution<Bond>>();
+BondAlgoExecutionService::BondAlgoExecutionService(std::size_t pool_capacity) :
+  pool_(pool_capacity)
+{
+  algo_execs_ = std::unordered_map<ProductId, AlgoExecution<Bond>*>();
   counter_ = 0L;
+  idTag_ = "57747FFC";
 }
 
 AlgoExecution<Bond>& BondAlgoExecutionService::GetData(std::string key) {
-  return algo_execs_[key];
+  auto it = algo_execs_.find(key);
+  return (it != algo_execs_.end()) ? *it->second : empty_;
 }
 
 void BondAlgoExecutionService::OnMessage(AlgoExecution<Bond>& data) {
@@ -135,16 +162,17 @@ const vector<ServiceListener<AlgoExecution<Bond>>*>& BondAlgoExecutionService::G
 
 void BondAlgoExecutionService::SendOrder(OrderBook<Bond>& orderBook) {
   
-  std::string id = orderBook.GetProduct().GetProductId();  // product to trade
+  const ProductId& id = orderBook.GetProduct().GetProductId();  // product to trade
   // top of the book (both sides):
   BidOffer best = orderBook.GetBestBidOffer();
 
   // instructions: "only aggressing when the spread is at its tightest (i.e. 1/128th)"
   double minimum_spread = 1. / 128.;
-  if (best.GetBidOrder().GetPrice() - best.GetOfferOrder().GetPrice() >= minimum_spread) {
-    Bond bond = orderBook.GetProduct();
+  if (best.GetOfferOrder().GetPrice() - best.GetBidOrder().GetPrice() <= minimum_spread) {
+    const Bond& bond = orderBook.GetProduct();
     
-    std::string order_id = bond.GetTicker() + "57747FFC" + std::to_string(counter_);
+    OrderId order_id(bond.GetTicker());
+    order_id.Append(idTag_).AppendNumber(counter_);
 
     // order specifications - most of them will be hardcoded for simplicity
     long all_qnt, visible_qnt, hidden_qnt;  // quantities
@@ -169,11 +197,12 @@ void BondAlgoExecutionService::SendOrder(OrderBook<Bond>& orderBook) {
     visible_qnt = all_qnt / divisor;
     hidden_qnt = all_qnt - visible_qnt;
     
-    // now handle the execution
-    ExecutionOrder<Bond> order(bond, side, order_id, MARKET, 1., visible_qnt, hidden_qnt, "", false);
+    // now handle the execution - the product's pooled object is overwritten and stays stored until the next order
     // note that we are crossing the spread -> use market orders and dont worry about the price
-    AlgoExecution<Bond> algo(order);
-    algo_execs_[id] = algo;
+    AlgoExecution<Bond>*& slot = algo_execs_[id];
+    if (slot == nullptr) slot = pool_.Acquire();
+    *slot = AlgoExecution<Bond>(ExecutionOrder<Bond>(bond, side, order_id, MARKET, 1., visible_qnt, hidden_qnt, "", false));
+    AlgoExecution<Bond>& algo = *slot;
 
     std::cout << "Communicating order " << order_id << " to Execution Listeners..." << std::endl;
     for (auto l : listeners_) {
@@ -184,6 +213,14 @@ void BondAlgoExecutionService::SendOrder(OrderBook<Bond>& orderBook) {
   }
 }
 
+const ObjectPool<AlgoExecution<Bond>>& BondAlgoExecutionService::GetPool() const {
+  return pool_;
+}
+
+void BondAlgoExecutionService::SetIdTag(const std::string& _tag) {
+  idTag_ = _tag;
+}
+
 
 
 // ************************************************************************************************
@@ -26,6 +26,7 @@ public:
   AlgoStream() = default;
 
   const PriceStream<T>& GetPriceStream() const;
+  PriceStream<T>& GetPriceStream();
 };
 
 //*************************************************************************************************
@@ -40,6 +41,11 @@ const PriceStream<T>& AlgoStream<T>::GetPriceStream() const {
   return priceStream_;
 }
 
+template <typename T>
+PriceStream<T>& AlgoStream<T>::GetPriceStream() {
+  return priceStream_;
+}
+
 
 /**
 * Algo Streaming Service class specialized fro bonds;
@@ -59,7 +65,7 @@ public:
 class BondAlgoStreamingService : public AlgoStreamingService<Bond> {
 private:
   std::vector<ServiceListener<AlgoStream<Bond>>*> listeners_;
-  std::unordered_map<std::string, AlgoStream<Bond>> algo_streams_;
+  std::unordered_map<ProductId, AlgoStream<Bond>> algo_streams_;
 
   // keep counter to alternate sizes of orders
   long counter_;
@@ -114,7 +120,7 @@ public:
 // BondAlgoStreamingService implementations
 //*************************************************************************************************
 BondAlgoStreamingService::BondAlgoStreamingService() {
-  algo_streams_ = std::unordered_map<std::string, AlgoStream<Bond>>();
+  algo_streams_ = std::unordered_map<ProductId, AlgoStream<Bond>>();
   counter_ = 0L;
 }
 
@@ -150,12 +156,11 @@ void BondAlgoStreamingService::PublishPrice(const Price<Bond>& price) {
   PriceStreamOrder bid_order(bid_price, visible_qnt, hidden_qnt, BID);
   PriceStreamOrder offer_order(offer_price, visible_qnt, hidden_qnt, OFFER);
 
-  Bond bond = price.GetProduct();
+  const Bond& bond = price.GetProduct();
 
-  // create the price stream and algo stream obects + add algo stream to map
-  PriceStream<Bond> price_stream(bond, bid_order, offer_order);
-  AlgoStream<Bond> stream_obj(price_stream);
-  algo_streams_[bond.GetProductId()] = stream_obj;
+  // create the price stream and algo stream obects in place in the map
+  AlgoStream<Bond>& stream_obj = algo_streams_[bond.GetProductId()];
+  stream_obj = AlgoStream<Bond>(PriceStream<Bond>(bond, bid_order, offer_order));
 
   std::cout << "Communicating algo stream to StreamingListeners..." << std::endl;
   for (auto l : listeners_) {
@@ -11,8 +11,10 @@
 
 #include <array>
 #include "../executionservice.hpp"
+#include "../objectpool.hpp"
 #include "BondTradeBookingService.hpp"
 #include "BondAlgoExecutionService.hpp"
+#include "BondSmartOrderRouter.hpp"
 
 
 /**
@@ -21,15 +23,24 @@
  * 
  * Gets data via a listener on BondAlgoExecutionService and communicates it
  * to TradeBooking listeners to book a trade
+ *
+ * With a smart order router set, parent orders are split into child orders
+ * across venues and the children are executed instead.
  */
 class BondExecutionService : public ExecutionService<Bond> {
 private:
   std::vector<ServiceListener<ExecutionOrder<Bond>>*> listeners_;
-  std::unordered_map<std::string, ExecutionOrder<Bond>> orders_;
+  std::unordered_map<ProductId, ExecutionOrder<Bond>*> orders_;
+
+  // preallocated execution orders, so executing never allocates - one per product, overwritten by each order
+  ObjectPool<ExecutionOrder<Bond>> pool_;
+  ExecutionOrder<Bond> empty_;  // returned for a product without an order, not stored
+
+  BondSmartOrderRouter* router_;
 
 public:
   //ctor
-  BondExecutionService();
+  BondExecutionService(std::size_t pool_capacity = 64);
 
   // Get data on our service given a key
   virtual ExecutionOrder<Bond>& GetData(std::string key) override;
@@ -46,6 +57,12 @@ public:
 
   // Execute an order on a market
   virtual void ExecuteOrder(ExecutionOrder<Bond>& order, Market market) override;
+
+  // Pool of execution orders
+  const ObjectPool<ExecutionOrder<Bond>>& GetPool() const;
+
+  // Route parent orders through a smart order router (nullptr executes them as they come)
+  void SetRouter(BondSmartOrderRouter* _router);
 };
 
 
@@ -80,12 +97,15 @@ public:
 //*************************************************************************************************
 // BondExecutionService implementations
 //*************************************************************************************************
-BondExecutionService::BondExecutionService() {
-  orders_ = std::unordered_map<std::string, ExecutionOrder<Bond>>();
+BondExecutionService::BondExecutionService(std::size_t pool_capacity) :
+  pool_(pool_capacity), router_(nullptr)
+{
+  orders_ = std::unordered_map<ProductId, ExecutionOrder<Bond>*>();
 }
 
 ExecutionOrder<Bond>& BondExecutionService::GetData(std::string key) {
-  return orders_[key];
+  auto it = orders_.find(key);
+  return (it != orders_.end()) ? *it->second : empty_;
 }
 
 void BondExecutionService::OnMessage(ExecutionOrder<Bond>& data) {
@@ -101,9 +121,22 @@ const vector<ServiceListener<ExecutionOrder<Bond>>*>& BondExecutionService::GetL
 }
 
 void BondExecutionService::ExecuteOrder(ExecutionOrder<Bond>& order, Market market) {
-  // add order to map
-  std::string id = order.GetProduct().GetProductId();
-  orders_[id] = order;
+  if (router_ != nullptr && !order.IsChildOrder()) {
+    // the router picks the venues: execute its children instead
+    for (RoutedOrder& child : router_->Route(order)) {
+      ExecuteOrder(child.order, child.market);
+    }
+    return;
+  }
+
+  // the order carries its market down to the trade listeners, which fill it there
+  order.SetMarket(market);
+
+  // add order to map - keep one pooled order per product and overwrite it
+  const ProductId& id = order.GetProduct().GetProductId();
+  ExecutionOrder<Bond>*& stored = orders_[id];
+  if (stored == nullptr) stored = pool_.Acquire();
+  *stored = order;
 
   // communicate order to trade listeners
   std::cout << "Communicating order " << id << " to TradeBooking Listeners..." << endl;
@@ -112,6 +145,14 @@ void BondExecutionService::ExecuteOrder(ExecutionOrder<Bond>& order, Market mark
   }
 }
 
+const ObjectPool<ExecutionOrder<Bond>>& BondExecutionService::GetPool() const {
+  return pool_;
+}
+
+void BondExecutionService::SetRouter(BondSmartOrderRouter* _router) {
+  router_ = _router;
+}
+
 //*************************************************************************************************
 // BondExecutionListener implementations
 //*************************************************************************************************
@@ -132,13 +173,11 @@ void BondExecutionListener::ProcessRemove(AlgoExecution<Bond>& data) {
 
 void BondExecutionListener::ProcessUpdate(AlgoExecution<Bond>& data) {
   
-  // get market to place the order on
+  // get market to place the order on - the service's router, if any, overrides it
   Market mkt = markets_[counter_];
   counter_++; counter_ %= 3;
-  // get executon order from algo
-  ExecutionOrder<Bond> order = data.GetOrder();
-
-  bondExecService_->ExecuteOrder(order, mkt);
+  // pass the executon order from algo thru by reference
+  bondExecService_->ExecuteOrder(data.GetOrder(), mkt);
 }
 
 
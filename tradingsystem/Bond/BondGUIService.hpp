@@ -10,6 +10,8 @@
 #define BONDGUISERVICE_HPP
 
 #include "../utils.hpp"
+#include "../conflationcache.hpp"
+#include "../timerwheel.hpp"
 #include "BondPricingService.hpp"
 #include <chrono>
 
@@ -36,12 +38,14 @@ public:
 
 /**
  * GUI service class specialized for bonds;
- * stores a vector of listeners and a map of strings -> price info
+ * stores a vector of listeners and a map of strings -> last published price
  * also stores a pointer to a connector which it uses to publish data
  * and a throttle interval managing the frequency of gui updates
  * 
- * Gets streaming prices via a listener on BondPricingService
- * and prints it to a txt file
+ * Gets streaming prices via a listener on BondPricingService into a
+ * conflation cache (one latest-price slot per product, written lock-free).
+ * A periodic timer fires every throttle interval and prints to a txt file
+ * only the products whose price changed since the previous refresh.
  */
 template <typename T>
 class GUIService : public Service<std::string, Price<T>> {
@@ -54,14 +58,20 @@ public:
 class BondGUIService : public GUIService<Bond> {
 private:
   std::vector<ServiceListener<Price<Bond>>*> listeners_;
-  std::unordered_map<std::string, Price<Bond>> prices_;  // keyed on product id
+  std::unordered_map<ProductId, Price<Bond>> prices_;  // keyed on product id, last published
 
   BondGUIConnector* guiConnector_;
   std::chrono::milliseconds throttle_;
 
+  ConflationCache<ProductId, Price<Bond>> latest_;  // latest price per product
+  std::size_t maxPerRefresh_;  // cap on products printed per refresh, 0 = none
+  TimerService* timers_;
+  TimerId refreshTimer_;
+
 public:
   //ctor
-  BondGUIService(const int& throttle_interval);
+  BondGUIService(const int& throttle_interval, std::size_t max_products = 1024);
+  ~BondGUIService();
   void SetConnector(BondGUIConnector* _gui_connector);
 
   // Get data on our service given a key
@@ -82,6 +92,23 @@ public:
 
   // Return length of throttle interval
   std::chrono::milliseconds GetThrottleInterval() const;
+
+  // Print a product at most once every `every_n` refreshes (0 mutes it)
+  void SetProductRefresh(const ProductId& productId, int every_n);
+
+  // Print at most this many products per refresh (0 = no cap)
+  void SetMaxPerRefresh(std::size_t max_products);
+
+  // Print the products that changed since the last refresh - returns how many were printed
+  std::size_t Refresh();
+
+  // Start / stop refreshing on a timer service; stopping flushes the last changes
+  void Start(TimerService* _timers);
+  void Stop();
+
+  // Number of prices received, and of prices printed
+  long GetReceivedCount() const;
+  long GetPublishedCount() const;
 };
 
 
@@ -95,10 +122,6 @@ class BondGUIListener : public ServiceListener<Price<Bond>> {
 private:
   BondGUIService* guiService_;
 
-  std::chrono::system_clock::time_point start_;
-  std::chrono::milliseconds throttle_;
-  int counter_;  // keep count of read prices - only need to print the first 100
-
 public:
   // ctor
   BondGUIListener(BondGUIService* _service);
@@ -117,10 +140,15 @@ public:
 //*************************************************************************************************
 // BondGUIService implementations
 //*************************************************************************************************
-BondGUIService::BondGUIService(const int& throttle_interval) :
-  throttle_(throttle_interval)
+BondGUIService::BondGUIService(const int& throttle_interval, std::size_t max_products) :
+  guiConnector_(nullptr), throttle_(throttle_interval), latest_(max_products), maxPerRefresh_(0),
+  timers_(nullptr), refreshTimer_(0)
 {
-  prices_ = std::unordered_map<std::string, Price<Bond>>();
+  prices_ = std::unordered_map<ProductId, Price<Bond>>();
+}
+
+BondGUIService::~BondGUIService() {
+  Stop();
 }
 
 void BondGUIService::SetConnector(BondGUIConnector* _gui_connector) {
@@ -144,17 +172,52 @@ const vector<ServiceListener<Price<Bond>>*>& BondGUIService::GetListeners() cons
 }
 
 void BondGUIService::AddPrice(Price<Bond>& price) {
-  // add data to the stored prices
-  std::string id = price.GetProduct().GetProductId();
-  prices_[id] = price;
-
-  guiConnector_->Publish(price);  // publish data to the GUI output
+  // overwrite the latest price of the product, the publisher picks it up
+  if (!latest_.Write(price.GetProduct().GetProductId(), price)) {
+    std::cout << "GUI cache full, dropping price for " << price.GetProduct().GetProductId() << std::endl;
+  }
 }
 
 std::chrono::milliseconds BondGUIService::GetThrottleInterval() const {
   return throttle_;
 }
 
+void BondGUIService::SetProductRefresh(const ProductId& productId, int every_n) {
+  latest_.Configure(productId, every_n);
+}
+
+void BondGUIService::SetMaxPerRefresh(std::size_t max_products) {
+  maxPerRefresh_ = max_products;
+}
+
+std::size_t BondGUIService::Refresh() {
+  return latest_.Snapshot([this](Price<Bond>& price) {
+    prices_[price.GetProduct().GetProductId()] = price;
+    if (guiConnector_ != nullptr) guiConnector_->Publish(price);  // publish data to the GUI output
+  }, maxPerRefresh_);
+}
+
+void BondGUIService::Start(TimerService* _timers) {
+  if (timers_ != nullptr) return;
+  timers_ = _timers;
+  refreshTimer_ = timers_->Schedule(throttle_, [this]() { Refresh(); }, throttle_);
+}
+
+void BondGUIService::Stop() {
+  if (timers_ == nullptr) return;
+  timers_->Cancel(refreshTimer_);
+  timers_ = nullptr;
+  Refresh();  // flush what changed since the last refresh
+}
+
+long BondGUIService::GetReceivedCount() const {
+  return latest_.GetWriteCount();
+}
+
+long BondGUIService::GetPublishedCount() const {
+  return latest_.GetPublishCount();
+}
+
 //*************************************************************************************************
 // BondGUIConnector implementations
 //*************************************************************************************************
@@ -188,24 +251,14 @@ void BondGUIConnector::Publish(Price<Bond>& data) {
 }
 
 //*************************************************************************************************
-// BondGUIConnector implementations
+// BondGUIListener implementations
 //*************************************************************************************************
 BondGUIListener::BondGUIListener(BondGUIService* _service) :
-  guiService_(_service), counter_(0)
-{
-  // get values for throttle
-  throttle_ = guiService_->GetThrottleInterval();
-  start_ = std::chrono::system_clock::now();
-}
+  guiService_(_service) {}
 
 void BondGUIListener::ProcessAdd(Price<Bond>& data) {
-  // logic for maximum number of prints and their frequency
-  if (counter_ < 100 && std::chrono::system_clock::now() - start_ >= throttle_) {
-    guiService_->AddPrice(data);  // store price and publish it
-    // restart throttle and counter
-    counter_++;
-    start_ = std::chrono::system_clock::now();
-  }
+  // every tick goes to the cache: throttling is done by the service's publisher
+  guiService_->AddPrice(data);
 }
 
 void BondGUIListener::ProcessRemove(Price<Bond>& data) {
@@ -10,17 +10,72 @@
 #define BONDHISTORICALDATACONNECTORS_HPP
 
 #include <fstream>
+#include <memory>
 #include "../historicaldataservice.hpp"
+#include "../uringwriter.hpp"
+#include "../timeindex.hpp"
+#include "BondHistoricalStore.hpp"
 #include "../utils.hpp"
 
+/**
+* Output file of a historical connector
+* Records are appended with an ofstream opened for each of them, or handed to a
+* UringFileWriter, which writes them from its own thread, when one is set;
+* the writer can also compress them, into `<file>.lz`.
+* With a store set, the positions, risk, executions, streams and inquiries also go to its time series.
+* With an index set, a sparse time index of the file is written next to it (see timeindex.hpp)
+* The file and its index are opened in the writer, and the index started, by the setters,
+* before any record is written, so writing never initializes anything.
+*/
+class HistoricalFileOutput {
+private:
+  std::string path_;
+  std::string target_;  // the file written: `path_`, or its frames when compressed
+  UringFileWriter* writer_;
+  int file_;  // handle in the writer
+  int indexFile_;
+  bool compress_;
+  BondHistoricalStore* store_;
+  std::unique_ptr<TimeIndexer> indexer_;
+
+  // Open the file and its index in the writer, if any, and start the index, if any
+  void _open();
+
+  // Append data to a file, `handle` being its handle in the writer
+  void _append(const std::string& path, int handle, const std::string& data);
+
+protected:
+  // Append records, each ending with a newline, to the file
+  void _write(const std::string& records);
+
+  // Add a record to the store, if any
+  template <typename T>
+  void _record(T& data);
+  void _record(const Inquiry<Bond>& data, std::chrono::system_clock::time_point time);
+
+public:
+  // ctor
+  HistoricalFileOutput(const std::string& _path);
+
+  // Write through a UringFileWriter (nullptr writes with an ofstream), compressed or not
+  // A file the writer cannot open is written with an ofstream instead
+  void SetFileWriter(UringFileWriter* _writer, bool _compress = false);
+
+  // Keep the records in a columnar store as well (nullptr for files only)
+  void SetStore(BondHistoricalStore* _store);
+
+  // Index the file, every `every` records of each key
+  void SetIndex(std::size_t every);
+};
+
 /**
 * Historical data connector specialized for bond positions 
 */
-class BondHistoricalPositionConnector : public Connector<Position<Bond>> {
+class BondHistoricalPositionConnector : public Connector<Position<Bond>>, public HistoricalFileOutput {
 
 public:
   // ctor
-  BondHistoricalPositionConnector() = default;
+  BondHistoricalPositionConnector();
 
   // Subscribe to a Service - this one is publish only tho
   virtual void Subscribe(const char* filename, const bool& header = false) override;
@@ -32,7 +87,7 @@ public:
 /**
 * Historical data connector specialized for bond risk
 */
-class BondHistoricalRiskConnector : public Connector<PV01<Bond>> {
+class BondHistoricalRiskConnector : public Connector<PV01<Bond>>, public HistoricalFileOutput {
 
 private:
   BondRiskService* bondRiskService_;
@@ -43,7 +98,6 @@ private:
 public:
   // ctor
   BondHistoricalRiskConnector(BondRiskService* _service);
-  BondHistoricalRiskConnector() = default;
 
   // Subscribe to a Service - this one is publish only tho
   virtual void Subscribe(const char* filename, const bool& header = false) override;
@@ -52,17 +106,17 @@ public:
   virtual void Publish(PV01<Bond>& data) override;
 
   // Publish data for Bucketed risk
-  void Publish(PV01<BucketedSector<Bond>>& data);
+  void Publish(const PV01<BucketedSector<Bond>>& data);
 };
 
 /**
 * Historical data connector specialized for bond execution
 */
-class BondHistoricalExecutionConnector : public Connector<ExecutionOrder<Bond>> {
+class BondHistoricalExecutionConnector : public Connector<ExecutionOrder<Bond>>, public HistoricalFileOutput {
 
 public:
   // ctor
-  BondHistoricalExecutionConnector() = default;
+  BondHistoricalExecutionConnector();
 
   // Subscribe to a Service - this one is publish only tho
   virtual void Subscribe(const char* filename, const bool& header = false) override;
@@ -74,11 +128,11 @@ public:
 /**
 * Historical data connector specialized for bond price streaming
 */
-class BondHistoricalStreamingConnector : public Connector<PriceStream<Bond>> {
+class BondHistoricalStreamingConnector : public Connector<PriceStream<Bond>>, public HistoricalFileOutput {
 
 public:
   // ctor
-  BondHistoricalStreamingConnector() = default;
+  BondHistoricalStreamingConnector();
 
   // Subscribe to a Service - this one is publish only tho
   virtual void Subscribe(const char* filename, const bool& header = false) override;
@@ -89,51 +143,148 @@ public:
 
 /**
 * Historical data connector specialized for bond inquiries
+* A batch of inquiries is written at once
 */
-class BondHistoricalInquiryConnector : public Connector<Inquiry<Bond>> {
+class BondHistoricalInquiryConnector : public BatchConnector<Inquiry<Bond>>, public HistoricalFileOutput {
+private:
+  // Add the record of an inquiry, stamped with `time`
+  static void _format(std::string& record, const std::string& time, const Inquiry<Bond>& data);
 
 public:
   // ctor
-  BondHistoricalInquiryConnector() = default;
+  BondHistoricalInquiryConnector();
 
   // Subscribe to a Service - this one is publish only tho
   virtual void Subscribe(const char* filename, const bool& header = false) override;
 
   // Publish data
   virtual void Publish(Inquiry<Bond>& data) override;
+
+  // Publish several inquiries with one write, each stamped with the time of its transition
+  virtual void PublishBatch(std::vector<Inquiry<Bond>>& data, const std::vector<std::chrono::system_clock::time_point>& times) override;
+};
+
+/**
+* Journal connector for bond trades evicted from the trade booking service
+* Writes them in the same format as `trades.txt`, so they can be read back
+*/
+class BondHistoricalTradeConnector : public Connector<Trade<Bond>>, public HistoricalFileOutput {
+
+public:
+  // ctor
+  BondHistoricalTradeConnector(const std::string& file_name = "Data/trades_journal.txt");
+
+  // Subscribe to a Service - this one is publish only tho
+  virtual void Subscribe(const char* filename, const bool& header = false) override;
+
+  // Publish data
+  virtual void Publish(Trade<Bond>& data) override;
 };
 
 // ************************************************************************************************
 // Implementations
 // ************************************************************************************************
 
+// FILE OUTPUT
+HistoricalFileOutput::HistoricalFileOutput(const std::string& _path) :
+  path_(_path), target_(_path), writer_(nullptr), file_(-1), indexFile_(-1), compress_(false), store_(nullptr) {}
+
+void HistoricalFileOutput::SetFileWriter(UringFileWriter* _writer, bool _compress) {
+  writer_ = _writer;
+  file_ = indexFile_ = -1;
+  compress_ = _compress && _writer != nullptr;  // frames are compressed on the writer's thread
+  target_ = compress_ ? path_ + frameSuffix : path_;
+  try {
+    _open();
+  }
+  catch (std::exception& e) {
+    std::cout << "An error occurred: " << e.what() << "; writing " << path_ << " with an ofstream" << std::endl;
+    writer_ = nullptr;
+    compress_ = false;
+    target_ = path_;
+    file_ = indexFile_ = -1;
+    _open();
+  }
+}
+
+void HistoricalFileOutput::_open() {
+  if (writer_ != nullptr) file_ = writer_->Open(target_, compress_);
+  if (indexer_ == nullptr) return;
+
+  // index offsets are in the uncompressed content of the file; starting the index may truncate it,
+  // so it is opened in the writer after
+  struct stat info;
+  std::uint64_t size = (writer_ != nullptr) ? writer_->GetInitialSize(file_)
+    : (stat(target_.c_str(), &info) == 0) ? static_cast<std::uint64_t>(info.st_size) : 0;
+  indexer_->Start(target_, size);
+  if (writer_ != nullptr) indexFile_ = writer_->Open(target_ + timeIndexSuffix);
+}
+
+void HistoricalFileOutput::_append(const std::string& path, int handle, const std::string& data) {
+  if (writer_ == nullptr) {
+    std::ofstream file;
+    file.open(path, ios::app | ios::binary);
+    file << data;
+    file.close();
+    return;
+  }
+  writer_->Append(handle, data);
+}
+
+void HistoricalFileOutput::_write(const std::string& records) {
+  std::string entries;
+  if (indexer_ != nullptr) {
+    TimeIndexEntry entry;
+    for (std::size_t begin = 0; begin < records.size();) {
+      std::size_t end = records.find('\n', begin);
+      end = (end == std::string::npos) ? records.size() : end + 1;
+      if (indexer_->Add(records.substr(begin, end - begin), entry)) entries.append(reinterpret_cast<const char*>(&entry), sizeof(entry));
+      begin = end;
+    }
+  }
+  _append(target_, file_, records);
+  if (!entries.empty()) _append(target_ + timeIndexSuffix, indexFile_, entries);
+}
+
+void HistoricalFileOutput::SetStore(BondHistoricalStore* _store) {
+  store_ = _store;
+}
+
+void HistoricalFileOutput::SetIndex(std::size_t every) {
+  indexer_ = std::make_unique<TimeIndexer>(every);
+  _open();
+}
+
+template <typename T>
+void HistoricalFileOutput::_record(T& data) {
+  if (store_ != nullptr) store_->Record(data);
+}
+
+void HistoricalFileOutput::_record(const Inquiry<Bond>& data, std::chrono::system_clock::time_point time) {
+  if (store_ != nullptr) store_->Record(data, time);
+}
+
 // POSITION
+BondHistoricalPositionConnector::BondHistoricalPositionConnector() :
+  HistoricalFileOutput("Data/positions.txt") {}
+
 void BondHistoricalPositionConnector::Subscribe(const char* filename, const bool& header) {
   // they all get data from listeners
 }
 
 void BondHistoricalPositionConnector::Publish(Position<Bond>& data) {
-  // extract information we need to output
-  std::string bond_id = data.GetProduct().GetProductId();
+  _record(data);
 
-  std::string book1 = "TRSY1", book2 = "TRSY2", book3 = "TRSY3";
-
-  long pos1_long = data.GetPosition(book1), pos2_long = data.GetPosition(book2), pos3_long = data.GetPosition(book3);
-  long aggregate_long = data.GetAggregatePosition();
-
-  std::string pos1 = std::to_string(pos1_long), pos2 = std::to_string(pos2_long), pos3 = std::to_string(pos3_long);
-  std::string aggregate = std::to_string(aggregate_long);
+  // time, bond, position in each book, then the aggregate
+  std::string record = PrintTimeStamp();
+  record.append(",").append(data.GetProduct().GetProductId().c_str());
+  for (const char* book : { "TRSY1", "TRSY2", "TRSY3" }) {
+    record.append(",").append(book).append(",").append(std::to_string(data.GetPosition(book)));
+  }
+  record.append(",AGGREGATE,").append(std::to_string(data.GetAggregatePosition())).append("\n");
 
-  // open file in append mode
   try {
-    std::ofstream file;
-    file.open("Data/positions.txt", ios::app);
-    std::cout << PrintTimeStamp() << " Writing positions into 'positions.txt'..." << endl;
-    // write into file
-    file << PrintTimeStamp();
-    file << "," << bond_id << ",TRSY1," << pos1 << ",TRSY2," << pos2 << ",TRSY3," << pos3;
-    file << ",AGGREGATE," << aggregate << endl;
-    file.close();
+    _write(record);
   }
   catch (std::exception& e) {
     std::cout << "An error occurred: " << e.what() << endl;
@@ -142,56 +293,42 @@ void BondHistoricalPositionConnector::Publish(Position<Bond>& data) {
 
 // RISK
 BondHistoricalRiskConnector::BondHistoricalRiskConnector(BondRiskService* _service) :
-  bondRiskService_(_service) {}
+  HistoricalFileOutput("Data/risk.txt"), bondRiskService_(_service) {}
 
 void BondHistoricalRiskConnector::Subscribe(const char* filename, const bool& header) {
   // they all get data from listeners
 }
 
 void BondHistoricalRiskConnector::Publish(PV01<Bond>& data) {
-  // extract information we need to output
-  std::string bond_id = data.GetProduct().GetProductId();
+  _record(data);
 
-  std::string pv01 = std::to_string(data.GetPV01());
-  std::string qnt = std::to_string(data.GetQuantity());
+  // time, bond, PV01 and quantity
+  std::string record = PrintTimeStamp();
+  record.append(",").append(data.GetProduct().GetProductId().c_str());
+  record.append(",").append(std::to_string(data.GetPV01())).append(",").append(std::to_string(data.GetQuantity())).append("\n");
 
-  // open file in append mode
   try {
-    std::ofstream file;
-    file.open("Data/risk.txt", ios::app);
-    std::cout << PrintTimeStamp() << " Writing PV01 into 'risk.txt'..." << endl;
-    // write into file
-    file << PrintTimeStamp();
-    file << "," << bond_id << "," << pv01 << "," << qnt << endl;
-    file.close();
+    _write(record);
   }
   catch (std::exception& e) {
     std::cout << "An error occurred: " << e.what() << endl;
   }
 
-  // update bucketed risk and publish that as well
+  // publish bucketed risk as well - the risk service has already refreshed it for this position
   std::string sector = _findBucket(data.GetProduct());
-  bondRiskService_->UpdateBucketedRisk(sector);
-  PV01<BucketedSector<Bond>> pv01bucket = bondRiskService_->GetBucketedRisk(sector);
-  this->Publish(pv01bucket);
+  this->Publish(bondRiskService_->GetBucketedRisk(sector));
 }
 
-void BondHistoricalRiskConnector::Publish(PV01<BucketedSector<Bond>>& data) {
-  // extract information we need to output
-  std::string sector_id = data.GetProduct().GetName();
+void BondHistoricalRiskConnector::Publish(const PV01<BucketedSector<Bond>>& data) {
+  _record(data);
 
-  std::string pv01 = std::to_string(data.GetPV01());
-  std::string qnt = std::to_string(data.GetQuantity());
+  // time, sector, PV01 and quantity
+  std::string record = PrintTimeStamp();
+  record.append(",").append(data.GetProduct().GetName());
+  record.append(",").append(std::to_string(data.GetPV01())).append(",").append(std::to_string(data.GetQuantity())).append("\n");
 
-  // open file in append mode
   try {
-    std::ofstream file;
-    file.open("Data/risk.txt", ios::app);
-    std::cout << PrintTimeStamp() << " Writing bucketed PV01 into 'risk.txt'..." << endl;
-    // write into file
-    file << PrintTimeStamp();
-    file << "," << sector_id << "," << pv01 << "," << qnt << endl;
-    file.close();
+    _write(record);
   }
   catch (std::exception& e) {
     std::cout << "An error occurred: " << e.what() << endl;
@@ -199,10 +336,10 @@ void BondHistoricalRiskConnector::Publish(PV01<BucketedSector<Bond>>& data) {
 }
 
 std::string BondHistoricalRiskConnector::_findBucket(const Bond& bond) {
-  // map sector name to vector of tickers in that sector
-  std::unordered_map<std::string, std::vector<std::string>> pv_tickers = BucketMap();
+  // map sector name to vector of tickers in that sector - built once
+  static const std::unordered_map<std::string, std::vector<std::string>> pv_tickers = BucketMap();
   // find key (sector) corresponding to input bond
-  std::string id = bond.GetProductId();
+  const std::string id = bond.GetProductId();
   for (const auto& [sector, tickers] : pv_tickers) {
     if (std::find(tickers.begin(), tickers.end(), id) != tickers.end()) {
       // found it!
@@ -214,24 +351,17 @@ std::string BondHistoricalRiskConnector::_findBucket(const Bond& bond) {
 }
 
 // EXECUTION
+BondHistoricalExecutionConnector::BondHistoricalExecutionConnector() :
+  HistoricalFileOutput("Data/executions.txt") {}
+
 void BondHistoricalExecutionConnector::Subscribe(const char* filename, const bool& header) {
   // they all get data from listeners
 }
 
 void BondHistoricalExecutionConnector::Publish(ExecutionOrder<Bond>& data) {
-  // extract information we need to output
-  std::string bond_id = data.GetProduct().GetProductId();
-  std::string order_id = data.GetOrderId();
-  std::string side = (data.GetSide() == BID) ? "BID" : "OFFER";
-  std::string is_child = (data.IsChildOrder()) ? "YES" : "NO";
+  _record(data);
 
-  double price_dbl = data.GetPrice();
-  std::string price = PriceToString(price_dbl);
-
-  long visible = data.GetVisibleQuantity(), hidden = data.GetHiddenQuantity();
-  std::string visible_qnt = std::to_string(visible), hidden_qnt = std::to_string(hidden);
-
-  std::string order_type;
+  const char* order_type = "";
   OrderType type = data.GetOrderType();
   if (type == FOK) order_type = "FOK";
   else if (type == IOC) order_type = "IOC";
@@ -239,16 +369,16 @@ void BondHistoricalExecutionConnector::Publish(ExecutionOrder<Bond>& data) {
   else if (type == LIMIT) order_type = "LIMIT";
   else if (type == STOP) order_type = "STOP";
 
-  // open file in append mode
+  // time, bond, side, order id, type, price, visible and hidden quantities, child order or not
+  std::string record = PrintTimeStamp();
+  record.append(",").append(data.GetProduct().GetProductId().c_str());
+  record.append((data.GetSide() == BID) ? ",BID," : ",OFFER,").append(data.GetOrderId().c_str());
+  record.append(",").append(order_type).append(",").append(PriceToString(data.GetPrice()));
+  record.append(",").append(std::to_string(data.GetVisibleQuantity())).append(",").append(std::to_string(data.GetHiddenQuantity()));
+  record.append(data.IsChildOrder() ? ",YES\n" : ",NO\n");
+
   try {
-    std::ofstream file;
-    file.open("Data/executions.txt", ios::app);
-    std::cout << PrintTimeStamp() << " Writing execution order into 'executions.txt'..." << endl;
-    // write into file
-    file << PrintTimeStamp();
-    file << "," << bond_id << "," << side << "," << order_id << "," << order_type << ",";
-    file << price << "," << visible_qnt << "," << hidden_qnt << "," << is_child << endl;
-    file.close();
+    _write(record);
   }
   catch (std::exception& e) {
     std::cout << "An error occurred: " << e.what() << endl;
@@ -256,35 +386,27 @@ void BondHistoricalExecutionConnector::Publish(ExecutionOrder<Bond>& data) {
 }
 
 // STREAMING
+BondHistoricalStreamingConnector::BondHistoricalStreamingConnector() :
+  HistoricalFileOutput("Data/streaming.txt") {}
+
 void BondHistoricalStreamingConnector::Subscribe(const char* filename, const bool& header) {
   // they all get data from listeners
 }
 
 void BondHistoricalStreamingConnector::Publish(PriceStream<Bond>& data) {
-  // extract information we need to output
-  std::string bond_id = data.GetProduct().GetProductId();
-
-  PriceStreamOrder bidOrder = data.GetBidOrder(), offerOrder = data.GetOfferOrder();
-  
-  double bid_price_dbl = bidOrder.GetPrice(), offer_price_dbl = offerOrder.GetPrice();
-  long bid_visible_long = bidOrder.GetVisibleQuantity(), bid_hidden_long = bidOrder.GetHiddenQuantity();
-  long offer_visible_long = offerOrder.GetVisibleQuantity(), offer_hidden_long = offerOrder.GetHiddenQuantity();
-
-  std::string bid_price = PriceToString(bid_price_dbl), offer_price = PriceToString(offer_price_dbl);
-  std::string bid_visible = std::to_string(bid_visible_long), bid_hidden = std::to_string(bid_hidden_long);
-  std::string offer_visible = std::to_string(offer_visible_long), offer_hidden = std::to_string(offer_hidden_long);
+  _record(data);
+
+  // one record per side: time, bond, side, price, visible and hidden quantities
+  std::string records;
+  const std::string time = PrintTimeStamp();
+  for (const PriceStreamOrder& order : { data.GetBidOrder(), data.GetOfferOrder() }) {
+    records.append(time).append(",").append(data.GetProduct().GetProductId().c_str());
+    records.append((order.GetSide() == BID) ? ",BID," : ",OFFER,").append(PriceToString(order.GetPrice()));
+    records.append(",").append(std::to_string(order.GetVisibleQuantity())).append(",").append(std::to_string(order.GetHiddenQuantity())).append("\n");
+  }
 
-  // open file in append mode
   try {
-    std::ofstream file;
-    file.open("Data/streaming.txt", ios::app);
-    std::cout << PrintTimeStamp() << " Writing price stream into 'streaming.txt'..." << endl;
-    // write into file
-    file << PrintTimeStamp();
-    file << "," << bond_id << ",BID," << bid_price << "," << bid_visible << "," << bid_hidden << endl;
-    file << PrintTimeStamp();
-    file << "," << bond_id << ",OFFER," << offer_price << "," << offer_visible << "," << offer_hidden << endl;
-    file.close();
+    _write(records);
   }
   catch (std::exception& e) {
     std::cout << "An error occurred: " << e.what() << endl;
@@ -292,23 +414,15 @@ void BondHistoricalStreamingConnector::Publish(PriceStream<Bond>& data) {
 }
 
 // INQUIRY
+BondHistoricalInquiryConnector::BondHistoricalInquiryConnector() :
+  HistoricalFileOutput("Data/allinquiries.txt") {}
+
 void BondHistoricalInquiryConnector::Subscribe(const char* filename, const bool& header) {
   // they all get data from listeners
 }
 
-void BondHistoricalInquiryConnector::Publish(Inquiry<Bond>& data) {
-  // extract information we need to output
-  std::string inquiry_id = data.GetInquiryId();
-  std::string bond_id = data.GetProduct().GetProductId();
-  std::string side = (data.GetSide() == SELL) ? "SELL" : "BUY";
-
-  double price_dbl = data.GetPrice();
-  std::string price = PriceToString(price_dbl);
-
-  long qnt_long = data.GetQuantity();
-  std::string qnt = std::to_string(qnt_long);
-
-  std::string state;
+void BondHistoricalInquiryConnector::_format(std::string& record, const std::string& time, const Inquiry<Bond>& data) {
+  const char* state = "";
   InquiryState inquiry_state = data.GetState();
   if (inquiry_state == RECEIVED) state = "RECEIVED";
   else if (inquiry_state == QUOTED) state = "QUOTED";
@@ -316,16 +430,57 @@ void BondHistoricalInquiryConnector::Publish(Inquiry<Bond>& data) {
   else if (inquiry_state == REJECTED) state = "REJECTED";
   else if (inquiry_state == CUSTOMER_REJECTED) state = "CUSTOMER_REJECTED";
 
-  // open file in append mode
+  // time, inquiry id, bond, side, quantity, price and state
+  record.append(time).append(",").append(data.GetInquiryId().c_str()).append(",").append(data.GetProduct().GetProductId().c_str());
+  record.append((data.GetSide() == SELL) ? ",SELL," : ",BUY,").append(std::to_string(data.GetQuantity()));
+  record.append(",").append(PriceToString(data.GetPrice())).append(",").append(state).append("\n");
+}
+
+void BondHistoricalInquiryConnector::Publish(Inquiry<Bond>& data) {
+  auto now = std::chrono::system_clock::now();
+  _record(data, now);
+
+  std::string record;
+  _format(record, PrintTimeStamp(now), data);
   try {
-    std::ofstream file;
-    file.open("Data/allinquiries.txt", ios::app);
-    std::cout << PrintTimeStamp() << " Writing inquiries into 'allinquiries.txt'..." << endl;
-    // write into file
-    file << PrintTimeStamp();
-    file << "," << inquiry_id << "," << bond_id << "," << side << "," << qnt << ",";
-    file << price << "," << state << endl;
-    file.close();
+    _write(record);
+  }
+  catch (std::exception& e) {
+    std::cout << "An error occurred: " << e.what() << endl;
+  }
+}
+
+void BondHistoricalInquiryConnector::PublishBatch(std::vector<Inquiry<Bond>>& data, const std::vector<std::chrono::system_clock::time_point>& times) {
+  std::string records;
+  for (std::size_t i = 0; i < data.size(); ++i) {
+    _record(data[i], times[i]);
+    _format(records, PrintTimeStamp(times[i]), data[i]);
+  }
+  try {
+    _write(records);
+  }
+  catch (std::exception& e) {
+    std::cout << "An error occurred: " << e.what() << endl;
+  }
+}
+
+// TRADE JOURNAL
+BondHistoricalTradeConnector::BondHistoricalTradeConnector(const std::string& file_name) :
+  HistoricalFileOutput(file_name) {}
+
+void BondHistoricalTradeConnector::Subscribe(const char* filename, const bool& header) {
+  // trades get here from the service
+}
+
+void BondHistoricalTradeConnector::Publish(Trade<Bond>& data) {
+  // as in trades.txt: bond, trade id, price, book, quantity and side
+  std::string record = data.GetProduct().GetProductId().c_str();
+  record.append(",").append(data.GetTradeId().c_str()).append(",").append(PriceToString(data.GetPrice()));
+  record.append(",").append(data.GetBook().c_str()).append(",").append(std::to_string(data.GetQuantity()));
+  record.append((data.GetSide() == BUY) ? ",BUY\n" : ",SELL\n");
+
+  try {
+    _write(record);
   }
   catch (std::exception& e) {
     std::cout << "An error occurred: " << e.what() << endl;
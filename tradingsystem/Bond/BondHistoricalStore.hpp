@@ -0,0 +1,148 @@
+/**
+* BondHistoricalStore.hpp
+*
+* Columnar time series of the bond positions, risk, executions, price streams and
+* inquiries written to the historical files, queryable in process
+*
+* @author: Gabo Bernardino
+*/
+
+#ifndef BONDHISTORICALSTORE_HPP
+#define BONDHISTORICALSTORE_HPP
+
+#include <chrono>
+#include <ostream>
+#include "../timeseriesstore.hpp"
+#include "../positionservice.hpp"
+#include "../riskservice.hpp"
+#include "../executionservice.hpp"
+#include "../streamingservice.hpp"
+#include "../inquiryservice.hpp"
+
+/**
+* Bond historical store
+* One time series per historical file, with a row for each record and the same
+* values. Prices keep 8 decimals, which hold any 1/256th exactly; PV01 keeps the
+* 6 decimals written to `risk.txt`. Bucketed risk goes to the risk series under
+* the name of its sector. Execution order ids and inquiry ids, unique to each row,
+* are left to `executions.txt` and `allinquiries.txt`: inquiries are kept by bond,
+* one row per transition, stamped when it was applied.
+* Every series keeps `_retention` partitions, the last hour by default.
+*/
+class BondHistoricalStore {
+public:
+  enum PositionColumn { POSITION_TRSY1, POSITION_TRSY2, POSITION_TRSY3, POSITION_AGGREGATE };
+  enum RiskColumn { RISK_PV01, RISK_QUANTITY };
+  enum ExecutionColumn { EXECUTION_SIDE, EXECUTION_TYPE, EXECUTION_PRICE, EXECUTION_VISIBLE, EXECUTION_HIDDEN, EXECUTION_CHILD };
+  enum StreamColumn { STREAM_BID, STREAM_BID_VISIBLE, STREAM_BID_HIDDEN, STREAM_OFFER, STREAM_OFFER_VISIBLE, STREAM_OFFER_HIDDEN };
+  enum InquiryColumn { INQUIRY_SIDE, INQUIRY_QUANTITY, INQUIRY_PRICE, INQUIRY_STATE };
+
+private:
+  TimeSeriesStore<4> positions_;
+  TimeSeriesStore<2> risk_;
+  TimeSeriesStore<6> executions_;
+  TimeSeriesStore<6> streams_;
+  TimeSeriesStore<4> inquiries_;
+
+public:
+  // ctor - partitions span `_span` of time, `_retention` of them kept (0 for all)
+  BondHistoricalStore(std::chrono::nanoseconds _span = std::chrono::minutes(1), std::size_t _retention = 60);
+
+  // Add the row of a record
+  void Record(Position<Bond>& data);
+  void Record(PV01<Bond>& data);
+  void Record(const PV01<BucketedSector<Bond>>& data);
+  void Record(ExecutionOrder<Bond>& data);
+  void Record(PriceStream<Bond>& data);
+  void Record(const Inquiry<Bond>& data, std::chrono::system_clock::time_point time);
+
+  const TimeSeriesStore<4>& GetPositions() const;
+  const TimeSeriesStore<2>& GetRisk() const;
+  const TimeSeriesStore<6>& GetExecutions() const;
+  const TimeSeriesStore<6>& GetStreams() const;
+  const TimeSeriesStore<4>& GetInquiries() const;
+
+  // One line per series
+  void Report(std::ostream& output) const;
+};
+
+//*************************************************************************************************
+// BondHistoricalStore implementations
+//*************************************************************************************************
+BondHistoricalStore::BondHistoricalStore(std::chrono::nanoseconds _span, std::size_t _retention) :
+  positions_("positions", { "TRSY1", "TRSY2", "TRSY3", "AGGREGATE" }, { 0, 0, 0, 0 }, _span),
+  risk_("risk", { "PV01", "QUANTITY" }, { 6, 0 }, _span),
+  executions_("executions", { "SIDE", "TYPE", "PRICE", "VISIBLE", "HIDDEN", "CHILD" }, { 0, 0, 8, 0, 0, 0 }, _span),
+  streams_("streams", { "BID", "BID_VISIBLE", "BID_HIDDEN", "OFFER", "OFFER_VISIBLE", "OFFER_HIDDEN" }, { 8, 0, 0, 8, 0, 0 }, _span),
+  inquiries_("inquiries", { "SIDE", "QUANTITY", "PRICE", "STATE" }, { 0, 0, 8, 0 }, _span)
+{
+  positions_.SetRetention(_retention);
+  risk_.SetRetention(_retention);
+  executions_.SetRetention(_retention);
+  streams_.SetRetention(_retention);
+  inquiries_.SetRetention(_retention);
+}
+
+void BondHistoricalStore::Record(Position<Bond>& data) {
+  positions_.Append(data.GetProduct().GetProductId(), { static_cast<double>(data.GetPosition("TRSY1")),
+    static_cast<double>(data.GetPosition("TRSY2")), static_cast<double>(data.GetPosition("TRSY3")),
+    static_cast<double>(data.GetAggregatePosition()) });
+}
+
+void BondHistoricalStore::Record(PV01<Bond>& data) {
+  risk_.Append(data.GetProduct().GetProductId(), { data.GetPV01(), static_cast<double>(data.GetQuantity()) });
+}
+
+void BondHistoricalStore::Record(const PV01<BucketedSector<Bond>>& data) {
+  risk_.Append(data.GetProduct().GetName(), { data.GetPV01(), static_cast<double>(data.GetQuantity()) });
+}
+
+void BondHistoricalStore::Record(ExecutionOrder<Bond>& data) {
+  executions_.Append(data.GetProduct().GetProductId(), { static_cast<double>(data.GetSide()),
+    static_cast<double>(data.GetOrderType()), data.GetPrice(), static_cast<double>(data.GetVisibleQuantity()),
+    static_cast<double>(data.GetHiddenQuantity()), data.IsChildOrder() ? 1.0 : 0.0 });
+}
+
+void BondHistoricalStore::Record(PriceStream<Bond>& data) {
+  const PriceStreamOrder& bid = data.GetBidOrder();
+  const PriceStreamOrder& offer = data.GetOfferOrder();
+  streams_.Append(data.GetProduct().GetProductId(), { bid.GetPrice(), static_cast<double>(bid.GetVisibleQuantity()),
+    static_cast<double>(bid.GetHiddenQuantity()), offer.GetPrice(), static_cast<double>(offer.GetVisibleQuantity()),
+    static_cast<double>(offer.GetHiddenQuantity()) });
+}
+
+void BondHistoricalStore::Record(const Inquiry<Bond>& data, std::chrono::system_clock::time_point time) {
+  auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+  inquiries_.Append(nanos, data.GetProduct().GetProductId(), { static_cast<double>(data.GetSide()),
+    static_cast<double>(data.GetQuantity()), data.GetPrice(), static_cast<double>(data.GetState()) });
+}
+
+const TimeSeriesStore<4>& BondHistoricalStore::GetPositions() const {
+  return positions_;
+}
+
+const TimeSeriesStore<2>& BondHistoricalStore::GetRisk() const {
+  return risk_;
+}
+
+const TimeSeriesStore<6>& BondHistoricalStore::GetExecutions() const {
+  return executions_;
+}
+
+const TimeSeriesStore<6>& BondHistoricalStore::GetStreams() const {
+  return streams_;
+}
+
+const TimeSeriesStore<4>& BondHistoricalStore::GetInquiries() const {
+  return inquiries_;
+}
+
+void BondHistoricalStore::Report(std::ostream& output) const {
+  positions_.Report(output);
+  risk_.Report(output);
+  executions_.Report(output);
+  streams_.Report(output);
+  inquiries_.Report(output);
+}
+
+#endif // !BONDHISTORICALSTORE_HPP
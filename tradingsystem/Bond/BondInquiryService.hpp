@@ -9,33 +9,112 @@
 #ifndef BONDINQUIRYSERVICE_HPP
 #define BONDINQUIRYSERVICE_HPP
 
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
 #include "boost/algorithm/string.hpp"
 #include "../utils.hpp"
+#include "../chunkedreader.hpp"
+#include "../filetailer.hpp"
+#include "../unixsocket.hpp"
+#include "BondWireProtocol.hpp"
 #include "../inquiryservice.hpp"
+#include "../historicaldataservice.hpp"
 #include "../products.hpp"
+#include "../retentionstore.hpp"
+#include "../snapshot.hpp"
 
 /**
  * Bond inquiry service specialized for bonds;
- * stores a vector of listeners and a map of strings -> inquiry
+ * stores a vector of listeners and a bounded store of inquiry ids -> inquiry
+ * (the most recent `retention` inquiries; older ones are evicted to a journal connector)
  * also syores a pointer to a connector which  it uses to publish
  * quotes for received inquiries
  * 
  * Gets data from `inquiries.txt` via a connector and sends it back
  * to the connector to publish
  * Also communicates the data to InquiryListeners and HistoricalData listeners
+ *
+ * Each inquiry moves through its states (RECEIVED -> QUOTED -> DONE, or REJECTED,
+ * or CUSTOMER_REJECTED once quoted) by transitions queued for it: a quote, a
+ * rejection, or the client's answer sent back by the connector. The service
+ * runs them to completion in one loop, oldest inquiry first and one transition
+ * of an inquiry at a time, applying each one in place and calling the listeners
+ * on the stored inquiry. The listeners and the connector only queue transitions,
+ * so there is never more than one loop on the stack however many follow.
+ * A new inquiry arrives RECEIVED; an inquiry already stored arriving again is
+ * one more transition, never a replacement. A transition the state machine does
+ * not allow, or past the few an inquiry can have queued, is refused and counted.
+ * The historical listener, when set apart, gets the transitions of a run in one batch,
+ * each with the time it was applied.
  */
 class BondInquiryService : public InquiryService<Bond> {
 private:
   std::vector<ServiceListener<Inquiry<Bond>>*> listeners_;
-  std::unordered_map<std::string, Inquiry<Bond>> inquiries_;
+  RetentionStore<InquiryId, Inquiry<Bond>> inquiries_;
 
   Connector<Inquiry<Bond>>* bondInquiryConnector_;
 
+  static constexpr std::size_t maxTransitions_ = 4;
+
+  // A state an inquiry is queued to move to
+  struct Transition {
+    InquiryState state;
+    double price;  // of a quote
+    bool arrival;  // a new inquiry: already stored, only the listeners are left
+  };
+
+  // The transitions queued for one inquiry, oldest first
+  struct TransitionQueue {
+    std::array<Transition, maxTransitions_> items;
+    std::size_t head = 0;
+    std::size_t size = 0;
+  };
+
+  // guards the inquiries against snapshots; quoting re-enters the service on the same thread
+  std::recursive_mutex mutex_;
+
+  std::unordered_map<InquiryId, TransitionQueue> transitions_;
+  std::deque<InquiryId> ready_;  // inquiries with transitions queued, in the order they are due
+  bool running_;  // a loop is running the transitions
+
+  HistoricalDataListener<Inquiry<Bond>>* historicalListener_;
+  std::vector<Inquiry<Bond>> batch_;  // for the historical listener, at the end of the run
+  std::vector<std::chrono::system_clock::time_point> batchTimes_;  // when each of them was applied
+
+  long applied_;
+  long refused_;  // not allowed by the state machine
+  long overflowed_;  // past the transitions an inquiry can have queued
+  long runs_;
+
+  // stored inquiry for this id, default one inserted if not retained
+  Inquiry<Bond>& _getInquiry(const InquiryId& id);
+
+  // Queue a transition of an inquiry, then run the transitions unless a loop already is
+  void _queue(const InquiryId& id, const Transition& transition);
+
+  // Run the queued transitions until there are none left
+  void _run();
+
+  // Apply a transition and tell the listeners and the connector
+  void _apply(const InquiryId& id, const Transition& transition);
+
+  // Whether the state machine allows moving from one state to the other
+  static bool _allowed(InquiryState from, InquiryState to);
+
 public:
+  static constexpr std::uint32_t snapshotTag_ = 5;
+
   //ctor
-  BondInquiryService();
+  BondInquiryService(std::size_t retention = 1 << 16);
   void SetConnector(Connector<Inquiry<Bond>>* _connector);
 
+  // Connector receiving the inquiries evicted from the service
+  void SetEvictionConnector(Connector<Inquiry<Bond>>* _connector);
+
   // Get data on our service given a key
   virtual Inquiry<Bond>& GetData(std::string key) override;
 
@@ -49,25 +128,60 @@ public:
   // Get all listeners on the Service.
   virtual const vector<ServiceListener<Inquiry<Bond>>*>& GetListeners() const override;
 
+  // Historical listener, given the inquiries of each run in one batch rather than called on each
+  void SetHistoricalListener(HistoricalDataListener<Inquiry<Bond>>* listener);
+
   // Send a quote back to the client
-  virtual void SendQuote(const string& inquiryId, double price) override;
+  virtual void SendQuote(const InquiryId& inquiryId, double price) override;
 
   // Reject an inquiry from the client
-  virtual void RejectInquiry(const string& inquiryId) override;
+  virtual void RejectInquiry(const InquiryId& inquiryId) override;
+
+  // Move an inquiry to a new state, e.g. the client's answer to a quote
+  void TransitionInquiry(const InquiryId& inquiryId, InquiryState state);
+
+  // Print the transitions applied and refused, and the runs they took
+  void Report(std::ostream& output);
+
+  // Snapshot the inquiries still open (received or quoted)
+  void SaveState(SnapshotWriter& writer);
+
+  // Restore the open inquiries of a snapshot; listeners are not called
+  void LoadState(SnapshotReader& reader);
 };
 
 /**
 * Inquiry connector class specialized for bonds;
 * Reads from `inquiries.txt` and sends the Inquiry object to the service
-* Publishes received inquiries after quoting them
+* Publishes the quoted inquiries to the client, who takes them (DONE)
+* With a task pool set, the file is parsed in chunks on the pool
+* Can also serve inquiries pushed as binary frames on a Unix socket
 */
 class BondInquiryConnector : public Connector<Inquiry<Bond>> {
 private:
   BondInquiryService* bondInquiryService_;
+  ChunkedFileReader<Inquiry<Bond>> reader_;
+
+  // Send a parsed line on to the service
+  void _deliver(Inquiry<Bond>& inquiry_obj);
+
 public:
   BondInquiryConnector(BondInquiryService* _service);
   BondInquiryConnector() = default;
 
+  // Parse a line: inquiry id, bond id, side, quantity, price, state
+  static bool ParseLine(const char* begin, const char* end, Inquiry<Bond>& inquiry);
+
+  // Parse the file in chunks on a pool (nullptr reads it line by line)
+  void SetTaskPool(WorkStealingPool* _pool);
+
+  // Follow a file still being written, until `stop` returns true
+  void Tail(const char* filename, const std::function<bool()>& stop, const bool& header = true);
+
+  // Serve binary frames (BondWireProtocol.hpp) from any number of clients on a Unix socket,
+  // until `stop` returns true
+  void ServeSocket(const char* path, const std::function<bool()>& stop);
+
   // Subscribe to a Service
   virtual void Subscribe(const char* filename, const bool& header = true) override;
 
@@ -76,53 +190,128 @@ public:
 };
 
 
-/**
-* Inquiry listener specialized for bonds
-* Sends back a quote of 100 when the inquiry is in `RECEIVED` state
-*/
-class BondInquiryListener : public ServiceListener<Inquiry<Bond>> {
-private:
-  BondInquiryService* bondInquiryService_;
+//*************************************************************************************************
+// BondInquiryService implementations
+//*************************************************************************************************
+BondInquiryService::BondInquiryService(std::size_t retention) :
+  inquiries_(retention), running_(false), historicalListener_(nullptr), applied_(0), refused_(0), overflowed_(0), runs_(0) {}
 
-public:
-  // ctor
-  BondInquiryListener(BondInquiryService* _service);
-  BondInquiryListener() = default;
+void BondInquiryService::SetConnector(Connector<Inquiry<Bond>>* _connector) {
+  bondInquiryConnector_ = _connector;
+}
 
-  // Listener callback to process an add event to the Service
-  virtual void ProcessAdd(Inquiry<Bond>& data) override;
+void BondInquiryService::SetEvictionConnector(Connector<Inquiry<Bond>>* _connector) {
+  inquiries_.SetEvictionConnector(_connector);
+}
 
-  // Listener callback to process a remove event to the Service
-  virtual void ProcessRemove(Inquiry<Bond>& data) override;
+Inquiry<Bond>& BondInquiryService::_getInquiry(const InquiryId& id) {
+  Inquiry<Bond>* inquiry = inquiries_.Find(id);
+  return (inquiry != nullptr) ? *inquiry : inquiries_.Insert(id, Inquiry<Bond>());
+}
 
-  // Listener callback to process an update event to the Service
-  virtual void ProcessUpdate(Inquiry<Bond>& data) override;
-};
+bool BondInquiryService::_allowed(InquiryState from, InquiryState to) {
+  if (from == RECEIVED) return to == QUOTED || to == REJECTED;
+  if (from == QUOTED) return to == DONE || to == CUSTOMER_REJECTED;
+  return false;
+}
 
-//*************************************************************************************************
-// BondInquiryService implementations
-//*************************************************************************************************
-BondInquiryService::BondInquiryService() {
-  inquiries_ = std::unordered_map<std::string, Inquiry<Bond>>();
+void BondInquiryService::_queue(const InquiryId& id, const Transition& transition) {
+  TransitionQueue& queue = transitions_[id];
+  if (queue.size == maxTransitions_) {
+    overflowed_++;  // a flood of them: counted for the report rather than logged one by one
+    return;
+  }
+  queue.items[(queue.head + queue.size) % maxTransitions_] = transition;
+  if (++queue.size == 1) ready_.push_back(id);
+
+  if (!running_) _run();  // otherwise queued behind the running transition
 }
 
-void BondInquiryService::SetConnector(Connector<Inquiry<Bond>>* _connector) {
-  bondInquiryConnector_ = _connector;
+void BondInquiryService::_run() {
+  running_ = true;
+  runs_++;
+  try {
+    while (!ready_.empty()) {
+      InquiryId id = ready_.front();
+      ready_.pop_front();
+      TransitionQueue& queue = transitions_[id];  // stays valid while more inquiries are queued
+      Transition transition = queue.items[queue.head];
+      queue.head = (queue.head + 1) % maxTransitions_;
+      bool more = --queue.size > 0;
+
+      _apply(id, transition);
+
+      if (more) ready_.push_back(id);  // after the other inquiries due
+      else if (queue.size == 0) transitions_.erase(id);
+    }
+    if (historicalListener_ != nullptr && !batch_.empty()) historicalListener_->ProcessBatch(batch_, batchTimes_);
+  }
+  catch (...) {
+    // a failed run drops what it queued, so the next one starts clean
+    transitions_.clear();
+    ready_.clear();
+    batch_.clear();
+    batchTimes_.clear();
+    running_ = false;
+    throw;
+  }
+  batch_.clear();
+  batchTimes_.clear();
+  running_ = false;
+}
+
+void BondInquiryService::_apply(const InquiryId& id, const Transition& transition) {
+  Inquiry<Bond>* inquiry = inquiries_.Find(id);
+  if (inquiry == nullptr) return;  // evicted since
+
+  if (!transition.arrival) {
+    if (!_allowed(inquiry->GetState(), transition.state)) {
+      std::cout << "Inquiry " << id << " cannot move to state " << transition.state << " from " << inquiry->GetState() << std::endl;
+      refused_++;
+      return;
+    }
+    inquiry->SetState(transition.state);
+    if (transition.state == QUOTED) inquiry->SetPrice(transition.price);
+  }
+  applied_++;
+
+  for (auto l : listeners_) {
+    l->ProcessAdd(*inquiry);  // this is for the historical data listener
+    l->ProcessUpdate(*inquiry);  // the listener will send back a quote if it is received
+  }
+  if (historicalListener_ != nullptr) {
+    batch_.push_back(*inquiry);
+    batchTimes_.push_back(std::chrono::system_clock::now());
+  }
+
+  // the client sees the quote or the rejection
+  if (!transition.arrival && (transition.state == QUOTED || transition.state == REJECTED)) {
+    bondInquiryConnector_->Publish(*inquiry);
+  }
 }
 
 Inquiry<Bond>& BondInquiryService::GetData(std::string key) {
-  return inquiries_[key];
+  return _getInquiry(InquiryId(key));
 }
 
 void BondInquiryService::OnMessage(Inquiry<Bond>& data) {
-  // add inquiry to map
-  std::string id = data.GetInquiryId();
-  inquiries_[id] = data;
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  const InquiryId& id = data.GetInquiryId();
 
-  for (auto l : listeners_) {
-    l->ProcessAdd(data);  // this is for the historical data listener
-    l->ProcessUpdate(data);  // the listener will send back a quote if it is received
+  // an inquiry already stored only moves on, as the state machine allows
+  if (inquiries_.Find(id) != nullptr) {
+    _queue(id, Transition{ data.GetState(), data.GetPrice(), false });
+    return;
   }
+
+  // a new one starts received
+  if (data.GetState() != RECEIVED) {
+    std::cout << "Inquiry " << id << " cannot arrive in state " << data.GetState() << std::endl;
+    refused_++;
+    return;
+  }
+  inquiries_.Insert(id, data);
+  _queue(id, Transition{ RECEIVED, data.GetPrice(), true });
 }
 
 void BondInquiryService::AddListener(ServiceListener<Inquiry<Bond>>* listener) {
@@ -133,24 +322,59 @@ const vector<ServiceListener<Inquiry<Bond>>*>& BondInquiryService::GetListeners(
   return listeners_;
 }
 
-void BondInquiryService::SendQuote(const string& inquiryId, double price) {
-  // modify quote and send back to the connector
-  Inquiry<Bond>& inquiry = inquiries_[inquiryId];  // get a reference so we can modify
-  inquiry.SetPrice(price);
-  
-  std::cout << "Modified price of inquiry " << inquiry.GetInquiryId();
-  std::cout << "; publishing the quoted inquiry" << std::endl;
-  bondInquiryConnector_->Publish(inquiry);
+void BondInquiryService::SetHistoricalListener(HistoricalDataListener<Inquiry<Bond>>* listener) {
+  historicalListener_ = listener;
+}
+
+void BondInquiryService::SendQuote(const InquiryId& inquiryId, double price) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  std::cout << "Modified price of inquiry " << inquiryId << "; publishing the quoted inquiry" << std::endl;
+  _queue(inquiryId, Transition{ QUOTED, price, false });
+}
+
+void BondInquiryService::RejectInquiry(const InquiryId& inquiryId) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  std::cout << "Rejected inquiry " << inquiryId << "; publishing the rejected inquiry" << std::endl;
+  _queue(inquiryId, Transition{ REJECTED, 0., false });
 }
 
-void BondInquiryService::RejectInquiry(const string& inquiryId) {
-  // modify state and send back to the connector
-  Inquiry<Bond>& inquiry = inquiries_[inquiryId];  // get a reference so we can modify
-  inquiry.SetState(REJECTED);
+void BondInquiryService::TransitionInquiry(const InquiryId& inquiryId, InquiryState state) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  _queue(inquiryId, Transition{ state, 0., false });
+}
+
+void BondInquiryService::Report(std::ostream& output) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  output << "Inquiry service: " << applied_ << " transitions in " << runs_ << " runs, " << refused_
+    << " refused by the state machine, " << overflowed_ << " past the queue limit" << std::endl;
+}
 
-  std::cout << "Rejected inquiry " << inquiry.GetInquiryId();
-  std::cout << "; publishing the rejected inquiry" << std::endl;
-  bondInquiryConnector_->Publish(inquiry);
+void BondInquiryService::SaveState(SnapshotWriter& writer) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  writer.BeginSection(snapshotTag_);
+  inquiries_.ForEach([&writer](const InquiryId& id, const Inquiry<Bond>& inquiry) {
+    if (inquiry.GetState() != RECEIVED && inquiry.GetState() != QUOTED) return;
+    writer.Put(id);
+    writer.Put(inquiry.GetProduct().GetProductId());
+    writer.Put(inquiry.GetSide());
+    writer.Put(inquiry.GetQuantity());
+    writer.Put(inquiry.GetPrice());
+    writer.Put(inquiry.GetState());
+  });
+}
+
+void BondInquiryService::LoadState(SnapshotReader& reader) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  if (!reader.FindSection(snapshotTag_)) throw std::runtime_error("snapshot has no inquiries");
+  while (reader.More()) {
+    InquiryId id = reader.Get<InquiryId>();
+    const Bond& bond = MakeBond(reader.Get<ProductId>());
+    Side side = reader.Get<Side>();
+    long quantity = reader.Get<long>();
+    double price = reader.Get<double>();
+    InquiryState state = reader.Get<InquiryState>();
+    inquiries_.Insert(id, Inquiry<Bond>(id, bond, side, quantity, price, state));
+  }
 }
 
 // ************************************************************************************************
@@ -159,47 +383,58 @@ void BondInquiryService::RejectInquiry(const string& inquiryId) {
 BondInquiryConnector::BondInquiryConnector(BondInquiryService* _service) :
   bondInquiryService_(_service) {}
 
-void BondInquiryConnector::Subscribe(const char* filename, const bool& header) {
-  std::string line;
-  std::vector<std::string> row;  // to store output of string splitting
-  std::string inquiry_id;
-  Bond bond;  // bond object for the bond being inquired
-  Side side; // buy or sell
-  long qnt;
+bool BondInquiryConnector::ParseLine(const char* begin, const char* end, Inquiry<Bond>& inquiry) {
+  // get id, bond id, side, quntity, price and status
+  std::array<std::pair<const char*, const char*>, 6> row;
+  if (SplitFields(begin, end, ',', row) < 6) return false;
+  auto field = [&row](int i) { return std::string_view(row[i].first, row[i].second - row[i].first); };
+
+  // get inquiry information
+  InquiryId inquiry_id;  // THIS IS WHAT THE SERVICE IS KEYED ON!
+  ProductId id;
+  if (!inquiry_id.TryAppend(row[0].first, row[0].second - row[0].first) || !id.TryAppend(row[1].first, row[1].second - row[1].first)) return false;
+  const Bond& bond = MakeBond(id);
+  Side side = (field(2) == "SELL") ? SELL : BUY;
+  long qnt = 0;
+  std::from_chars(row[3].first, row[3].second, qnt);
   double price;
-  InquiryState state;  // received -> quoted -> done
+  if (!TryStringToPrice(row[4].first, row[4].second, price)) return RejectField("price", row[4].first, row[4].second);
+  InquiryState state = RECEIVED;  // received -> quoted -> done
+  if (field(5) == "QUOTED")
+    state = QUOTED;
+  else if (field(5) == "DONE")
+    state = DONE;
+  else if (field(5) == "REJECTED")
+    state = REJECTED;
+  else if (field(5) == "CUSTOMER_REJECTED")
+    state = CUSTOMER_REJECTED;
+
+  inquiry = Inquiry<Bond>(inquiry_id, bond, side, qnt, price, state);
+  return true;
+}
+
+void BondInquiryConnector::_deliver(Inquiry<Bond>& inquiry_obj) {
+  // send inquiry object to service
+  std::cout << std::endl << PrintTimeStamp() << std::endl;
+  bondInquiryService_->OnMessage(inquiry_obj);
+}
 
+void BondInquiryConnector::Subscribe(const char* filename, const bool& header) {
   try {
+    if (reader_.GetTaskPool() != nullptr) {
+      reader_.Read(filename, header, ParseLine, [this](Inquiry<Bond>& inquiry_obj) { _deliver(inquiry_obj); });
+      return;
+    }
+
+    std::string line;
+    Inquiry<Bond> inquiry_obj;
     std::ifstream in(filename);
     if (header) std::getline(in, line);  // skip header
 
     while (std::getline(in, line)) {
       // preprocess line string
       boost::algorithm::trim(line);
-      // get id, bond id, side, quntity, price and status
-      boost::algorithm::split(row, line, boost::algorithm::is_any_of(","));
-
-      // get inquiry information
-      inquiry_id = row[0];  // THIS IS WHAT THE SERVICE IS KEYED ON!
-      bond = MakeBond(row[1]);
-      side = (row[2] == "SELL") ? SELL : BUY;
-      qnt = std::stol(row[3]);
-      price = StringToPrice(row[4]);
-      if (row[5] == "RECEIVED")
-        state = RECEIVED;
-      else if (row[5] == "QUOTED")
-        state = QUOTED;
-      else if (row[5] == "DONE")
-        state = DONE;
-      else if (row[5] == "REJECTED")
-        state = REJECTED;
-      else if (row[5] == "CUSTOMER_REJECTED")
-        state = CUSTOMER_REJECTED;
-
-      // create inquiry object and send it to service
-      std::cout << std::endl << PrintTimeStamp() << std::endl;
-      Inquiry<Bond> inquiry_obj(inquiry_id, bond, side, qnt, price, state);
-      bondInquiryService_->OnMessage(inquiry_obj);
+      if (ParseLine(line.data(), line.data() + line.size(), inquiry_obj)) _deliver(inquiry_obj);
     }    
   }
   catch (std::exception& e) {
@@ -207,42 +442,49 @@ void BondInquiryConnector::Subscribe(const char* filename, const bool& header) {
   }
 }
 
-void BondInquiryConnector::Publish(Inquiry<Bond>& data) {
-  if (data.GetState() == RECEIVED) {
-    // transition the inquiry to the QUOTED state and send it back to the BondInquiryService
-    data.SetState(QUOTED);
-    std::cout << "Connector sending back quoted inquiry " << data.GetInquiryId() << std::endl;
-    bondInquiryService_->OnMessage(data);  // new price was already set by the service
-    // immediately send update with DONE state
-    data.SetState(DONE);
-    std::cout << "Connector updating inquiry " << data.GetInquiryId() << " to done." << std::endl;
-    bondInquiryService_->OnMessage(data);
-  }
-  else {
-    std::cout << "Inquiry was rejected" << std::endl;
-  }
+void BondInquiryConnector::SetTaskPool(WorkStealingPool* _pool) {
+  reader_.SetTaskPool(_pool);
 }
 
-//*************************************************************************************************
-// BondInquiryListener implementations
-//*************************************************************************************************
-BondInquiryListener::BondInquiryListener(BondInquiryService* _service) :
-  bondInquiryService_(_service) {}
-
-void BondInquiryListener::ProcessAdd(Inquiry<Bond>& data) {
-  // not implemented
+void BondInquiryConnector::Tail(const char* filename, const std::function<bool()>& stop, const bool& header) {
+  try {
+    FileTailer tailer(filename);
+    Inquiry<Bond> inquiry_obj;
+    tailer.Run([this, &inquiry_obj](const char* begin, const char* end) {
+      if (ParseLine(begin, end, inquiry_obj)) _deliver(inquiry_obj);
+    }, stop, header);
+  }
+  catch (std::exception& e) {
+    std::cout << "An error occurred: " << e.what() << std::endl;
+  }
 }
 
-void BondInquiryListener::ProcessRemove(Inquiry<Bond>& data) {
-  // not implemented
+void BondInquiryConnector::ServeSocket(const char* path, const std::function<bool()>& stop) {
+  try {
+    UnixSocketServer server(path, wireFrameSize);
+    Inquiry<Bond> inquiry_obj;
+    long rejected = 0;  // frames of another type, or with an unknown side or state
+    server.Run([this, &inquiry_obj, &rejected](const char* frame) {
+      if (DecodeInquiry(frame, inquiry_obj)) _deliver(inquiry_obj);
+      else rejected++;
+    }, stop);
+    std::cout << PrintTimeStamp() << " " << path << ": " << server.GetFrameCount() << " frames from "
+      << server.GetClientCount() << " clients in " << server.GetRecvCount() << " reads, " << rejected << " rejected" << std::endl;
+  }
+  catch (std::exception& e) {
+    std::cout << "An error occurred: " << e.what() << std::endl;
+  }
 }
 
-void BondInquiryListener::ProcessUpdate(Inquiry<Bond>& data) {
-  // You should register a ServiceListener on the BondInquiryService
-  // which sends back a quote of 100 when the inquiry is in the RECEIVED state
-  if (data.GetState() == RECEIVED) {
-    std::cout << "Received inquiry, sending back a quote of 100" << std::endl;
-    bondInquiryService_->SendQuote(data.GetInquiryId(), 100.);
+void BondInquiryConnector::Publish(Inquiry<Bond>& data) {
+  if (data.GetState() == QUOTED) {
+    // the client takes the quote straight away
+    std::cout << "Connector sending back quoted inquiry " << data.GetInquiryId() << std::endl;
+    std::cout << "Connector updating inquiry " << data.GetInquiryId() << " to done." << std::endl;
+    bondInquiryService_->TransitionInquiry(data.GetInquiryId(), DONE);
+  }
+  else {
+    std::cout << "Inquiry was rejected" << std::endl;
   }
 }
 
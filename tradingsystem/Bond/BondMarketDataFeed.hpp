@@ -0,0 +1,269 @@
+/**
+* BondMarketDataFeed.hpp
+*
+* Shared-memory market data feed: prices and order books published by a feed
+* process and read by the pricing and market data connectors of other processes
+*
+* @author: Gabo Bernardino
+*/
+
+#ifndef BONDMARKETDATAFEED_HPP
+#define BONDMARKETDATAFEED_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "../shmring.hpp"
+#include "../latencystats.hpp"
+#include "../pricingservice.hpp"
+#include "../marketdataservice.hpp"
+#include "../utils.hpp"
+
+// Default name of the shared memory segment carrying the feed
+const char* const defaultFeedName = "/mth9815_marketdata";
+
+/**
+* Message of the feed, trivially copyable so it can sit in shared memory
+* Carries either a price or an order book (up to `maxLevels_` orders a side),
+* and the monotonic time at which it was published, for the delivery latency
+*/
+struct FeedMessage {
+  static constexpr int maxLevels_ = 16;
+
+  enum Kind : std::int32_t { PRICE, ORDER_BOOK };
+
+  struct Level {
+    double price;
+    long quantity;
+  };
+
+  Kind kind;
+  ProductId productId;
+  std::int64_t publishedNanos;
+
+  // PRICE
+  double mid;
+  double bidOfferSpread;
+
+  // ORDER_BOOK
+  std::int32_t nBids;
+  std::int32_t nOffers;
+  Level bids[maxLevels_];
+  Level offers[maxLevels_];
+};
+
+// Monotonic clock shared by every process on the host, in nanoseconds
+std::int64_t FeedClockNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Build a feed message from a price
+FeedMessage MakeFeedMessage(const Price<Bond>& price) {
+  FeedMessage message{};
+  message.kind = FeedMessage::PRICE;
+  message.productId = price.GetProduct().GetProductId();
+  message.mid = price.GetMid();
+  message.bidOfferSpread = price.GetBidOfferSpread();
+  return message;
+}
+
+// Build a feed message from an order book - orders past `maxLevels_` a side are dropped
+FeedMessage MakeFeedMessage(const OrderBook<Bond>& book) {
+  FeedMessage message{};
+  message.kind = FeedMessage::ORDER_BOOK;
+  message.productId = book.GetProduct().GetProductId();
+
+  auto copy_side = [](const vector<Order>& stack, FeedMessage::Level* levels, std::int32_t& n) {
+    n = static_cast<std::int32_t>(std::min<std::size_t>(stack.size(), FeedMessage::maxLevels_));
+    for (std::int32_t i = 0; i < n; ++i) levels[i] = FeedMessage::Level{ stack[i].GetPrice(), stack[i].GetQuantity() };
+  };
+  copy_side(book.GetBidStack(), message.bids, message.nBids);
+  copy_side(book.GetOfferStack(), message.offers, message.nOffers);
+  return message;
+}
+
+Price<Bond> FeedMessageToPrice(const FeedMessage& message) {
+  return Price<Bond>(MakeBond(message.productId), message.mid, message.bidOfferSpread);
+}
+
+OrderBook<Bond> FeedMessageToOrderBook(const FeedMessage& message) {
+  vector<Order> bid_stack, offer_stack;
+  for (std::int32_t i = 0; i < message.nBids; ++i) bid_stack.push_back(Order(message.bids[i].price, message.bids[i].quantity, BID));
+  for (std::int32_t i = 0; i < message.nOffers; ++i) offer_stack.push_back(Order(message.offers[i].price, message.offers[i].quantity, OFFER));
+  return OrderBook<Bond>(MakeBond(message.productId), bid_stack, offer_stack);
+}
+
+/**
+* Publisher of the feed
+* Listens to a pricing service and a market data service, and publishes every
+* price and order book they receive on the shared memory ring, stamped with the
+* time of publication. Publishing is serialized, so the two services may run on
+* different threads of the feed process.
+*/
+class BondFeedPublisher : public ServiceListener<Price<Bond>>, public ServiceListener<OrderBook<Bond>> {
+private:
+  ShmRingWriter<FeedMessage> ring_;
+  std::mutex mutex_;  // the ring has a single writer
+
+  void _publish(FeedMessage& message);
+
+public:
+  // ctor - creates the feed, replacing any previous one with that name
+  BondFeedPublisher(const std::string& _name = defaultFeedName, std::size_t _capacity = 1 << 14);
+
+  // Listener callbacks: publish prices
+  virtual void ProcessAdd(Price<Bond>& data) override;
+  virtual void ProcessRemove(Price<Bond>& data) override;
+  virtual void ProcessUpdate(Price<Bond>& data) override;
+
+  // Listener callbacks: publish order books
+  virtual void ProcessAdd(OrderBook<Bond>& data) override;
+  virtual void ProcessRemove(OrderBook<Bond>& data) override;
+  virtual void ProcessUpdate(OrderBook<Bond>& data) override;
+
+  // Tell the readers the feed is over
+  void Close();
+
+  // Remove the feed's name: readers attached keep reading it, new ones no longer find it
+  void Unlink();
+
+  std::uint64_t GetPublishedCount() const;
+};
+
+/**
+* Reader of the feed for one kind of message
+* Waits for the feed to be created, then busy-polls its own cursor on the ring
+* (yielding when idle) until the feed is closed and drained or `stop` returns true.
+* Records the delivery latency of every message, from publish to the start of its processing.
+*/
+class BondFeedReader {
+private:
+  std::string name_;
+  FeedMessage::Kind kind_;
+  LatencyStats latency_;
+  std::uint64_t received_;
+  std::uint64_t lost_;
+
+public:
+  // ctor
+  BondFeedReader(const std::string& _name, FeedMessage::Kind _kind);
+
+  // Read messages of our kind and hand them to `on_message`
+  void Run(const std::function<void(const FeedMessage&)>& on_message, const std::function<bool()>& stop);
+
+  const LatencyStats& GetLatency() const;
+  std::uint64_t GetReceivedCount() const;
+
+  // Messages overwritten before they were read, of any kind
+  std::uint64_t GetLostCount() const;
+};
+
+//*************************************************************************************************
+// BondFeedPublisher implementations
+//*************************************************************************************************
+BondFeedPublisher::BondFeedPublisher(const std::string& _name, std::size_t _capacity) :
+  ring_(_name, _capacity) {}
+
+void BondFeedPublisher::_publish(FeedMessage& message) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  message.publishedNanos = FeedClockNanos();
+  ring_.Publish(message);
+}
+
+void BondFeedPublisher::ProcessAdd(Price<Bond>& data) {
+  FeedMessage message = MakeFeedMessage(data);
+  _publish(message);
+}
+
+void BondFeedPublisher::ProcessRemove(Price<Bond>& data) {
+  // not implemented
+}
+
+void BondFeedPublisher::ProcessUpdate(Price<Bond>& data) {
+  ProcessAdd(data);
+}
+
+void BondFeedPublisher::ProcessAdd(OrderBook<Bond>& data) {
+  FeedMessage message = MakeFeedMessage(data);
+  _publish(message);
+}
+
+void BondFeedPublisher::ProcessRemove(OrderBook<Bond>& data) {
+  // not implemented
+}
+
+void BondFeedPublisher::ProcessUpdate(OrderBook<Bond>& data) {
+  ProcessAdd(data);
+}
+
+void BondFeedPublisher::Close() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ring_.Close();
+}
+
+void BondFeedPublisher::Unlink() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ring_.Unlink();
+}
+
+std::uint64_t BondFeedPublisher::GetPublishedCount() const {
+  return ring_.GetPublishedCount();
+}
+
+//*************************************************************************************************
+// BondFeedReader implementations
+//*************************************************************************************************
+BondFeedReader::BondFeedReader(const std::string& _name, FeedMessage::Kind _kind) :
+  name_(_name), kind_(_kind), received_(0), lost_(0) {}
+
+void BondFeedReader::Run(const std::function<void(const FeedMessage&)>& on_message, const std::function<bool()>& stop) {
+  // the feed process may start after us
+  std::unique_ptr<ShmRingReader<FeedMessage>> ring;
+  while (ring == nullptr) {
+    if (stop()) return;
+    try {
+      ring = std::make_unique<ShmRingReader<FeedMessage>>(name_, true);
+    }
+    catch (std::runtime_error&) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  }
+
+  FeedMessage message;
+  long idle = 0;
+  while (true) {
+    if (ring->Poll(message)) {
+      idle = 0;
+      if (message.kind != kind_) continue;
+      latency_.Record(static_cast<std::uint64_t>(std::max<std::int64_t>(0, FeedClockNanos() - message.publishedNanos)));
+      received_++;
+      on_message(message);
+      continue;
+    }
+    if (ring->Finished()) break;
+    // spin for a while before giving the core away, and check `stop` now and then
+    if (++idle % 1024 == 0) {
+      if (stop()) break;
+      std::this_thread::yield();
+    }
+  }
+  lost_ = ring->GetLostCount();
+}
+
+const LatencyStats& BondFeedReader::GetLatency() const {
+  return latency_;
+}
+
+std::uint64_t BondFeedReader::GetReceivedCount() const {
+  return received_;
+}
+
+std::uint64_t BondFeedReader::GetLostCount() const {
+  return lost_;
+}
+
+#endif // !BONDMARKETDATAFEED_HPP
@@ -9,9 +9,16 @@
 #ifndef BONDMARKETDATASERVICE_HPP
 #define BONDMARKETDATASERVICE_HPP
 
+#include <charconv>
+#include <mutex>
 #include "boost/algorithm/string.hpp"
 #include "../marketdataservice.hpp"
 #include "../utils.hpp"
+#include "../workstealingpool.hpp"
+#include "../chunkedreader.hpp"
+#include "../filetailer.hpp"
+#include "../snapshot.hpp"
+#include "BondMarketDataFeed.hpp"
 
 /**
 * Market data service class specialized for bonds;
@@ -23,9 +30,15 @@
 class BondMarketDataService : public MarketDataService<Bond> {
 private:
   std::vector<ServiceListener<OrderBook<Bond>>*> listeners_;
-  std::unordered_map<std::string, OrderBook<Bond>> books_;  // keyed on product id
+  std::unordered_map<ProductId, OrderBook<Bond>> books_;  // keyed on product id
+  std::mutex mutex_;  // guards the books against snapshots
+
+  // Merge the orders at the same price, in place
+  void _aggregate(OrderBook<Bond>& book);
 
 public:
+  static constexpr std::uint32_t snapshotTag_ = 4;
+
   // ctor
   BondMarketDataService();
 
@@ -43,25 +56,62 @@ public:
   virtual const vector<ServiceListener<OrderBook<Bond>>*>& GetListeners() const override;
 
   // Get the best bid/offer order
-  virtual const BidOffer& GetBestBidOffer(const string& productId) override;
+  virtual BidOffer GetBestBidOffer(const string& productId) override;
 
   // Aggregate the order book
   virtual const OrderBook<Bond>& AggregateDepth(const string& productId) override;
+
+  // Snapshot the stored books
+  void SaveState(SnapshotWriter& writer);
+
+  // Restore the books of a snapshot; listeners are not called
+  void LoadState(SnapshotReader& reader);
+};
+
+/**
+* One line of `marketdata.txt`: an order on a product
+*/
+struct MarketDataLine {
+  ProductId productId;
+  Order order;
 };
 
 /**
 * Market data connector class specialized for bonds;
 * Reads from `marketdata.txt`, creates OrderBook object and sends it to the service
 * Subscribe-only connector
+* With a task pool set, the file is parsed in chunks on the pool; lines are still
+* grouped into books in file order, so a book may span two chunks
 */
 class BondMarketDataConnector : public Connector<OrderBook<Bond>> {
 private:
   BondMarketDataService* marketDataService_;
+  ChunkedFileReader<MarketDataLine> reader_;
+
+  // lines are grouped into books as they arrive, whichever way the file is read
+  static constexpr long ordersPerBond_ = 10L;  // HARDCODED, instructions say 5 bids, 5 offers
+  std::vector<Order> bidStack_, offerStack_;
+  long counter_ = 0L;
+
+  // Add a parsed line to the current book, and send the book to the service once full
+  void _deliver(MarketDataLine& line);
 
 public:
   BondMarketDataConnector(BondMarketDataService* _service);
   BondMarketDataConnector() = default;
 
+  // Parse a line: bond id, price, size, side
+  static bool ParseLine(const char* begin, const char* end, MarketDataLine& line);
+
+  // Parse the file in chunks on a pool (nullptr reads it line by line)
+  void SetTaskPool(WorkStealingPool* _pool);
+
+  // Follow a file still being written, until `stop` returns true
+  void Tail(const char* filename, const std::function<bool()>& stop, const bool& header = true);
+
+  // Read the order books of a shared memory feed, until the feed ends or `stop` returns true
+  void SubscribeFeed(BondFeedReader& reader, const std::function<bool()>& stop);
+
   // Subscribe to a Service
   virtual void Subscribe(const char* filename, const bool& header = true) override;
 
@@ -74,7 +124,7 @@ public:
 // BondMarketDataService implementations
 // ************************************************************************************************
 BondMarketDataService::BondMarketDataService() {
-  books_ = std::unordered_map<std::string, OrderBook<Bond>>();
+  books_ = std::unordered_map<ProductId, OrderBook<Bond>>();
 }
 
 OrderBook<Bond>& BondMarketDataService::GetData(std::string key) {
@@ -83,8 +133,11 @@ OrderBook<Bond>& BondMarketDataService::GetData(std::string key) {
 
 void BondMarketDataService::OnMessage(OrderBook<Bond>& data) {
   // add data to stored books
-  std::string id = data.GetProduct().GetProductId();
-  books_[id] = data;
+  const ProductId& id = data.GetProduct().GetProductId();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    books_[id] = data;
+  }
 
   // communicate book to listeners
   cout << "Communicating order book to algo execution listeners..." << endl;
@@ -101,15 +154,56 @@ const vector<ServiceListener<OrderBook<Bond>>*>& BondMarketDataService::GetListe
   return listeners_;
 }
 
-const BidOffer& BondMarketDataService::GetBestBidOffer(const string& productId) {
+BidOffer BondMarketDataService::GetBestBidOffer(const string& productId) {
   return books_[productId].GetBestBidOffer();
 }
 
 const OrderBook<Bond>& BondMarketDataService::AggregateDepth(const string& productId) {
+  OrderBook<Bond>& book = books_[productId];
+  _aggregate(book);
+  return book;
+}
+
+void BondMarketDataService::SaveState(SnapshotWriter& writer) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  writer.BeginSection(snapshotTag_);
+  auto put_stack = [&writer](const vector<Order>& stack) {
+    writer.Put(static_cast<std::uint64_t>(stack.size()));
+    for (const Order& order : stack) {
+      writer.Put(order.GetPrice());
+      writer.Put(order.GetQuantity());
+    }
+  };
+  for (const auto& [id, book] : books_) {
+    writer.Put(id);
+    put_stack(book.GetBidStack());
+    put_stack(book.GetOfferStack());
+  }
+}
+
+void BondMarketDataService::LoadState(SnapshotReader& reader) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!reader.FindSection(snapshotTag_)) throw std::runtime_error("snapshot has no order books");
+  auto get_stack = [&reader](PricingSide side) {
+    vector<Order> stack(reader.Get<std::uint64_t>());
+    for (Order& order : stack) {
+      double price = reader.Get<double>();
+      order = Order(price, reader.Get<long>(), side);
+    }
+    return stack;
+  };
+  while (reader.More()) {
+    ProductId id = reader.Get<ProductId>();
+    vector<Order> bid_stack = get_stack(BID);
+    vector<Order> offer_stack = get_stack(OFFER);
+    books_[id] = OrderBook<Bond>(MakeBond(id), bid_stack, offer_stack);
+  }
+}
+
+void BondMarketDataService::_aggregate(OrderBook<Bond>& book) {
   // aggregate different orders with same price
 
-  // get orders in the requested book
-  OrderBook<Bond> book = books_[productId];
+  // get orders in the book
   std::vector<Order> bid_stack = book.GetBidStack(), offer_stack = book.GetOfferStack();
 
   // ue a map to merge orders with same price
@@ -150,10 +244,7 @@ const OrderBook<Bond>& BondMarketDataService::AggregateDepth(const string& produ
   }
 
   // update the book for the product
-  Bond bond = MakeBond(productId);
-  OrderBook<Bond> new_book(bond, new_bids, new_offers);
-  books_[productId] = new_book;
-  return books_[productId];
+  book = OrderBook<Bond>(book.GetProduct(), new_bids, new_offers);
 }
 
 
@@ -163,63 +254,80 @@ const OrderBook<Bond>& BondMarketDataService::AggregateDepth(const string& produ
 BondMarketDataConnector::BondMarketDataConnector(BondMarketDataService* _service) :
   marketDataService_(_service) {}
 
-void BondMarketDataConnector::Subscribe(const char* filename, const bool& header) {
-  std::string line;
-  std::vector<std::string> row;  // to store output of string splitting
-  Bond bond;  // bond object for which the order book will be created
+bool BondMarketDataConnector::ParseLine(const char* begin, const char* end, MarketDataLine& line) {
+  // get bond id, price, size and side
+  std::array<std::pair<const char*, const char*>, 4> row;
+  if (SplitFields(begin, end, ',', row) < 4) return false;
+
+  // some items need preprocessing
+  line.productId = ProductId();
+  if (!line.productId.TryAppend(row[0].first, row[0].second - row[0].first)) return false;
+  // compute price
   double order_price;
-  long order_size;
-  PricingSide side;  // bid or offer
-  std::vector<Order> bid_stack, offer_stack;
+  if (!TryStringToPrice(row[1].first, row[1].second, order_price)) return RejectField("price", row[1].first, row[1].second);
+  // trade size:
+  long order_size = 0;
+  std::from_chars(row[2].first, row[2].second, order_size);
+  // trade side:
+  PricingSide side = (std::string_view(row[3].first, row[3].second - row[3].first) == "BID") ? BID : OFFER;
+
+  line.order = Order(order_price, order_size, side);
+  return true;
+}
 
-  long orders_per_bond = 10L;  // HARDCODED, instructions say 5 bids, 5 offers
-  long counter = 0L;
+void BondMarketDataConnector::_deliver(MarketDataLine& line) {
+  counter_++;  // keep count of orders
+
+  // create order object and add it to correct stack
+  const Order& order = line.order;
+  switch (order.GetSide()){
+  case BID:
+    bidStack_.push_back(order);
+    break;
+  case OFFER:
+    offerStack_.push_back(order);
+    break;
+  default:
+    break;
+  }
+
+  // we create a full order book after going through 10 lines of `mkt_data.txt`
+  if (counter_ % ordersPerBond_ == 0) {
+    // create a bond object from the id:
+    const Bond& bond = MakeBond(line.productId);
+    std::cout << std::endl << PrintTimeStamp() << " Bond: " << bond << std::endl;
+
+    OrderBook<Bond> book_obj(bond, bidStack_, offerStack_);
+    // communicate book to service
+    marketDataService_->OnMessage(book_obj);
+
+    // start over
+    counter_ = 0L;
+    bidStack_.clear();
+    offerStack_.clear();
+  }
+}
+
+void BondMarketDataConnector::Subscribe(const char* filename, const bool& header) {
+  // start a new book
+  counter_ = 0L;
+  bidStack_.clear();
+  offerStack_.clear();
 
   try {
+    if (reader_.GetTaskPool() != nullptr) {
+      reader_.Read(filename, header, ParseLine, [this](MarketDataLine& line) { _deliver(line); });
+      return;
+    }
+
+    std::string line;
+    MarketDataLine line_obj;
     std::ifstream in(filename);
     if (header) std::getline(in, line);  // skip header
 
     while (std::getline(in, line)) {
-      counter++;  // keep count of orders
-
-      // get bond id, price, size and side
-      boost::algorithm::split(row, line, boost::algorithm::is_any_of(","));
-
-      // some items need preprocessing
-      // compute price
-      order_price = StringToPrice(row[1]);
-      // trade size:
-      order_size = std::stol(row[2]);
-      // trade side:
-      boost::algorithm::trim(row[3]);
-      side = (row[3] == "BID") ? BID : OFFER;
-
-      // create order object and add it to correct stack
-      Order order(order_price, order_size, side);
-      switch (side){
-      case BID:
-        bid_stack.push_back(order);
-      case OFFER:
-        offer_stack.push_back(order);
-      default:
-        break;
-      }
-
-      // we create a full order book after going through 10 lines of `mkt_data.txt`
-      if (counter % orders_per_bond == 0) {
-        // create a bond object from the id:
-        bond = MakeBond(row[0]);
-        std::cout << std::endl << PrintTimeStamp() << " Bond: " << bond << std::endl;
-
-        OrderBook<Bond> book_obj(bond, bid_stack, offer_stack);
-        // communicate book to service
-        marketDataService_->OnMessage(book_obj);
-
-        // start over
-        counter = 0L;
-        bid_stack = std::vector<Order>();
-        offer_stack = std::vector<Order>();
-      }
+      boost::algorithm::trim(line);
+      if (ParseLine(line.data(), line.data() + line.size(), line_obj)) _deliver(line_obj);
     }
   }
   catch (std::exception& e) {
@@ -227,6 +335,37 @@ void BondMarketDataConnector::Subscribe(const char* filename, const bool& header
   }
 }
 
+void BondMarketDataConnector::SetTaskPool(WorkStealingPool* _pool) {
+  reader_.SetTaskPool(_pool);
+}
+
+void BondMarketDataConnector::Tail(const char* filename, const std::function<bool()>& stop, const bool& header) {
+  // start a new book
+  counter_ = 0L;
+  bidStack_.clear();
+  offerStack_.clear();
+
+  try {
+    FileTailer tailer(filename);
+    MarketDataLine line_obj;
+    tailer.Run([this, &line_obj](const char* begin, const char* end) {
+      if (ParseLine(begin, end, line_obj)) _deliver(line_obj);
+    }, stop, header);
+  }
+  catch (std::exception& e) {
+    std::cout << "An error occurred: " << e.what() << std::endl;
+  }
+}
+
+void BondMarketDataConnector::SubscribeFeed(BondFeedReader& reader, const std::function<bool()>& stop) {
+  reader.Run([this](const FeedMessage& message) {
+    OrderBook<Bond> book_obj = FeedMessageToOrderBook(message);
+    std::cout << std::endl << PrintTimeStamp() << " Bond: " << book_obj.GetProduct() << std::endl;
+    // books come whole from the feed
+    marketDataService_->OnMessage(book_obj);
+  }, stop);
+}
+
 void BondMarketDataConnector::Publish(OrderBook<Bond>& data) {
   // subscribe only
 }
@@ -0,0 +1,480 @@
+/**
+* BondMatchingEngine.hpp
+*
+* Local matching engine filling execution orders against the live order books
+*
+* @author: Gabo Bernardino
+*/
+
+#ifndef BONDMATCHINGENGINE_HPP
+#define BONDMATCHINGENGINE_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../executionservice.hpp"
+#include "../marketdataservice.hpp"
+#include "../objectpool.hpp"
+#include "../latencystats.hpp"
+#include "../products.hpp"
+
+/**
+* Fill of (part of) an execution order
+* Side follows the order's side: BID sells, OFFER buys
+* leaves is the quantity of the order still open after this fill
+*/
+template <typename T>
+class Fill {
+private:
+  T product_;
+  OrderId orderId_;
+  PricingSide side_;
+  double price_;
+  long quantity_;
+  long leaves_;
+
+public:
+  Fill(const T& _product, const OrderId& _orderId, PricingSide _side, double _price, long _quantity, long _leaves);
+  Fill() = default;
+
+  const T& GetProduct() const;
+  const OrderId& GetOrderId() const;
+  PricingSide GetSide() const;
+  double GetPrice() const;
+  long GetQuantity() const;
+  long GetLeaves() const;
+};
+
+//*************************************************************************************************
+// Fill implementations
+//*************************************************************************************************
+template <typename T>
+Fill<T>::Fill(const T& _product, const OrderId& _orderId, PricingSide _side, double _price, long _quantity, long _leaves) :
+  product_(_product), orderId_(_orderId), side_(_side), price_(_price), quantity_(_quantity), leaves_(_leaves) {}
+
+template <typename T>
+const T& Fill<T>::GetProduct() const {
+  return product_;
+}
+
+template <typename T>
+const OrderId& Fill<T>::GetOrderId() const {
+  return orderId_;
+}
+
+template <typename T>
+PricingSide Fill<T>::GetSide() const {
+  return side_;
+}
+
+template <typename T>
+double Fill<T>::GetPrice() const {
+  return price_;
+}
+
+template <typename T>
+long Fill<T>::GetQuantity() const {
+  return quantity_;
+}
+
+template <typename T>
+long Fill<T>::GetLeaves() const {
+  return leaves_;
+}
+
+/**
+* Matching engine - local stand-in for an exchange, with price-time priority
+* Keeps, per product, a book of price levels in 1/256th ticks. Each level holds
+* the liquidity of the live order book at that price, then our resting orders
+* in arrival order. Every new order book replaces the feed liquidity and keeps
+* the resting orders, which may then cross the new book and trade.
+*
+* An order with side BID hits the bids (sell), one with side OFFER lifts the
+* offers (buy), as in the rest of the system:
+* - MARKET fills against whatever is on the book, the rest is cancelled
+* - LIMIT fills at its price or better, the rest rests on the book
+* - IOC fills at its price or better, the rest is cancelled
+* - FOK fills in full at its price or better, or not at all
+* - STOP waits until the market reaches its price, then becomes a MARKET order
+*
+* Every order comes from a source (the desk submitting it). Self-trade prevention:
+* an order never trades with a resting order of its own source; that resting
+* order is cancelled instead and the order goes on matching behind it.
+*
+* Fills are sent to the listeners once the order is done matching. Resting orders
+* come from a pool that grows by blocks when it runs out, so matching never
+* allocates in steady state and never fails for lack of room.
+*
+* An engine can stand for one venue with SetVenue: it then sees the venue's
+* share of each live book's liquidity, at prices the venue's offset worse, as
+* the smart order router's venue books do.
+*
+* Add the engine as a listener of the market data service before the algo
+* execution listener, so it sees a book before orders generated from it arrive.
+*/
+class BondMatchingEngine : public ServiceListener<OrderBook<Bond>> {
+public:
+  static constexpr double ticksPerUnit_ = 256.;
+
+private:
+  struct Resting {
+    OrderId orderId;
+    int source;
+    long quantity;
+    Resting* next;
+  };
+
+  struct Level {
+    long ticks;
+    long feed;  // quantity of the live book, ahead of our orders
+    Resting* head;  // our resting orders, oldest first
+    Resting* tail;
+  };
+
+  struct Stop {
+    ExecutionOrder<Bond> order;
+    int source;
+    long ticks;
+  };
+
+  // bids sorted ascending and offers descending: the best level is always at the back
+  struct ProductBook {
+    Bond product;
+    std::vector<Level> bids;
+    std::vector<Level> offers;
+    std::vector<Stop> stops;
+  };
+
+  std::unordered_map<ProductId, ProductBook> books_;
+  ObjectPool<Resting> resting_;
+  std::vector<ServiceListener<Fill<Bond>>*> listeners_;
+  std::vector<Fill<Bond>> fills_;  // fills of the order being matched, reused
+
+  long orders_;
+  long fillCount_;
+  long filledQuantity_;
+  long cancelledQuantity_;  // MARKET and IOC leftovers, killed FOKs
+  long selfTradeCancelled_;  // resting quantity cancelled by self-trade prevention
+  LatencyStats matchLatency_;
+
+  std::string venue_;
+  double share_;  // of the live books' liquidity
+  long offsetTicks_;  // bids this much lower, offers this much higher
+
+  static long _ticks(double price);
+  static double _price(long ticks);
+
+  // Level at a price, created if needed - invalidates references to the other levels of the side
+  static Level& _level(std::vector<Level>& levels, long ticks, bool ascending);
+
+  // Quantity available at `limit_ticks` or better for an order of side `side` from `source`, stops counting at `needed`
+  static long _available(const ProductBook& book, PricingSide side, int source, long limit_ticks, long needed);
+
+  // Take liquidity for an order; `limited` false takes at any price. Returns the quantity left
+  long _match(ProductBook& book, const OrderId& id, int source, PricingSide side, long quantity, bool limited, long limit_ticks);
+
+  // Queue an order at the back of its level
+  void _rest(ProductBook& book, const OrderId& id, int source, PricingSide side, long quantity, long ticks);
+
+  // Match resting orders crossing the opposite side of the book
+  void _uncross(ProductBook& book, PricingSide side);
+
+  // Turn the stops the market reached into MARKET orders
+  void _triggerStops(ProductBook& book);
+
+  void _execute(ProductBook& book, const ExecutionOrder<Bond>& order, int source);
+  void _publish();
+
+public:
+  // ctor
+  BondMatchingEngine(std::size_t resting_capacity = 1 << 16);
+
+  // Add a listener for the fills
+  void AddListener(ServiceListener<Fill<Bond>>* listener);
+
+  // Match an order from `source` against the book of its product; returns the quantity filled right away
+  long Submit(const ExecutionOrder<Bond>& order, int source = 0);
+
+  // Replace the feed liquidity of a product with the live book
+  void OnBook(const OrderBook<Bond>& book);
+
+  // Match as the venue `name`: `share` of the live books' liquidity, prices `price_offset` worse
+  void SetVenue(const std::string& name, double share, double price_offset);
+
+  // Listener callbacks: refresh the books
+  virtual void ProcessAdd(OrderBook<Bond>& data) override;
+  virtual void ProcessRemove(OrderBook<Bond>& data) override;
+  virtual void ProcessUpdate(OrderBook<Bond>& data) override;
+
+  const LatencyStats& GetMatchLatency() const;
+
+  // Resting quantity cancelled by self-trade prevention
+  long GetSelfTradeCancelled() const;
+
+  // Print order and fill counters and match latency
+  void Report(std::ostream& output) const;
+};
+
+//*************************************************************************************************
+// BondMatchingEngine implementations
+//*************************************************************************************************
+BondMatchingEngine::BondMatchingEngine(std::size_t resting_capacity) :
+  resting_(resting_capacity), orders_(0), fillCount_(0), filledQuantity_(0), cancelledQuantity_(0), selfTradeCancelled_(0),
+  share_(1.), offsetTicks_(0) {}
+
+long BondMatchingEngine::_ticks(double price) {
+  return std::lround(price * ticksPerUnit_);
+}
+
+double BondMatchingEngine::_price(long ticks) {
+  return ticks / ticksPerUnit_;
+}
+
+BondMatchingEngine::Level& BondMatchingEngine::_level(std::vector<Level>& levels, long ticks, bool ascending) {
+  // books are a handful of levels deep: scan from the best level
+  auto it = levels.end();
+  while (it != levels.begin()) {
+    auto prev = it - 1;
+    if (prev->ticks == ticks) return *prev;
+    if (ascending ? prev->ticks < ticks : prev->ticks > ticks) break;
+    it = prev;
+  }
+  return *levels.insert(it, Level{ ticks, 0, nullptr, nullptr });
+}
+
+long BondMatchingEngine::_available(const ProductBook& book, PricingSide side, int source, long limit_ticks, long needed) {
+  const std::vector<Level>& levels = (side == BID) ? book.bids : book.offers;
+  long available = 0;
+  for (auto it = levels.rbegin(); it != levels.rend() && available < needed; ++it) {
+    if (side == BID ? it->ticks < limit_ticks : it->ticks > limit_ticks) break;
+    available += it->feed;
+    for (const Resting* r = it->head; r != nullptr; r = r->next) {
+      if (r->source != source) available += r->quantity;  // the order would not trade with its own
+    }
+  }
+  return available;
+}
+
+long BondMatchingEngine::_match(ProductBook& book, const OrderId& id, int source, PricingSide side, long quantity, bool limited, long limit_ticks) {
+  // a BID order hits the bids, an OFFER order lifts the offers; the resting orders are on the other side
+  std::vector<Level>& levels = (side == BID) ? book.bids : book.offers;
+  PricingSide passive_side = (side == BID) ? OFFER : BID;
+
+  while (quantity > 0 && !levels.empty()) {
+    Level& level = levels.back();
+    if (limited && (side == BID ? level.ticks < limit_ticks : level.ticks > limit_ticks)) break;
+    double price = _price(level.ticks);
+    long taken = 0;
+
+    // feed liquidity first
+    long take = std::min(quantity - taken, level.feed);
+    level.feed -= take;
+    taken += take;
+
+    // then our resting orders, oldest first; those of the order's own source are cancelled rather than traded with
+    while (taken < quantity && level.head != nullptr) {
+      Resting* resting = level.head;
+      if (resting->source == source) {
+        selfTradeCancelled_ += resting->quantity;
+        resting->quantity = 0;
+      }
+      else {
+        take = std::min(quantity - taken, resting->quantity);
+        resting->quantity -= take;
+        taken += take;
+        fills_.emplace_back(book.product, resting->orderId, passive_side, price, take, resting->quantity);
+      }
+      if (resting->quantity == 0) {
+        level.head = resting->next;
+        if (level.head == nullptr) level.tail = nullptr;
+        resting_.Release(resting);
+      }
+    }
+
+    quantity -= taken;
+    if (taken > 0) fills_.emplace_back(book.product, id, side, price, taken, quantity);
+    if (level.feed == 0 && level.head == nullptr) levels.pop_back();
+  }
+  return quantity;
+}
+
+void BondMatchingEngine::_rest(ProductBook& book, const OrderId& id, int source, PricingSide side, long quantity, long ticks) {
+  // a resting sell waits on the offers, a resting buy on the bids
+  Level& level = (side == BID) ? _level(book.offers, ticks, false) : _level(book.bids, ticks, true);
+  Resting* resting = resting_.Acquire();
+  *resting = Resting{ id, source, quantity, nullptr };
+  if (level.tail != nullptr) level.tail->next = resting;
+  else level.head = resting;
+  level.tail = resting;
+}
+
+void BondMatchingEngine::_uncross(ProductBook& book, PricingSide side) {
+  // resting buys live on the bids and take from the offers, resting sells the opposite
+  std::vector<Level>& levels = (side == BID) ? book.bids : book.offers;
+  PricingSide taker = (side == BID) ? OFFER : BID;
+
+  for (auto it = levels.rbegin(); it != levels.rend(); ++it) {
+    Level& level = *it;
+    while (level.head != nullptr) {
+      Resting* resting = level.head;
+      long left = _match(book, resting->orderId, resting->source, taker, resting->quantity, true, level.ticks);
+      if (left == resting->quantity) break;  // no longer crosses: neither do worse levels
+      resting->quantity = left;
+      if (left > 0) break;  // the other side is exhausted at this price
+      level.head = resting->next;
+      if (level.head == nullptr) level.tail = nullptr;
+      resting_.Release(resting);
+    }
+    if (level.head != nullptr) break;
+  }
+  levels.erase(std::remove_if(levels.begin(), levels.end(),
+    [](const Level& l) { return l.feed == 0 && l.head == nullptr; }), levels.end());
+}
+
+void BondMatchingEngine::_triggerStops(ProductBook& book) {
+  // a buy stop triggers once the offer reaches its price, a sell stop once the bid falls to it
+  std::size_t i = 0;
+  while (i < book.stops.size()) {
+    Stop& stop = book.stops[i];
+    PricingSide side = stop.order.GetSide();
+    const std::vector<Level>& levels = (side == BID) ? book.bids : book.offers;
+    bool triggered = !levels.empty() &&
+      (side == BID ? levels.back().ticks <= stop.ticks : levels.back().ticks >= stop.ticks);
+    if (!triggered) {
+      ++i;
+      continue;
+    }
+    long quantity = stop.order.GetVisibleQuantity() + stop.order.GetHiddenQuantity();
+    cancelledQuantity_ += _match(book, stop.order.GetOrderId(), stop.source, side, quantity, false, 0);
+    stop = book.stops.back();
+    book.stops.pop_back();
+  }
+}
+
+void BondMatchingEngine::_execute(ProductBook& book, const ExecutionOrder<Bond>& order, int source) {
+  const OrderId& id = order.GetOrderId();
+  PricingSide side = order.GetSide();
+  long quantity = order.GetVisibleQuantity() + order.GetHiddenQuantity();
+  long ticks = _ticks(order.GetPrice());
+
+  switch (order.GetOrderType()) {
+  case MARKET:
+    cancelledQuantity_ += _match(book, id, source, side, quantity, false, 0);
+    break;
+  case LIMIT: {
+    long left = _match(book, id, source, side, quantity, true, ticks);
+    if (left > 0) _rest(book, id, source, side, left, ticks);
+    break;
+  }
+  case IOC:
+    cancelledQuantity_ += _match(book, id, source, side, quantity, true, ticks);
+    break;
+  case FOK:
+    if (_available(book, side, source, ticks, quantity) >= quantity) _match(book, id, source, side, quantity, true, ticks);
+    else cancelledQuantity_ += quantity;
+    break;
+  case STOP:
+    book.stops.push_back(Stop{ order, source, ticks });
+    _triggerStops(book);
+    break;
+  }
+}
+
+void BondMatchingEngine::_publish() {
+  for (Fill<Bond>& fill : fills_) {
+    fillCount_++;
+    filledQuantity_ += fill.GetQuantity();
+    for (auto l : listeners_) {
+      l->ProcessAdd(fill);
+    }
+  }
+  fills_.clear();
+}
+
+void BondMatchingEngine::AddListener(ServiceListener<Fill<Bond>>* listener) {
+  listeners_.push_back(listener);
+}
+
+long BondMatchingEngine::Submit(const ExecutionOrder<Bond>& order, int source) {
+  auto start = std::chrono::steady_clock::now();
+
+  ProductBook& book = books_[order.GetProduct().GetProductId()];
+  book.product = order.GetProduct();
+  _execute(book, order, source);
+
+  long filled = 0;
+  for (const Fill<Bond>& fill : fills_) {
+    if (fill.GetOrderId() == order.GetOrderId()) filled += fill.GetQuantity();
+  }
+  orders_++;
+  matchLatency_.Record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now() - start).count());
+
+  _publish();
+  return filled;
+}
+
+void BondMatchingEngine::OnBook(const OrderBook<Bond>& book) {
+  ProductBook& product_book = books_[book.GetProduct().GetProductId()];
+  product_book.product = book.GetProduct();
+
+  auto refresh = [this](const vector<Order>& stack, std::vector<Level>& levels, bool ascending) {
+    // bids are ascending: the venue bids lower and offers higher
+    long offset = ascending ? -offsetTicks_ : offsetTicks_;
+    for (Level& level : levels) level.feed = 0;
+    for (const Order& order : stack) {
+      long quantity = static_cast<long>(order.GetQuantity() * share_);
+      if (quantity <= 0) continue;
+      _level(levels, _ticks(order.GetPrice()) + offset, ascending).feed += quantity;
+    }
+    levels.erase(std::remove_if(levels.begin(), levels.end(),
+      [](const Level& l) { return l.feed == 0 && l.head == nullptr; }), levels.end());
+  };
+  refresh(book.GetBidStack(), product_book.bids, true);
+  refresh(book.GetOfferStack(), product_book.offers, false);
+
+  // the new book may cross our resting orders or reach our stops
+  _uncross(product_book, BID);
+  _uncross(product_book, OFFER);
+  _triggerStops(product_book);
+  _publish();
+}
+
+void BondMatchingEngine::ProcessAdd(OrderBook<Bond>& data) {
+  OnBook(data);
+}
+
+void BondMatchingEngine::ProcessRemove(OrderBook<Bond>& data) {
+  // not implemented
+}
+
+void BondMatchingEngine::ProcessUpdate(OrderBook<Bond>& data) {
+  OnBook(data);
+}
+
+void BondMatchingEngine::SetVenue(const std::string& name, double share, double price_offset) {
+  venue_ = name;
+  share_ = share;
+  offsetTicks_ = _ticks(price_offset);
+}
+
+const LatencyStats& BondMatchingEngine::GetMatchLatency() const {
+  return matchLatency_;
+}
+
+long BondMatchingEngine::GetSelfTradeCancelled() const {
+  return selfTradeCancelled_;
+}
+
+void BondMatchingEngine::Report(std::ostream& output) const {
+  output << "Matching engine" << (venue_.empty() ? "" : " " + venue_) << ": " << orders_ << " orders, " << fillCount_ << " fills for " << filledQuantity_
+    << ", " << cancelledQuantity_ << " cancelled, " << selfTradeCancelled_ << " resting cancelled by self-trade prevention, "
+    << resting_.InUse() << " orders resting" << std::endl;
+  matchLatency_.Report(output, venue_.empty() ? "Match latency" : "Match latency, " + venue_);
+}
+
+#endif // !BONDMATCHINGENGINE_HPP
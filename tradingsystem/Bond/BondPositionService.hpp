@@ -9,7 +9,9 @@
 #ifndef BONDPOSITIONSERVICE_HPP
 #define BONDPOSITIONSERVICE_HPP
 
+#include <mutex>
 #include "../positionservice.hpp"
+#include "../snapshot.hpp"
 #include "BondRiskService.hpp"
 
 
@@ -19,13 +21,18 @@
 * 
 * Gets data from listener on TradeBookingService and communicates it
 * to Risk Listeners and Historical Data Listeners
+* Positions are updated under a lock, since trades can come from several flows
 */
 class BondPositionService : public PositionService<Bond> {
 private:
   std::vector<ServiceListener<Position<Bond>>*> listeners_;
-  std::unordered_map<std::string, Position<Bond>> positions_;  // keyed on product id
+  std::unordered_map<ProductId, Position<Bond>> positions_;  // keyed on product id
+
+  std::mutex mutex_;  // guards positions and the updates sent to listeners
 
 public:
+  static constexpr std::uint32_t snapshotTag_ = 2;
+
   // ctor
   BondPositionService();
 
@@ -44,6 +51,12 @@ public:
 
   // Add a trade to the service
   virtual void AddTrade(Trade<Bond>& trade) override;
+
+  // Snapshot the positions
+  void SaveState(SnapshotWriter& writer);
+
+  // Restore the positions of a snapshot; listeners are not called
+  void LoadState(SnapshotReader& reader);
 };
 
 /**
@@ -96,16 +109,17 @@ const vector<ServiceListener<Position<Bond>>*>& BondPositionService::GetListener
 }
 
 void BondPositionService::AddTrade(Trade<Bond>& trade) {
+  std::lock_guard<std::mutex> lock(mutex_);
 
   // get (current) position object to modify and communicate to listeners
-  std::string id = trade.GetProduct().GetProductId();
+  const ProductId& id = trade.GetProduct().GetProductId();
   Position<Bond>& position_obj = positions_[id];
   // get trade size and direction
   long quantity = trade.GetQuantity();
   if (trade.GetSide() == SELL) quantity *= -1;
   
   // get book for the trade
-  std::string book = trade.GetBook();
+  const BookId& book = trade.GetBook();
 
   // update current position before communicating to listeners
   position_obj.AddPosition(book, quantity);
@@ -119,6 +133,34 @@ void BondPositionService::AddTrade(Trade<Bond>& trade) {
   }
 }
 
+void BondPositionService::SaveState(SnapshotWriter& writer) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  writer.BeginSection(snapshotTag_);
+  for (const auto& [id, position] : positions_) {
+    writer.Put(id);
+    writer.Put(static_cast<std::uint64_t>(position.GetPositions().size()));
+    for (const auto& [book, quantity] : position.GetPositions()) {
+      writer.Put(book);
+      writer.Put(quantity);
+    }
+  }
+}
+
+void BondPositionService::LoadState(SnapshotReader& reader) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!reader.FindSection(snapshotTag_)) throw std::runtime_error("snapshot has no positions");
+  while (reader.More()) {
+    ProductId id = reader.Get<ProductId>();
+    Position<Bond> position(MakeBond(id));
+    std::uint64_t books = reader.Get<std::uint64_t>();
+    for (std::uint64_t i = 0; i < books; ++i) {
+      BookId book = reader.Get<BookId>();
+      position.AddPosition(book, reader.Get<long>());
+    }
+    positions_[id] = position;
+  }
+}
+
 
 // ************************************************************************************************
 // BondPositionListener implementations
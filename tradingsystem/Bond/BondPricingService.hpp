@@ -14,6 +14,9 @@
 #include <fstream>
 #include "../pricingservice.hpp"
 #include "../utils.hpp"
+#include "../chunkedreader.hpp"
+#include "../filetailer.hpp"
+#include "BondMarketDataFeed.hpp"
 
 
 /**
@@ -26,7 +29,7 @@
 class BondPricingService : public PricingService<Bond> {
 private:
   std::vector<ServiceListener<Price<Bond>>*> listeners_;
-  std::unordered_map<std::string, Price<Bond>> prices_;  // keyed on product id
+  std::unordered_map<ProductId, Price<Bond>> prices_;  // keyed on product id
 
 public:
   // ctor
@@ -50,14 +53,32 @@ public:
 * Pricing connector class specialized for bonds;
 * Reads from `prices.txt`, creates a Price object and sends it to the service
 * Subscribe-only connector
+* With a task pool set, the file is parsed in chunks on the pool
 */
 class BondPricingConnector : public PricingConnector<Bond> {
 private:
   BondPricingService* bondPricingService_;
+  ChunkedFileReader<Price<Bond>> reader_;
+
+  // Send a parsed line on to the service
+  void _deliver(Price<Bond>& price_obj);
+
 public:
   BondPricingConnector(BondPricingService* _service);
   BondPricingConnector() = default;
 
+  // Parse a line: id, bid, offer
+  static bool ParseLine(const char* begin, const char* end, Price<Bond>& price);
+
+  // Parse the file in chunks on a pool (nullptr reads it line by line)
+  void SetTaskPool(WorkStealingPool* _pool);
+
+  // Follow a file still being written, until `stop` returns true
+  void Tail(const char* filename, const std::function<bool()>& stop, const bool& header = true);
+
+  // Read the prices of a shared memory feed, until the feed ends or `stop` returns true
+  void SubscribeFeed(BondFeedReader& reader, const std::function<bool()>& stop);
+
   // Subscribe to a Service
   virtual void Subscribe(const char* filename, const bool& header = true) override;
 
@@ -70,7 +91,7 @@ public:
 // BondPricingService implementations
 // ************************************************************************************************
 BondPricingService::BondPricingService() {
-  prices_ = std::unordered_map<std::string, Price<Bond>>();
+  prices_ = std::unordered_map<ProductId, Price<Bond>>();
 }
 
 Price<Bond>& BondPricingService::GetData(std::string key) {
@@ -79,7 +100,7 @@ Price<Bond>& BondPricingService::GetData(std::string key) {
 
 void BondPricingService::OnMessage(Price<Bond>& data) {
   // add data to the stored prices:
-  std::string id = data.GetProduct().GetProductId();
+  const ProductId& id = data.GetProduct().GetProductId();
   prices_[id] = data;
 
   // communicate new price to listeners
@@ -103,41 +124,80 @@ const vector<ServiceListener<Price<Bond>>*>& BondPricingService::GetListeners()
 BondPricingConnector::BondPricingConnector(BondPricingService* _service) : 
   bondPricingService_(_service) {}
 
-void BondPricingConnector::Subscribe(const char* filename, const bool& header) {
-  std::string line;
-  std::vector<std::string> row;  // to store output of string splitting
-  Bond bond;  // bond object whose price will be created
+bool BondPricingConnector::ParseLine(const char* begin, const char* end, Price<Bond>& price) {
+  // get id, bid, offer
+  std::array<std::pair<const char*, const char*>, 3> row;
+  if (SplitFields(begin, end, ',', row) < 3) return false;
+
+  // create a bond object from the id
+  ProductId id;
+  if (!id.TryAppend(row[0].first, row[0].second - row[0].first)) return false;
+  const Bond& bond = MakeBond(id);
+
+  // get price information
   double bid, ask;
+  if (!TryStringToPrice(row[1].first, row[1].second, bid)) return RejectField("bid", row[1].first, row[1].second);
+  if (!TryStringToPrice(row[2].first, row[2].second, ask)) return RejectField("offer", row[2].first, row[2].second);
+  price = Price<Bond>(bond, 0.5 * (bid + ask), ask - bid);
+  return true;
+}
+
+void BondPricingConnector::_deliver(Price<Bond>& price_obj) {
+  double half_spread = 0.5 * price_obj.GetBidOfferSpread();
+  std::cout << std::endl << PrintTimeStamp();
+  std::cout << " Bid price = " << price_obj.GetMid() - half_spread << "; ";
+  std::cout << "Ask price = " << price_obj.GetMid() + half_spread << std::endl;
+
+  // communicate price to service
+  bondPricingService_->OnMessage(price_obj);
+}
 
+void BondPricingConnector::Subscribe(const char* filename, const bool& header) {
   try {
+    if (reader_.GetTaskPool() != nullptr) {
+      reader_.Read(filename, header, ParseLine, [this](Price<Bond>& price_obj) { _deliver(price_obj); });
+      return;
+    }
+
+    std::string line;
+    Price<Bond> price_obj;
     std::ifstream in(filename);
     if (header) std::getline(in, line);  // skip header
 
     while (std::getline(in, line)) {
       // preprocess line string
       boost::algorithm::trim(line);
-      // get id, bid, offer
-      boost::algorithm::split(row, line, boost::algorithm::is_any_of(","));
-
-      // create a bond object from the id
-      bond = MakeBond(row[0]);
-      
-      // get price information
-      bid = StringToPrice(row[1]);
-      std::cout << std::endl << PrintTimeStamp();
-      std::cout << " Bid price = " << bid << "; ";
-      ask = StringToPrice(row[2]);
-      std::cout << "Ask price = " << ask << std::endl;
-      Price<Bond> price_obj(bond, 0.5 * (bid + ask), ask - bid);
-
-      // communicate price to service
-      bondPricingService_->OnMessage(price_obj);
+      if (ParseLine(line.data(), line.data() + line.size(), price_obj)) _deliver(price_obj);
     }
   } catch (std::exception& e) {
     std::cout << "An error occurred: " << e.what() << std::endl;
   }
 }
 
+void BondPricingConnector::SetTaskPool(WorkStealingPool* _pool) {
+  reader_.SetTaskPool(_pool);
+}
+
+void BondPricingConnector::Tail(const char* filename, const std::function<bool()>& stop, const bool& header) {
+  try {
+    FileTailer tailer(filename);
+    Price<Bond> price_obj;
+    tailer.Run([this, &price_obj](const char* begin, const char* end) {
+      if (ParseLine(begin, end, price_obj)) _deliver(price_obj);
+    }, stop, header);
+  }
+  catch (std::exception& e) {
+    std::cout << "An error occurred: " << e.what() << std::endl;
+  }
+}
+
+void BondPricingConnector::SubscribeFeed(BondFeedReader& reader, const std::function<bool()>& stop) {
+  reader.Run([this](const FeedMessage& message) {
+    Price<Bond> price_obj = FeedMessageToPrice(message);
+    _deliver(price_obj);
+  }, stop);
+}
+
 void BondPricingConnector::Publish(Price<Bond>& data){
   // subscribe only
 }
@@ -0,0 +1,254 @@
+/**
+* BondQuotingEngine.hpp
+*
+* Quotes the bond inquiries off the live prices and positions
+*
+* @author: Gabo Bernardino
+*/
+
+#ifndef BONDQUOTINGENGINE_HPP
+#define BONDQUOTINGENGINE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <ostream>
+#include "../conflationcache.hpp"
+#include "../latencystats.hpp"
+#include "BondInquiryService.hpp"
+#include "BondPricingService.hpp"
+#include "BondPositionService.hpp"
+
+/**
+* Bond quoting engine
+* Listens to the inquiries and quotes each one in `RECEIVED` state from the
+* latest mid and bid/offer spread of its product: the client's side of the
+* market (the offer when the client buys, the bid when it sells), pushed away
+* from the mid by a skew growing with the size of the inquiry, and shifted
+* against the aggregate position (lower when long, higher when short) so
+* that quotes lean towards reducing it. The two skews together are capped at
+* `maxSkew`, and the quote is rounded away from the mid to a 1/256th.
+*
+* Prices and positions come from the BondQuotingPriceListener and
+* BondQuotingPositionListener, on their own flows: each is kept in a
+* conflation cache, written lock-free by its flow and read lock-free here, so
+* a quote costs two reads and never waits on pricing or on the positions.
+* Each inquiry is quoted off the price in the cache when it arrives, on the
+* inquiry flow; one arriving before the first price of its product has no
+* market to be quoted from and is rejected.
+*/
+class BondQuotingEngine : public ServiceListener<Inquiry<Bond>> {
+private:
+  static constexpr double skewUnit_ = 1e7;  // skews are given per 10MM
+  static constexpr double tick_ = 1. / 256;
+
+  BondInquiryService* bondInquiryService_;
+  double sizeSkew_;
+  double positionSkew_;
+  double maxSkew_;
+
+  ConflationCache<ProductId, Price<Bond>> prices_;
+  ConflationCache<ProductId, long> positions_;  // aggregate position per product
+  std::atomic<long> priced_;  // products with a price, written by the pricing flow
+
+  // inquiry flow only
+  long quoted_;
+  long rejected_;
+  LatencyStats latency_;
+
+  // Price of the quote for an inquiry, given the market
+  double _price(const Inquiry<Bond>& inquiry, const Price<Bond>& price) const;
+
+  // Send the quote for an inquiry
+  void _quote(const Inquiry<Bond>& inquiry, const Price<Bond>& price);
+
+public:
+  // ctor - skews in price per 10MM of inquiry size and of position
+  BondQuotingEngine(BondInquiryService* _service, double _sizeSkew = 1. / 256, double _positionSkew = 1. / 256,
+    double _maxSkew = 1. / 32, std::size_t max_products = 1024);
+
+  // Take the latest price of a product
+  void AddPrice(const Price<Bond>& price);
+
+  // Number of products with a price, e.g. to open quoting once the whole universe is priced
+  long GetPricedCount() const;
+
+  // Take the latest aggregate position of a product
+  void AddPosition(const ProductId& productId, long aggregate);
+
+  // Listener callback to process an add event to the Service
+  virtual void ProcessAdd(Inquiry<Bond>& data) override;
+
+  // Listener callback to process a remove event to the Service
+  virtual void ProcessRemove(Inquiry<Bond>& data) override;
+
+  // Listener callback to process an update event to the Service
+  virtual void ProcessUpdate(Inquiry<Bond>& data) override;
+
+  // Print quote counters and the latency of quoting
+  void Report(std::ostream& output) const;
+};
+
+/**
+* Quoting price listener specialized for bonds
+* Hands the prices of BondPricingService to the quoting engine
+*/
+class BondQuotingPriceListener : public ServiceListener<Price<Bond>> {
+private:
+  BondQuotingEngine* bondQuotingEngine_;
+
+public:
+  // ctor
+  BondQuotingPriceListener(BondQuotingEngine* _engine);
+  BondQuotingPriceListener() = default;
+
+  // Listener callback to process an add event to the Service
+  virtual void ProcessAdd(Price<Bond>& data) override;
+
+  // Listener callback to process a remove event to the Service
+  virtual void ProcessRemove(Price<Bond>& data) override;
+
+  // Listener callback to process an update event to the Service
+  virtual void ProcessUpdate(Price<Bond>& data) override;
+};
+
+/**
+* Quoting position listener specialized for bonds
+* Hands the aggregate positions of BondPositionService to the quoting engine
+*/
+class BondQuotingPositionListener : public ServiceListener<Position<Bond>> {
+private:
+  BondQuotingEngine* bondQuotingEngine_;
+
+public:
+  // ctor
+  BondQuotingPositionListener(BondQuotingEngine* _engine);
+  BondQuotingPositionListener() = default;
+
+  // Listener callback to process an add event to the Service
+  virtual void ProcessAdd(Position<Bond>& data) override;
+
+  // Listener callback to process a remove event to the Service
+  virtual void ProcessRemove(Position<Bond>& data) override;
+
+  // Listener callback to process an update event to the Service
+  virtual void ProcessUpdate(Position<Bond>& data) override;
+};
+
+//*************************************************************************************************
+// BondQuotingEngine implementations
+//*************************************************************************************************
+BondQuotingEngine::BondQuotingEngine(BondInquiryService* _service, double _sizeSkew, double _positionSkew,
+  double _maxSkew, std::size_t max_products) :
+  bondInquiryService_(_service), sizeSkew_(_sizeSkew), positionSkew_(_positionSkew), maxSkew_(_maxSkew),
+  prices_(max_products), positions_(max_products), priced_(0), quoted_(0), rejected_(0) {}
+
+double BondQuotingEngine::_price(const Inquiry<Bond>& inquiry, const Price<Bond>& price) const {
+  long position = 0;
+  positions_.Read(inquiry.GetProduct().GetProductId(), position);  // flat until a trade is seen
+
+  double size = sizeSkew_ * static_cast<double>(inquiry.GetQuantity()) / skewUnit_;
+  double lean = positionSkew_ * static_cast<double>(position) / skewUnit_;
+  double half_spread = 0.5 * price.GetBidOfferSpread();
+
+  if (inquiry.GetSide() == BUY) {
+    // the client buys at our offer
+    double skew = std::max(-maxSkew_, std::min(maxSkew_, size - lean));
+    return std::ceil((price.GetMid() + half_spread + skew) / tick_ - 1e-9) * tick_;
+  }
+  double skew = std::max(-maxSkew_, std::min(maxSkew_, size + lean));
+  return std::floor((price.GetMid() - half_spread - skew) / tick_ + 1e-9) * tick_;
+}
+
+void BondQuotingEngine::_quote(const Inquiry<Bond>& inquiry, const Price<Bond>& price) {
+  double quote = _price(inquiry, price);
+  std::cout << "Quoting inquiry " << inquiry.GetInquiryId() << " at " << PriceToString(quote)
+    << " (mid " << PriceToString(price.GetMid()) << ")" << std::endl;
+  bondInquiryService_->SendQuote(inquiry.GetInquiryId(), quote);
+}
+
+void BondQuotingEngine::AddPrice(const Price<Bond>& price) {
+  const ProductId& id = price.GetProduct().GetProductId();
+  Price<Bond> previous;
+  bool first = !prices_.Read(id, previous);  // the pricing flow is the only writer
+  prices_.Write(id, price);
+  if (first) priced_.fetch_add(1, std::memory_order_release);
+}
+
+long BondQuotingEngine::GetPricedCount() const {
+  return priced_.load(std::memory_order_acquire);
+}
+
+void BondQuotingEngine::AddPosition(const ProductId& productId, long aggregate) {
+  positions_.Write(productId, aggregate);
+}
+
+void BondQuotingEngine::ProcessAdd(Inquiry<Bond>& data) {
+  // not implemented
+}
+
+void BondQuotingEngine::ProcessRemove(Inquiry<Bond>& data) {
+  // not implemented
+}
+
+void BondQuotingEngine::ProcessUpdate(Inquiry<Bond>& data) {
+  if (data.GetState() != RECEIVED) return;
+  auto start = std::chrono::steady_clock::now();
+
+  const ProductId& id = data.GetProduct().GetProductId();
+  Price<Bond> price;
+  if (!prices_.Read(id, price)) {
+    std::cout << "No price yet for " << id << ", rejecting inquiry " << data.GetInquiryId() << std::endl;
+    bondInquiryService_->RejectInquiry(data.GetInquiryId());
+    rejected_++;
+    return;
+  }
+  _quote(data, price);
+  quoted_++;
+  latency_.Record(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+void BondQuotingEngine::Report(std::ostream& output) const {
+  output << "Quoting engine: " << quoted_ << " inquiries quoted, " << rejected_
+    << " rejected for lack of a price" << std::endl;
+  latency_.Report(output, "Quote latency");
+}
+
+//*************************************************************************************************
+// BondQuotingPriceListener implementations
+//*************************************************************************************************
+BondQuotingPriceListener::BondQuotingPriceListener(BondQuotingEngine* _engine) :
+  bondQuotingEngine_(_engine) {}
+
+void BondQuotingPriceListener::ProcessAdd(Price<Bond>& data) {
+  bondQuotingEngine_->AddPrice(data);
+}
+
+void BondQuotingPriceListener::ProcessRemove(Price<Bond>& data) {
+  // not implemented
+}
+
+void BondQuotingPriceListener::ProcessUpdate(Price<Bond>& data) {
+  // not implemented
+}
+
+//*************************************************************************************************
+// BondQuotingPositionListener implementations
+//*************************************************************************************************
+BondQuotingPositionListener::BondQuotingPositionListener(BondQuotingEngine* _engine) :
+  bondQuotingEngine_(_engine) {}
+
+void BondQuotingPositionListener::ProcessAdd(Position<Bond>& data) {
+  // not implemented
+}
+
+void BondQuotingPositionListener::ProcessRemove(Position<Bond>& data) {
+  // not implemented
+}
+
+void BondQuotingPositionListener::ProcessUpdate(Position<Bond>& data) {
+  bondQuotingEngine_->AddPosition(data.GetProduct().GetProductId(), data.GetAggregatePosition());
+}
+
+#endif // !BONDQUOTINGENGINE_HPP
@@ -13,6 +13,7 @@
 #include "../riskservice.hpp"
 #include "../products.hpp"
 #include "../utils.hpp"
+#include "../snapshot.hpp"
 
 
 /**
@@ -22,13 +23,27 @@
 * 
 * Gets data from listener on BondPositionService and communicates it
 * to Historical Data Listeners
+*
+* Bucketed risk is refreshed before listeners are called, so they see one
+* consistent snapshot; a position only recomputes the sectors holding its bond.
 */
 class BondRiskService : public RiskService<Bond> {
 private:
   std::vector<ServiceListener<PV01<Bond>>*> listeners_;
-  std::unordered_map<std::string, PV01<Bond>> pv_;  // keyed on product id
+  std::unordered_map<ProductId, PV01<Bond>> pv_;  // keyed on product id
   std::unordered_map<std::string, PV01<BucketedSector<Bond>>> pv_buckets_;  // keyed on sector name
+  std::vector<PV01<BucketedSector<Bond>>*> bucketList_;  // same buckets, indexable
+  std::unordered_map<ProductId, std::vector<std::size_t>> bucketsOf_;  // product id -> its buckets in bucketList_
+
+  // Weighted PV01 and quantity of a bucket, from the current positions
+  std::pair<double, long long> _computeBucket(const PV01<BucketedSector<Bond>>& bucket) const;
+
+  // Recompute a bucket in place
+  void _updateBucket(PV01<BucketedSector<Bond>>& bucket);
+
 public:
+  static constexpr std::uint32_t snapshotTag_ = 3;
+
   // ctor
   BondRiskService();
 
@@ -54,6 +69,16 @@ public:
 
   // Update the bucketed sector risk
   virtual void UpdateBucketedRisk(std::string& sector) override;
+
+  // Recompute every bucket from the current positions
+  void UpdateAllBucketedRisk();
+
+  // Snapshot the PV01 of every bond
+  // Positions reach the service thru the booking chain: take it under the booking lock
+  void SaveState(SnapshotWriter& writer) const;
+
+  // Restore the PV01 of a snapshot and recompute the buckets; listeners are not called
+  void LoadState(SnapshotReader& reader);
 };
 
 /**
@@ -85,7 +110,7 @@ public:
 BondRiskService::BondRiskService() {
   // initialize the PV01 map of individual bonds
   std::unordered_map <std::string, double> pv_base_map = PV_Map();  // map with the hardcoded PV01 values for each ticker
-  pv_ = std::unordered_map<std::string, PV01<Bond>>();  // actual member
+  pv_ = std::unordered_map<ProductId, PV01<Bond>>();  // actual member
   PV01<Bond> pv_obj;
 
   for (auto [id, pv_value] : pv_base_map) {
@@ -109,6 +134,12 @@ BondRiskService::BondRiskService() {
     pv_of_bucket = PV01<BucketedSector<Bond>>(bucket_obj, 0., 0);
     pv_buckets_[sector] = pv_of_bucket;
   }
+  for (auto& [sector, bucket] : pv_buckets_) {
+    for (const Bond& bond : bucket.GetProduct().GetProducts()) {
+      bucketsOf_[bond.GetProductId()].push_back(bucketList_.size());
+    }
+    bucketList_.push_back(&bucket);
+  }
 }
 
 PV01<Bond>& BondRiskService::GetData(std::string key) {
@@ -130,7 +161,7 @@ const vector<ServiceListener<PV01<Bond>>*>& BondRiskService::GetListeners() cons
 void BondRiskService::AddPosition(Position<Bond>& position) {
 
   // get (current) PV object to update the exposure and send to listeners
-  std::string id = position.GetProduct().GetProductId();
+  const ProductId& id = position.GetProduct().GetProductId();
   PV01<Bond>& pv_obj = pv_[id];
   // modify quantity in PV object to communicate to listeners
   long long quantity = pv_obj.GetQuantity() + position.GetAggregatePosition();
@@ -138,6 +169,12 @@ void BondRiskService::AddPosition(Position<Bond>& position) {
 
   std::cout << "New position: size is " << pv_[id].GetQuantity() << ", PV01 = " << pv_obj.GetPV01() << std::endl;
 
+  // listeners read the buckets too: refresh the ones holding the bond before publishing
+  auto buckets = bucketsOf_.find(id);
+  if (buckets != bucketsOf_.end()) {
+    for (std::size_t i : buckets->second) _updateBucket(*bucketList_[i]);
+  }
+
   std::cout << "Communicating risk of new position to listeners..." << endl;
   for (auto l : listeners_) {
     l->ProcessAdd(pv_obj);  // this is for the historical data listener
@@ -153,29 +190,56 @@ const PV01< BucketedSector<Bond> >& BondRiskService::GetBucketedRisk(std::string
   return pv_buckets_.at(sectorName);
 }
 
-void BondRiskService::UpdateBucketedRisk(std::string& sector) {
-  
-  // get bucketed sector object
-  BucketedSector<Bond> bucket = pv_buckets_[sector].GetProduct();
-  
+std::pair<double, long long> BondRiskService::_computeBucket(const PV01<BucketedSector<Bond>>& bucket) const {
   // loop thru bonds in bucketed sector and compute weighted PV
-  vector<Bond> products = bucket.GetProducts();
   long long qnt = 0LL;  // needed to divide and get weighted avg
   double cumulative_pv01 = 0.;
-  std::string id;
-  PV01<Bond> position;
 
-  for (Bond bond : products) {
-    id = bond.GetProductId();
-    position = pv_[id];
+  for (const Bond& bond : bucket.GetProduct().GetProducts()) {
+    auto it = pv_.find(bond.GetProductId());
+    if (it == pv_.end()) continue;
+    const PV01<Bond>& position = it->second;
     qnt += position.GetQuantity();
     cumulative_pv01 += position.GetPV01() * position.GetQuantity();
   }
   // compute weighted pv01
   double pv01 = (qnt != 0) ? cumulative_pv01 / qnt : 0.;
+  return { pv01, qnt };
+}
+
+void BondRiskService::_updateBucket(PV01<BucketedSector<Bond>>& bucket) {
+  auto [pv01, qnt] = _computeBucket(bucket);
+  bucket.SetPV01(pv01);
+  bucket.SetQuantity(qnt);
+}
+
+void BondRiskService::UpdateBucketedRisk(std::string& sector) {
+  // get bucketed sector risk, updated in place
+  _updateBucket(pv_buckets_[sector]);
+}
 
-  PV01<BucketedSector<Bond>> pv01bucket(bucket, pv01, qnt);
-  pv_buckets_[sector] = pv01bucket;
+void BondRiskService::UpdateAllBucketedRisk() {
+  // a handful of bonds per bucket: cheaper inline than forked on a pool
+  for (PV01<BucketedSector<Bond>>* bucket : bucketList_) _updateBucket(*bucket);
+}
+
+void BondRiskService::SaveState(SnapshotWriter& writer) const {
+  writer.BeginSection(snapshotTag_);
+  for (const auto& [id, pv] : pv_) {
+    writer.Put(id);
+    writer.Put(pv.GetPV01());
+    writer.Put(pv.GetQuantity());
+  }
+}
+
+void BondRiskService::LoadState(SnapshotReader& reader) {
+  if (!reader.FindSection(snapshotTag_)) throw std::runtime_error("snapshot has no risk");
+  while (reader.More()) {
+    ProductId id = reader.Get<ProductId>();
+    double pv01 = reader.Get<double>();
+    pv_[id] = PV01<Bond>(MakeBond(id), pv01, reader.Get<long>());
+  }
+  UpdateAllBucketedRisk();
 }
 
 // ************************************************************************************************
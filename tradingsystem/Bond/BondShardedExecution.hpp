@@ -0,0 +1,227 @@
+/**
+* BondShardedExecution.hpp
+*
+* Product-sharded market data -> algo -> execution -> booking -> position -> risk chain
+*
+* @author: Gabo Bernardino
+*/
+
+#ifndef BONDSHARDEDEXECUTION_HPP
+#define BONDSHARDEDEXECUTION_HPP
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <ostream>
+#include <thread>
+#include <vector>
+#include "../spscqueue.hpp"
+#include "BondMarketDataService.hpp"
+#include "BondAlgoExecutionService.hpp"
+#include "BondExecutionService.hpp"
+#include "BondSmartOrderRouter.hpp"
+#include "BondMatchingEngine.hpp"
+#include "BondTradeBookingService.hpp"
+#include "BondPositionService.hpp"
+#include "BondRiskService.hpp"
+
+/**
+* One shard of the execution chain.
+* Owns its own slice of every service in the chain, with its own smart order
+* router and venue matching engines, wired the same way as in main, plus the
+* queue of order books it consumes.
+* Order and trade ids carry the shard number, so they stay unique across shards.
+*
+* The trades, positions and risk of a shard stay in the shard: the historical
+* data services, the snapshots, the journal and the quoting engine of main do
+* not see them.
+*/
+class BondExecutionShard {
+public:
+  BondMarketDataService mkt_service;
+  BondAlgoExecutionService algo_service;
+  BondExecutionService execution_service;
+  BondTradeBookingService trade_service;
+  BondPositionService pos_service;
+  BondRiskService risk_service;
+  BondSmartOrderRouter router;
+  std::array<BondMatchingEngine, 3> venue_engines;  // per market
+
+private:
+  BondAlgoExecutionListener algo_listener_;
+  BondExecutionListener execution_listener_;
+  BondTradeBookingListener trade_listener_;
+  BondPositionListener pos_listener_;
+  BondRiskListener risk_listener_;
+
+  SpscQueue<OrderBook<Bond>> queue_;
+  int shardId_;
+  long processed_;
+
+public:
+  // ctor
+  BondExecutionShard(int shard_id, std::size_t queue_capacity);
+
+  // Queue of order books routed to this shard
+  SpscQueue<OrderBook<Bond>>& GetQueue();
+
+  // Process the queued order books until the queue is empty and `stop` is set
+  void Run(const std::atomic<bool>& stop);
+
+  // Number of order books processed by this shard
+  long GetProcessedCount() const;
+
+  // Print the books processed and how far the object pools grew
+  void Report(std::ostream& output) const;
+};
+
+/**
+* Sharded market data service
+* Partitions products across N worker threads: each order book is routed, by a
+* hash of its product id, to the shard owning that product, and processed there
+* by the whole chain down to risk. Products never share state across shards,
+* so shards run without locks on each other.
+*
+* Derives from BondMarketDataService so a BondMarketDataConnector can feed it directly.
+*/
+class BondShardedMarketDataService : public BondMarketDataService {
+private:
+  std::vector<std::unique_ptr<BondExecutionShard>> shards_;
+  std::vector<std::thread> workers_;
+  std::atomic<bool> stop_;
+
+public:
+  // ctor
+  BondShardedMarketDataService(int n_shards, std::size_t queue_capacity = 1024);
+  ~BondShardedMarketDataService();
+
+  // The callback that a Connector should invoke for any new or updated data
+  virtual void OnMessage(OrderBook<Bond>& data) override;
+
+  // Start one worker thread per shard
+  void Start();
+
+  // Drain every shard's queue, then join the workers
+  void Stop();
+
+  // Shard owning a product
+  std::size_t GetShardIndex(const ProductId& productId) const;
+
+  std::size_t GetShardCount() const;
+  BondExecutionShard& GetShard(std::size_t index);
+
+  // Print the report of every shard
+  void Report(std::ostream& output) const;
+};
+
+//*************************************************************************************************
+// BondExecutionShard implementations
+//*************************************************************************************************
+BondExecutionShard::BondExecutionShard(int shard_id, std::size_t queue_capacity) :
+  algo_listener_(&algo_service), execution_listener_(&execution_service), trade_listener_(&trade_service),
+  pos_listener_(&pos_service), risk_listener_(&risk_service), queue_(queue_capacity), shardId_(shard_id), processed_(0)
+{
+  // the trade path of main: the router and the venue engines see each book before the algo trades on it
+  mkt_service.AddListener(&router);
+  for (const VenueParams& venue : BondSmartOrderRouter::DefaultVenues()) {
+    BondMatchingEngine& engine = venue_engines[venue.market];
+    engine.SetVenue(BondSmartOrderRouter::MarketName(venue.market), venue.share, venue.priceOffset);
+    trade_listener_.SetVenueEngine(venue.market, &engine);
+    mkt_service.AddListener(&engine);
+  }
+  mkt_service.AddListener(&algo_listener_);
+  algo_service.AddListener(&execution_listener_);
+  execution_service.SetRouter(&router);
+  router.SetSimulateFills(false);  // the engines fill the children: the router only prices them
+  execution_service.AddListener(&trade_listener_);
+  trade_service.AddListener(&pos_listener_);
+  pos_service.AddListener(&risk_listener_);
+
+  // shard-local id generation
+  std::string tag = "57747FFCS" + std::to_string(shard_id) + "-";
+  algo_service.SetIdTag(tag);
+  trade_listener_.SetIdTag(tag);
+}
+
+SpscQueue<OrderBook<Bond>>& BondExecutionShard::GetQueue() {
+  return queue_;
+}
+
+void BondExecutionShard::Run(const std::atomic<bool>& stop) {
+  OrderBook<Bond> book;
+  while (true) {
+    if (queue_.TryPop(book)) {
+      mkt_service.OnMessage(book);
+      processed_++;
+    }
+    else if (stop.load(std::memory_order_acquire)) {
+      // the producer is done: drain what is left and exit
+      if (queue_.Empty()) break;
+    }
+    else std::this_thread::yield();
+  }
+}
+
+long BondExecutionShard::GetProcessedCount() const {
+  return processed_;
+}
+
+void BondExecutionShard::Report(std::ostream& output) const {
+  // each service keeps one pooled object per product: the pools grow with the products of the shard
+  output << "Shard " << shardId_ << ": " << processed_ << " order books, " << trade_service.GetBookedCount() << " trades booked, object pool high-water marks: AlgoExecution "
+    << algo_service.GetPool().GetHighWaterMark() << ", ExecutionOrder " << execution_service.GetPool().GetHighWaterMark()
+    << " (" << algo_service.GetPool().GetGrowthCount() + execution_service.GetPool().GetGrowthCount() << " growths)" << std::endl;
+}
+
+//*************************************************************************************************
+// BondShardedMarketDataService implementations
+//*************************************************************************************************
+BondShardedMarketDataService::BondShardedMarketDataService(int n_shards, std::size_t queue_capacity) :
+  stop_(false)
+{
+  for (int i = 0; i < n_shards; ++i) {
+    shards_.push_back(std::make_unique<BondExecutionShard>(i, queue_capacity));
+  }
+}
+
+BondShardedMarketDataService::~BondShardedMarketDataService() {
+  Stop();
+}
+
+void BondShardedMarketDataService::OnMessage(OrderBook<Bond>& data) {
+  // hand the book over to the shard owning the product
+  shards_[GetShardIndex(data.GetProduct().GetProductId())]->GetQueue().Push(data);
+}
+
+void BondShardedMarketDataService::Start() {
+  if (!workers_.empty()) return;
+  stop_ = false;
+  for (auto& shard : shards_) {
+    BondExecutionShard* s = shard.get();
+    workers_.emplace_back([this, s]() { s->Run(stop_); });
+  }
+}
+
+void BondShardedMarketDataService::Stop() {
+  stop_.store(true, std::memory_order_release);
+  for (std::thread& worker : workers_) worker.join();
+  workers_.clear();
+}
+
+std::size_t BondShardedMarketDataService::GetShardIndex(const ProductId& productId) const {
+  return std::hash<ProductId>()(productId) % shards_.size();
+}
+
+std::size_t BondShardedMarketDataService::GetShardCount() const {
+  return shards_.size();
+}
+
+BondExecutionShard& BondShardedMarketDataService::GetShard(std::size_t index) {
+  return *shards_[index];
+}
+
+void BondShardedMarketDataService::Report(std::ostream& output) const {
+  for (const auto& shard : shards_) shard->Report(output);
+}
+
+#endif // !BONDSHARDEDEXECUTION_HPP
@@ -0,0 +1,397 @@
+/**
+* BondSmartOrderRouter.hpp
+*
+* Venue simulators and a smart order router splitting parent execution
+* orders into child orders across BrokerTec, eSpeed and CME
+*
+* @author: Gabo Bernardino
+*/
+
+#ifndef BONDSMARTORDERROUTER_HPP
+#define BONDSMARTORDERROUTER_HPP
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+#include "../executionservice.hpp"
+#include "../marketdataservice.hpp"
+#include "../latencystats.hpp"
+#include "../products.hpp"
+
+/**
+* Parameters of a simulated venue
+* share: fraction of the consolidated book's liquidity resting on the venue
+* priceOffset: how much worse than the consolidated book the venue quotes, in price units
+* latency and jitter: order round trip, in microseconds
+* fee: per unit of quantity, in price units
+*/
+struct VenueParams {
+  Market market;
+  double share;
+  double priceOffset;
+  double latency;
+  double jitter;
+  double fee;
+};
+
+/**
+* Venue simulator - local stand-in for an exchange
+* Keeps, per product, a book derived from the live order book with the venue's
+* share of liquidity and price offset. Routed orders consume that liquidity
+* until the next book refreshes it, and each fill samples the latency model.
+*/
+class BondVenueSimulator {
+public:
+  struct Level {
+    double price;
+    long quantity;
+  };
+
+  static constexpr int depth_ = 5;
+
+  struct VenueBook {
+    std::array<Level, depth_> bids{};  // best first
+    std::array<Level, depth_> offers{};
+    int nBids = 0, nOffers = 0;
+  };
+
+private:
+  VenueParams params_;
+  std::unordered_map<ProductId, VenueBook> books_;
+  std::uint64_t seed_;  // latency jitter generator state
+
+public:
+  // ctor
+  BondVenueSimulator(const VenueParams& _params);
+
+  // Refresh the venue's view of a product from the live book
+  void OnBook(const OrderBook<Bond>& book);
+
+  // Venue book of a product - nullptr if the venue has not seen it
+  VenueBook* GetBook(const ProductId& productId);
+
+  // Take liquidity: consume `quantity` on the side hit by an order of side `side`
+  // Returns the quantity filled; `avg_price` receives the average fill price
+  long Execute(const ProductId& productId, PricingSide side, long quantity, double& avg_price);
+
+  // As Execute, but leaves the liquidity on the book
+  long Quote(const ProductId& productId, PricingSide side, long quantity, double& avg_price);
+
+  // Sample a round trip from the latency model, microseconds
+  double SampleLatency();
+
+  const VenueParams& GetParams() const;
+};
+
+/**
+* Order routed to a venue
+*/
+struct RoutedOrder {
+  Market market;
+  ExecutionOrder<Bond> order;
+};
+
+/**
+* Smart order router
+* For each parent order, ranks every level of every venue book by its expected
+* cost per unit - distance from the consolidated top of book, plus the price
+* drift expected over the venue's latency, plus fees - and fills the order from
+* the cheapest levels first. This minimizes expected slippage when cost is
+* linear in quantity. One child order is created per venue used; whatever the
+* venues cannot absorb goes to the venue with the cheapest top of book.
+*
+* The router listens to market data to refresh the venue books: add it as a
+* listener of the market data service before the algo execution listener, so
+* the venues see a book before orders generated from it are routed.
+*
+* Decision latency (from receiving the parent to having the children) is
+* recorded for every order, and the venues' simulated round trips for every child.
+*
+* By default the router also fills the children on the venue books, which then
+* hold less liquidity until the next book. When the children are filled further
+* down, e.g. by a BondMatchingEngine, turn that off with SetSimulateFills(false):
+* the router then only prices the children off the venue books, so each order is
+* executed once, by the engine.
+*/
+class BondSmartOrderRouter : public ServiceListener<OrderBook<Bond>> {
+private:
+  std::vector<BondVenueSimulator> venues_;
+  double driftPerMicro_;  // expected adverse price move per microsecond of latency
+  std::vector<RoutedOrder> children_;  // reused for every parent
+  std::vector<long> allocation_;  // quantity per venue, reused for every parent
+  LatencyStats decisionLatency_;
+  std::vector<LatencyStats> venueLatency_;  // simulated round trips of the child orders
+  long parents_;
+  long childCount_;
+  bool simulateFills_;
+
+  struct Candidate {
+    int venue;
+    int level;
+    double cost;
+  };
+  std::vector<Candidate> candidates_;  // reused for every parent
+
+public:
+  // ctor - default venues if none given
+  BondSmartOrderRouter(const std::vector<VenueParams>& venues = DefaultVenues(), double drift_per_micro = 1e-7);
+
+  static std::vector<VenueParams> DefaultVenues();
+  static const char* MarketName(Market market);
+
+  // Split a parent order into child orders, one per venue used
+  std::vector<RoutedOrder>& Route(const ExecutionOrder<Bond>& parent);
+
+  // Fill the children on the venue books (true, the default) or only price them off the books
+  void SetSimulateFills(bool simulate);
+
+  // Listener callbacks: refresh the venue books
+  virtual void ProcessAdd(OrderBook<Bond>& data) override;
+  virtual void ProcessRemove(OrderBook<Bond>& data) override;
+  virtual void ProcessUpdate(OrderBook<Bond>& data) override;
+
+  BondVenueSimulator& GetVenue(Market market);
+  const LatencyStats& GetDecisionLatency() const;
+
+  // Print routing counters and decision latency
+  void Report(std::ostream& output) const;
+};
+
+//*************************************************************************************************
+// BondVenueSimulator implementations
+//*************************************************************************************************
+BondVenueSimulator::BondVenueSimulator(const VenueParams& _params) :
+  params_(_params), seed_(0x9E3779B97F4A7C15ULL ^ static_cast<std::uint64_t>(_params.market)) {}
+
+void BondVenueSimulator::OnBook(const OrderBook<Bond>& book) {
+  VenueBook& venue_book = books_[book.GetProduct().GetProductId()];
+
+  auto copy_side = [this](const vector<Order>& stack, std::array<Level, depth_>& levels, int& n, bool bids) {
+    // the venue quotes worse than the consolidated book: lower bids, higher offers
+    double offset = bids ? -params_.priceOffset : params_.priceOffset;
+    n = 0;
+    for (const Order& order : stack) {
+      if (n == depth_) break;
+      long quantity = static_cast<long>(order.GetQuantity() * params_.share);
+      if (quantity <= 0) continue;
+      levels[n++] = Level{ order.GetPrice() + offset, quantity };
+    }
+    // best first: highest bid, lowest offer
+    std::sort(levels.begin(), levels.begin() + n, [bids](const Level& a, const Level& b) {
+      return bids ? a.price > b.price : a.price < b.price;
+    });
+  };
+  copy_side(book.GetBidStack(), venue_book.bids, venue_book.nBids, true);
+  copy_side(book.GetOfferStack(), venue_book.offers, venue_book.nOffers, false);
+}
+
+BondVenueSimulator::VenueBook* BondVenueSimulator::GetBook(const ProductId& productId) {
+  auto it = books_.find(productId);
+  return (it != books_.end()) ? &it->second : nullptr;
+}
+
+long BondVenueSimulator::Quote(const ProductId& productId, PricingSide side, long quantity, double& avg_price) {
+  avg_price = 0.;
+  const VenueBook* book = GetBook(productId);
+  if (book == nullptr) return 0;
+
+  const std::array<Level, depth_>& levels = (side == BID) ? book->bids : book->offers;
+  int n = (side == BID) ? book->nBids : book->nOffers;
+  long filled = 0;
+  double notional = 0.;
+  for (int level = 0; level < n && filled < quantity; ++level) {
+    long take = std::min(quantity - filled, levels[level].quantity);
+    filled += take;
+    notional += take * levels[level].price;
+  }
+  if (filled > 0) avg_price = notional / filled;
+  return filled;
+}
+
+long BondVenueSimulator::Execute(const ProductId& productId, PricingSide side, long quantity, double& avg_price) {
+  avg_price = 0.;
+  VenueBook* book = GetBook(productId);
+  if (book == nullptr) return 0;
+
+  // a BID order hits the bids (sell), an OFFER order lifts the offers (buy)
+  std::array<Level, depth_>& levels = (side == BID) ? book->bids : book->offers;
+  int& n = (side == BID) ? book->nBids : book->nOffers;
+
+  long filled = 0;
+  double notional = 0.;
+  int level = 0;
+  while (level < n && filled < quantity) {
+    long take = std::min(quantity - filled, levels[level].quantity);
+    filled += take;
+    notional += take * levels[level].price;
+    levels[level].quantity -= take;
+    if (levels[level].quantity == 0) level++;
+  }
+  // drop the exhausted levels
+  std::copy(levels.begin() + level, levels.begin() + n, levels.begin());
+  n -= level;
+
+  if (filled > 0) avg_price = notional / filled;
+  return filled;
+}
+
+double BondVenueSimulator::SampleLatency() {
+  // xorshift: uniform jitter in [-jitter, +jitter]
+  seed_ ^= seed_ << 13;
+  seed_ ^= seed_ >> 7;
+  seed_ ^= seed_ << 17;
+  double uniform = static_cast<double>(seed_ >> 11) / static_cast<double>(1ULL << 53);
+  return params_.latency + (2. * uniform - 1.) * params_.jitter;
+}
+
+const VenueParams& BondVenueSimulator::GetParams() const {
+  return params_;
+}
+
+//*************************************************************************************************
+// BondSmartOrderRouter implementations
+//*************************************************************************************************
+BondSmartOrderRouter::BondSmartOrderRouter(const std::vector<VenueParams>& venues, double drift_per_micro) :
+  driftPerMicro_(drift_per_micro), parents_(0), childCount_(0), simulateFills_(true)
+{
+  for (const VenueParams& params : venues) venues_.emplace_back(params);
+  venueLatency_.resize(venues_.size());
+  allocation_.resize(venues_.size());
+  children_.reserve(venues_.size());
+  candidates_.reserve(venues_.size() * BondVenueSimulator::depth_);
+}
+
+std::vector<VenueParams> BondSmartOrderRouter::DefaultVenues() {
+  // market, share, price offset, latency, jitter, fee
+  return {
+    VenueParams{ BROKERTEC, 0.5, 0., 150., 50., 0. },
+    VenueParams{ ESPEED, 0.3, 0., 250., 100., 0. },
+    VenueParams{ CME, 0.2, 1. / 256., 400., 150., 0. }
+  };
+}
+
+const char* BondSmartOrderRouter::MarketName(Market market) {
+  switch (market) {
+  case BROKERTEC: return "BROKERTEC";
+  case ESPEED: return "ESPEED";
+  case CME: return "CME";
+  }
+  return "";
+}
+
+std::vector<RoutedOrder>& BondSmartOrderRouter::Route(const ExecutionOrder<Bond>& parent) {
+  auto start = std::chrono::steady_clock::now();
+
+  children_.clear();
+  candidates_.clear();
+  const ProductId& id = parent.GetProduct().GetProductId();
+  PricingSide side = parent.GetSide();
+  long quantity = parent.GetVisibleQuantity() + parent.GetHiddenQuantity();
+
+  // reference price: best price across venues on the side the order takes
+  double reference = 0.;
+  bool has_reference = false;
+  for (BondVenueSimulator& venue : venues_) {
+    BondVenueSimulator::VenueBook* book = venue.GetBook(id);
+    if (book == nullptr) continue;
+    int n = (side == BID) ? book->nBids : book->nOffers;
+    if (n == 0) continue;
+    double top = (side == BID) ? book->bids[0].price : book->offers[0].price;
+    if (!has_reference || (side == BID ? top > reference : top < reference)) reference = top;
+    has_reference = true;
+  }
+
+  // expected cost per unit of every level of every venue
+  for (int v = 0; v < static_cast<int>(venues_.size()); ++v) {
+    BondVenueSimulator::VenueBook* book = venues_[v].GetBook(id);
+    if (book == nullptr) continue;
+    const VenueParams& params = venues_[v].GetParams();
+    int n = (side == BID) ? book->nBids : book->nOffers;
+    for (int l = 0; l < n; ++l) {
+      double price = (side == BID) ? book->bids[l].price : book->offers[l].price;
+      double slippage = (side == BID) ? reference - price : price - reference;
+      candidates_.push_back(Candidate{ v, l, slippage + driftPerMicro_ * params.latency + params.fee });
+    }
+  }
+  std::sort(candidates_.begin(), candidates_.end(),
+    [](const Candidate& a, const Candidate& b) { return a.cost < b.cost; });
+
+  // fill from the cheapest levels
+  std::fill(allocation_.begin(), allocation_.end(), 0L);
+  long remaining = quantity;
+  for (const Candidate& candidate : candidates_) {
+    if (remaining == 0) break;
+    BondVenueSimulator::VenueBook* book = venues_[candidate.venue].GetBook(id);
+    const BondVenueSimulator::Level& level = (side == BID) ? book->bids[candidate.level] : book->offers[candidate.level];
+    long take = std::min(remaining, level.quantity);
+    allocation_[candidate.venue] += take;
+    remaining -= take;
+  }
+  // whatever cannot be absorbed goes to the cheapest venue, or the first one without any book
+  int fallback = candidates_.empty() ? 0 : candidates_.front().venue;
+  allocation_[fallback] += remaining;
+
+  // one child per venue used, keeping the parent's visible/hidden ratio
+  double visible_ratio = (quantity > 0) ? static_cast<double>(parent.GetVisibleQuantity()) / quantity : 0.;
+  for (int v = 0; v < static_cast<int>(venues_.size()); ++v) {
+    if (allocation_[v] == 0) continue;
+    double avg_price = 0.;
+    if (simulateFills_) venues_[v].Execute(id, side, allocation_[v], avg_price);
+    else venues_[v].Quote(id, side, allocation_[v], avg_price);
+    venueLatency_[v].Record(static_cast<std::uint64_t>(venues_[v].SampleLatency() * 1000.));
+    if (avg_price == 0.) avg_price = parent.GetPrice();  // nothing resting: keep the parent's price
+
+    long visible = static_cast<long>(allocation_[v] * visible_ratio);
+    OrderId child_id(parent.GetOrderId());
+    child_id.Append("-").Append(MarketName(venues_[v].GetParams().market));
+    children_.push_back(RoutedOrder{ venues_[v].GetParams().market,
+      ExecutionOrder<Bond>(parent.GetProduct(), side, child_id, parent.GetOrderType(), avg_price,
+        visible, allocation_[v] - visible, parent.GetOrderId(), true) });
+  }
+
+  parents_++;
+  childCount_ += children_.size();
+  decisionLatency_.Record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now() - start).count());
+  return children_;
+}
+
+void BondSmartOrderRouter::SetSimulateFills(bool simulate) {
+  simulateFills_ = simulate;
+}
+
+void BondSmartOrderRouter::ProcessAdd(OrderBook<Bond>& data) {
+  for (BondVenueSimulator& venue : venues_) venue.OnBook(data);
+}
+
+void BondSmartOrderRouter::ProcessRemove(OrderBook<Bond>& data) {
+  // not implemented
+}
+
+void BondSmartOrderRouter::ProcessUpdate(OrderBook<Bond>& data) {
+  ProcessAdd(data);
+}
+
+BondVenueSimulator& BondSmartOrderRouter::GetVenue(Market market) {
+  for (BondVenueSimulator& venue : venues_) {
+    if (venue.GetParams().market == market) return venue;
+  }
+  return venues_.front();
+}
+
+const LatencyStats& BondSmartOrderRouter::GetDecisionLatency() const {
+  return decisionLatency_;
+}
+
+void BondSmartOrderRouter::Report(std::ostream& output) const {
+  output << "Router: " << parents_ << " parent orders split into " << childCount_ << " child orders" << std::endl;
+  decisionLatency_.Report(output, "Routing decision latency");
+  for (std::size_t v = 0; v < venues_.size(); ++v) {
+    venueLatency_[v].Report(output, std::string("Simulated round trip on ") + MarketName(venues_[v].GetParams().market));
+  }
+}
+
+#endif // !BONDSMARTORDERROUTER_HPP
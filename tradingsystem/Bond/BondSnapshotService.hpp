@@ -0,0 +1,153 @@
+/**
+* BondSnapshotService.hpp
+*
+* Periodic snapshots of the state of the bond services, and the fast restart
+* from the last snapshot and the tail of the trade journal
+*
+* @author: Gabo Bernardino
+*/
+
+#ifndef BONDSNAPSHOTSERVICE_HPP
+#define BONDSNAPSHOTSERVICE_HPP
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include "../snapshot.hpp"
+#include "../timerwheel.hpp"
+#include "../latencystats.hpp"
+#include "BondTradeBookingService.hpp"
+#include "BondPositionService.hpp"
+#include "BondRiskService.hpp"
+#include "BondMarketDataService.hpp"
+#include "BondInquiryService.hpp"
+#include "BondTradeJournal.hpp"
+
+/**
+* Snapshot service
+* A snapshot holds the booking counters and retained trades, positions, PV01,
+* order books and open inquiries. Trades, positions and risk are taken together
+* under the booking lock, so they match the same point of the trade journal;
+* order books and inquiries are each taken under their own service's lock.
+*
+* Restoring loads the snapshot, then books again the trades journaled after it,
+* so its cost depends on the size of the state and on the time since the last
+* snapshot, not on how many trades the day has seen.
+* The caller then resumes its inputs past what was booked: the trade connector
+* past GetReceivedCount() trades, and the booking listener past the executions
+* booked (GetBookedCount() - GetReceivedCount()), as the market data is replayed.
+*/
+class BondSnapshotService {
+private:
+  BondTradeBookingService* tradeService_;
+  BondPositionService* positionService_;
+  BondRiskService* riskService_;
+  BondMarketDataService* marketDataService_;
+  BondInquiryService* inquiryService_;
+  std::string path_;
+
+  TimerService* timers_;
+  TimerId timer_;
+  std::mutex mutex_;  // one snapshot at a time
+
+  long snapshots_;
+  std::size_t lastBytes_;
+  LatencyStats latency_;
+
+public:
+  // ctor
+  BondSnapshotService(BondTradeBookingService* _tradeService, BondPositionService* _positionService,
+    BondRiskService* _riskService, BondMarketDataService* _marketDataService, BondInquiryService* _inquiryService,
+    const std::string& _path = "Data/state.snap");
+
+  // Take a snapshot now; returns its size in bytes
+  std::size_t TakeSnapshot();
+
+  // Load the last snapshot into the services, then replay the trades of the journal booked after it
+  // Without a valid snapshot, the booked trades and positions are rebuilt from the whole journal
+  // Returns the number of trades replayed
+  long Restore(const std::string& journal);
+
+  // Take a snapshot every `period` on the timer service, until Stop
+  void Start(TimerService& timers, std::chrono::microseconds period);
+  void Stop();
+
+  // One-line summary: snapshots taken, last size, time to take one
+  void Report(std::ostream& output) const;
+};
+
+//*************************************************************************************************
+// BondSnapshotService implementations
+//*************************************************************************************************
+BondSnapshotService::BondSnapshotService(BondTradeBookingService* _tradeService, BondPositionService* _positionService,
+  BondRiskService* _riskService, BondMarketDataService* _marketDataService, BondInquiryService* _inquiryService,
+  const std::string& _path) :
+  tradeService_(_tradeService), positionService_(_positionService), riskService_(_riskService),
+  marketDataService_(_marketDataService), inquiryService_(_inquiryService), path_(_path),
+  timers_(nullptr), timer_(0), snapshots_(0), lastBytes_(0) {}
+
+std::size_t BondSnapshotService::TakeSnapshot() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto start = std::chrono::steady_clock::now();
+
+  SnapshotWriter writer;
+  tradeService_->SaveState(writer, [this](SnapshotWriter& w) {
+    positionService_->SaveState(w);
+    riskService_->SaveState(w);
+  });
+  marketDataService_->SaveState(writer);
+  inquiryService_->SaveState(writer);
+  lastBytes_ = writer.Commit(path_);
+
+  latency_.Record(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+  snapshots_++;
+  return lastBytes_;
+}
+
+long BondSnapshotService::Restore(const std::string& journal) {
+  std::unique_ptr<SnapshotReader> reader;
+  try {
+    reader = std::make_unique<SnapshotReader>(path_);  // checked whole before anything is loaded
+  }
+  catch (std::exception& e) {
+    std::cout << "An error occurred: " << e.what() << "; rebuilding from the journal" << std::endl;
+  }
+  if (reader) {
+    tradeService_->LoadState(*reader);
+    positionService_->LoadState(*reader);
+    riskService_->LoadState(*reader);
+    marketDataService_->LoadState(*reader);
+    inquiryService_->LoadState(*reader);
+  }
+
+  // the journal holds every trade booked: the snapshot covers the ones before its offset, which is seeked to
+  return BondTradeJournal::Replay(journal, tradeService_->GetJournalOffset(), BondTradeBookingConnector::ParseLine,
+    [this](Trade<Bond>& trade, bool received) { tradeService_->Replay(trade, received); });
+}
+
+void BondSnapshotService::Start(TimerService& timers, std::chrono::microseconds period) {
+  timers_ = &timers;
+  timer_ = timers.Schedule(period, [this]() {
+    try {
+      TakeSnapshot();
+    }
+    catch (std::exception& e) {
+      std::cout << "An error occurred: " << e.what() << std::endl;
+    }
+  }, period);
+}
+
+void BondSnapshotService::Stop() {
+  if (timers_ != nullptr) timers_->Cancel(timer_);
+  timers_ = nullptr;
+}
+
+void BondSnapshotService::Report(std::ostream& output) const {
+  output << "Snapshots: " << snapshots_ << " taken, last one " << lastBytes_ << " bytes" << std::endl;
+  latency_.Report(output, "Snapshot time");
+}
+
+#endif // !BONDSNAPSHOTSERVICE_HPP
@@ -9,10 +9,22 @@
 #ifndef BONDSTREAMINGSERVICE_HPP
 #define BONDSTREAMINGSERVICE_HPP
 
+#include <algorithm>
+#include <mutex>
+#include <ostream>
 #include "../streamingservice.hpp"
+#include "../timerwheel.hpp"
+#include "../latencystats.hpp"
 #include "BondTradeBookingService.hpp"
 #include "BondAlgoStreamingService.hpp"
 
+/**
+* Conflation applied by the streaming service before publishing:
+* NONE publishes every stream,
+* SUPPRESS_UNCHANGED drops a stream identical to the last one published for the product,
+* WINDOW keeps only the latest stream of each product and publishes it at the end of the window.
+*/
+enum class StreamConflation { NONE, SUPPRESS_UNCHANGED, WINDOW };
 
 /**
  * Bond Streaming Service
@@ -21,15 +33,65 @@
  * 
  * Gets data via a listener on BondAlgoStreamingService and communicates it
  * to Historical Data Listeners to print the stream
+ *
+ * Optionally conflates the streams before publishing them (see StreamConflation).
+ * In WINDOW mode a periodic timer flushes the pending streams, so listeners are
+ * then called from the timer thread; publishing is serialized by a lock.
  */
 class BondStreamingService : public StreamingService<Bond> {
 private:
+  struct PendingStream {
+    PriceStream<Bond> stream;
+    std::int64_t arrival = 0;  // clock time of the held stream, micros
+    bool pending = false;
+  };
+
   std::vector<ServiceListener<PriceStream<Bond>>*> listeners_;
-  std::unordered_map<std::string, PriceStream<Bond>> streams_;
+  std::unordered_map<ProductId, PriceStream<Bond>> streams_;  // last published
+
+  StreamConflation conflation_;
+  TimerService* timers_;
+  TimerId windowTimer_;
+  std::unordered_map<ProductId, PendingStream> pending_;
+  std::mutex mutex_;
+
+  // counters
+  long received_;
+  long published_;
+  long suppressed_;
+  LatencyStats addedLatency_;  // delay the window added to each stream it delivered
+
+  // Same prices and sizes on both sides
+  static bool _sameStream(const PriceStream<Bond>& a, const PriceStream<Bond>& b);
+  // Send a stream to the listeners - lock held
+  void _publish(PriceStream<Bond>& priceStream);
+  // Publish every pending stream - lock held
+  void _flushPending();
 
 public:
   //ctor
   BondStreamingService();
+  ~BondStreamingService();
+
+  // Choose the conflation - WINDOW needs a timer service to flush the windows
+  void SetConflation(StreamConflation mode, std::chrono::microseconds window = std::chrono::microseconds(0),
+    TimerService* timers = nullptr);
+
+  // Publish the streams still held by the window and stop its timer;
+  // streams are published as they come afterwards
+  void Flush();
+
+  // Counters
+  long GetReceivedCount() const;
+  long GetPublishedCount() const;
+  long GetSuppressedCount() const;
+  // Average and maximum delay added by the window to the streams it delivered, micros
+  double GetAverageAddedLatency() const;
+  std::int64_t GetMaxAddedLatency() const;
+  const LatencyStats& GetAddedLatency() const;
+
+  // Print the counters and the delay added by the window
+  void Report(std::ostream& output) const;
 
   // Get data on our service given a key
   virtual PriceStream<Bond>& GetData(std::string key) override;
@@ -76,8 +138,15 @@ public:
 //*************************************************************************************************
 // BondStreamingService implementations
 //*************************************************************************************************
-BondStreamingService::BondStreamingService() {
-  streams_ = std::unordered_map<std::string, PriceStream<Bond>>();
+BondStreamingService::BondStreamingService() :
+  conflation_(StreamConflation::NONE), timers_(nullptr), windowTimer_(0),
+  received_(0), published_(0), suppressed_(0)
+{
+  streams_ = std::unordered_map<ProductId, PriceStream<Bond>>();
+}
+
+BondStreamingService::~BondStreamingService() {
+  Flush();
 }
 
 PriceStream<Bond>& BondStreamingService::GetData(std::string key) {
@@ -97,9 +166,48 @@ const vector<ServiceListener<PriceStream<Bond>>*>& BondStreamingService::GetList
 }
 
 void BondStreamingService::PublishPrice(PriceStream<Bond>& priceStream) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  received_++;
+  const ProductId& id = priceStream.GetProduct().GetProductId();
+
+  switch (conflation_) {
+  case StreamConflation::SUPPRESS_UNCHANGED: {
+    auto it = streams_.find(id);
+    if (it != streams_.end() && _sameStream(it->second, priceStream)) {
+      suppressed_++;
+      return;
+    }
+    break;
+  }
+  case StreamConflation::WINDOW: {
+    // hold the latest stream, the window timer publishes it
+    PendingStream& held = pending_[id];
+    if (held.pending) suppressed_++;  // overwritten before being published
+    held.stream = priceStream;
+    held.arrival = timers_->GetClock().NowMicros();
+    held.pending = true;
+    return;
+  }
+  default:
+    break;
+  }
+
+  _publish(priceStream);
+}
+
+bool BondStreamingService::_sameStream(const PriceStream<Bond>& a, const PriceStream<Bond>& b) {
+  auto same_order = [](const PriceStreamOrder& x, const PriceStreamOrder& y) {
+    return x.GetPrice() == y.GetPrice() && x.GetVisibleQuantity() == y.GetVisibleQuantity()
+      && x.GetHiddenQuantity() == y.GetHiddenQuantity();
+  };
+  return same_order(a.GetBidOrder(), b.GetBidOrder()) && same_order(a.GetOfferOrder(), b.GetOfferOrder());
+}
+
+void BondStreamingService::_publish(PriceStream<Bond>& priceStream) {
   // add price stream to map
-  std::string id = priceStream.GetProduct().GetProductId();
+  const ProductId& id = priceStream.GetProduct().GetProductId();
   streams_[id] = priceStream;
+  published_++;
 
   // communicate order to listeners
   std::cout << "Communicating price stream for bond " << id << " to PriceStream Listeners..." << endl;
@@ -108,6 +216,80 @@ void BondStreamingService::PublishPrice(PriceStream<Bond>& priceStream) {
   }
 }
 
+void BondStreamingService::_flushPending() {
+  if (timers_ == nullptr) return;
+  std::int64_t now = timers_->GetClock().NowMicros();
+  for (auto& [id, held] : pending_) {
+    if (!held.pending) continue;
+    addedLatency_.Record(static_cast<std::uint64_t>(std::max<std::int64_t>(now - held.arrival, 0)) * 1000);
+    held.pending = false;
+    _publish(held.stream);
+  }
+}
+
+void BondStreamingService::SetConflation(StreamConflation mode, std::chrono::microseconds window, TimerService* timers) {
+  Flush();  // leave the previous mode cleanly
+
+  // the timer callback takes the lock: never schedule or cancel while holding it
+  TimerId timer = 0;
+  if (mode == StreamConflation::WINDOW) {
+    timer = timers->Schedule(window, [this]() {
+      std::lock_guard<std::mutex> lock(mutex_);
+      _flushPending();
+    }, window);
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  conflation_ = mode;
+  timers_ = (mode == StreamConflation::WINDOW) ? timers : nullptr;
+  windowTimer_ = timer;
+}
+
+void BondStreamingService::Flush() {
+  TimerService* timers;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    timers = timers_;
+  }
+  if (timers == nullptr) return;
+  timers->Cancel(windowTimer_);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  _flushPending();
+  timers_ = nullptr;
+  conflation_ = StreamConflation::NONE;
+}
+
+long BondStreamingService::GetReceivedCount() const {
+  return received_;
+}
+
+long BondStreamingService::GetPublishedCount() const {
+  return published_;
+}
+
+long BondStreamingService::GetSuppressedCount() const {
+  return suppressed_;
+}
+
+double BondStreamingService::GetAverageAddedLatency() const {
+  return addedLatency_.GetMean() / 1000.;
+}
+
+std::int64_t BondStreamingService::GetMaxAddedLatency() const {
+  return static_cast<std::int64_t>(addedLatency_.GetMax() / 1000);
+}
+
+const LatencyStats& BondStreamingService::GetAddedLatency() const {
+  return addedLatency_;
+}
+
+void BondStreamingService::Report(std::ostream& output) const {
+  output << "Streaming: " << received_ << " price streams received, " << published_ << " published, "
+    << suppressed_ << " suppressed by conflation" << std::endl;
+  if (addedLatency_.GetCount() > 0) addedLatency_.Report(output, "Latency added by the conflation window");
+}
+
 //*************************************************************************************************
 // BondStreamingListener implementations
 //*************************************************************************************************
@@ -124,10 +306,8 @@ void BondStreamingListener::ProcessRemove(AlgoStream<Bond>& data) {
 
 void BondStreamingListener::ProcessUpdate(AlgoStream<Bond>& data) {
   
-  // get price stream from algo
-  PriceStream<Bond> price = data.GetPriceStream();
-
-  bondStreamService_->PublishPrice(price);
+  // pass the price stream from algo thru by reference
+  bondStreamService_->PublishPrice(data.GetPriceStream());
 }
 
 
@@ -9,29 +9,76 @@
 #ifndef BONDTRADEBOOKINGSERVICE_HPP
 #define BONDTRADEBOOKINGSERVICE_HPP
 
+#include <algorithm>
 #include <array>
+#include <charconv>
+#include <deque>
 #include <fstream>
+#include <mutex>
 #include <unordered_map>
 #include "../tradebookingservice.hpp"
+#include "../retentionstore.hpp"
 #include "../utils.hpp"
+#include "../chunkedreader.hpp"
+#include "../filetailer.hpp"
+#include "../snapshot.hpp"
+#include "../unixsocket.hpp"
+#include "BondWireProtocol.hpp"
 #include "BondPositionService.hpp"
 #include "BondExecutionService.hpp"
+#include "BondMatchingEngine.hpp"
+#include "BondTradeJournal.hpp"
 
 /**
  * Trade Booking Service to book trades to a particular book specialized for Bonds
- * stores a vector of listeners and a map of strings -> trades
+ * stores a vector of listeners and a bounded store of trade ids -> trades
+ * (the most recent `retention` trades; older ones are evicted to a journal connector)
  * 
  * Gets data from `trades.txt` via a connector and communicates it
  * to Position listeners
+ * Trades also arrive from the execution flow, so booking is serialized:
+ * the service is the single writer of the trade -> position -> risk chain
+ * With a journal set, every trade is journaled and held until the journal's group
+ * commit has made it durable: only then is it stored and sent to the listeners,
+ * so positions, risk and the historical files never see a trade a crash could lose
  */
 class BondTradeBookingService : public TradeBookingService<Bond> {
 private:
   std::vector<ServiceListener<Trade<Bond>>*> listeners_;
-  std::unordered_map<std::string, Trade<Bond>> trades_;  // keyed on trade id
+  RetentionStore<TradeId, Trade<Bond>> trades_;  // keyed on trade id
+  BondTradeJournal* journal_;
+
+  // trades journaled but not durable yet, in journal order
+  struct HeldTrade {
+    long entry;
+    Trade<Bond> trade;
+    bool received;
+  };
+  std::deque<HeldTrade> held_;
+
+  std::int64_t journalOffset_;  // journal offset past the last trade booked, as of the last snapshot taken or restored
+  long booked_;  // trades booked since the start of the day
+  long received_;  // of which received from the connector
+
+  std::mutex mutex_;  // one trade at a time thru the service and its listeners
+
+  // Book a trade, the lock being held - journaled trades are held until durable
+  void _book(Trade<Bond>& trade, bool received);
+
+  // Store a trade and send it to the listeners, the lock being held
+  void _deliver(Trade<Bond>& trade, bool received);
+
+  // Deliver the held trades among the first `durable` entries of the journal, the lock being held
+  void _release(long durable);
 
 public:
+  static constexpr std::uint32_t snapshotTag_ = 1;
+
   // ctor
-  BondTradeBookingService();
+  BondTradeBookingService(std::size_t retention = 1 << 16);
+
+  // Connector receiving the trades evicted from the service
+  void SetEvictionConnector(Connector<Trade<Bond>>* _connector);
 
   // Get data on our service given a key
   virtual Trade<Bond>& GetData(std::string key) override;
@@ -48,25 +95,57 @@ public:
 
   // Book the trade
   virtual void AddTrade(Trade<Bond>& trade) override;
+
+  // Journal every trade booked from now on (nullptr stops journaling)
+  void SetJournal(BondTradeJournal* _journal);
+
+  // Make every trade journaled so far durable, and deliver the ones still held
+  void SyncJournal();
+
+  // Book a trade read back from the journal
+  void Replay(Trade<Bond>& trade, bool received);
+
+  // Snapshot the booking counters and the retained trades, then let `downstream`
+  // snapshot the services fed by the booking, all without a trade going thru
+  void SaveState(SnapshotWriter& writer, const std::function<void(SnapshotWriter&)>& downstream);
+
+  // Restore the state of a snapshot; listeners are not called
+  void LoadState(SnapshotReader& reader);
+
+  long GetBookedCount() const;
+  long GetReceivedCount() const;
+
+  // Byte offset of the journal after the trades of the snapshot loaded (0 before any)
+  std::int64_t GetJournalOffset() const;
+
+  // Trades journaled and waiting for their commit
+  std::size_t GetHeldCount();
 };
 
 /**
 * Trade booking listener specialized for bonds
 * Sends trades from Booking service to Position service
+* Without a matching engine every execution order is booked in full at its price;
+* with one, orders go to the engine of their market and a trade is booked for each of their fills
 */
-class BondTradeBookingListener : public ServiceListener<ExecutionOrder<Bond>> {
+class BondTradeBookingListener : public ServiceListener<ExecutionOrder<Bond>>, public ServiceListener<Fill<Bond>> {
 private:
   BondTradeBookingService* bondTradeBookingService_;
+  std::array<BondMatchingEngine*, 3> engines_;  // per market
+  int source_;  // of the orders submitted to the engine
 
   // keep count of book to place the trade on
-  std::array<std::string, 3> books_;
+  std::array<BookId, 3> books_;
   long counter_;
+  std::string idTag_;  // goes between ticker and counter in trade ids
+  long skip_;  // trades still to skip before resuming
 
+  // Book a trade on the next book in the rotation
+  void _book(const Bond& bond, double price, long qnt, Side side);
 
 public:
   // ctor
   BondTradeBookingListener(BondTradeBookingService* _service);
-  BondTradeBookingListener() = default;
 
   // Listener callback to process an add event to the Service
   virtual void ProcessAdd(ExecutionOrder<Bond>& data) override;
@@ -76,6 +155,25 @@ public:
 
   // Listener callback to process an update event to the Service
   virtual void ProcessUpdate(ExecutionOrder<Bond>& data) override;
+
+  // Listener callbacks for the fills of the matching engine
+  virtual void ProcessAdd(Fill<Bond>& data) override;
+  virtual void ProcessRemove(Fill<Bond>& data) override;
+  virtual void ProcessUpdate(Fill<Bond>& data) override;
+
+  // Fill orders on a matching engine instead of booking them in full (nullptr books them as they come)
+  // The orders are submitted as coming from `_source`, so they never trade with each other
+  void SetMatchingEngine(BondMatchingEngine* _engine, int _source = 0);
+
+  // Fill the orders executed on `_market` on their own engine, e.g. one seeing that venue's book
+  void SetVenueEngine(Market _market, BondMatchingEngine* _engine);
+
+  // Set the tag used to build trade ids, e.g. to keep ids of different shards apart
+  void SetIdTag(const std::string& _tag);
+
+  // Skip the first `trades` trades from executions, already booked before a restart
+  // The market data is replayed from its start, so the same executions come again in the same order
+  void SetResumePoint(long trades);
 };
 
 
@@ -83,14 +181,38 @@ public:
 * Trade booking connector class specialized for bonds;
 * Reads from `trades.txt`, creates Trade objects and sends them to the service
 * Subscribe-only connector
+* With a task pool set, the file is parsed in chunks on the pool
+* Can also serve trades pushed as binary frames on a Unix socket
 */
 class BondTradeBookingConnector : public Connector<Trade<Bond>> {
 private:
   BondTradeBookingService* tradeBookingService_;
+  ChunkedFileReader<Trade<Bond>> reader_;
+  long skip_ = 0L;  // trades still to skip before resuming
+
+  // Send a parsed line on to the service
+  void _deliver(Trade<Bond>& trade_obj);
+
 public:
   BondTradeBookingConnector(BondTradeBookingService* _service);
   BondTradeBookingConnector() = default;
 
+  // Parse a line: bond id, trade id, price, book, size, side
+  static bool ParseLine(const char* begin, const char* end, Trade<Bond>& trade);
+
+  // Parse the file in chunks on a pool (nullptr reads it line by line)
+  void SetTaskPool(WorkStealingPool* _pool);
+
+  // Skip the first `trades` trades received, already booked before a restart
+  void SetResumePoint(long trades);
+
+  // Follow a file still being written, until `stop` returns true
+  void Tail(const char* filename, const std::function<bool()>& stop, const bool& header = true);
+
+  // Serve binary frames (BondWireProtocol.hpp) from any number of clients on a Unix socket,
+  // until `stop` returns true
+  void ServeSocket(const char* path, const std::function<bool()>& stop);
+
   // Subscribe to a Service
   virtual void Subscribe(const char* filename, const bool& header = true) override;
 
@@ -102,17 +224,23 @@ public:
 // ************************************************************************************************
 // BondTradeBookingService implementations
 // ************************************************************************************************
-BondTradeBookingService::BondTradeBookingService() {
-  trades_ = std::unordered_map<std::string, Trade<Bond>>();
+BondTradeBookingService::BondTradeBookingService(std::size_t retention) :
+  trades_(retention), journal_(nullptr), journalOffset_(0), booked_(0), received_(0) {}
+
+void BondTradeBookingService::SetEvictionConnector(Connector<Trade<Bond>>* _connector) {
+  trades_.SetEvictionConnector(_connector);
 }
 
 Trade<Bond>& BondTradeBookingService::GetData(std::string key) {
-  return trades_[key];
+  TradeId id(key);
+  Trade<Bond>* trade = trades_.Find(id);
+  return (trade != nullptr) ? *trade : trades_.Insert(id, Trade<Bond>());
 }
 
 void BondTradeBookingService::OnMessage(Trade<Bond>& data) {
   // book the trade
-  AddTrade(data);
+  std::lock_guard<std::mutex> lock(mutex_);
+  _book(data, true);
 }
 
 void BondTradeBookingService::AddListener(ServiceListener<Trade<Bond>>* listener) {
@@ -124,9 +252,28 @@ const vector<ServiceListener<Trade<Bond>>*>& BondTradeBookingService::GetListene
 }
 
 void BondTradeBookingService::AddTrade(Trade<Bond>& trade) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  _book(trade, false);
+}
+
+void BondTradeBookingService::_book(Trade<Bond>& trade, bool received) {
+  if (journal_ == nullptr) {
+    _deliver(trade, received);
+    return;
+  }
+
+  // journal first: a trade that reached the positions can always be replayed
+  long entry = journal_->Append(trade, received);
+  held_.push_back(HeldTrade{ entry, trade, received });
+  _release(journal_->GetDurableCount());  // a zero window has already synced it
+}
+
+void BondTradeBookingService::_deliver(Trade<Bond>& trade, bool received) {
+  booked_++;
+  if (received) received_++;
+
   // add data to the stored trades:
-  std::string id = trade.GetTradeId();
-  trades_[id] = trade;
+  trades_.Insert(trade.GetTradeId(), trade);
 
   std::cout << "Communicating trade to Position Listeners" << std::endl;
   // communicate trade to position service via listener
@@ -135,6 +282,104 @@ void BondTradeBookingService::AddTrade(Trade<Bond>& trade) {
   }
 }
 
+void BondTradeBookingService::_release(long durable) {
+  while (!held_.empty() && held_.front().entry <= durable) {
+    HeldTrade& held = held_.front();
+    _deliver(held.trade, held.received);
+    held_.pop_front();
+  }
+}
+
+void BondTradeBookingService::SetJournal(BondTradeJournal* _journal) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (journal_ != nullptr) {
+    // the trades held for the previous journal go thru before it is dropped
+    journal_->SetCommitCallback(nullptr);
+    journal_->Sync();
+    _release(journal_->GetDurableCount());
+  }
+  journal_ = _journal;
+  if (journal_ != nullptr) {
+    // the committer thread books the trades of each group commit
+    journal_->SetCommitCallback([this](long durable) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      _release(durable);
+    });
+  }
+}
+
+void BondTradeBookingService::SyncJournal() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (journal_ == nullptr) return;
+  journal_->Sync();
+  _release(journal_->GetDurableCount());
+}
+
+void BondTradeBookingService::Replay(Trade<Bond>& trade, bool received) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  BondTradeJournal* journal = journal_;
+  journal_ = nullptr;  // already in the journal
+  _book(trade, received);
+  journal_ = journal;
+}
+
+void BondTradeBookingService::SaveState(SnapshotWriter& writer, const std::function<void(SnapshotWriter&)>& downstream) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  // a snapshot never covers trades the journal could still lose, nor misses one it holds
+  if (journal_ != nullptr) {
+    journal_->Sync();
+    _release(journal_->GetDurableCount());
+    journalOffset_ = journal_->GetDurableOffset();  // every trade booked is before it
+  }
+  writer.BeginSection(snapshotTag_);
+  writer.Put(journalOffset_);
+  writer.Put(booked_);
+  writer.Put(received_);
+  trades_.ForEach([&writer](const TradeId& id, const Trade<Bond>& trade) {
+    writer.Put(trade.GetProduct().GetProductId());
+    writer.Put(id);
+    writer.Put(trade.GetPrice());
+    writer.Put(trade.GetBook());
+    writer.Put(trade.GetQuantity());
+    writer.Put(trade.GetSide());
+  });
+  downstream(writer);
+}
+
+void BondTradeBookingService::LoadState(SnapshotReader& reader) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!reader.FindSection(snapshotTag_)) throw std::runtime_error("snapshot has no trade booking state");
+  journalOffset_ = reader.Get<std::int64_t>();
+  booked_ = reader.Get<long>();
+  received_ = reader.Get<long>();
+  while (reader.More()) {
+    const Bond& bond = MakeBond(reader.Get<ProductId>());
+    TradeId id = reader.Get<TradeId>();
+    double price = reader.Get<double>();
+    BookId book = reader.Get<BookId>();
+    long quantity = reader.Get<long>();
+    Side side = reader.Get<Side>();
+    trades_.Insert(id, Trade<Bond>(bond, id, price, book, quantity, side));
+  }
+}
+
+long BondTradeBookingService::GetBookedCount() const {
+  return booked_;
+}
+
+long BondTradeBookingService::GetReceivedCount() const {
+  return received_;
+}
+
+std::int64_t BondTradeBookingService::GetJournalOffset() const {
+  return journalOffset_;
+}
+
+std::size_t BondTradeBookingService::GetHeldCount() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return held_.size();
+}
+
 
 // ************************************************************************************************
 // BondTradeBookingConnector implementations
@@ -142,40 +387,61 @@ void BondTradeBookingService::AddTrade(Trade<Bond>& trade) {
 BondTradeBookingConnector::BondTradeBookingConnector(BondTradeBookingService* _service) :
   tradeBookingService_(_service) {}
 
-void BondTradeBookingConnector::Subscribe(const char* filename, const bool& header) {
-  std::string line;
-  std::vector<std::string> row;  // to store output of string splitting
-  Bond bond;  // bond object for the bond that is being traded
+bool BondTradeBookingConnector::ParseLine(const char* begin, const char* end, Trade<Bond>& trade) {
+  // get bond id, trade id, price, book, size and side
+  std::array<std::pair<const char*, const char*>, 6> row;
+  if (SplitFields(begin, end, ',', row) < 6) return false;
+
+  // some items need preprocessing
+  // create a bond object from the id:
+  // ids too long for their type make the line malformed
+  ProductId id;
+  TradeId trade_id;
+  BookId book;
+  if (!id.TryAppend(row[0].first, row[0].second - row[0].first) || !trade_id.TryAppend(row[1].first, row[1].second - row[1].first)
+    || !book.TryAppend(row[3].first, row[3].second - row[3].first)) return false;
+  const Bond& bond = MakeBond(id);
+  // compute price
   double trade_price;
-  long trade_size;
-  Side side;  // buy or sell
+  if (!TryStringToPrice(row[2].first, row[2].second, trade_price)) return RejectField("price", row[2].first, row[2].second);
+  // trade size:
+  long trade_size = 0;
+  std::from_chars(row[4].first, row[4].second, trade_size);
+  // trade side:
+  Side side = (std::string_view(row[5].first, row[5].second - row[5].first) == "BUY") ? BUY : SELL;
+
+  trade = Trade<Bond>(bond, trade_id, trade_price, book, trade_size, side);
+  return true;
+}
+
+void BondTradeBookingConnector::_deliver(Trade<Bond>& trade_obj) {
+  if (skip_ > 0) {
+    skip_--;
+    return;
+  }
+  std::cout << PrintTimeStamp();
+  std::cout << " Bond: " << trade_obj.GetProduct() << std::endl;
+  // communicate trade to service
+  tradeBookingService_->OnMessage(trade_obj);
 
+  std::cout << std::endl;
+}
+
+void BondTradeBookingConnector::Subscribe(const char* filename, const bool& header) {
   try {
+    if (reader_.GetTaskPool() != nullptr) {
+      reader_.Read(filename, header, ParseLine, [this](Trade<Bond>& trade_obj) { _deliver(trade_obj); });
+      return;
+    }
+
+    std::string line;
+    Trade<Bond> trade_obj;
     std::ifstream in(filename);
     if (header) std::getline(in, line);  // skip header
     
     while (std::getline(in, line)) {
-      // get bond id, trade id, price, book, size and side
-      boost::algorithm::split(row, line, boost::algorithm::is_any_of(","));
-
-      // some items need preprocessing
-      // create a bond object from the id:
-      bond = MakeBond(row[0]);
-      std::cout << PrintTimeStamp();
-      std::cout << " Bond: " << bond << std::endl;
-      // compute price
-      trade_price = StringToPrice(row[2]);
-      // trade size:
-      trade_size = std::stol(row[4]);
-      // trade side:
-      boost::algorithm::trim(row[5]);
-      side = (row[5] == "BUY") ? BUY : SELL;
-
-      Trade<Bond> trade_obj(bond, row[1], trade_price, row[3], trade_size, side);
-      // communicate trade to service
-      tradeBookingService_->OnMessage(trade_obj);
-
-      std::cout << std::endl;
+      boost::algorithm::trim(line);
+      if (ParseLine(line.data(), line.data() + line.size(), trade_obj)) _deliver(trade_obj);
     }
   }
   catch (std::exception& e) {
@@ -183,6 +449,44 @@ void BondTradeBookingConnector::Subscribe(const char* filename, const bool& head
   }
 }
 
+void BondTradeBookingConnector::SetTaskPool(WorkStealingPool* _pool) {
+  reader_.SetTaskPool(_pool);
+}
+
+void BondTradeBookingConnector::SetResumePoint(long trades) {
+  skip_ = trades;
+}
+
+void BondTradeBookingConnector::Tail(const char* filename, const std::function<bool()>& stop, const bool& header) {
+  try {
+    FileTailer tailer(filename);
+    Trade<Bond> trade_obj;
+    tailer.Run([this, &trade_obj](const char* begin, const char* end) {
+      if (ParseLine(begin, end, trade_obj)) _deliver(trade_obj);
+    }, stop, header);
+  }
+  catch (std::exception& e) {
+    std::cout << "An error occurred: " << e.what() << std::endl;
+  }
+}
+
+void BondTradeBookingConnector::ServeSocket(const char* path, const std::function<bool()>& stop) {
+  try {
+    UnixSocketServer server(path, wireFrameSize);
+    Trade<Bond> trade_obj;
+    long rejected = 0;  // frames of another type, or with an unknown side or state
+    server.Run([this, &trade_obj, &rejected](const char* frame) {
+      if (DecodeTrade(frame, trade_obj)) _deliver(trade_obj);
+      else rejected++;
+    }, stop);
+    std::cout << PrintTimeStamp() << " " << path << ": " << server.GetFrameCount() << " frames from "
+      << server.GetClientCount() << " clients in " << server.GetRecvCount() << " reads, " << rejected << " rejected" << std::endl;
+  }
+  catch (std::exception& e) {
+    std::cout << "An error occurred: " << e.what() << std::endl;
+  }
+}
+
 void BondTradeBookingConnector::Publish(Trade<Bond>& data) {
   // subscribe only
 }
@@ -192,29 +496,45 @@ void BondTradeBookingConnector::Publish(Trade<Bond>& data) {
 // BondTradeBookingListener implementations
 // ************************************************************************************************
 BondTradeBookingListener::BondTradeBookingListener(BondTradeBookingService* _service) :
-  bondTradeBookingService_(_service)
+  bondTradeBookingService_(_service), source_(0), skip_(0)
 {
-  books_ = std::array<std::string, 3>{"TRSY1", "TRSY2", "TRSY3"};
+  engines_.fill(nullptr);
+  books_ = std::array<BookId, 3>{"TRSY1", "TRSY2", "TRSY3"};
   counter_ = 0;
+  idTag_ = "57747FFC";
 }
 
-void BondTradeBookingListener::ProcessAdd(ExecutionOrder<Bond>& data) {
-  // bond object:
-  std::string id = data.GetProduct().GetProductId();
-  Bond bond = MakeBond(id);
+void BondTradeBookingListener::_book(const Bond& bond, double price, long qnt, Side side) {
   //trade data:
-  std::string trade_id = bond.GetTicker() + "57747FFC" + std::to_string(counter_);
-  double price = data.GetPrice();
-  long qnt = data.GetHiddenQuantity() + data.GetVisibleQuantity();
-  Side side = (data.GetSide() == OFFER) ? BUY : SELL;
+  TradeId trade_id(bond.GetTicker());
+  trade_id.Append(idTag_).AppendNumber(counter_);
   // rotate thru the three books:
-  std::string book = books_[counter_];
+  const BookId& book = books_[counter_];
   counter_++; counter_ %= 3;
+  if (skip_ > 0) {
+    // booked before the restart: the rotation still moves on, as it did then
+    skip_--;
+    return;
+  }
 
+  // the service keeps its own copy: the trade only lives for the call
   Trade<Bond> trade_obj(bond, trade_id, price, book, qnt, side);
   bondTradeBookingService_->AddTrade(trade_obj);
 }
 
+void BondTradeBookingListener::ProcessAdd(ExecutionOrder<Bond>& data) {
+  BondMatchingEngine* engine = engines_[data.GetMarket()];
+  if (engine != nullptr) {
+    // the engine calls back with the fills, if any
+    engine->Submit(data, source_);
+    return;
+  }
+
+  long qnt = data.GetHiddenQuantity() + data.GetVisibleQuantity();
+  Side side = (data.GetSide() == OFFER) ? BUY : SELL;
+  _book(data.GetProduct(), data.GetPrice(), qnt, side);
+}
+
 void BondTradeBookingListener::ProcessRemove(ExecutionOrder<Bond>& data) {
   // not implemented
 }
@@ -223,4 +543,38 @@ void BondTradeBookingListener::ProcessUpdate(ExecutionOrder<Bond>& data) {
   // not implemented
 }
 
+void BondTradeBookingListener::ProcessAdd(Fill<Bond>& data) {
+  Side side = (data.GetSide() == OFFER) ? BUY : SELL;
+  _book(data.GetProduct(), data.GetPrice(), data.GetQuantity(), side);
+}
+
+void BondTradeBookingListener::ProcessRemove(Fill<Bond>& data) {
+  // not implemented
+}
+
+void BondTradeBookingListener::ProcessUpdate(Fill<Bond>& data) {
+  // not implemented
+}
+
+void BondTradeBookingListener::SetMatchingEngine(BondMatchingEngine* _engine, int _source) {
+  engines_.fill(_engine);
+  source_ = _source;
+  if (_engine != nullptr) _engine->AddListener(this);
+}
+
+void BondTradeBookingListener::SetVenueEngine(Market _market, BondMatchingEngine* _engine) {
+  // listen to each engine once, however many markets it fills
+  bool listening = std::find(engines_.begin(), engines_.end(), _engine) != engines_.end();
+  engines_[_market] = _engine;
+  if (_engine != nullptr && !listening) _engine->AddListener(this);
+}
+
+void BondTradeBookingListener::SetIdTag(const std::string& _tag) {
+  idTag_ = _tag;
+}
+
+void BondTradeBookingListener::SetResumePoint(long trades) {
+  skip_ = trades;
+}
+
 #endif
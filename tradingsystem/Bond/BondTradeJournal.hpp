@@ -0,0 +1,347 @@
+/**
+* BondTradeJournal.hpp
+*
+* Write-ahead journal of every trade booked, in booking order, made durable by
+* group commit and read back on restart to rebuild the booked trades and positions
+*
+* @author: Gabo Bernardino
+*/
+
+#ifndef BONDTRADEJOURNAL_HPP
+#define BONDTRADEJOURNAL_HPP
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../tradebookingservice.hpp"
+#include "../latencystats.hpp"
+#include "../utils.hpp"
+
+/**
+* Trade journal
+* One line per trade: its origin (`I` for trades received from the connector,
+* `E` for trades booked from executions), then the trade as in `trades.txt`.
+*
+* Append only adds the line to the pending batch, in booking order. With a zero
+* commit window every Append writes and syncs its own line before returning;
+* otherwise a committer thread waits `window` after the first line of a batch,
+* then writes every line appended meanwhile and syncs them with one fdatasync,
+* and hands the number of entries now on disk to the commit callback.
+* A wider window means fewer syncs for the same trades, and a longer wait for
+* a trade to be durable; a crash loses at most the trades of the last window.
+*
+* A commit that fails to write or sync never counts its entries durable. Its
+* lines go back in front of the pending ones and the committer retries them
+* after `retryDelay_`; with a zero window, the failing Append takes its line
+* back and throws, so the trade is neither journaled nor booked. Whatever part
+* of a failed commit reached the file is cut off before the next one writes.
+*/
+class BondTradeJournal {
+public:
+  static constexpr std::chrono::milliseconds retryDelay_{ 100 };
+
+private:
+  std::string path_;
+  int fd_;
+  std::chrono::microseconds window_;
+
+  std::mutex mutex_;
+  std::condition_variable pendingCv_;  // wakes the committer
+  std::condition_variable durableCv_;  // wakes the writers waiting for a commit
+  std::string pending_;  // lines appended since the last commit
+  std::string batch_;  // lines being committed
+  long entries_;  // appended by this journal
+  long durable_;  // of which synced
+  std::int64_t offset_;  // size of the journal on disk, up to the last line synced
+  bool torn_;  // a failed commit may have written past `offset_`
+  bool committing_;
+  bool running_;
+  std::thread committer_;
+
+  std::function<void(long)> onCommit_;  // called by the committer thread, without the lock
+
+  long commits_;
+  long failedCommits_;
+  LatencyStats syncLatency_;
+
+  // Write and sync the pending lines; the lock is released during the I/O
+  // Throws if they could not be made durable, having put them back or, with a zero window, dropped them
+  void _commit(std::unique_lock<std::mutex>& lock);
+
+  void _run();
+
+public:
+  // ctor - appends to the journal, or starts a new one when `_truncate`
+  BondTradeJournal(const std::string& _path = "Data/booked_trades.txt", bool _truncate = false,
+    std::chrono::microseconds _window = std::chrono::milliseconds(1));
+  ~BondTradeJournal();
+
+  BondTradeJournal(const BondTradeJournal&) = delete;
+  BondTradeJournal& operator=(const BondTradeJournal&) = delete;
+
+  // Record a booked trade; returns its entry number (1-based), durable once GetDurableCount reaches it
+  // With a zero window, throws if the trade could not be made durable, leaving the journal as it was
+  long Append(const Trade<Bond>& trade, bool received);
+
+  // Called with the number of durable entries after each commit of the committer thread
+  // (commits made by Append with a zero window, or by Sync, are seen by their caller)
+  void SetCommitCallback(const std::function<void(long)>& _callback);
+
+  // Commit everything appended so far; throws if it could not, the lines staying pending
+  void Sync();
+
+  // Entries appended by this journal, and of those on disk
+  long GetEntryCount();
+  long GetDurableCount();
+
+  // Byte offset just past the last entry on disk, where a replay of what follows would start
+  std::int64_t GetDurableOffset();
+
+  const std::string& GetPath() const;
+
+  // Commits, trades per commit, failed commits and fdatasync latency
+  void Report(std::ostream& output);
+
+  // Call `f(trade, received)` for every entry from byte `offset` on, in order
+  // Returns the number of entries replayed
+  template <typename Parse, typename F>
+  static long Replay(const std::string& path, std::int64_t offset, Parse parse, F f);
+};
+
+//*************************************************************************************************
+// BondTradeJournal implementations
+//*************************************************************************************************
+BondTradeJournal::BondTradeJournal(const std::string& _path, bool _truncate, std::chrono::microseconds _window) :
+  path_(_path), fd_(-1), window_(_window), entries_(0), durable_(0), offset_(0), torn_(false), committing_(false), running_(false),
+  commits_(0), failedCommits_(0)
+{
+  fd_ = open(path_.c_str(), O_RDWR | O_CREAT | O_CLOEXEC | (_truncate ? O_TRUNC : 0), 0644);
+  if (fd_ < 0) throw std::runtime_error("cannot open trade journal " + path_);
+
+  // a line cut by a crash is never replayed: drop it, so the next entry starts on a line of its own
+  off_t end = lseek(fd_, 0, SEEK_END);
+  off_t keep = end;
+  char c;
+  while (keep > 0 && pread(fd_, &c, 1, keep - 1) == 1 && c != '\n') keep--;
+  if (keep != end && ftruncate(fd_, keep) != 0) {
+    close(fd_);
+    throw std::runtime_error("cannot repair trade journal " + path_);
+  }
+  offset_ = keep;
+
+  if (window_.count() > 0) {
+    running_ = true;
+    committer_ = std::thread(&BondTradeJournal::_run, this);
+  }
+}
+
+BondTradeJournal::~BondTradeJournal() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_ = false;
+  }
+  pendingCv_.notify_all();
+  if (committer_.joinable()) committer_.join();
+  try {
+    Sync();
+  }
+  catch (std::exception& e) {
+    std::cout << "An error occurred: " << e.what() << std::endl;
+  }
+  close(fd_);
+}
+
+void BondTradeJournal::_commit(std::unique_lock<std::mutex>& lock) {
+  while (committing_) durableCv_.wait(lock);  // one commit at a time
+  if (pending_.empty()) return;
+
+  batch_.swap(pending_);
+  long last = entries_;
+  std::int64_t at = offset_;
+  std::int64_t size = static_cast<std::int64_t>(batch_.size());
+  bool torn = torn_;
+  committing_ = true;
+  lock.unlock();
+
+  // the lines go right after the last ones synced, over whatever a failed commit left there
+  int error = 0;
+  if (torn && ftruncate(fd_, static_cast<off_t>(at)) != 0) error = errno;
+  for (std::int64_t done = 0; error == 0 && done < size;) {
+    ssize_t n = pwrite(fd_, batch_.data() + done, static_cast<std::size_t>(size - done), static_cast<off_t>(at + done));
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0) error = errno;
+    else if (n == 0) error = EIO;  // nothing written and no error reported: retrying would spin
+    else done += n;
+  }
+  auto start = std::chrono::steady_clock::now();
+  if (error == 0 && fdatasync(fd_) != 0) error = errno;
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  bool ok = (error == 0);
+
+  lock.lock();
+  committing_ = false;
+  if (ok) {
+    syncLatency_.Record(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    durable_ = last;
+    offset_ += size;
+    torn_ = false;
+    commits_++;
+  }
+  else {
+    failedCommits_++;
+    torn_ = true;
+    if (window_.count() == 0) {
+      // the line of the failing Append: its caller gets the trade back with the exception
+      entries_ -= static_cast<long>(std::count(batch_.begin(), batch_.end(), '\n'));
+    }
+    else {
+      // retried first, ahead of the lines appended meanwhile
+      batch_.append(pending_);
+      pending_.swap(batch_);
+    }
+  }
+  batch_.clear();
+  durableCv_.notify_all();
+  if (!ok) throw std::runtime_error("cannot write trade journal " + path_ + ": " + std::strerror(error));
+}
+
+void BondTradeJournal::_run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (running_) {
+    pendingCv_.wait(lock, [this]() { return !running_ || !pending_.empty(); });
+    if (!running_) break;
+    // the window opens with the first line of the batch
+    pendingCv_.wait_for(lock, window_, [this]() { return !running_; });
+    try {
+      _commit(lock);
+    }
+    catch (std::exception& e) {
+      std::cout << "An error occurred: " << e.what() << "; retrying" << std::endl;
+      pendingCv_.wait_for(lock, retryDelay_, [this]() { return !running_; });
+    }
+    if (onCommit_) {
+      // the callback books the trades now durable: it must not hold up the writers
+      std::function<void(long)> callback = onCommit_;
+      long durable = durable_;
+      lock.unlock();
+      callback(durable);
+      lock.lock();
+    }
+  }
+}
+
+long BondTradeJournal::Append(const Trade<Bond>& trade, bool received) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  bool first = pending_.empty();
+  pending_ += received ? "I," : "E,";
+  pending_ += trade.GetProduct().GetProductId().c_str();
+  pending_ += ',';
+  pending_ += trade.GetTradeId().c_str();
+  pending_ += ',';
+  pending_ += PriceToString(trade.GetPrice());
+  pending_ += ',';
+  pending_ += trade.GetBook().c_str();
+  pending_ += ',';
+  pending_ += std::to_string(trade.GetQuantity());
+  pending_ += (trade.GetSide() == BUY) ? ",BUY\n" : ",SELL\n";
+  long entry = ++entries_;
+
+  if (window_.count() == 0) _commit(lock);
+  else if (first) pendingCv_.notify_one();
+  return entry;
+}
+
+void BondTradeJournal::SetCommitCallback(const std::function<void(long)>& _callback) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  onCommit_ = _callback;
+}
+
+void BondTradeJournal::Sync() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  _commit(lock);
+  while (committing_) durableCv_.wait(lock);  // a commit already under way may hold older lines
+}
+
+long BondTradeJournal::GetEntryCount() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_;
+}
+
+long BondTradeJournal::GetDurableCount() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return durable_;
+}
+
+std::int64_t BondTradeJournal::GetDurableOffset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return offset_;
+}
+
+const std::string& BondTradeJournal::GetPath() const {
+  return path_;
+}
+
+void BondTradeJournal::Report(std::ostream& output) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  output << "Trade journal: " << entries_ << " trades, " << durable_ << " durable, " << commits_ << " commits ("
+    << (commits_ > 0 ? static_cast<double>(durable_) / commits_ : 0.0) << " trades per commit, window "
+    << window_.count() << "us), " << failedCommits_ << " failed commits" << std::endl;
+  syncLatency_.Report(output, "Journal fdatasync");
+}
+
+template <typename Parse, typename F>
+long BondTradeJournal::Replay(const std::string& path, std::int64_t offset, Parse parse, F f) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return 0;  // nothing journaled yet
+  if (lseek(fd, static_cast<off_t>(offset), SEEK_SET) != static_cast<off_t>(offset)) {
+    close(fd);
+    throw std::runtime_error("cannot seek trade journal " + path + " to " + std::to_string(offset));
+  }
+
+  // read from the offset in blocks; a last line without its newline was cut by a crash and is left out
+  std::string buffer;
+  char block[1 << 16];
+  Trade<Bond> trade;
+  long replayed = 0;
+  while (true) {
+    ssize_t n = read(fd, block, sizeof(block));
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0) {
+      int error = errno;
+      close(fd);
+      throw std::runtime_error("cannot read trade journal " + path + ": " + std::strerror(error));
+    }
+    if (n == 0) break;
+    buffer.append(block, static_cast<std::size_t>(n));
+
+    std::size_t start = 0, newline;
+    while ((newline = buffer.find('\n', start)) != std::string::npos) {
+      const char* line = buffer.data() + start;
+      std::size_t length = newline - start;
+      start = newline + 1;
+      if (length < 2 || line[1] != ',') continue;
+      if (!parse(line + 2, line + length, trade)) continue;
+      f(trade, line[0] == 'I');
+      replayed++;
+    }
+    buffer.erase(0, start);
+  }
+  close(fd);
+  return replayed;
+}
+
+#endif // !BONDTRADEJOURNAL_HPP
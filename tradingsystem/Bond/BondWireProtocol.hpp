@@ -0,0 +1,133 @@
+/**
+* BondWireProtocol.hpp
+*
+* Binary frames carrying trades and inquiries over the connectors' Unix sockets
+*
+* @author: Gabo Bernardino
+*/
+
+#ifndef BONDWIREPROTOCOL_HPP
+#define BONDWIREPROTOCOL_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include "../tradebookingservice.hpp"
+#include "../inquiryservice.hpp"
+#include "../utils.hpp"
+
+/**
+* Every frame is `wireFrameSize` bytes, integers are little-endian and text is
+* zero-padded ASCII. Prices travel as integer 1/256ths, the finest increment of
+* a treasury quote, so they go through the wire exactly. Each text field holds
+* the longest identifier of its type, so nothing is cut on the way.
+* A frame with an unknown side or state is rejected.
+*
+* Trade frame                          Inquiry frame
+*  0  u16  type = TRADE                 0  u16  type = INQUIRY
+*  2  u8   side (0 BUY, 1 SELL)         2  u8   side (0 BUY, 1 SELL)
+*  3  u8   reserved                     3  u8   state (InquiryState)
+*  4  4    reserved                     4  4    reserved
+*  8  i64  price in 1/256ths            8  i64  price in 1/256ths
+* 16  i64  quantity                    16  i64  quantity
+* 24  16s  product id                  24  16s  product id
+* 40  32s  trade id                    40  32s  inquiry id
+* 72  16s  book                        72  16   reserved
+* 88  8    reserved                    88  8    reserved
+*/
+const std::size_t wireFrameSize = 96;
+const std::size_t wireProductWidth = 16;
+const std::size_t wireIdWidth = 32;
+const std::size_t wireBookWidth = 16;
+
+static_assert(ProductId::capacity() <= wireProductWidth, "product ids must fit their wire field");
+static_assert(TradeId::capacity() <= wireIdWidth && InquiryId::capacity() <= wireIdWidth, "trade and inquiry ids must fit their wire field");
+static_assert(BookId::capacity() <= wireBookWidth, "books must fit their wire field");
+
+enum WireType : std::uint16_t { WIRE_TRADE = 1, WIRE_INQUIRY = 2 };
+
+// Default paths of the connectors' sockets
+const char* const defaultTradeSocket = "/tmp/mth9815_trades.sock";
+const char* const defaultInquirySocket = "/tmp/mth9815_inquiries.sock";
+
+// Little-endian integers, whatever the byte order of the host
+template <typename I>
+void WirePut(char* out, I value) {
+  std::uint64_t bits = static_cast<std::uint64_t>(value);
+  for (std::size_t i = 0; i < sizeof(I); ++i) out[i] = static_cast<char>((bits >> (8 * i)) & 0xFF);
+}
+
+template <typename I>
+I WireGet(const char* in) {
+  std::uint64_t bits = 0;
+  for (std::size_t i = 0; i < sizeof(I); ++i) bits |= static_cast<std::uint64_t>(static_cast<unsigned char>(in[i])) << (8 * i);
+  return static_cast<I>(bits);
+}
+
+// Zero-padded text - the fields are sized so that identifiers always fit
+template <typename S>
+void WirePutText(char* out, std::size_t width, const S& text) {
+  std::memset(out, 0, width);
+  std::memcpy(out, text.c_str(), std::min(width, text.size()));
+}
+
+template <typename S>
+S WireGetText(const char* in, std::size_t width) {
+  S text;
+  text.Append(in, strnlen(in, width));
+  return text;
+}
+
+WireType WireFrameType(const char* frame) {
+  return static_cast<WireType>(WireGet<std::uint16_t>(frame));
+}
+
+void EncodeTrade(const Trade<Bond>& trade, char* frame) {
+  std::memset(frame, 0, wireFrameSize);
+  WirePut<std::uint16_t>(frame, WIRE_TRADE);
+  WirePut<std::uint8_t>(frame + 2, trade.GetSide());
+  WirePut<std::int64_t>(frame + 8, std::llround(trade.GetPrice() * 256));
+  WirePut<std::int64_t>(frame + 16, trade.GetQuantity());
+  WirePutText(frame + 24, wireProductWidth, trade.GetProduct().GetProductId());
+  WirePutText(frame + 40, wireIdWidth, trade.GetTradeId());
+  WirePutText(frame + 72, wireBookWidth, trade.GetBook());
+}
+
+// Decode a trade frame - false if the frame is not a trade or has an unknown side
+bool DecodeTrade(const char* frame, Trade<Bond>& trade) {
+  if (WireFrameType(frame) != WIRE_TRADE) return false;
+  std::uint8_t side = WireGet<std::uint8_t>(frame + 2);
+  if (side > SELL) return false;
+  const Bond& bond = MakeBond(WireGetText<ProductId>(frame + 24, wireProductWidth));
+  double price = WireGet<std::int64_t>(frame + 8) / 256.0;
+  trade = Trade<Bond>(bond, WireGetText<TradeId>(frame + 40, wireIdWidth), price, WireGetText<BookId>(frame + 72, wireBookWidth),
+    WireGet<std::int64_t>(frame + 16), static_cast<Side>(side));
+  return true;
+}
+
+void EncodeInquiry(const Inquiry<Bond>& inquiry, char* frame) {
+  std::memset(frame, 0, wireFrameSize);
+  WirePut<std::uint16_t>(frame, WIRE_INQUIRY);
+  WirePut<std::uint8_t>(frame + 2, inquiry.GetSide());
+  WirePut<std::uint8_t>(frame + 3, inquiry.GetState());
+  WirePut<std::int64_t>(frame + 8, std::llround(inquiry.GetPrice() * 256));
+  WirePut<std::int64_t>(frame + 16, inquiry.GetQuantity());
+  WirePutText(frame + 24, wireProductWidth, inquiry.GetProduct().GetProductId());
+  WirePutText(frame + 40, wireIdWidth, inquiry.GetInquiryId());
+}
+
+// Decode an inquiry frame - false if the frame is not an inquiry or has an unknown side or state
+bool DecodeInquiry(const char* frame, Inquiry<Bond>& inquiry) {
+  if (WireFrameType(frame) != WIRE_INQUIRY) return false;
+  std::uint8_t side = WireGet<std::uint8_t>(frame + 2);
+  std::uint8_t state = WireGet<std::uint8_t>(frame + 3);
+  if (side > SELL || state > CUSTOMER_REJECTED) return false;
+  const Bond& bond = MakeBond(WireGetText<ProductId>(frame + 24, wireProductWidth));
+  double price = WireGet<std::int64_t>(frame + 8) / 256.0;
+  inquiry = Inquiry<Bond>(WireGetText<InquiryId>(frame + 40, wireIdWidth), bond, static_cast<Side>(side), WireGet<std::int64_t>(frame + 16),
+    price, static_cast<InquiryState>(state));
+  return true;
+}
+
+#endif // !BONDWIREPROTOCOL_HPP
@@ -0,0 +1,189 @@
+/**
+* chunkedreader.hpp
+*
+* Parallel reader splitting a file in chunks at line boundaries, for connectors
+* whose parsing is the bottleneck on large files
+*
+* @author: Gabo Bernardino
+*/
+
+#ifndef CHUNKEDREADER_HPP
+#define CHUNKEDREADER_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "workstealingpool.hpp"
+
+/**
+* Split a line on a delimiter, without copying
+* Fills at most N (begin, end) pairs and returns the number of fields found
+*/
+template <std::size_t N>
+std::size_t SplitFields(const char* begin, const char* end, char delimiter, std::array<std::pair<const char*, const char*>, N>& fields) {
+  std::size_t n = 0;
+  const char* start = begin;
+  for (const char* c = begin; c != end && n < N; ++c) {
+    if (*c == delimiter) {
+      fields[n++] = { start, c };
+      start = c + 1;
+    }
+  }
+  if (n < N) fields[n++] = { start, end };
+  return n;
+}
+
+/**
+* Chunked file reader
+* Maps the file in memory and cuts it into chunks of about `_chunkBytes`, each
+* ending on a newline. A batch of chunks (a few per pool thread) is parsed in
+* parallel on the pool, every chunk into its own array of events; the arrays are
+* then handed to `deliver` in file order on the calling thread. The consumer sees
+* the exact sequence of a serial read, so state carried from one line to the next
+* (e.g. grouping lines into order books) works across chunk boundaries.
+*
+* The event arrays are kept between batches and calls, so once they have grown
+* to the size of a chunk, reading allocates nothing.
+* Without a pool, chunks are parsed on the calling thread.
+*/
+template <typename E>
+class ChunkedFileReader {
+public:
+  static constexpr std::size_t defaultChunkBytes_ = 1 << 20;
+
+private:
+  WorkStealingPool* pool_;
+  std::size_t chunkBytes_;
+  std::vector<std::vector<E>> events_;  // one array per chunk of a batch
+  std::vector<std::pair<const char*, const char*>> chunks_;  // chunks of the current batch
+
+public:
+  // ctor
+  ChunkedFileReader(WorkStealingPool* _pool = nullptr, std::size_t _chunkBytes = defaultChunkBytes_);
+
+  // Parse chunks on a pool (nullptr parses them on the calling thread)
+  void SetTaskPool(WorkStealingPool* _pool);
+  WorkStealingPool* GetTaskPool() const;
+
+  void SetChunkBytes(std::size_t _chunkBytes);
+
+  // Read a file: `parse(begin, end, event)` turns a line (without its newline) into
+  // an event and returns false to skip it; `deliver(event)` is called for every event in order.
+  // parse runs concurrently on several threads and must only touch its arguments.
+  // Returns the number of events delivered; throws if the file cannot be read.
+  template <typename Parse, typename Deliver>
+  std::size_t Read(const char* filename, bool header, Parse parse, Deliver deliver);
+};
+
+//*************************************************************************************************
+// ChunkedFileReader implementations
+//*************************************************************************************************
+template <typename E>
+ChunkedFileReader<E>::ChunkedFileReader(WorkStealingPool* _pool, std::size_t _chunkBytes) :
+  pool_(_pool), chunkBytes_(std::max<std::size_t>(_chunkBytes, 1)) {}
+
+template <typename E>
+void ChunkedFileReader<E>::SetTaskPool(WorkStealingPool* _pool) {
+  pool_ = _pool;
+}
+
+template <typename E>
+WorkStealingPool* ChunkedFileReader<E>::GetTaskPool() const {
+  return pool_;
+}
+
+template <typename E>
+void ChunkedFileReader<E>::SetChunkBytes(std::size_t _chunkBytes) {
+  chunkBytes_ = std::max<std::size_t>(_chunkBytes, 1);
+}
+
+template <typename E>
+template <typename Parse, typename Deliver>
+std::size_t ChunkedFileReader<E>::Read(const char* filename, bool header, Parse parse, Deliver deliver) {
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) throw std::runtime_error(std::string("cannot open ") + filename);
+  struct stat info;
+  if (fstat(fd, &info) < 0) {
+    close(fd);
+    throw std::runtime_error(std::string("cannot stat ") + filename);
+  }
+  std::size_t size = static_cast<std::size_t>(info.st_size);
+  if (size == 0) {
+    close(fd);
+    return 0;
+  }
+  void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED) throw std::runtime_error(std::string("cannot map ") + filename);
+  madvise(mapped, size, MADV_SEQUENTIAL);
+
+  const char* data = static_cast<const char*>(mapped);
+  const char* end = data + size;
+  const char* cursor = data;
+  if (header) {
+    const char* newline = static_cast<const char*>(std::memchr(cursor, '\n', end - cursor));
+    cursor = (newline != nullptr) ? newline + 1 : end;
+  }
+
+  std::size_t batch = (pool_ != nullptr) ? 4 * pool_->GetThreadCount() : 1;
+  if (events_.size() < batch) events_.resize(batch);
+  std::size_t delivered = 0;
+
+  auto parse_chunk = [&](std::size_t i) {
+    std::vector<E>& events = events_[i];
+    events.clear();
+    const char* line = chunks_[i].first;
+    const char* chunk_end = chunks_[i].second;
+    E event;
+    while (line < chunk_end) {
+      const char* newline = static_cast<const char*>(std::memchr(line, '\n', chunk_end - line));
+      const char* line_end = (newline != nullptr) ? newline : chunk_end;
+      const char* trimmed = line_end;
+      while (trimmed > line && (trimmed[-1] == '\r' || trimmed[-1] == ' ')) --trimmed;  // Windows line endings, trailing blanks
+      if (trimmed > line && parse(line, trimmed, event)) events.push_back(event);
+      line = line_end + 1;
+    }
+  };
+
+  try {
+    while (cursor < end) {
+      // cut the next batch of chunks, each ending right after a newline
+      chunks_.clear();
+      while (cursor < end && chunks_.size() < batch) {
+        const char* chunk_end = cursor + std::min(chunkBytes_, static_cast<std::size_t>(end - cursor));
+        if (chunk_end < end) {
+          const char* newline = static_cast<const char*>(std::memchr(chunk_end, '\n', end - chunk_end));
+          chunk_end = (newline != nullptr) ? newline + 1 : end;
+        }
+        chunks_.emplace_back(cursor, chunk_end);
+        cursor = chunk_end;
+      }
+
+      if (pool_ != nullptr) pool_->ParallelFor(0, chunks_.size(), parse_chunk);
+      else for (std::size_t i = 0; i < chunks_.size(); ++i) parse_chunk(i);
+
+      // hand the events over in file order
+      for (std::size_t i = 0; i < chunks_.size(); ++i) {
+        for (E& event : events_[i]) deliver(event);
+        delivered += events_[i].size();
+      }
+    }
+  }
+  catch (...) {
+    munmap(mapped, size);
+    throw;
+  }
+
+  munmap(mapped, size);
+  return delivered;
+}
+
+#endif // !CHUNKEDREADER_HPP
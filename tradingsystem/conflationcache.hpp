@@ -0,0 +1,232 @@
+/**
+* conflationcache.hpp
+*
+* Per-key latest-value cache: written lock-free on the hot path,
+* snapshotted periodically by a publisher that only sees what changed
+*
+* @author: Gabo Bernardino
+*/
+
+#ifndef CONFLATIONCACHE_HPP
+#define CONFLATIONCACHE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <type_traits>
+
+/**
+* Conflation cache
+* One slot per key holds the latest value; every Write overwrites it, so
+* a burst of updates between two snapshots costs the publisher one value.
+*
+* Slots live in a fixed open-addressing table and are claimed with a CAS
+* the first time a key is written. Each value sits behind a sequence lock:
+* the writer bumps the sequence around the copy and the reader retries if
+* the sequence moved, so neither side ever blocks. Values are copied word by
+* word through relaxed atomics, hence V must be trivially copyable.
+*
+* Threading: one writer per key (e.g. the pricing thread), one snapshotting
+* thread (the publisher), and any number of threads reading single keys.
+*
+* Each key can be configured to be published at most once every n snapshots,
+* or muted (n = 0), and a snapshot can be capped to a number of values so
+* that large universes are rendered with bounded work per refresh.
+*/
+template <typename K, typename V>
+class ConflationCache {
+  static_assert(std::is_trivially_copyable<V>::value, "ConflationCache values are copied bytewise");
+
+private:
+  static constexpr std::size_t words_ = (sizeof(V) + 7) / 8;
+  enum SlotState { EMPTY = 0, CLAIMED = 1, READY = 2 };
+
+  struct Slot {
+    std::atomic<int> state{ EMPTY };
+    K key;  // written once, before state becomes READY
+    std::atomic<std::uint64_t> seq{ 0 };  // odd while a write is in progress
+    std::atomic<std::uint64_t> value[words_];
+    std::atomic<int> every{ 1 };  // publish once every n snapshots, 0 = muted
+    // publisher side only
+    std::uint64_t publishedSeq = 0;
+    int skipped = 0;
+  };
+
+  std::unique_ptr<Slot[]> slots_;
+  std::size_t mask_;
+  std::size_t cursor_;  // where the next capped snapshot resumes
+  std::atomic<long> writes_;
+  long published_;
+
+  // Slot for the key, claiming an empty one if needed - nullptr if the table is full
+  Slot* _slot(const K& key);
+
+  // Seqlock read of a slot's value, starting from sequence `seq`; returns the sequence read at
+  static std::uint64_t _load(const Slot& slot, std::uint64_t seq, std::uint64_t* words);
+
+public:
+  // ctor - capacity is the maximum number of keys
+  ConflationCache(std::size_t _capacity);
+
+  // Overwrite the latest value of a key - false if the table is full
+  bool Write(const K& key, const V& v);
+
+  // Latest value of a key - false if the key was never written
+  bool Read(const K& key, V& v) const;
+
+  // Publish a key at most once every `every_n` snapshots (0 mutes it)
+  bool Configure(const K& key, int every_n);
+
+  // Call fn(value) for each key written since it was last snapshotted and due this time,
+  // visiting at most `limit` such keys (0 = no limit). Returns the number visited.
+  template <typename F>
+  std::size_t Snapshot(F fn, std::size_t limit = 0);
+
+  // Number of writes, and of values handed to the publisher
+  long GetWriteCount() const;
+  long GetPublishCount() const;
+};
+
+//*************************************************************************************************
+// ConflationCache implementations
+//*************************************************************************************************
+template <typename K, typename V>
+ConflationCache<K, V>::ConflationCache(std::size_t _capacity) :
+  cursor_(0), writes_(0), published_(0)
+{
+  // keep the table at most half full
+  std::size_t slots = 16;
+  while (slots < 2 * _capacity) slots <<= 1;
+  slots_.reset(new Slot[slots]);
+  mask_ = slots - 1;
+}
+
+template <typename K, typename V>
+typename ConflationCache<K, V>::Slot* ConflationCache<K, V>::_slot(const K& key) {
+  std::size_t index = std::hash<K>()(key) & mask_;
+  for (std::size_t probes = 0; probes <= mask_; ++probes, index = (index + 1) & mask_) {
+    Slot& slot = slots_[index];
+    int state = slot.state.load(std::memory_order_acquire);
+
+    if (state == EMPTY) {
+      if (slot.state.compare_exchange_strong(state, CLAIMED, std::memory_order_acq_rel)) {
+        slot.key = key;
+        slot.state.store(READY, std::memory_order_release);
+        return &slot;
+      }
+      // lost the race for this slot: `state` now holds the winner's state
+    }
+    // another writer is installing its key
+    while (state == CLAIMED) state = slot.state.load(std::memory_order_acquire);
+    if (slot.key == key) return &slot;
+  }
+  return nullptr;
+}
+
+template <typename K, typename V>
+bool ConflationCache<K, V>::Write(const K& key, const V& v) {
+  Slot* slot = _slot(key);
+  if (slot == nullptr) return false;
+
+  std::uint64_t words[words_] = {};
+  std::memcpy(words, &v, sizeof(V));
+
+  std::uint64_t seq = slot->seq.load(std::memory_order_relaxed);
+  slot->seq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  for (std::size_t i = 0; i < words_; ++i) slot->value[i].store(words[i], std::memory_order_relaxed);
+  slot->seq.store(seq + 2, std::memory_order_release);
+
+  writes_.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+template <typename K, typename V>
+std::uint64_t ConflationCache<K, V>::_load(const Slot& slot, std::uint64_t seq, std::uint64_t* words) {
+  // seqlock read: retry until a stable, even sequence brackets the copy
+  while (true) {
+    if (seq & 1) {
+      seq = slot.seq.load(std::memory_order_acquire);
+      continue;
+    }
+    for (std::size_t i = 0; i < words_; ++i) words[i] = slot.value[i].load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    std::uint64_t check = slot.seq.load(std::memory_order_relaxed);
+    if (check == seq) return seq;
+    seq = check;
+  }
+}
+
+template <typename K, typename V>
+bool ConflationCache<K, V>::Read(const K& key, V& v) const {
+  std::size_t index = std::hash<K>()(key) & mask_;
+  for (std::size_t probes = 0; probes <= mask_; ++probes, index = (index + 1) & mask_) {
+    const Slot& slot = slots_[index];
+    int state = slot.state.load(std::memory_order_acquire);
+    if (state == EMPTY) return false;  // the key would have been placed here
+    while (state == CLAIMED) state = slot.state.load(std::memory_order_acquire);
+    if (!(slot.key == key)) continue;
+
+    std::uint64_t seq = slot.seq.load(std::memory_order_acquire);
+    if (seq == 0) return false;  // configured, never written
+    std::uint64_t words[words_];
+    _load(slot, seq, words);
+    std::memcpy(&v, words, sizeof(V));
+    return true;
+  }
+  return false;
+}
+
+template <typename K, typename V>
+bool ConflationCache<K, V>::Configure(const K& key, int every_n) {
+  Slot* slot = _slot(key);
+  if (slot == nullptr) return false;
+  slot->every.store(every_n, std::memory_order_relaxed);
+  return true;
+}
+
+template <typename K, typename V>
+template <typename F>
+std::size_t ConflationCache<K, V>::Snapshot(F fn, std::size_t limit) {
+  std::size_t visited = 0;
+  std::uint64_t words[words_];
+  V v;
+
+  for (std::size_t n = 0; n <= mask_; ++n) {
+    if (limit != 0 && visited == limit) break;
+    Slot& slot = slots_[cursor_];
+    cursor_ = (cursor_ + 1) & mask_;
+
+    if (slot.state.load(std::memory_order_acquire) != READY) continue;
+    int every = slot.every.load(std::memory_order_relaxed);
+    if (every == 0) continue;
+
+    std::uint64_t seq = slot.seq.load(std::memory_order_acquire);
+    if (seq == slot.publishedSeq) continue;  // unchanged since last snapshot
+    if (++slot.skipped < every) continue;
+
+    seq = _load(slot, seq, words);
+    std::memcpy(&v, words, sizeof(V));
+
+    slot.publishedSeq = seq;
+    slot.skipped = 0;
+    published_++;
+    visited++;
+    fn(v);
+  }
+  return visited;
+}
+
+template <typename K, typename V>
+long ConflationCache<K, V>::GetWriteCount() const {
+  return writes_.load(std::memory_order_relaxed);
+}
+
+template <typename K, typename V>
+long ConflationCache<K, V>::GetPublishCount() const {
+  return published_;
+}
+
+#endif // !CONFLATIONCACHE_HPP
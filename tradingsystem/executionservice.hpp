@@ -10,11 +10,15 @@
 #include <string>
 #include "soa.hpp"
 #include "marketdataservice.hpp"
+#include "fixedstring.hpp"
 
 enum OrderType { FOK, IOC, MARKET, LIMIT, STOP };
 
 enum Market { BROKERTEC, ESPEED, CME };
 
+// Order identifiers are stored inline - room for a child order id: ticker, shard tag, counter and venue
+typedef FixedString<48> OrderId;
+
 /**
  * An execution order that can be placed on an exchange.
  * Type T is the product type.
@@ -26,7 +30,7 @@ class ExecutionOrder
 public:
 
   // ctor for an order
-  ExecutionOrder(const T &_product, PricingSide _side, string _orderId, OrderType _orderType, double _price, double _visibleQuantity, double _hiddenQuantity, string _parentOrderId, bool _isChildOrder);
+  ExecutionOrder(const T &_product, PricingSide _side, const OrderId &_orderId, OrderType _orderType, double _price, double _visibleQuantity, double _hiddenQuantity, const OrderId &_parentOrderId, bool _isChildOrder);
   ExecutionOrder() = default;
 
   // Get the product
@@ -36,7 +40,7 @@ public:
   const PricingSide& GetSide() const;
 
   // Get the order ID
-  const string& GetOrderId() const;
+  const OrderId& GetOrderId() const;
 
   // Get the order type on this order
   OrderType GetOrderType() const;
@@ -51,21 +55,28 @@ public:
   long GetHiddenQuantity() const;
 
   // Get the parent order ID
-  const string& GetParentOrderId() const;
+  const OrderId& GetParentOrderId() const;
 
   // Is child order?
   bool IsChildOrder() const;
 
+  // Get the market the order is executed on
+  Market GetMarket() const;
+
+  // Set the market the order is executed on
+  void SetMarket(Market _market);
+
 private:
   T product;
   PricingSide side;
-  string orderId;
+  OrderId orderId;
   OrderType orderType;
   double price;
   double visibleQuantity;
   double hiddenQuantity;
-  string parentOrderId;
+  OrderId parentOrderId;
   bool isChildOrder;
+  Market market = BROKERTEC;
 
 };
 
@@ -86,16 +97,14 @@ public:
 };
 
 template<typename T>
-ExecutionOrder<T>::ExecutionOrder(const T &_product, PricingSide _side, string _orderId, OrderType _orderType, double _price, double _visibleQuantity, double _hiddenQuantity, string _parentOrderId, bool _isChildOrder) :
-  product(_product)
+ExecutionOrder<T>::ExecutionOrder(const T &_product, PricingSide _side, const OrderId &_orderId, OrderType _orderType, double _price, double _visibleQuantity, double _hiddenQuantity, const OrderId &_parentOrderId, bool _isChildOrder) :
+  product(_product), orderId(_orderId), parentOrderId(_parentOrderId)
 {
   side = _side;
-  orderId = _orderId;
   orderType = _orderType;
   price = _price;
   visibleQuantity = _visibleQuantity;
   hiddenQuantity = _hiddenQuantity;
-  parentOrderId = _parentOrderId;
   isChildOrder = _isChildOrder;
 }
 
@@ -112,7 +121,7 @@ const PricingSide& ExecutionOrder<T>::GetSide() const
 }
 
 template<typename T>
-const string& ExecutionOrder<T>::GetOrderId() const
+const OrderId& ExecutionOrder<T>::GetOrderId() const
 {
   return orderId;
 }
@@ -142,7 +151,7 @@ long ExecutionOrder<T>::GetHiddenQuantity() const
 }
 
 template<typename T>
-const string& ExecutionOrder<T>::GetParentOrderId() const
+const OrderId& ExecutionOrder<T>::GetParentOrderId() const
 {
   return parentOrderId;
 }
@@ -153,4 +162,16 @@ bool ExecutionOrder<T>::IsChildOrder() const
   return isChildOrder;
 }
 
+template<typename T>
+Market ExecutionOrder<T>::GetMarket() const
+{
+  return market;
+}
+
+template<typename T>
+void ExecutionOrder<T>::SetMarket(Market _market)
+{
+  market = _market;
+}
+
 #endif
@@ -0,0 +1,253 @@
+/**
+* filetailer.hpp
+*
+* Follows a file that is still being written, for connectors reading a live feed
+*
+* @author: Gabo Bernardino
+*/
+
+#ifndef FILETAILER_HPP
+#define FILETAILER_HPP
+
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+* File tailer - the equivalent of `tail -F`
+* Reads what is already in the file, then waits for data to be appended and
+* hands every complete line to a callback, without its newline.
+* - waits on inotify for changes to the file's directory entry, and falls back
+*   to checking the file every poll interval when inotify is unavailable
+* - a line whose newline has not been written yet is kept until it is complete
+* - rotation: when the path is replaced by a new file, the rest of the old file
+*   is read before switching to the new one; a truncated file is read again from its start
+* Waits never exceed the poll interval, so the stop predicate is checked regularly.
+*/
+class FileTailer {
+private:
+  std::string filename_;
+  std::string directory_;
+  std::string basename_;
+  std::chrono::milliseconds pollInterval_;
+
+  int fd_;
+  ino_t inode_;
+  off_t offset_;
+  int inotify_;  // -1 when polling
+
+  std::vector<char> buffer_;
+  std::string partial_;  // start of a line whose newline is still to come
+  bool skipHeader_;  // the next line is the header of a newly opened file
+
+  long lines_;
+  long rotations_;
+
+  // Open the file if it exists, at its start - false if it does not exist
+  bool _open(bool header);
+  void _close();
+
+  // Hand over every complete line appended since the last call
+  template <typename F>
+  void _drain(F& on_line);
+
+  // Hand over one line, dropping a trailing carriage return
+  template <typename F>
+  void _emit(F& on_line, const char* begin, const char* end);
+
+  // Block until the file may have changed, or for at most the poll interval
+  void _wait();
+
+public:
+  // ctor
+  FileTailer(const std::string& _filename, std::chrono::milliseconds _pollInterval = std::chrono::milliseconds(10));
+  ~FileTailer();
+
+  FileTailer(const FileTailer&) = delete;
+  FileTailer& operator=(const FileTailer&) = delete;
+
+  // Follow the file until `stop` returns true, calling `on_line(begin, end)` for every line
+  // `header`: skip the first line of the file, and of every file it is rotated to
+  // A last line still without its newline when stopping is not handed over
+  template <typename F>
+  void Run(F on_line, const std::function<bool()>& stop, bool header = false);
+
+  // Is the tailer woken by inotify rather than polling?
+  bool UsesInotify() const;
+
+  long GetLineCount() const;
+  long GetRotationCount() const;
+};
+
+//*************************************************************************************************
+// FileTailer implementations
+//*************************************************************************************************
+FileTailer::FileTailer(const std::string& _filename, std::chrono::milliseconds _pollInterval) :
+  filename_(_filename), pollInterval_(_pollInterval), fd_(-1), inode_(0), offset_(0), inotify_(-1),
+  buffer_(1 << 16), skipHeader_(false), lines_(0), rotations_(0)
+{
+  std::size_t slash = filename_.find_last_of('/');
+  directory_ = (slash == std::string::npos) ? "." : filename_.substr(0, slash + 1);
+  basename_ = (slash == std::string::npos) ? filename_ : filename_.substr(slash + 1);
+
+  // watch the directory rather than the file: that also sees the file being replaced
+  inotify_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (inotify_ >= 0 &&
+    inotify_add_watch(inotify_, directory_.c_str(), IN_MODIFY | IN_CREATE | IN_MOVED_TO | IN_DELETE | IN_ATTRIB) < 0) {
+    close(inotify_);
+    inotify_ = -1;
+  }
+}
+
+FileTailer::~FileTailer() {
+  _close();
+  if (inotify_ >= 0) close(inotify_);
+}
+
+bool FileTailer::_open(bool header) {
+  int fd = open(filename_.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return false;
+  struct stat info;
+  if (fstat(fd, &info) < 0) {
+    close(fd);
+    return false;
+  }
+  fd_ = fd;
+  inode_ = info.st_ino;
+  offset_ = 0;
+  partial_.clear();
+  skipHeader_ = header;
+  return true;
+}
+
+void FileTailer::_close() {
+  if (fd_ >= 0) close(fd_);
+  fd_ = -1;
+}
+
+template <typename F>
+void FileTailer::_emit(F& on_line, const char* begin, const char* end) {
+  if (end > begin && end[-1] == '\r') --end;
+  if (skipHeader_) {
+    skipHeader_ = false;
+    return;
+  }
+  if (end == begin) return;
+  lines_++;
+  on_line(begin, end);
+}
+
+template <typename F>
+void FileTailer::_drain(F& on_line) {
+  ssize_t n;
+  while ((n = read(fd_, buffer_.data(), buffer_.size())) > 0) {
+    offset_ += n;
+    const char* begin = buffer_.data();
+    const char* end = begin + n;
+    while (begin < end) {
+      const char* newline = static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+      if (newline == nullptr) {
+        // the writer has not finished this line yet
+        partial_.append(begin, end);
+        break;
+      }
+      if (partial_.empty()) {
+        _emit(on_line, begin, newline);
+      }
+      else {
+        partial_.append(begin, newline);
+        _emit(on_line, partial_.data(), partial_.data() + partial_.size());
+        partial_.clear();
+      }
+      begin = newline + 1;
+    }
+  }
+}
+
+void FileTailer::_wait() {
+  if (inotify_ < 0) {
+    std::this_thread::sleep_for(pollInterval_);
+    return;
+  }
+
+  // wake up on the first event about our file, ignore the rest of the directory
+  auto deadline = std::chrono::steady_clock::now() + pollInterval_;
+  alignas(struct inotify_event) char events[4096];
+  while (true) {
+    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+    if (left.count() <= 0) return;
+    struct pollfd pfd{ inotify_, POLLIN, 0 };
+    if (poll(&pfd, 1, static_cast<int>(left.count())) <= 0) return;
+
+    bool relevant = false;
+    ssize_t n;
+    while ((n = read(inotify_, events, sizeof(events))) > 0) {
+      for (char* p = events; p < events + n; ) {
+        struct inotify_event* event = reinterpret_cast<struct inotify_event*>(p);
+        if (event->len == 0 || basename_ == event->name) relevant = true;
+        if (event->mask & IN_Q_OVERFLOW) relevant = true;
+        p += sizeof(struct inotify_event) + event->len;
+      }
+    }
+    if (relevant) return;
+  }
+}
+
+template <typename F>
+void FileTailer::Run(F on_line, const std::function<bool()>& stop, bool header) {
+  _open(header);
+
+  while (true) {
+    if (fd_ >= 0) _drain(on_line);
+    if (stop()) break;
+
+    if (fd_ < 0) {
+      // not created yet
+      if (_open(header)) continue;
+    }
+    else {
+      struct stat path_info, fd_info;
+      if (stat(filename_.c_str(), &path_info) == 0 && path_info.st_ino != inode_) {
+        // rotated: finish the old file, then start on the new one
+        _drain(on_line);
+        _close();
+        rotations_++;
+        if (_open(header)) continue;
+      }
+      else if (fstat(fd_, &fd_info) == 0 && fd_info.st_size < offset_) {
+        // truncated in place: read it again from the start
+        lseek(fd_, 0, SEEK_SET);
+        offset_ = 0;
+        partial_.clear();
+        skipHeader_ = header;
+        rotations_++;
+        continue;
+      }
+    }
+    _wait();
+  }
+
+  _close();
+}
+
+bool FileTailer::UsesInotify() const {
+  return inotify_ >= 0;
+}
+
+long FileTailer::GetLineCount() const {
+  return lines_;
+}
+
+long FileTailer::GetRotationCount() const {
+  return rotations_;
+}
+
+#endif // !FILETAILER_HPP
@@ -0,0 +1,213 @@
+/**
+* fixedstring.hpp
+*
+* Fixed-capacity string with inline storage, used for identifiers
+* (CUSIPs, books, order, trade and inquiry ids) so that building, copying,
+* hashing and comparing them never allocates
+*
+* @author: Gabo Bernardino
+*/
+
+#ifndef FIXEDSTRING_HPP
+#define FIXEDSTRING_HPP
+
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <ostream>
+#include <functional>
+#include <stdexcept>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/**
+* String of at most N characters stored inline.
+* Trivially copyable. An id is never cut: Append throws std::length_error when the
+* characters would not fit, and TryAppend, for input that may be malformed, returns false.
+*
+* The storage is zero-padded to a multiple of 16 bytes so that equality is a
+* fixed number of 16-byte SIMD compares, and the (FNV-1a) hash is updated as
+* characters are appended, so hashing is a load.
+*/
+template <std::size_t N>
+class FixedString {
+  static_assert(N > 0 && N < 256, "FixedString capacity must fit in one byte");
+
+private:
+  static constexpr std::size_t storage_ = ((N + 1 + 15) / 16) * 16;
+
+  alignas(16) char data_[storage_];  // always null terminated, zero padded
+  std::uint64_t hash_;
+  unsigned char size_;
+
+public:
+  // ctors
+  FixedString();
+  FixedString(const char* _str);
+  FixedString(const std::string& _str);
+
+  // Append characters - throws std::length_error past the capacity
+  FixedString& Append(const char* _str, std::size_t _len);
+  FixedString& Append(const char* _str);
+  FixedString& Append(const std::string& _str);
+
+  // Append the decimal representation of a number
+  FixedString& AppendNumber(long _value);
+
+  // Append characters if they fit - false, and the string unchanged, if they do not
+  bool TryAppend(const char* _str, std::size_t _len);
+
+  const char* c_str() const;
+  std::size_t size() const;
+  bool empty() const;
+  static constexpr std::size_t capacity() { return N; }
+
+  // Precomputed hash of the content
+  std::size_t GetHash() const;
+
+  // Conversion for code that still works on std::string
+  operator std::string() const;
+
+  bool operator==(const FixedString& other) const;
+  bool operator!=(const FixedString& other) const;
+  bool operator<(const FixedString& other) const;
+
+  template <std::size_t M>
+  friend std::ostream& operator<<(std::ostream& output, const FixedString<M>& str);
+};
+
+//*************************************************************************************************
+// FixedString implementations
+//*************************************************************************************************
+template <std::size_t N>
+FixedString<N>::FixedString() : hash_(14695981039346656037ULL), size_(0) {
+  std::memset(data_, 0, storage_);
+}
+
+template <std::size_t N>
+FixedString<N>::FixedString(const char* _str) : FixedString() {
+  Append(_str);
+}
+
+template <std::size_t N>
+FixedString<N>::FixedString(const std::string& _str) : FixedString() {
+  Append(_str);
+}
+
+template <std::size_t N>
+FixedString<N>& FixedString<N>::Append(const char* _str, std::size_t _len) {
+  if (!TryAppend(_str, _len)) {
+    throw std::length_error(std::string(data_, size_) + std::string(_str, _len) + " is longer than "
+      + std::to_string(N) + " characters");
+  }
+  return *this;
+}
+
+template <std::size_t N>
+bool FixedString<N>::TryAppend(const char* _str, std::size_t _len) {
+  if (_len > N - size_) return false;
+  for (std::size_t i = 0; i < _len; ++i) {
+    data_[size_ + i] = _str[i];
+    // FNV-1a, continued from the current content
+    hash_ ^= static_cast<unsigned char>(_str[i]);
+    hash_ *= 1099511628211ULL;
+  }
+  size_ += static_cast<unsigned char>(_len);
+  return true;
+}
+
+template <std::size_t N>
+FixedString<N>& FixedString<N>::Append(const char* _str) {
+  return Append(_str, std::strlen(_str));
+}
+
+template <std::size_t N>
+FixedString<N>& FixedString<N>::Append(const std::string& _str) {
+  return Append(_str.data(), _str.size());
+}
+
+template <std::size_t N>
+FixedString<N>& FixedString<N>::AppendNumber(long _value) {
+  // write digits backwards into a small buffer
+  char buffer[24];
+  int pos = sizeof(buffer);
+  unsigned long magnitude = (_value < 0) ? 0UL - static_cast<unsigned long>(_value) : _value;
+  do {
+    buffer[--pos] = static_cast<char>('0' + magnitude % 10);
+    magnitude /= 10;
+  } while (magnitude != 0);
+  if (_value < 0) buffer[--pos] = '-';
+
+  return Append(buffer + pos, sizeof(buffer) - pos);
+}
+
+template <std::size_t N>
+const char* FixedString<N>::c_str() const {
+  return data_;
+}
+
+template <std::size_t N>
+std::size_t FixedString<N>::size() const {
+  return size_;
+}
+
+template <std::size_t N>
+bool FixedString<N>::empty() const {
+  return size_ == 0;
+}
+
+template <std::size_t N>
+std::size_t FixedString<N>::GetHash() const {
+  return static_cast<std::size_t>(hash_);
+}
+
+template <std::size_t N>
+FixedString<N>::operator std::string() const {
+  return std::string(data_, size_);
+}
+
+template <std::size_t N>
+bool FixedString<N>::operator==(const FixedString& other) const {
+  if (hash_ != other.hash_ || size_ != other.size_) return false;
+#ifdef __SSE2__
+  // padding is zeroed, so whole blocks can be compared
+  for (std::size_t i = 0; i < storage_; i += 16) {
+    __m128i a = _mm_load_si128(reinterpret_cast<const __m128i*>(data_ + i));
+    __m128i b = _mm_load_si128(reinterpret_cast<const __m128i*>(other.data_ + i));
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) != 0xFFFF) return false;
+  }
+  return true;
+#else
+  return std::memcmp(data_, other.data_, storage_) == 0;
+#endif
+}
+
+template <std::size_t N>
+bool FixedString<N>::operator!=(const FixedString& other) const {
+  return !(*this == other);
+}
+
+template <std::size_t N>
+bool FixedString<N>::operator<(const FixedString& other) const {
+  // padding is zeroed, so this is the lexicographic order
+  return std::memcmp(data_, other.data_, N + 1) < 0;
+}
+
+template <std::size_t M>
+std::ostream& operator<<(std::ostream& output, const FixedString<M>& str) {
+  output.write(str.data_, str.size_);
+  return output;
+}
+
+// hash so that fixed strings can key the services' maps
+namespace std {
+  template <std::size_t N>
+  struct hash<FixedString<N>> {
+    std::size_t operator()(const FixedString<N>& str) const {
+      return str.GetHash();
+    }
+  };
+}
+
+#endif // !FIXEDSTRING_HPP
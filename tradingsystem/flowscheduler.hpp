@@ -0,0 +1,125 @@
+/**
+* flowscheduler.hpp
+*
+* Runs independent flows of the trading system (e.g. one connector's
+* Subscribe loop each) concurrently, one thread per flow
+*
+* @author: Gabo Bernardino
+*/
+
+#ifndef FLOWSCHEDULER_HPP
+#define FLOWSCHEDULER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+
+/**
+* Flow scheduler
+* Flows are registered with AddFlow, launched together by Start and waited
+* for by Join. Shutdown is cooperative: RequestStop raises a flag that
+* long-running flows (e.g. tailing a live file) poll via StopRequested.
+* The elapsed time of each flow is recorded and printed by Report.
+*/
+class FlowScheduler {
+private:
+  struct Flow {
+    std::string name;
+    std::function<void()> body;
+    std::thread thread;
+    std::chrono::duration<double> elapsed{ 0. };
+    std::exception_ptr error;
+  };
+
+  std::deque<Flow> flows_;  // deque: flows never move once added
+  std::atomic<bool> stop_;
+  bool started_;
+
+public:
+  // ctor
+  FlowScheduler();
+  ~FlowScheduler();
+
+  // Register a flow - must be called before Start
+  void AddFlow(const std::string& name, std::function<void()> body);
+
+  // Launch every flow on its own thread
+  void Start();
+
+  // Wait for all flows to finish; rethrows the first error raised by a flow
+  void Join();
+
+  // Ask the flows to stop
+  void RequestStop();
+  bool StopRequested() const;
+
+  // Print the elapsed time of each flow
+  void Report(std::ostream& output) const;
+};
+
+//*************************************************************************************************
+// FlowScheduler implementations
+//*************************************************************************************************
+FlowScheduler::FlowScheduler() :
+  stop_(false), started_(false) {}
+
+FlowScheduler::~FlowScheduler() {
+  RequestStop();
+  for (Flow& flow : flows_) {
+    if (flow.thread.joinable()) flow.thread.join();
+  }
+}
+
+void FlowScheduler::AddFlow(const std::string& name, std::function<void()> body) {
+  flows_.push_back(Flow());
+  flows_.back().name = name;
+  flows_.back().body = std::move(body);
+}
+
+void FlowScheduler::Start() {
+  if (started_) return;
+  started_ = true;
+
+  for (Flow& flow : flows_) {
+    flow.thread = std::thread([&flow]() {
+      auto start = std::chrono::steady_clock::now();
+      try {
+        flow.body();
+      }
+      catch (...) {
+        flow.error = std::current_exception();
+      }
+      flow.elapsed = std::chrono::steady_clock::now() - start;
+    });
+  }
+}
+
+void FlowScheduler::Join() {
+  for (Flow& flow : flows_) {
+    if (flow.thread.joinable()) flow.thread.join();
+  }
+  for (Flow& flow : flows_) {
+    if (flow.error) std::rethrow_exception(flow.error);
+  }
+}
+
+void FlowScheduler::RequestStop() {
+  stop_ = true;
+}
+
+bool FlowScheduler::StopRequested() const {
+  return stop_;
+}
+
+void FlowScheduler::Report(std::ostream& output) const {
+  for (const Flow& flow : flows_) {
+    output << "Flow '" << flow.name << "' elapsed time: " << flow.elapsed.count() << "s\n";
+  }
+}
+
+#endif // !FLOWSCHEDULER_HPP
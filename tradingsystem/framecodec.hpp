@@ -0,0 +1,208 @@
+/**
+* framecodec.hpp
+*
+* Compressed frames for the historical files: each frame is an LZ77 block that
+* decodes on its own, so a reader can start at any frame
+*
+* @author: Gabo Bernardino
+*/
+
+#ifndef FRAMECODEC_HPP
+#define FRAMECODEC_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+/**
+* A compressed file is a sequence of frames, each a header and a block:
+*  u32 magic, u32 raw length, u32 block length, u64 offset of the frame in the uncompressed stream,
+*  u32 CRC-32 of the lengths, the offset and the block
+* (host byte order, like the snapshots). The checksum catches a frame torn or
+* damaged on disk before it is decoded. The block holds LZ77 sequences in the
+* layout of LZ4 blocks: a token (literal length << 4 | match length - 4), longer
+* lengths continued in bytes of 255, the literals, then a 2-byte little-endian
+* match offset within the 64KB before. The last sequence has literals only.
+*/
+const std::uint32_t frameMagic = 0x5A48544DU;  // "MTHZ"
+const std::size_t frameHeaderSize = 24;
+const char* const frameSuffix = ".lz";
+
+// Unaligned 32-bit read
+std::uint32_t FrameRead32(const char* p) {
+  std::uint32_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+// CRC-32 (IEEE, reflected) of `length` bytes, continuing from `crc`
+std::uint32_t FrameCrc(const char* data, std::size_t length, std::uint32_t crc = 0) {
+  static const std::array<std::uint32_t, 256> table = []() {
+    std::array<std::uint32_t, 256> t;
+    for (std::uint32_t i = 0; i < 256; ++i) {
+      std::uint32_t c = i;
+      for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320U ^ (c >> 1) : c >> 1;
+      t[i] = c;
+    }
+    return t;
+  }();
+  crc = ~crc;
+  for (std::size_t i = 0; i < length; ++i) crc = table[(crc ^ static_cast<unsigned char>(data[i])) & 0xFF] ^ (crc >> 8);
+  return ~crc;
+}
+
+// Checksum of a frame whose block follows its header: lengths and offset, then the block
+std::uint32_t FrameChecksum(const char* frame, std::size_t blockLength) {
+  std::uint32_t crc = FrameCrc(frame + 4, 16);
+  return FrameCrc(frame + frameHeaderSize, blockLength, crc);
+}
+
+// Write the rest of a length, in bytes of 255
+void FramePutLength(std::string& out, std::size_t length) {
+  while (length >= 255) {
+    out.push_back(static_cast<char>(255));
+    length -= 255;
+  }
+  out.push_back(static_cast<char>(length));
+}
+
+// Write a sequence: literals, then a match unless `offset` is 0
+void FramePutSequence(std::string& out, const char* literals, std::size_t literalLength,
+  std::size_t offset, std::size_t matchLength) {
+  std::size_t match = (offset > 0) ? matchLength - 4 : 0;
+  out.push_back(static_cast<char>((std::min<std::size_t>(literalLength, 15) << 4) | std::min<std::size_t>(match, 15)));
+  if (literalLength >= 15) FramePutLength(out, literalLength - 15);
+  out.append(literals, literalLength);
+  if (offset == 0) return;
+  out.push_back(static_cast<char>(offset & 0xFF));
+  out.push_back(static_cast<char>(offset >> 8));
+  if (match >= 15) FramePutLength(out, match - 15);
+}
+
+// Compress `length` bytes into a frame appended to `out`; `offset` is their place in the uncompressed stream
+void FrameCompress(const char* data, std::size_t length, std::uint64_t offset, std::string& out) {
+  const int hashBits = 12;
+  std::array<std::uint32_t, 1 << hashBits> table;  // last position of each hashed 4 bytes
+  table.fill(0);
+
+  std::size_t header = out.size();
+  out.append(frameHeaderSize, '\0');
+
+  std::size_t anchor = 0, position = 0;
+  while (position + 4 <= length) {
+    std::uint32_t sequence = FrameRead32(data + position);
+    std::uint32_t hash = (sequence * 2654435761U) >> (32 - hashBits);
+    std::size_t candidate = table[hash];
+    table[hash] = static_cast<std::uint32_t>(position);
+    if (candidate >= position || position - candidate > 0xFFFF || FrameRead32(data + candidate) != sequence) {
+      position++;
+      continue;
+    }
+    std::size_t match = 4;
+    while (position + match < length && data[candidate + match] == data[position + match]) match++;
+    FramePutSequence(out, data + anchor, position - anchor, position - candidate, match);
+    position += match;
+    anchor = position;
+  }
+  FramePutSequence(out, data + anchor, length - anchor, 0, 0);
+
+  std::uint32_t magic = frameMagic;
+  std::uint32_t raw = static_cast<std::uint32_t>(length);
+  std::uint32_t block = static_cast<std::uint32_t>(out.size() - header - frameHeaderSize);
+  std::memcpy(&out[header], &magic, 4);
+  std::memcpy(&out[header + 4], &raw, 4);
+  std::memcpy(&out[header + 8], &block, 4);
+  std::memcpy(&out[header + 12], &offset, 8);
+  std::uint32_t checksum = FrameChecksum(&out[header], block);
+  std::memcpy(&out[header + 20], &checksum, 4);
+}
+
+// Decode a block into `out` - false if it is corrupt or does not give `rawLength` bytes
+bool FrameDecode(const char* block, std::size_t blockLength, std::size_t rawLength, std::string& out) {
+  if (rawLength / 255 > blockLength) return false;  // more than a block can expand to, from a corrupt header
+  out.resize(rawLength);
+  char* begin = &out[0];
+  char* to = begin;
+  char* last = begin + rawLength;
+  const char* in = block;
+  const char* end = block + blockLength;
+  while (in < end) {
+    unsigned token = static_cast<unsigned char>(*in++);
+    std::size_t literals = token >> 4;
+    if (literals == 15) {
+      unsigned byte;
+      do {
+        if (in >= end) return false;
+        byte = static_cast<unsigned char>(*in++);
+        literals += byte;
+      } while (byte == 255);
+    }
+    if (static_cast<std::size_t>(end - in) < literals || static_cast<std::size_t>(last - to) < literals) return false;
+    std::memcpy(to, in, literals);
+    to += literals;
+    in += literals;
+    if (in == end) break;  // the last sequence
+
+    if (end - in < 2) return false;
+    std::size_t offset = static_cast<unsigned char>(in[0]) | (static_cast<std::size_t>(static_cast<unsigned char>(in[1])) << 8);
+    in += 2;
+    std::size_t match = (token & 15) + 4;
+    if ((token & 15) == 15) {
+      unsigned byte;
+      do {
+        if (in >= end) return false;
+        byte = static_cast<unsigned char>(*in++);
+        match += byte;
+      } while (byte == 255);
+    }
+    if (offset == 0 || offset > static_cast<std::size_t>(to - begin) || static_cast<std::size_t>(last - to) < match) return false;
+    const char* from = to - offset;
+    if (offset >= match) std::memcpy(to, from, match);
+    else for (std::size_t i = 0; i < match; ++i) to[i] = from[i];  // overlaps what it copies
+    to += match;
+  }
+  return to == last;
+}
+
+// Read a frame header - false if there is no frame there
+bool FrameHeader(const char* data, std::uint32_t& rawLength, std::uint32_t& blockLength, std::uint64_t& offset) {
+  if (FrameRead32(data) != frameMagic) return false;
+  rawLength = FrameRead32(data + 4);
+  blockLength = FrameRead32(data + 8);
+  std::memcpy(&offset, data + 12, 8);
+  return true;
+}
+
+// Does a frame, header and the `blockLength` bytes of block after it, match its checksum?
+bool FrameIntact(const char* frame, std::size_t blockLength) {
+  return FrameRead32(frame + 20) == FrameChecksum(frame, blockLength);
+}
+
+// Walk the frames of an open file: returns the size of its uncompressed stream, and
+// in `valid` the bytes up to the end of the last whole frame - whole meaning its checksum
+// matches, as the writes of a crashed run can land out of order and leave holes
+std::uint64_t FrameScan(int fd, std::uint64_t& valid) {
+  std::vector<char> frame(frameHeaderSize);
+  std::uint64_t position = 0, raw = 0;
+  off_t size = lseek(fd, 0, SEEK_END);
+  while (static_cast<off_t>(position + frameHeaderSize) <= size
+    && pread(fd, frame.data(), frameHeaderSize, static_cast<off_t>(position)) == static_cast<ssize_t>(frameHeaderSize)) {
+    std::uint32_t rawLength, blockLength;
+    std::uint64_t offset;
+    if (!FrameHeader(frame.data(), rawLength, blockLength, offset)) break;
+    if (static_cast<off_t>(position + frameHeaderSize + blockLength) > size) break;  // cut by a crash
+    frame.resize(frameHeaderSize + blockLength);
+    if (pread(fd, frame.data() + frameHeaderSize, blockLength, static_cast<off_t>(position + frameHeaderSize)) != static_cast<ssize_t>(blockLength)
+      || !FrameIntact(frame.data(), blockLength)) break;
+    position += frameHeaderSize + blockLength;
+    raw = offset + rawLength;
+  }
+  valid = position;
+  return raw;
+}
+
+#endif // !FRAMECODEC_HPP
@@ -11,10 +11,31 @@
 #ifndef HISTORICAL_DATA_SERVICE_HPP
 #define HISTORICAL_DATA_SERVICE_HPP
 
+#include <chrono>
 #include <unordered_map>
 #include <string>
+#include <vector>
 #include "soa.hpp"
 
+/**
+ * Connector that can also publish several records at once,
+ * e.g. with one write for all of them
+ */
+template<typename T>
+class BatchConnector : public Connector<T>
+{
+public:
+  // Publish several records, in order, each stamped with its time
+  virtual void PublishBatch(std::vector<T>& data, const std::vector<std::chrono::system_clock::time_point>& times) = 0;
+};
+
+// Key of a record in the historical data - its product id, unless an overload for its type says otherwise
+template<typename T>
+std::string HistoricalKey(const T& data)
+{
+  return data.GetProduct().GetProductId();
+}
+
 /**
  * Service for processing and persisting historical data to a persistent store.
  * Keyed on some persistent key.
@@ -28,6 +49,7 @@ protected:
   std::vector<ServiceListener<T>*> listeners_;
   std::unordered_map<std::string, T> historicalData_;
   Connector<T>* historicalDataConnector_;  // special connector for type T
+  BatchConnector<T>* batchConnector_;  // the same connector, when it takes batches
 
 public:
   //ctor
@@ -48,7 +70,11 @@ public:
   virtual const vector<ServiceListener<T>*>& GetListeners() const override;
   
   // Persist data to a store
-  void PersistData(string persistKey, T& data);
+  void PersistData(const string& persistKey, T& data);
+
+  // Persist several records, each stamped with its time and keyed on its HistoricalKey
+  // - in one publish when the connector takes batches
+  void PersistBatch(std::vector<T>& data, const std::vector<std::chrono::system_clock::time_point>& times);
 };
 
 /**
@@ -76,6 +102,9 @@ public:
 
   // Listener callback to process an update event to the Service
   virtual void ProcessUpdate(T& data) override;
+
+  // Callback for services handing over several events at once, each with the time it happened
+  void ProcessBatch(std::vector<T>& data, const std::vector<std::chrono::system_clock::time_point>& times);
 };
 
 
@@ -83,7 +112,8 @@ public:
 // HistoricalDataService implementations
 //*************************************************************************************************
 template <typename T>
-HistoricalDataService<T>::HistoricalDataService()
+HistoricalDataService<T>::HistoricalDataService() :
+  historicalDataConnector_(nullptr), batchConnector_(nullptr)
 {
   historicalData_ = std::unordered_map<std::string, T>();
 }
@@ -91,6 +121,7 @@ HistoricalDataService<T>::HistoricalDataService()
 template <typename T>
 void HistoricalDataService<T>::SetConnector(Connector<T>* _connector) {
   historicalDataConnector_ = _connector;
+  batchConnector_ = dynamic_cast<BatchConnector<T>*>(_connector);
 }
 
 template <typename T>
@@ -114,13 +145,20 @@ const vector<ServiceListener<T>*>& HistoricalDataService<T>::GetListeners() cons
 }
 
 template <typename T>
-void HistoricalDataService<T>::PersistData(std::string persistKey, T& data) {
+void HistoricalDataService<T>::PersistData(const std::string& persistKey, T& data) {
   // add new data to map
   historicalData_[persistKey] = data;
   // then publish via connector to persist in appropriate file
   historicalDataConnector_->Publish(data);
 }
 
+template <typename T>
+void HistoricalDataService<T>::PersistBatch(std::vector<T>& data, const std::vector<std::chrono::system_clock::time_point>& times) {
+  for (T& item : data) historicalData_[HistoricalKey(item)] = item;
+  if (batchConnector_ != nullptr) batchConnector_->PublishBatch(data, times);
+  else for (T& item : data) historicalDataConnector_->Publish(item);
+}
+
 //*************************************************************************************************
 // HistoricalDataListener implementations
 //*************************************************************************************************
@@ -130,7 +168,7 @@ HistoricalDataListener<T>::HistoricalDataListener(HistoricalDataService<T>* _ser
 
 template <typename T>
 void HistoricalDataListener<T>::ProcessAdd(T& data) {
-  std::string persist_key = data.GetProduct().GetProductId();  // key is always product id
+  const std::string persist_key = HistoricalKey(data);  // product id, or inquiry id for an inquiry
   historicalDataService_->PersistData(persist_key, data);
 }
 
@@ -144,4 +182,9 @@ void HistoricalDataListener<T>::ProcessUpdate(T& data) {
   // not implemented
 }
 
+template <typename T>
+void HistoricalDataListener<T>::ProcessBatch(std::vector<T>& data, const std::vector<std::chrono::system_clock::time_point>& times) {
+  historicalDataService_->PersistBatch(data, times);
+}
+
 #endif
@@ -13,6 +13,9 @@
 // Various inqyury states
 enum InquiryState { RECEIVED, QUOTED, DONE, REJECTED, CUSTOMER_REJECTED };
 
+// Inquiry identifiers are stored inline
+typedef FixedString<32> InquiryId;
+
 /**
  * Inquiry object modeling a customer inquiry from a client.
  * Type T is the product type.
@@ -24,11 +27,11 @@ class Inquiry
 public:
 
   // ctor for an inquiry
-  Inquiry(string _inquiryId, const T &_product, Side _side, long _quantity, double _price, InquiryState _state);
+  Inquiry(const InquiryId &_inquiryId, const T &_product, Side _side, long _quantity, double _price, InquiryState _state);
   Inquiry() = default;
 
   // Get the inquiry ID
-  const string& GetInquiryId() const;
+  const InquiryId& GetInquiryId() const;
 
   // Get the product
   const T& GetProduct() const;
@@ -52,7 +55,7 @@ public:
   void SetState(const InquiryState& newState);
 
 private:
-  string inquiryId;
+  InquiryId inquiryId;
   T product;
   Side side;
   long quantity;
@@ -73,18 +76,24 @@ class InquiryService : public Service<string,Inquiry <T> >
 public:
 
   // Send a quote back to the client
-  virtual void SendQuote(const string &inquiryId, double price) = 0;
+  virtual void SendQuote(const InquiryId &inquiryId, double price) = 0;
 
   // Reject an inquiry from the client
-  virtual void RejectInquiry(const string &inquiryId) = 0;
+  virtual void RejectInquiry(const InquiryId &inquiryId) = 0;
 
 };
 
+// Inquiries are kept in the historical data by inquiry id: several are open on a product at once
+template<typename T>
+std::string HistoricalKey(const Inquiry<T> &data)
+{
+  return data.GetInquiryId();
+}
+
 template<typename T>
-Inquiry<T>::Inquiry(string _inquiryId, const T &_product, Side _side, long _quantity, double _price, InquiryState _state) :
-  product(_product)
+Inquiry<T>::Inquiry(const InquiryId &_inquiryId, const T &_product, Side _side, long _quantity, double _price, InquiryState _state) :
+  inquiryId(_inquiryId), product(_product)
 {
-  inquiryId = _inquiryId;
   side = _side;
   quantity = _quantity;
   price = _price;
@@ -92,7 +101,7 @@ Inquiry<T>::Inquiry(string _inquiryId, const T &_product, Side _side, long _quan
 }
 
 template<typename T>
-const string& Inquiry<T>::GetInquiryId() const
+const InquiryId& Inquiry<T>::GetInquiryId() const
 {
   return inquiryId;
 }
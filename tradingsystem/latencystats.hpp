@@ -0,0 +1,123 @@
+/**
+* latencystats.hpp
+*
+* Latency recorder with a log-linear histogram, for percentiles without storing samples
+*
+* @author: Gabo Bernardino
+*/
+
+#ifndef LATENCYSTATS_HPP
+#define LATENCYSTATS_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+/**
+* Latency statistics
+* Samples (in nanoseconds) go into a histogram with 8 linear sub-buckets per
+* power of two, so Record is O(1), memory is fixed and percentiles are
+* accurate to 1/8th of their order of magnitude.
+*/
+class LatencyStats {
+private:
+  static constexpr int subBits_ = 3;
+  static constexpr int subBuckets_ = 1 << subBits_;
+  static constexpr int buckets_ = 64 * subBuckets_;
+
+  std::array<std::uint64_t, buckets_> histogram_;
+  std::uint64_t count_;
+  std::uint64_t total_;
+  std::uint64_t max_;
+
+  static int _bucket(std::uint64_t value);
+  // upper bound of the values falling in a bucket
+  static std::uint64_t _upper(int bucket);
+
+public:
+  // ctor
+  LatencyStats();
+
+  void Record(std::uint64_t nanos);
+  void Reset();
+
+  std::uint64_t GetCount() const;
+  double GetMean() const;
+  std::uint64_t GetMax() const;
+
+  // Value below which a fraction p (in [0, 1]) of the samples fall
+  std::uint64_t GetPercentile(double p) const;
+
+  // One-line summary: count, mean, p50, p99, p99.9, max in microseconds
+  void Report(std::ostream& output, const std::string& name) const;
+};
+
+//*************************************************************************************************
+// LatencyStats implementations
+//*************************************************************************************************
+LatencyStats::LatencyStats() {
+  Reset();
+}
+
+int LatencyStats::_bucket(std::uint64_t value) {
+  if (value < subBuckets_) return static_cast<int>(value);
+  int magnitude = 63 - __builtin_clzll(value);  // position of the leading bit
+  int sub = static_cast<int>((value >> (magnitude - subBits_)) & (subBuckets_ - 1));
+  return (magnitude - subBits_ + 1) * subBuckets_ + sub;
+}
+
+std::uint64_t LatencyStats::_upper(int bucket) {
+  if (bucket < subBuckets_) return bucket;
+  int magnitude = bucket / subBuckets_ + subBits_ - 1;
+  std::uint64_t sub = bucket % subBuckets_;
+  return ((subBuckets_ + sub + 1) << (magnitude - subBits_)) - 1;
+}
+
+void LatencyStats::Record(std::uint64_t nanos) {
+  histogram_[_bucket(nanos)]++;
+  count_++;
+  total_ += nanos;
+  max_ = std::max(max_, nanos);
+}
+
+void LatencyStats::Reset() {
+  histogram_.fill(0);
+  count_ = total_ = max_ = 0;
+}
+
+std::uint64_t LatencyStats::GetCount() const {
+  return count_;
+}
+
+double LatencyStats::GetMean() const {
+  return (count_ > 0) ? static_cast<double>(total_) / count_ : 0.;
+}
+
+std::uint64_t LatencyStats::GetMax() const {
+  return max_;
+}
+
+std::uint64_t LatencyStats::GetPercentile(double p) const {
+  if (count_ == 0) return 0;
+  std::uint64_t rank = static_cast<std::uint64_t>(p * count_);
+  if (rank >= count_) rank = count_ - 1;
+
+  std::uint64_t seen = 0;
+  for (int bucket = 0; bucket < buckets_; ++bucket) {
+    seen += histogram_[bucket];
+    if (seen > rank) return std::min(_upper(bucket), max_);
+  }
+  return max_;
+}
+
+void LatencyStats::Report(std::ostream& output, const std::string& name) const {
+  output << name << ": " << count_ << " samples, mean " << GetMean() / 1000. << "us"
+    << ", p50 " << GetPercentile(0.5) / 1000. << "us"
+    << ", p99 " << GetPercentile(0.99) / 1000. << "us"
+    << ", p99.9 " << GetPercentile(0.999) / 1000. << "us"
+    << ", max " << max_ / 1000. << "us" << std::endl;
+}
+
+#endif // !LATENCYSTATS_HPP
@@ -91,8 +91,8 @@ public:
   // Get the offer stack
   const vector<Order>& GetOfferStack() const;
 
-  // Get the best bid/offer order
-  const BidOffer& GetBestBidOffer() const;
+  // Get the best bid/offer order of this book
+  BidOffer GetBestBidOffer() const;
 
 private:
   T product;
@@ -113,7 +113,7 @@ class MarketDataService : public Service<string,OrderBook <T> >
 public:
 
   // Get the best bid/offer order
-  virtual const BidOffer& GetBestBidOffer(const string &productId) = 0;
+  virtual BidOffer GetBestBidOffer(const string &productId) = 0;
 
   // Aggregate the order book
   virtual const OrderBook<T>& AggregateDepth(const string &productId) = 0;
@@ -184,14 +184,12 @@ const vector<Order>& OrderBook<T>::GetOfferStack() const
 }
 
 template<typename T>
-const BidOffer& OrderBook<T>::GetBestBidOffer() const {
+BidOffer OrderBook<T>::GetBestBidOffer() const {
   // extract best bid and best offer
   Order best_bid = find_best_order(this->GetBidStack(), BID);
   Order best_offer = find_best_order(this->GetOfferStack(), OFFER);
-  // create bid-offer object
-  static BidOffer bid_off_obj(best_bid, best_offer);
-
-  return bid_off_obj;
+  // create bid-offer object - by value: each book has its own
+  return BidOffer(best_bid, best_offer);
 }
 
 #endif
@@ -0,0 +1,115 @@
+/**
+* objectpool.hpp
+*
+* Preallocated pool of objects of a single type
+*
+* @author: Gabo Bernardino
+*/
+
+#ifndef OBJECTPOOL_HPP
+#define OBJECTPOOL_HPP
+
+#include <memory>
+#include <vector>
+
+/**
+* Growable object pool.
+* Objects are default-constructed in blocks; Acquire and Release only move
+* pointers on a free list, so the pool only touches the global allocator
+* when every object is handed out, to add one more block of the initial
+* capacity. Blocks are never freed or moved, so objects keep their address
+* for the lifetime of the pool.
+* Keeps track of the high-water mark of objects in use.
+*/
+template <typename T>
+class ObjectPool {
+private:
+  std::vector<std::unique_ptr<T[]>> blocks_;
+  std::vector<T*> free_;  // objects available
+  std::size_t blockSize_;
+  std::size_t capacity_;
+  std::size_t highWaterMark_;
+
+  // Add a block of objects to the free list
+  void _grow();
+
+public:
+  // ctor
+  ObjectPool(std::size_t _capacity);
+
+  // Get an object from the pool - grows the pool if it is exhausted
+  T* Acquire();
+
+  // Give an object back to the pool
+  void Release(T* object);
+
+  // Number of objects currently handed out
+  std::size_t InUse() const;
+
+  // Largest number of objects handed out at the same time
+  std::size_t GetHighWaterMark() const;
+
+  std::size_t GetCapacity() const;
+
+  // Number of blocks added after construction
+  std::size_t GetGrowthCount() const;
+};
+
+//*************************************************************************************************
+// ObjectPool implementations
+//*************************************************************************************************
+template <typename T>
+ObjectPool<T>::ObjectPool(std::size_t _capacity) :
+  blockSize_(_capacity > 0 ? _capacity : 1), capacity_(0), highWaterMark_(0)
+{
+  _grow();
+}
+
+template <typename T>
+void ObjectPool<T>::_grow() {
+  blocks_.push_back(std::make_unique<T[]>(blockSize_));
+  T* block = blocks_.back().get();
+  free_.reserve(capacity_ + blockSize_);
+  // hand out low addresses first
+  for (std::size_t i = blockSize_; i > 0; --i) free_.push_back(block + i - 1);
+  capacity_ += blockSize_;
+}
+
+template <typename T>
+T* ObjectPool<T>::Acquire() {
+  if (free_.empty()) _grow();
+
+  T* object = free_.back();
+  free_.pop_back();
+
+  if (InUse() > highWaterMark_) highWaterMark_ = InUse();
+  return object;
+}
+
+template <typename T>
+void ObjectPool<T>::Release(T* object) {
+  if (object == nullptr) return;
+  free_.push_back(object);
+}
+
+template <typename T>
+std::size_t ObjectPool<T>::InUse() const {
+  return capacity_ - free_.size();
+}
+
+template <typename T>
+std::size_t ObjectPool<T>::GetHighWaterMark() const {
+  return highWaterMark_;
+}
+
+template <typename T>
+std::size_t ObjectPool<T>::GetCapacity() const {
+  return capacity_;
+}
+
+template <typename T>
+std::size_t ObjectPool<T>::GetGrowthCount() const {
+  return blocks_.size() - 1;
+}
+
+#endif // !OBJECTPOOL_HPP
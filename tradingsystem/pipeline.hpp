@@ -0,0 +1,118 @@
+/**
+* pipeline.hpp
+*
+* Compile-time wiring of a Service to a fixed set of listeners
+*
+* @author: Gabo Bernardino
+*/
+
+#ifndef PIPELINE_HPP
+#define PIPELINE_HPP
+
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "soa.hpp"
+
+/**
+* Listener that forwards every event to a fixed list of concrete listeners.
+* The stage types are known at compile time, so each forward is a qualified
+* (non-virtual) call that the compiler is free to inline.
+*
+* It is itself a ServiceListener<V>, so it can be registered with AddListener
+* on any dynamic service: the service pays one virtual hop, the fan-out none.
+*/
+template <typename V, typename... Stages>
+class StaticFanOut : public ServiceListener<V> {
+private:
+  std::tuple<Stages*...> stages_;
+
+public:
+  // ctor
+  StaticFanOut(Stages*... _stages);
+  StaticFanOut() = default;
+
+  // Set the concrete listeners to forward to
+  void SetStages(Stages*... _stages);
+
+  // Listener callback to process an add event to the Service
+  virtual void ProcessAdd(V& data) override;
+
+  // Listener callback to process a remove event to the Service
+  virtual void ProcessRemove(V& data) override;
+
+  // Listener callback to process an update event to the Service
+  virtual void ProcessUpdate(V& data) override;
+};
+
+/**
+* Service statically wired to its downstream listeners.
+* Derives from the Source service, so connectors and dynamic listeners keep
+* working unchanged: OnMessage runs the Source logic (storing the data and
+* notifying any listener added via AddListener), then forwards the event to
+* each stage with a direct call to Stage::ProcessAdd.
+*
+* e.g. Pipeline<BondPricingService, BondGUIListener, BondAlgoStreamingListener>
+*/
+template <typename Source, typename... Stages>
+class Pipeline final : public Source {
+private:
+  using V = typename std::remove_reference<decltype(std::declval<Source&>().GetData(""))>::type;
+
+  std::tuple<Stages*...> stages_;
+
+public:
+  // ctor - Source must be default constructible
+  Pipeline() = default;
+
+  // Set the concrete listeners the pipeline forwards to
+  void SetStages(Stages*... _stages);
+
+  // The callback that a Connector should invoke for any new or updated data
+  virtual void OnMessage(V& data) override;
+};
+
+//*************************************************************************************************
+// StaticFanOut implementations
+//*************************************************************************************************
+template <typename V, typename... Stages>
+StaticFanOut<V, Stages...>::StaticFanOut(Stages*... _stages) :
+  stages_(_stages...) {}
+
+template <typename V, typename... Stages>
+void StaticFanOut<V, Stages...>::SetStages(Stages*... _stages) {
+  stages_ = std::tuple<Stages*...>(_stages...);
+}
+
+template <typename V, typename... Stages>
+void StaticFanOut<V, Stages...>::ProcessAdd(V& data) {
+  (std::get<Stages*>(stages_)->Stages::ProcessAdd(data), ...);
+}
+
+template <typename V, typename... Stages>
+void StaticFanOut<V, Stages...>::ProcessRemove(V& data) {
+  (std::get<Stages*>(stages_)->Stages::ProcessRemove(data), ...);
+}
+
+template <typename V, typename... Stages>
+void StaticFanOut<V, Stages...>::ProcessUpdate(V& data) {
+  (std::get<Stages*>(stages_)->Stages::ProcessUpdate(data), ...);
+}
+
+//*************************************************************************************************
+// Pipeline implementations
+//*************************************************************************************************
+template <typename Source, typename... Stages>
+void Pipeline<Source, Stages...>::SetStages(Stages*... _stages) {
+  stages_ = std::tuple<Stages*...>(_stages...);
+}
+
+template <typename Source, typename... Stages>
+void Pipeline<Source, Stages...>::OnMessage(V& data) {
+  // dynamic part first: store the data and notify registered listeners
+  Source::OnMessage(data);
+  // static part: direct calls into the concrete listeners
+  (std::get<Stages*>(stages_)->Stages::ProcessAdd(data), ...);
+}
+
+#endif // !PIPELINE_HPP
@@ -32,17 +32,20 @@ public:
   const T& GetProduct() const;
 
   // Get the position quantity
-  long GetPosition(string &book);
+  long GetPosition(const BookId &book);
 
   // Get the aggregate position
   long GetAggregatePosition();
 
+  // Get the positions of every book
+  const map<BookId,long>& GetPositions() const;
+
   // Add a position to a book
-  void AddPosition(std::string& book, long& size);
+  void AddPosition(const BookId& book, long size);
 
 private:
   T product;
-  map<string,long> positions;  // keyed on book
+  map<BookId,long> positions;  // keyed on book
 
 };
 
@@ -75,7 +78,7 @@ const T& Position<T>::GetProduct() const
 }
 
 template<typename T>
-long Position<T>::GetPosition(string &book)
+long Position<T>::GetPosition(const BookId &book)
 {
   return positions[book];
 }
@@ -93,8 +96,14 @@ long Position<T>::GetAggregatePosition()
   return aggregate;
 }
 
+template<typename T>
+const map<BookId,long>& Position<T>::GetPositions() const
+{
+  return positions;
+}
+
 template <typename T>
-void Position<T>::AddPosition(std::string& book, long& size) {
+void Position<T>::AddPosition(const BookId& book, long size) {
   if (positions.find(book) != positions.end()) {
     positions[book] += size;
   }
@@ -9,14 +9,20 @@
 
 #include <iostream>
 #include <string>
+#include <unordered_map>
+#include <utility>
 
 #include "boost/date_time/gregorian/gregorian.hpp"
+#include "fixedstring.hpp"
 
 using namespace std;
 using namespace boost::gregorian;
 
 enum ProductType { IRSWAP, BOND };
 
+// Product identifiers (CUSIP, ISIN) are stored inline
+typedef FixedString<15> ProductId;
+
 /**
  * Base class for a product.
  */
@@ -26,24 +32,37 @@ class Product
 public:
 
   // ctor for a prduct
-  Product(string _productId, ProductType _productType);
+  Product(const ProductId& _productId, ProductType _productType);
 
   // Get the product identifier
-  const string& GetProductId() const;
+  const ProductId& GetProductId() const;
 
   // Ge the product type
   ProductType GetProductType() const;
 
 private:
-  string productId;
+  ProductId productId;
   ProductType productType;
 
 };
 
 enum BondIdType { CUSIP, ISIN };
 
+/**
+ * Static reference data of a bond.
+ * Interned once per product id, so that Bond objects only carry a handle to it.
+ */
+struct BondData
+{
+  BondIdType bondIdType;
+  string ticker;
+  float coupon;
+  date maturityDate;
+};
+
 /**
  * Bond product class
+ * Copying a bond copies its id and a handle to the interned reference data
  */
 class Bond : public Product
 {
@@ -51,7 +70,7 @@ class Bond : public Product
 public:
 
   // ctor for a bond
-  Bond(string _productId, BondIdType _bondIdType, string _ticker, float _coupon, date _maturityDate);
+  Bond(const ProductId& _productId, BondIdType _bondIdType, string _ticker, float _coupon, date _maturityDate);
   Bond();
 
   // Get the ticker
@@ -70,11 +89,10 @@ public:
   friend ostream& operator<<(ostream &output, const Bond &bond);
 
 private:
-  string productId;
-  BondIdType bondIdType;
-  string ticker;
-  float coupon;
-  date maturityDate;
+  const BondData* data;  // handle to the interned reference data
+
+  // Intern the reference data for a product id
+  static const BondData* Intern(const ProductId& _productId, BondIdType _bondIdType, string _ticker, float _coupon, date _maturityDate);
 
 };
 
@@ -98,7 +116,7 @@ class IRSwap : public Product
 public:
 
   // ctor for a swap
-  IRSwap(string productId, DayCountConvention _fixedLegDayCountConvention, DayCountConvention _floatingLegDayCountConvention, PaymentFrequency _fixedLegPaymentFrequency, FloatingIndex _floatingIndex, FloatingIndexTenor _floatingIndexTenor, date _effectiveDate, date _terminationDate, Currency _currency, int termYears, SwapType _swapType, SwapLegType _swapLegType);
+  IRSwap(const ProductId& productId, DayCountConvention _fixedLegDayCountConvention, DayCountConvention _floatingLegDayCountConvention, PaymentFrequency _fixedLegPaymentFrequency, FloatingIndex _floatingIndex, FloatingIndexTenor _floatingIndexTenor, date _effectiveDate, date _terminationDate, Currency _currency, int termYears, SwapType _swapType, SwapLegType _swapLegType);
   IRSwap();
 
   // Get the fixed leg daycount convention
@@ -159,13 +177,13 @@ private:
 
 };
 
-Product::Product(string _productId, ProductType _productType)
+Product::Product(const ProductId& _productId, ProductType _productType) :
+  productId(_productId)
 {
-  productId = _productId;
   productType = _productType;
 }
 
-const string& Product::GetProductId() const
+const ProductId& Product::GetProductId() const
 {
   return productId;
 }
@@ -175,45 +193,55 @@ ProductType Product::GetProductType() const
   return productType;
 }
 
-Bond::Bond(string _productId, BondIdType _bondIdType, string _ticker, float _coupon, date _maturityDate) : Product(_productId, BOND)
+Bond::Bond(const ProductId& _productId, BondIdType _bondIdType, string _ticker, float _coupon, date _maturityDate) :
+  Product(_productId, BOND)
 {
-  bondIdType = _bondIdType;
-  ticker = _ticker;
-  coupon = _coupon;
-  maturityDate =_maturityDate;
+  data = Intern(GetProductId(), _bondIdType, std::move(_ticker), _coupon, _maturityDate);
 }
 
 Bond::Bond() : Product("0", BOND)
 {
+  static const BondData empty{ CUSIP, "", 0.f, date() };
+  data = &empty;
+}
+
+const BondData* Bond::Intern(const ProductId& _productId, BondIdType _bondIdType, string _ticker, float _coupon, date _maturityDate)
+{
+  // node-based map: addresses of the stored records never move
+  static unordered_map<ProductId, BondData> registry;
+  BondData& record = registry[_productId];
+  record = BondData{ _bondIdType, std::move(_ticker), _coupon, _maturityDate };
+  return &record;
 }
 
 const string& Bond::GetTicker() const
 {
-  return ticker;
+  return data->ticker;
 }
 
 float Bond::GetCoupon() const
 {
-  return coupon;
+  return data->coupon;
 }
 
 const date& Bond::GetMaturityDate() const
 {
-  return maturityDate;
+  return data->maturityDate;
 }
 
 BondIdType Bond::GetBondIdType() const
 {
-  return bondIdType;
+  return data->bondIdType;
 }
 
 ostream& operator<<(ostream &output, const Bond &bond)
 {
-  output << bond.ticker << " " << bond.coupon << " " << bond.GetMaturityDate();
+  // format the date directly: streaming it imbues a facet on the (shared) output stream
+  output << bond.GetTicker() << " " << bond.GetCoupon() << " " << to_simple_string(bond.GetMaturityDate());
   return output;
 }
 
-IRSwap::IRSwap(string _productId, DayCountConvention _fixedLegDayCountConvention, DayCountConvention _floatingLegDayCountConvention, PaymentFrequency _fixedLegPaymentFrequency, FloatingIndex _floatingIndex, FloatingIndexTenor _floatingIndexTenor, date _effectiveDate, date _terminationDate, Currency _currency, int _termYears, SwapType _swapType, SwapLegType _swapLegType) :
+IRSwap::IRSwap(const ProductId& _productId, DayCountConvention _fixedLegDayCountConvention, DayCountConvention _floatingLegDayCountConvention, PaymentFrequency _fixedLegPaymentFrequency, FloatingIndex _floatingIndex, FloatingIndexTenor _floatingIndexTenor, date _effectiveDate, date _terminationDate, Currency _currency, int _termYears, SwapType _swapType, SwapLegType _swapLegType) :
   Product(_productId, IRSWAP)
 {
   fixedLegDayCountConvention =_fixedLegDayCountConvention;
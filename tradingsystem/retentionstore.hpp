@@ -0,0 +1,187 @@
+/**
+* retentionstore.hpp
+*
+* Bounded keyed store: an open-addressing hash index over a circular arena
+*
+* @author: Gabo Bernardino
+*/
+
+#ifndef RETENTIONSTORE_HPP
+#define RETENTIONSTORE_HPP
+
+#include <algorithm>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include "soa.hpp"
+
+/**
+* Keeps the most recent `capacity` values inserted, keyed on K.
+* Values live in a circular arena in insertion order; a linear-probing index
+* maps keys to arena slots, so lookups stay O(1) and memory stays bounded.
+* Once the arena is full, inserting a new key evicts the oldest value, which
+* is first published to the eviction connector (if any) so it can be journaled.
+* Updating an existing key overwrites it in place.
+*/
+template <typename K, typename V>
+class RetentionStore {
+private:
+  struct Entry {
+    K key;
+    V value;
+    bool live = false;
+  };
+
+  static constexpr std::uint32_t empty_ = 0xFFFFFFFF;
+
+  std::vector<Entry> arena_;  // circular, in insertion order
+  std::vector<std::uint32_t> index_;  // open addressing: arena slot or `empty_`
+  std::size_t mask_;
+  std::size_t head_;  // next arena slot to overwrite
+  std::size_t size_;
+  long evicted_;
+
+  Connector<V>* evictionConnector_;
+
+  std::size_t _home(const K& key) const;
+  // index slot holding the key, or the empty slot where it would go
+  std::size_t _probe(const K& key) const;
+  // remove an index slot, shifting back the entries of its probe chain
+  void _erase(std::size_t slot);
+
+public:
+  // ctor - a capacity of 0 is taken as 1
+  RetentionStore(std::size_t _capacity);
+
+  // Where evicted values are published before being dropped
+  void SetEvictionConnector(Connector<V>* _connector);
+
+  // Insert a value, or overwrite the value stored for this key
+  V& Insert(const K& key, const V& value);
+
+  // Find the value stored for this key - nullptr if not retained
+  V* Find(const K& key);
+
+  // Call `f(key, value)` for every value retained, oldest first
+  template <typename F>
+  void ForEach(F f) const;
+
+  std::size_t Size() const;
+  std::size_t Capacity() const;
+
+  // Number of values evicted so far
+  long GetEvictedCount() const;
+};
+
+//*************************************************************************************************
+// RetentionStore implementations
+//*************************************************************************************************
+template <typename K, typename V>
+RetentionStore<K, V>::RetentionStore(std::size_t _capacity) :
+  arena_(std::max<std::size_t>(_capacity, 1)), head_(0), size_(0), evicted_(0), evictionConnector_(nullptr)
+{
+  // keep the index at most half full
+  std::size_t slots = 16;
+  while (slots < 2 * arena_.size()) slots <<= 1;
+  index_.assign(slots, empty_);
+  mask_ = slots - 1;
+}
+
+template <typename K, typename V>
+void RetentionStore<K, V>::SetEvictionConnector(Connector<V>* _connector) {
+  evictionConnector_ = _connector;
+}
+
+template <typename K, typename V>
+std::size_t RetentionStore<K, V>::_home(const K& key) const {
+  return std::hash<K>()(key) & mask_;
+}
+
+template <typename K, typename V>
+std::size_t RetentionStore<K, V>::_probe(const K& key) const {
+  std::size_t slot = _home(key);
+  while (index_[slot] != empty_ && !(arena_[index_[slot]].key == key)) {
+    slot = (slot + 1) & mask_;
+  }
+  return slot;
+}
+
+template <typename K, typename V>
+void RetentionStore<K, V>::_erase(std::size_t slot) {
+  std::size_t next = slot;
+  while (true) {
+    next = (next + 1) & mask_;
+    if (index_[next] == empty_) break;
+    // move the entry back if its home is not between the hole and its slot
+    std::size_t home = _home(arena_[index_[next]].key);
+    bool movable = (slot <= next) ? (home <= slot || home > next) : (home <= slot && home > next);
+    if (movable) {
+      index_[slot] = index_[next];
+      slot = next;
+    }
+  }
+  index_[slot] = empty_;
+}
+
+template <typename K, typename V>
+V& RetentionStore<K, V>::Insert(const K& key, const V& value) {
+  std::size_t slot = _probe(key);
+  if (index_[slot] != empty_) {
+    // already retained: update in place
+    Entry& entry = arena_[index_[slot]];
+    entry.value = value;
+    return entry.value;
+  }
+
+  Entry& oldest = arena_[head_];
+  if (oldest.live) {
+    // arena is full: journal and drop the oldest value
+    if (evictionConnector_ != nullptr) evictionConnector_->Publish(oldest.value);
+    _erase(_probe(oldest.key));
+    oldest.live = false;
+    evicted_++;
+    size_--;
+    slot = _probe(key);  // the erase may have shifted the chain
+  }
+
+  oldest.key = key;
+  oldest.value = value;
+  oldest.live = true;
+  index_[slot] = static_cast<std::uint32_t>(head_);
+  head_ = (head_ + 1) % arena_.size();
+  size_++;
+  return oldest.value;
+}
+
+template <typename K, typename V>
+V* RetentionStore<K, V>::Find(const K& key) {
+  std::size_t slot = _probe(key);
+  return (index_[slot] != empty_) ? &arena_[index_[slot]].value : nullptr;
+}
+
+template <typename K, typename V>
+template <typename F>
+void RetentionStore<K, V>::ForEach(F f) const {
+  // values are inserted at `head_`, so the oldest one is the next live one from there
+  for (std::size_t i = 0; i < arena_.size(); ++i) {
+    const Entry& entry = arena_[(head_ + i) % arena_.size()];
+    if (entry.live) f(entry.key, entry.value);
+  }
+}
+
+template <typename K, typename V>
+std::size_t RetentionStore<K, V>::Size() const {
+  return size_;
+}
+
+template <typename K, typename V>
+std::size_t RetentionStore<K, V>::Capacity() const {
+  return arena_.size();
+}
+
+template <typename K, typename V>
+long RetentionStore<K, V>::GetEvictedCount() const {
+  return evicted_;
+}
+
+#endif // !RETENTIONSTORE_HPP
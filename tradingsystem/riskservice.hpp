@@ -36,6 +36,9 @@ public:
   // Set the quantity
   void SetQuantity(const long& newQuantity);
 
+  // Set the PV01 value
+  void SetPV01(const double& newPV01);
+
 private:
   T product;
   double pv01;
@@ -124,11 +127,16 @@ void PV01<T>::SetQuantity(const long& newQuantity)
   quantity = newQuantity;
 }
 
+template <typename T>
+void PV01<T>::SetPV01(const double& newPV01)
+{
+  pv01 = newPV01;
+}
+
 template<typename T>
 BucketedSector<T>::BucketedSector(const vector<T>& _products, string _name) :
-  products(_products)
+  products(_products), name(std::move(_name))
 {
-  name = _name;
 }
 
 template<typename T>
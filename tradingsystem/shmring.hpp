@@ -0,0 +1,276 @@
+/**
+* shmring.hpp
+*
+* Broadcast ring buffer in POSIX shared memory: one writer process, any number
+* of reader processes, each reading at its own pace
+*
+* @author: Gabo Bernardino
+*/
+
+#ifndef SHMRING_HPP
+#define SHMRING_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+* Layout of the shared memory segment: a header, then `capacity` slots.
+* Each slot carries a version, a per-slot seqlock: 2n+1 while message n is
+* being written, 2n+2 once it is complete. Readers check the version before and
+* after copying a message, so they never need to lock, and the writer never
+* waits for them.
+*/
+template <typename T>
+struct ShmRingLayout {
+  static_assert(std::is_trivially_copyable<T>::value, "shared memory messages must be trivially copyable");
+  static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "the ring needs lock-free 64-bit atomics");
+
+  static constexpr std::uint64_t magic_ = 0x4D54483938313552ULL;
+
+  struct Header {
+    std::uint64_t magic;
+    std::uint64_t capacity;
+    std::uint64_t slotSize;
+    alignas(64) std::atomic<std::uint64_t> published;  // number of messages written so far
+    std::atomic<std::uint32_t> closed;  // the writer will not publish anymore
+  };
+
+  struct alignas(64) Slot {
+    std::atomic<std::uint64_t> version;
+    T message;
+  };
+
+  static std::size_t Bytes(std::uint64_t capacity) {
+    return sizeof(Header) + capacity * sizeof(Slot);
+  }
+};
+
+/**
+* Writer side of the ring - creates the segment, replacing any previous one with that name
+* When the ring is full the oldest messages are overwritten: readers that fell
+* more than `capacity` messages behind skip ahead and count what they lost.
+*/
+template <typename T>
+class ShmRingWriter {
+private:
+  typedef ShmRingLayout<T> Layout;
+
+  std::string name_;
+  std::size_t bytes_;
+  void* mapped_;
+  typename Layout::Header* header_;
+  typename Layout::Slot* slots_;
+  std::uint64_t mask_;
+  std::uint64_t next_;
+
+public:
+  // ctor - capacity is rounded up to a power of two; name follows shm_open, e.g. "/feed"
+  ShmRingWriter(const std::string& _name, std::size_t _capacity);
+  ~ShmRingWriter();
+
+  ShmRingWriter(const ShmRingWriter&) = delete;
+  ShmRingWriter& operator=(const ShmRingWriter&) = delete;
+
+  // Publish a message to every reader
+  void Publish(const T& message);
+
+  // Tell the readers the stream is over
+  void Close();
+
+  // Remove the segment name; mapped readers keep their view
+  void Unlink();
+
+  std::uint64_t GetPublishedCount() const;
+};
+
+/**
+* Reader side of the ring - opens an existing segment
+* Every reader has its own cursor, so readers never slow each other or the writer down.
+*/
+template <typename T>
+class ShmRingReader {
+private:
+  typedef ShmRingLayout<T> Layout;
+
+  std::size_t bytes_;
+  void* mapped_;
+  typename Layout::Header* header_;
+  typename Layout::Slot* slots_;
+  std::uint64_t capacity_;
+  std::uint64_t mask_;
+  std::uint64_t cursor_;  // next message to read
+  std::uint64_t lost_;
+
+public:
+  // ctor - starts with the next message published, or with the oldest one still in the ring
+  // Throws if the segment does not exist (yet) or was not created for messages of type T
+  ShmRingReader(const std::string& _name, bool _fromOldest = false);
+  ~ShmRingReader();
+
+  ShmRingReader(const ShmRingReader&) = delete;
+  ShmRingReader& operator=(const ShmRingReader&) = delete;
+
+  // Copy the next message out - false if there is none yet
+  bool Poll(T& message);
+
+  // Has the writer closed the ring, and has this reader read everything?
+  bool Finished() const;
+
+  // Messages overwritten before this reader got to them
+  std::uint64_t GetLostCount() const;
+};
+
+//*************************************************************************************************
+// ShmRingWriter implementations
+//*************************************************************************************************
+template <typename T>
+ShmRingWriter<T>::ShmRingWriter(const std::string& _name, std::size_t _capacity) :
+  name_(_name), mapped_(MAP_FAILED), next_(0)
+{
+  std::uint64_t capacity = 2;
+  while (capacity < _capacity) capacity <<= 1;
+  mask_ = capacity - 1;
+  bytes_ = Layout::Bytes(capacity);
+
+  // start from a fresh segment: readers of a previous run keep the old one
+  shm_unlink(name_.c_str());
+  int fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (fd < 0) throw std::runtime_error("cannot create shared memory " + name_);
+  if (ftruncate(fd, static_cast<off_t>(bytes_)) < 0) {
+    close(fd);
+    throw std::runtime_error("cannot size shared memory " + name_);
+  }
+  mapped_ = mmap(nullptr, bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapped_ == MAP_FAILED) throw std::runtime_error("cannot map shared memory " + name_);
+
+  // the segment comes zero-filled: every slot is at version 0, i.e. never written
+  header_ = new (mapped_) typename Layout::Header();
+  header_->capacity = capacity;
+  header_->slotSize = sizeof(typename Layout::Slot);
+  slots_ = reinterpret_cast<typename Layout::Slot*>(static_cast<char*>(mapped_) + sizeof(typename Layout::Header));
+  header_->published.store(0, std::memory_order_relaxed);
+  header_->closed.store(0, std::memory_order_relaxed);
+  // readers check the magic last: publish it once the rest is in place
+  std::atomic_thread_fence(std::memory_order_release);
+  header_->magic = Layout::magic_;
+}
+
+template <typename T>
+ShmRingWriter<T>::~ShmRingWriter() {
+  if (mapped_ != MAP_FAILED) munmap(mapped_, bytes_);
+}
+
+template <typename T>
+void ShmRingWriter<T>::Publish(const T& message) {
+  typename Layout::Slot& slot = slots_[next_ & mask_];
+  slot.version.store(2 * next_ + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  std::memcpy(&slot.message, &message, sizeof(T));
+  slot.version.store(2 * next_ + 2, std::memory_order_release);
+  next_++;
+  header_->published.store(next_, std::memory_order_release);
+}
+
+template <typename T>
+void ShmRingWriter<T>::Close() {
+  header_->closed.store(1, std::memory_order_release);
+}
+
+template <typename T>
+void ShmRingWriter<T>::Unlink() {
+  shm_unlink(name_.c_str());
+}
+
+template <typename T>
+std::uint64_t ShmRingWriter<T>::GetPublishedCount() const {
+  return next_;
+}
+
+//*************************************************************************************************
+// ShmRingReader implementations
+//*************************************************************************************************
+template <typename T>
+ShmRingReader<T>::ShmRingReader(const std::string& _name, bool _fromOldest) :
+  mapped_(MAP_FAILED), lost_(0)
+{
+  int fd = shm_open(_name.c_str(), O_RDONLY, 0);
+  if (fd < 0) throw std::runtime_error("no shared memory " + _name);
+  struct stat info;
+  if (fstat(fd, &info) < 0 || static_cast<std::size_t>(info.st_size) < sizeof(typename Layout::Header)) {
+    close(fd);
+    throw std::runtime_error("shared memory " + _name + " is not ready");
+  }
+  bytes_ = static_cast<std::size_t>(info.st_size);
+  mapped_ = mmap(nullptr, bytes_, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapped_ == MAP_FAILED) throw std::runtime_error("cannot map shared memory " + _name);
+
+  header_ = static_cast<typename Layout::Header*>(mapped_);
+  if (header_->magic != Layout::magic_ || header_->slotSize != sizeof(typename Layout::Slot)
+    || Layout::Bytes(header_->capacity) > bytes_) {
+    munmap(mapped_, bytes_);
+    mapped_ = MAP_FAILED;
+    throw std::runtime_error("shared memory " + _name + " is not ready or holds other messages");
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+  capacity_ = header_->capacity;
+  mask_ = capacity_ - 1;
+  slots_ = reinterpret_cast<typename Layout::Slot*>(static_cast<char*>(mapped_) + sizeof(typename Layout::Header));
+
+  std::uint64_t published = header_->published.load(std::memory_order_acquire);
+  cursor_ = (_fromOldest && published > capacity_) ? published - capacity_ : (_fromOldest ? 0 : published);
+}
+
+template <typename T>
+ShmRingReader<T>::~ShmRingReader() {
+  if (mapped_ != MAP_FAILED) munmap(mapped_, bytes_);
+}
+
+template <typename T>
+bool ShmRingReader<T>::Poll(T& message) {
+  const typename Layout::Slot& slot = slots_[cursor_ & mask_];
+  std::uint64_t expected = 2 * cursor_ + 2;
+
+  std::uint64_t before = slot.version.load(std::memory_order_acquire);
+  if (before < expected) return false;  // not written yet, or being written
+  if (before == expected) {
+    std::memcpy(&message, &slot.message, sizeof(T));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.version.load(std::memory_order_relaxed) == expected) {
+      cursor_++;
+      return true;
+    }
+  }
+
+  // the writer lapped us: jump to the middle of what is still in the ring
+  std::uint64_t published = header_->published.load(std::memory_order_acquire);
+  std::uint64_t resume = published - capacity_ / 2;
+  if (resume > cursor_) {
+    lost_ += resume - cursor_;
+    cursor_ = resume;
+  }
+  return false;
+}
+
+template <typename T>
+bool ShmRingReader<T>::Finished() const {
+  return header_->closed.load(std::memory_order_acquire) != 0
+    && cursor_ >= header_->published.load(std::memory_order_acquire);
+}
+
+template <typename T>
+std::uint64_t ShmRingReader<T>::GetLostCount() const {
+  return lost_;
+}
+
+#endif // !SHMRING_HPP
@@ -0,0 +1,256 @@
+/**
+* snapshot.hpp
+*
+* Binary snapshot files: tagged sections of plain values, checked by a CRC and
+* replaced atomically
+*
+* @author: Gabo Bernardino
+*/
+
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <fcntl.h>
+#include <unistd.h>
+
+/**
+* Layout: magic, then sections (u32 tag, u64 length, `length` bytes), then the
+* CRC-32 of everything before it. Values are stored as their bytes: a snapshot
+* is read back by the same build on the same host, it is not an exchange format.
+*/
+const std::uint64_t snapshotMagic = 0x3150414E5348544DULL;  // "MTHSNAP1"
+
+// CRC-32 (IEEE), table built once
+std::uint32_t SnapshotCrc(const char* data, std::size_t length) {
+  static const std::array<std::uint32_t, 256> table = []() {
+    std::array<std::uint32_t, 256> t{};
+    for (std::uint32_t i = 0; i < 256; ++i) {
+      std::uint32_t c = i;
+      for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320U ^ (c >> 1) : c >> 1;
+      t[i] = c;
+    }
+    return t;
+  }();
+  std::uint32_t crc = 0xFFFFFFFFU;
+  for (std::size_t i = 0; i < length; ++i) crc = table[(crc ^ static_cast<unsigned char>(data[i])) & 0xFF] ^ (crc >> 8);
+  return crc ^ 0xFFFFFFFFU;
+}
+
+/**
+* Snapshot writer
+* Builds the snapshot in memory; Commit writes it next to the target, syncs it,
+* renames it over the target and syncs the directory, so a crash leaves either
+* the old or the new snapshot, and a snapshot committed stays there.
+*/
+class SnapshotWriter {
+private:
+  std::string data_;
+  std::size_t section_;  // offset of the length of the open section, 0 if none
+
+  // Write the length of the open section
+  void _closeSection();
+
+  // Write all of `length` bytes, whatever write(2) takes each time - false on error
+  static bool _writeAll(int fd, const char* data, std::size_t length);
+
+  // Sync the directory holding `path`, so a rename into it survives a crash
+  static bool _syncDirectory(const std::string& path);
+
+public:
+  // ctor
+  SnapshotWriter();
+
+  // Open a section - sections are closed by the next one or by Commit
+  void BeginSection(std::uint32_t tag);
+
+  // Append a trivially copyable value
+  template <typename T>
+  void Put(const T& value);
+
+  void PutString(const std::string& value);
+
+  // Write the snapshot to `path`; returns its size in bytes
+  std::size_t Commit(const std::string& path);
+};
+
+/**
+* Snapshot reader
+* Loads a whole snapshot and checks it; values are read back section by section,
+* in the order they were written.
+*/
+class SnapshotReader {
+private:
+  std::string data_;
+  std::size_t cursor_;
+  std::size_t sectionEnd_;
+
+public:
+  // ctor - throws if the file is missing, truncated or corrupt
+  SnapshotReader(const std::string& path);
+
+  // Move to a section - false if the snapshot has none with this tag
+  bool FindSection(std::uint32_t tag);
+
+  // Is there anything left in the current section?
+  bool More() const;
+
+  template <typename T>
+  T Get();
+
+  std::string GetString();
+
+  std::size_t GetSize() const;
+};
+
+//*************************************************************************************************
+// SnapshotWriter implementations
+//*************************************************************************************************
+SnapshotWriter::SnapshotWriter() :
+  section_(0)
+{
+  Put(snapshotMagic);
+}
+
+void SnapshotWriter::_closeSection() {
+  if (section_ == 0) return;
+  std::uint64_t length = data_.size() - section_ - sizeof(std::uint64_t);
+  std::memcpy(&data_[section_], &length, sizeof(length));
+  section_ = 0;
+}
+
+void SnapshotWriter::BeginSection(std::uint32_t tag) {
+  _closeSection();
+  Put(tag);
+  section_ = data_.size();
+  Put(std::uint64_t(0));  // patched once the section is complete
+}
+
+template <typename T>
+void SnapshotWriter::Put(const T& value) {
+  static_assert(std::is_trivially_copyable<T>::value, "snapshot values must be trivially copyable");
+  data_.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void SnapshotWriter::PutString(const std::string& value) {
+  Put(static_cast<std::uint64_t>(value.size()));
+  data_.append(value);
+}
+
+bool SnapshotWriter::_writeAll(int fd, const char* data, std::size_t length) {
+  std::size_t done = 0;
+  while (done < length) {
+    ssize_t n = write(fd, data + done, length - done);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    done += static_cast<std::size_t>(n);
+  }
+  return true;
+}
+
+bool SnapshotWriter::_syncDirectory(const std::string& path) {
+  std::size_t slash = path.find_last_of('/');
+  std::string directory = (slash == std::string::npos) ? "." : (slash == 0) ? "/" : path.substr(0, slash);
+  int fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0) return false;
+  bool ok = fsync(fd) == 0;
+  close(fd);
+  return ok;
+}
+
+std::size_t SnapshotWriter::Commit(const std::string& path) {
+  _closeSection();
+  std::uint32_t crc = SnapshotCrc(data_.data(), data_.size());
+  std::string temporary = path + ".tmp";
+
+  int fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) throw std::runtime_error("cannot write snapshot " + temporary);
+  bool ok = _writeAll(fd, data_.data(), data_.size())
+    && _writeAll(fd, reinterpret_cast<const char*>(&crc), sizeof(crc))
+    && fsync(fd) == 0;
+  close(fd);
+  if (!ok || std::rename(temporary.c_str(), path.c_str()) != 0) {
+    std::remove(temporary.c_str());
+    throw std::runtime_error("cannot write snapshot " + path);
+  }
+  // the new name is only durable once the directory entry is
+  if (!_syncDirectory(path)) throw std::runtime_error("cannot sync the directory of snapshot " + path);
+  return data_.size() + sizeof(crc);
+}
+
+//*************************************************************************************************
+// SnapshotReader implementations
+//*************************************************************************************************
+SnapshotReader::SnapshotReader(const std::string& path) :
+  cursor_(0), sectionEnd_(0)
+{
+  std::ifstream in(path, std::ios::binary);
+  if (!in) throw std::runtime_error("no snapshot " + path);
+  data_.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+
+  std::uint64_t magic;
+  std::uint32_t crc;
+  if (data_.size() < sizeof(magic) + sizeof(crc)) throw std::runtime_error("truncated snapshot " + path);
+  std::memcpy(&magic, data_.data(), sizeof(magic));
+  std::memcpy(&crc, data_.data() + data_.size() - sizeof(crc), sizeof(crc));
+  data_.resize(data_.size() - sizeof(crc));
+  if (magic != snapshotMagic || crc != SnapshotCrc(data_.data(), data_.size())) {
+    throw std::runtime_error("corrupt snapshot " + path);
+  }
+}
+
+bool SnapshotReader::FindSection(std::uint32_t tag) {
+  std::size_t position = sizeof(snapshotMagic);
+  while (position + sizeof(std::uint32_t) + sizeof(std::uint64_t) <= data_.size()) {
+    std::uint32_t current;
+    std::uint64_t length;
+    std::memcpy(&current, data_.data() + position, sizeof(current));
+    std::memcpy(&length, data_.data() + position + sizeof(current), sizeof(length));
+    position += sizeof(current) + sizeof(length);
+    if (length > data_.size() - position) throw std::runtime_error("corrupt snapshot section");
+    if (current == tag) {
+      cursor_ = position;
+      sectionEnd_ = position + length;
+      return true;
+    }
+    position += length;
+  }
+  return false;
+}
+
+bool SnapshotReader::More() const {
+  return cursor_ < sectionEnd_;
+}
+
+template <typename T>
+T SnapshotReader::Get() {
+  static_assert(std::is_trivially_copyable<T>::value, "snapshot values must be trivially copyable");
+  if (cursor_ + sizeof(T) > sectionEnd_) throw std::runtime_error("snapshot section too short");
+  T value;
+  std::memcpy(&value, data_.data() + cursor_, sizeof(T));
+  cursor_ += sizeof(T);
+  return value;
+}
+
+std::string SnapshotReader::GetString() {
+  std::uint64_t length = Get<std::uint64_t>();
+  if (length > sectionEnd_ - cursor_) throw std::runtime_error("snapshot section too short");
+  std::string value(data_.data() + cursor_, length);
+  cursor_ += length;
+  return value;
+}
+
+std::size_t SnapshotReader::GetSize() const {
+  return data_.size();
+}
+
+#endif // !SNAPSHOT_HPP
@@ -0,0 +1,89 @@
+/**
+* spscqueue.hpp
+*
+* Bounded lock-free queue for one producer thread and one consumer thread
+*
+* @author: Gabo Bernardino
+*/
+
+#ifndef SPSCQUEUE_HPP
+#define SPSCQUEUE_HPP
+
+#include <atomic>
+#include <vector>
+#include <thread>
+#include <utility>
+
+/**
+* Single-producer single-consumer ring buffer.
+* Capacity is rounded up to a power of two; head and tail are kept on
+* separate cache lines so producer and consumer do not false-share.
+*/
+template <typename T>
+class SpscQueue {
+private:
+  std::vector<T> slots_;
+  std::size_t mask_;
+  alignas(64) std::atomic<std::size_t> head_;  // next slot to pop (consumer)
+  alignas(64) std::atomic<std::size_t> tail_;  // next slot to push (producer)
+
+public:
+  // ctor
+  SpscQueue(std::size_t _capacity);
+
+  // Push an item - false if the queue is full
+  bool TryPush(const T& item);
+
+  // Push an item, yielding while the queue is full
+  void Push(const T& item);
+
+  // Pop an item - false if the queue is empty
+  bool TryPop(T& item);
+
+  bool Empty() const;
+};
+
+//*************************************************************************************************
+// SpscQueue implementations
+//*************************************************************************************************
+template <typename T>
+SpscQueue<T>::SpscQueue(std::size_t _capacity) :
+  head_(0), tail_(0)
+{
+  std::size_t size = 2;
+  while (size < _capacity) size <<= 1;
+  slots_.resize(size);
+  mask_ = size - 1;
+}
+
+template <typename T>
+bool SpscQueue<T>::TryPush(const T& item) {
+  std::size_t tail = tail_.load(std::memory_order_relaxed);
+  if (tail - head_.load(std::memory_order_acquire) == slots_.size()) return false;
+
+  slots_[tail & mask_] = item;
+  tail_.store(tail + 1, std::memory_order_release);
+  return true;
+}
+
+template <typename T>
+void SpscQueue<T>::Push(const T& item) {
+  while (!TryPush(item)) std::this_thread::yield();
+}
+
+template <typename T>
+bool SpscQueue<T>::TryPop(T& item) {
+  std::size_t head = head_.load(std::memory_order_relaxed);
+  if (head == tail_.load(std::memory_order_acquire)) return false;
+
+  item = std::move(slots_[head & mask_]);
+  head_.store(head + 1, std::memory_order_release);
+  return true;
+}
+
+template <typename T>
+bool SpscQueue<T>::Empty() const {
+  return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+}
+
+#endif // !SPSCQUEUE_HPP
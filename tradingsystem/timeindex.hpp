@@ -0,0 +1,330 @@
+/**
+* timeindex.hpp
+*
+* Sparse time index of a historical file, written next to it, and point-in-time
+* lookups over the memory-mapped file and index
+*
+* @author: Gabo Bernardino
+*/
+
+#ifndef TIMEINDEX_HPP
+#define TIMEINDEX_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "framecodec.hpp"
+
+/**
+* The index of `file` is `file.idx`: fixed-size entries in the order of the file,
+* each with the time of a record, the key that follows the time (product, sector
+* or inquiry id) and the offset of the record in the file. A key is indexed on
+* its first record and then every `every` records of its own. A key longer than
+* the entry holds is never cut, which would mix it up with another: it is left
+* out of the index, and its lookups scan the whole file.
+*
+* Times are the record timestamps "YYYY-MM-DD hh:mm:ss.mmm" read as the number
+* YYYYMMDDhhmmssmmm, which orders like the text and needs no time zone.
+*/
+struct TimeIndexEntry {
+  std::int64_t time;
+  std::uint64_t offset;
+  char key[32];  // zero-padded, fits every id of the system
+};
+
+const char* const timeIndexSuffix = ".idx";
+
+// Time of a record's timestamp - -1 if the text does not start with one
+std::int64_t ParseIndexTime(const char* begin, const char* end) {
+  static const char layout[] = "0000-00-00 00:00:00.000";
+  const std::size_t length = sizeof(layout) - 1;
+  if (end - begin < static_cast<std::ptrdiff_t>(length)) return -1;
+  std::int64_t time = 0;
+  for (std::size_t i = 0; i < length; ++i) {
+    if (layout[i] == '0') {
+      if (begin[i] < '0' || begin[i] > '9') return -1;
+      time = time * 10 + (begin[i] - '0');
+    }
+    else if (begin[i] != layout[i]) return -1;
+  }
+  return time;
+}
+
+/**
+* Time indexer
+* Follows the records appended to a file and picks those that go in its index
+*/
+class TimeIndexer {
+private:
+  std::size_t every_;
+  std::unordered_map<std::string, std::size_t> counts_;  // records seen by key
+  std::uint64_t offset_;  // where the next record starts
+  bool started_;
+  std::string path_;
+  std::size_t unindexed_;  // records of keys too long for an entry
+
+public:
+  // ctor - index every `_every` records of a key
+  TimeIndexer(std::size_t _every = 64);
+
+  // Follow the file at `path`, whose content is `size` bytes long - an empty file starts a new index
+  void Start(const std::string& path, std::uint64_t size);
+  bool IsStarted() const;
+
+  // Account for a record about to be appended to the file
+  // Returns true, with the entry filled, when the record goes in the index
+  bool Add(const std::string& record, TimeIndexEntry& entry);
+
+  // Records left out of the index because their key does not fit an entry
+  std::size_t GetUnindexedCount() const;
+};
+
+/**
+* Time-indexed file
+* Maps a historical file and its index, and lists the entries of each key once.
+* A lookup binary-searches the entries of the key for the last one at or before
+* the time, then reads the lines of the file from there until the time is passed,
+* so it reads about `every` records of the key whatever the size of the file.
+* A compressed file is read frame by frame, from the frame holding the entry.
+*/
+class TimeIndexedFile {
+private:
+  struct Frame {
+    std::uint64_t offset;  // in the uncompressed content
+    std::size_t position;  // in the file
+    std::uint32_t rawLength;
+    std::uint32_t blockLength;
+  };
+
+  const char* data_;
+  std::size_t size_;
+  const TimeIndexEntry* entries_;
+  std::size_t count_;
+  std::size_t indexBytes_;
+  std::vector<Frame> frames_;  // empty for a plain file
+  std::unordered_map<std::string, std::vector<const TimeIndexEntry*>> byKey_;  // entries of each key, in time order
+
+  static const char* _map(const std::string& path, std::size_t& size);
+
+  // Keep in `found` the last line of `key` at or before `time` in [begin, end)
+  // Returns true once a line is past the time
+  static bool _scan(const char* begin, const char* end, const std::string& key, std::int64_t time, std::string& found);
+
+  // Decode a frame - throws if it is corrupt
+  void _decode(const Frame& frame, std::string& out) const;
+
+  // Keep in `found` the last line of `key` at or before `time`, reading from `offset` in the content
+  void _scanFrom(std::uint64_t offset, const std::string& key, std::int64_t time, std::string& found) const;
+
+public:
+  // ctor - throws if the file or its index cannot be mapped
+  TimeIndexedFile(const std::string& path);
+  ~TimeIndexedFile();
+
+  TimeIndexedFile(const TimeIndexedFile&) = delete;
+  TimeIndexedFile& operator=(const TimeIndexedFile&) = delete;
+
+  // Last line of `key` with a time at or before `time` - empty if there is none
+  std::string Find(const std::string& key, std::int64_t time) const;
+
+  // Time of the first record - -1 if the file is empty
+  std::int64_t GetFirstTime() const;
+
+  std::size_t GetEntryCount() const;
+  std::size_t GetFileSize() const;
+
+  // Frames of a compressed file - 0 for a plain file
+  std::size_t GetFrameCount() const;
+};
+
+//*************************************************************************************************
+// TimeIndexer implementations
+//*************************************************************************************************
+TimeIndexer::TimeIndexer(std::size_t _every) :
+  every_(std::max<std::size_t>(_every, 1)), offset_(0), started_(false), unindexed_(0) {}
+
+void TimeIndexer::Start(const std::string& path, std::uint64_t size) {
+  // the file is appended to: offsets start from its current size
+  offset_ = size;
+  path_ = path;
+  if (offset_ == 0) std::ofstream(path + timeIndexSuffix, std::ios::trunc);
+  started_ = true;
+}
+
+bool TimeIndexer::IsStarted() const {
+  return started_;
+}
+
+bool TimeIndexer::Add(const std::string& record, TimeIndexEntry& entry) {
+  std::uint64_t offset = offset_;
+  offset_ += record.size();
+
+  std::int64_t time = ParseIndexTime(record.data(), record.data() + record.size());
+  if (time < 0) return false;
+  std::size_t begin = record.find(',');
+  std::size_t end = record.find_first_of(",\n", begin + 1);
+  if (begin == std::string::npos || end == std::string::npos) return false;
+  std::string key = record.substr(begin + 1, end - begin - 1);
+  if (key.size() > sizeof(entry.key)) {
+    if (unindexed_++ == 0) {
+      std::cout << "An error occurred: key " << key << " is longer than the " << sizeof(entry.key)
+        << " characters of the time index of " << path_ << ", its lookups will scan the file" << std::endl;
+    }
+    return false;
+  }
+
+  if (counts_[key]++ % every_ != 0) return false;
+  entry.time = time;
+  entry.offset = offset;
+  std::memset(entry.key, 0, sizeof(entry.key));
+  std::memcpy(entry.key, key.data(), key.size());
+  return true;
+}
+
+std::size_t TimeIndexer::GetUnindexedCount() const {
+  return unindexed_;
+}
+
+//*************************************************************************************************
+// TimeIndexedFile implementations
+//*************************************************************************************************
+const char* TimeIndexedFile::_map(const std::string& path, std::size_t& size) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  struct stat info;
+  if (fd < 0 || fstat(fd, &info) < 0) {
+    if (fd >= 0) close(fd);
+    throw std::runtime_error("cannot open " + path);
+  }
+  size = static_cast<std::size_t>(info.st_size);
+  void* map = (size > 0) ? mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0) : nullptr;
+  close(fd);
+  if (map == MAP_FAILED) throw std::runtime_error("cannot map " + path);
+  return static_cast<const char*>(map);
+}
+
+TimeIndexedFile::TimeIndexedFile(const std::string& path) {
+  data_ = _map(path, size_);
+  try {
+    entries_ = reinterpret_cast<const TimeIndexEntry*>(_map(path + timeIndexSuffix, indexBytes_));
+  }
+  catch (...) {
+    if (data_ != nullptr) munmap(const_cast<char*>(data_), size_);
+    throw;
+  }
+  count_ = indexBytes_ / sizeof(TimeIndexEntry);  // an entry cut by a crash is left out
+  for (const TimeIndexEntry* entry = entries_; entry != entries_ + count_; ++entry) {
+    byKey_[std::string(entry->key, strnlen(entry->key, sizeof(entry->key)))].push_back(entry);
+  }
+
+  // a compressed file: list its frames, leaving out one cut by a crash
+  std::size_t position = 0;
+  Frame frame;
+  while (size_ - position >= frameHeaderSize
+    && FrameHeader(data_ + position, frame.rawLength, frame.blockLength, frame.offset)
+    && size_ - position - frameHeaderSize >= frame.blockLength) {
+    frame.position = position;
+    frames_.push_back(frame);
+    position += frameHeaderSize + frame.blockLength;
+  }
+}
+
+TimeIndexedFile::~TimeIndexedFile() {
+  if (data_ != nullptr) munmap(const_cast<char*>(data_), size_);
+  if (entries_ != nullptr) munmap(const_cast<TimeIndexEntry*>(entries_), indexBytes_);
+}
+
+bool TimeIndexedFile::_scan(const char* begin, const char* end, const std::string& key, std::int64_t time, std::string& found) {
+  for (const char* line = begin; line < end;) {
+    const char* next = static_cast<const char*>(std::memchr(line, '\n', end - line));
+    next = (next == nullptr) ? end : next + 1;
+    std::int64_t line_time = ParseIndexTime(line, next);
+    if (line_time > time) return true;
+    const char* field = static_cast<const char*>(std::memchr(line, ',', next - line));
+    if (line_time >= 0 && field != nullptr) {
+      field++;
+      const char* field_end = static_cast<const char*>(std::memchr(field, ',', next - field));
+      if (field_end != nullptr && std::string_view(field, field_end - field) == key) {
+        found.assign(line, (next[-1] == '\n') ? next - line - 1 : next - line);
+      }
+    }
+    line = next;
+  }
+  return false;
+}
+
+void TimeIndexedFile::_decode(const Frame& frame, std::string& out) const {
+  if (!FrameIntact(data_ + frame.position, frame.blockLength) || !FrameDecode(data_ + frame.position + frameHeaderSize, frame.blockLength, frame.rawLength, out)) {
+    throw std::runtime_error("corrupt frame at " + std::to_string(frame.position));
+  }
+}
+
+void TimeIndexedFile::_scanFrom(std::uint64_t offset, const std::string& key, std::int64_t time, std::string& found) const {
+  if (frames_.empty()) {
+    _scan(data_ + std::min<std::uint64_t>(offset, size_), data_ + size_, key, time, found);
+    return;
+  }
+  auto frame = std::upper_bound(frames_.begin(), frames_.end(), offset,
+    [](std::uint64_t o, const Frame& f) { return o < f.offset; });
+  if (frame == frames_.begin()) return;
+  --frame;
+  std::string raw;
+  for (std::uint64_t skip = offset - frame->offset; frame != frames_.end(); ++frame, skip = 0) {
+    _decode(*frame, raw);
+    if (_scan(raw.data() + std::min<std::uint64_t>(skip, raw.size()), raw.data() + raw.size(), key, time, found)) break;
+  }
+}
+
+std::string TimeIndexedFile::Find(const std::string& key, std::int64_t time) const {
+  std::string found;
+
+  // a key too long for the index was never indexed: read the whole file
+  if (key.size() > sizeof(TimeIndexEntry::key)) {
+    _scanFrom(0, key, time, found);
+    return found;
+  }
+
+  // last entry of the key at or before the time - a key is indexed from its first record
+  auto it = byKey_.find(key);
+  if (it == byKey_.end()) return found;
+  const std::vector<const TimeIndexEntry*>& entries = it->second;
+  auto entry = std::upper_bound(entries.begin(), entries.end(), time,
+    [](std::int64_t t, const TimeIndexEntry* e) { return t < e->time; });
+  if (entry == entries.begin()) return found;
+  --entry;
+
+  // then the lines of the file from it, until the time is passed
+  _scanFrom((*entry)->offset, key, time, found);
+  return found;
+}
+
+std::int64_t TimeIndexedFile::GetFirstTime() const {
+  if (frames_.empty()) return ParseIndexTime(data_, data_ + size_);
+  std::string raw;
+  _decode(frames_.front(), raw);
+  return ParseIndexTime(raw.data(), raw.data() + raw.size());
+}
+
+std::size_t TimeIndexedFile::GetEntryCount() const {
+  return count_;
+}
+
+std::size_t TimeIndexedFile::GetFileSize() const {
+  return size_;
+}
+
+std::size_t TimeIndexedFile::GetFrameCount() const {
+  return frames_.size();
+}
+
+#endif // !TIMEINDEX_HPP
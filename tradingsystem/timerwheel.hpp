@@ -0,0 +1,463 @@
+/**
+* timerwheel.hpp
+*
+* Clocks, a hierarchical timer wheel and the timer service that drives it,
+* for throttles, heartbeats, timeouts and periodic flushes
+*
+* @author: Gabo Bernardino
+*/
+
+#ifndef TIMERWHEEL_HPP
+#define TIMERWHEEL_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "soa.hpp"
+
+/**
+* Source of time for the timers, in microseconds
+*/
+class Clock {
+public:
+  virtual ~Clock() = default;
+  virtual std::int64_t NowMicros() const = 0;
+};
+
+/**
+* Wall clock - monotonic time of the machine
+*/
+class WallClock : public Clock {
+public:
+  virtual std::int64_t NowMicros() const override;
+};
+
+/**
+* Replay clock - time only moves when the replay sets it
+* (e.g. from the timestamps of the data being replayed)
+*/
+class ReplayClock : public Clock {
+private:
+  std::atomic<std::int64_t> now_;
+
+public:
+  // ctor
+  ReplayClock(std::int64_t start_micros = 0);
+
+  virtual std::int64_t NowMicros() const override;
+
+  // Move the clock to a time - never backwards
+  void Set(std::int64_t micros);
+  void Advance(std::int64_t micros);
+};
+
+typedef std::uint64_t TimerId;
+
+/**
+* Hierarchical timer wheel
+* Four levels of 256 slots: level 0 has one slot per tick, each slot of level k
+* spans 256^k ticks. A timer is placed on the level matching how far away it
+* is and cascades down as time gets closer, so schedule and cancel are O(1)
+* and advancing costs O(1) per tick plus the timers that fire; stretches
+* of ticks with nothing due on the lower levels are skipped.
+*
+* Timers sit in intrusive doubly-linked lists over a node pool; a TimerId
+* carries the node's generation, so cancelling a fired or stale id is a no-op.
+* Callbacks may schedule and cancel timers, including their own.
+*
+* Not thread safe: see TimerService.
+*/
+class TimerWheel {
+private:
+  static constexpr int levels_ = 4;
+  static constexpr int bits_ = 8;
+  static constexpr std::uint32_t slots_ = 1 << bits_;
+  static constexpr std::uint32_t nil_ = 0xFFFFFFFF;
+
+  struct Node {
+    std::function<void()> callback;
+    std::uint64_t expiry = 0;  // in ticks
+    std::uint64_t period = 0;  // in ticks, 0 for one-shot timers
+    std::uint32_t prev = nil_, next = nil_;
+    std::uint32_t generation = 0;
+    int level = -1, slot = -1;  // where the node is linked, -1 if not linked
+    bool live = false;
+  };
+
+  std::deque<Node> nodes_;  // deque: nodes never move, callbacks can run in place
+  std::vector<std::uint32_t> free_;
+  std::uint32_t heads_[levels_][slots_];
+  std::size_t linked_[levels_];  // timers linked on each level
+  std::uint64_t current_;  // current tick
+  std::size_t count_;  // live timers
+
+  void _link(std::uint32_t index);
+  void _unlink(std::uint32_t index);
+  void _release(std::uint32_t index);
+  // move the timers of a higher level slot down to where they belong now
+  void _cascade(int level);
+
+public:
+  // ctor - starts at the given tick
+  TimerWheel(std::uint64_t start_tick = 0);
+
+  // Call back in `delay` ticks (at least 1), then every `period` ticks if non zero
+  TimerId Schedule(std::uint64_t delay, std::function<void()> callback, std::uint64_t period = 0);
+
+  // Cancel a timer - false if it already fired or was cancelled
+  bool Cancel(TimerId id);
+
+  // Fire every timer due up to `tick` included
+  void Advance(std::uint64_t tick);
+
+  std::uint64_t GetCurrentTick() const;
+  std::size_t Size() const;
+};
+
+/**
+* Timer service
+* Wraps a timer wheel with a clock and a tick resolution, converting delays
+* to ticks. With a wall clock, Start runs a driver thread that advances the
+* wheel every tick; with a replay clock, the replay calls Poll after moving
+* the clock. Schedule and Cancel can be called from any thread, including
+* from callbacks; callbacks run on the driving thread.
+*/
+class TimerService {
+private:
+  const Clock& clock_;
+  std::chrono::microseconds resolution_;
+  std::int64_t origin_;  // clock time of tick 0
+  TimerWheel wheel_;
+  std::recursive_mutex mutex_;
+
+  std::thread driver_;
+  std::mutex driverMutex_;
+  std::condition_variable driverWake_;
+  bool running_;
+
+  std::uint64_t _ticks(std::chrono::microseconds delay) const;
+
+public:
+  // ctor
+  TimerService(const Clock& _clock, std::chrono::microseconds _resolution = std::chrono::milliseconds(1));
+  ~TimerService();
+
+  // Call back after `delay`, then every `period` if non zero
+  TimerId Schedule(std::chrono::microseconds delay, std::function<void()> callback,
+    std::chrono::microseconds period = std::chrono::microseconds(0));
+
+  // Cancel a timer; once this returns, its callback is not running and will not run
+  bool Cancel(TimerId id);
+
+  // Fire the timers due at the clock's current time
+  void Poll();
+
+  // Start / stop the driver thread
+  void Start();
+  void Stop();
+
+  const Clock& GetClock() const;
+};
+
+/**
+* Replay driver
+* Listener moving a replay clock a fixed step for every event it hears, then
+* firing the timers due, so that the timers follow the data being replayed
+* rather than the machine: a replay gives the same refreshes however fast it runs.
+* Type V is the data type of the service it listens to.
+*/
+template <typename V>
+class ReplayDriver : public ServiceListener<V> {
+private:
+  ReplayClock& clock_;
+  TimerService& timers_;
+  std::int64_t step_;  // micros per event
+
+public:
+  // ctor
+  ReplayDriver(ReplayClock& _clock, TimerService& _timers, std::chrono::microseconds _step);
+
+  // Listener callback to process an add event to the Service
+  virtual void ProcessAdd(V& data) override;
+
+  // Listener callback to process a remove event to the Service
+  virtual void ProcessRemove(V& data) override;
+
+  // Listener callback to process an update event to the Service
+  virtual void ProcessUpdate(V& data) override;
+};
+
+//*************************************************************************************************
+// Clock implementations
+//*************************************************************************************************
+std::int64_t WallClock::NowMicros() const {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+ReplayClock::ReplayClock(std::int64_t start_micros) :
+  now_(start_micros) {}
+
+std::int64_t ReplayClock::NowMicros() const {
+  return now_.load(std::memory_order_acquire);
+}
+
+void ReplayClock::Set(std::int64_t micros) {
+  std::int64_t now = now_.load(std::memory_order_relaxed);
+  while (micros > now && !now_.compare_exchange_weak(now, micros, std::memory_order_release));
+}
+
+void ReplayClock::Advance(std::int64_t micros) {
+  now_.fetch_add(micros, std::memory_order_release);
+}
+
+//*************************************************************************************************
+// TimerWheel implementations
+//*************************************************************************************************
+TimerWheel::TimerWheel(std::uint64_t start_tick) :
+  current_(start_tick), count_(0)
+{
+  for (int level = 0; level < levels_; ++level) {
+    for (std::uint32_t slot = 0; slot < slots_; ++slot) heads_[level][slot] = nil_;
+    linked_[level] = 0;
+  }
+}
+
+void TimerWheel::_link(std::uint32_t index) {
+  Node& node = nodes_[index];
+  std::uint64_t delta = (node.expiry > current_) ? node.expiry - current_ : 0;
+
+  // lowest level whose span covers the delay; the top level takes anything further
+  int level = 0;
+  while (level < levels_ - 1 && delta >= (std::uint64_t(1) << (bits_ * (level + 1)))) level++;
+  std::uint64_t when = (delta >> (bits_ * levels_) == 0) ? node.expiry
+    : current_ + (std::uint64_t(slots_ - 1) << (bits_ * (levels_ - 1)));  // re-placed when it cascades
+  int slot = static_cast<int>((when >> (bits_ * level)) & (slots_ - 1));
+
+  node.level = level;
+  node.slot = slot;
+  node.prev = nil_;
+  node.next = heads_[level][slot];
+  if (node.next != nil_) nodes_[node.next].prev = index;
+  heads_[level][slot] = index;
+  linked_[level]++;
+}
+
+void TimerWheel::_unlink(std::uint32_t index) {
+  Node& node = nodes_[index];
+  if (node.level < 0) return;
+  if (node.prev != nil_) nodes_[node.prev].next = node.next;
+  else heads_[node.level][node.slot] = node.next;
+  if (node.next != nil_) nodes_[node.next].prev = node.prev;
+  linked_[node.level]--;
+  node.prev = node.next = nil_;
+  node.level = node.slot = -1;
+}
+
+void TimerWheel::_release(std::uint32_t index) {
+  Node& node = nodes_[index];
+  node.live = false;
+  node.callback = nullptr;
+  node.generation++;
+  free_.push_back(index);
+  count_--;
+}
+
+void TimerWheel::_cascade(int level) {
+  int slot = static_cast<int>((current_ >> (bits_ * level)) & (slots_ - 1));
+  std::uint32_t index = heads_[level][slot];
+  heads_[level][slot] = nil_;
+  while (index != nil_) {
+    std::uint32_t next = nodes_[index].next;
+    linked_[level]--;
+    nodes_[index].level = -1;
+    _link(index);
+    index = next;
+  }
+}
+
+TimerId TimerWheel::Schedule(std::uint64_t delay, std::function<void()> callback, std::uint64_t period) {
+  std::uint32_t index;
+  if (!free_.empty()) {
+    index = free_.back();
+    free_.pop_back();
+  }
+  else {
+    index = static_cast<std::uint32_t>(nodes_.size());
+    nodes_.emplace_back();
+  }
+
+  Node& node = nodes_[index];
+  node.callback = std::move(callback);
+  node.expiry = current_ + ((delay == 0) ? 1 : delay);
+  node.period = period;
+  node.live = true;
+  count_++;
+  _link(index);
+
+  return (std::uint64_t(node.generation) << 32) | index;
+}
+
+bool TimerWheel::Cancel(TimerId id) {
+  std::uint32_t index = static_cast<std::uint32_t>(id & 0xFFFFFFFF);
+  std::uint32_t generation = static_cast<std::uint32_t>(id >> 32);
+  if (index >= nodes_.size()) return false;
+
+  Node& node = nodes_[index];
+  if (!node.live || node.generation != generation) return false;
+  if (node.level < 0) {
+    // cancelled from its own callback: the wheel releases it once the callback returns
+    node.period = 0;
+    node.live = false;
+    return true;
+  }
+  _unlink(index);
+  _release(index);
+  return true;
+}
+
+void TimerWheel::Advance(std::uint64_t tick) {
+  while (current_ < tick) {
+    if (count_ == 0) {
+      // nothing can fire: jump straight there
+      current_ = tick;
+      break;
+    }
+    // nothing linked below level k: skip to the tick before level k's next slot
+    int k = 0;
+    while (k < levels_ - 1 && linked_[k] == 0) k++;
+    if (k > 0) {
+      std::uint64_t skip_to = current_ | ((std::uint64_t(1) << (bits_ * k)) - 1);
+      if (skip_to >= tick) {
+        current_ = tick;
+        break;
+      }
+      current_ = skip_to;
+    }
+    current_++;
+
+    // on a wrap of a level, bring the next slot of the level above down
+    for (int level = 1; level < levels_; ++level) {
+      if ((current_ & ((std::uint64_t(1) << (bits_ * level)) - 1)) != 0) break;
+      _cascade(level);
+    }
+
+    std::uint32_t* head = &heads_[0][current_ & (slots_ - 1)];
+    while (*head != nil_) {
+      std::uint32_t index = *head;
+      _unlink(index);
+      Node& node = nodes_[index];
+      node.callback();  // nodes never move, so this is safe even if the callback schedules
+
+      if (node.live && node.period != 0) {
+        node.expiry = current_ + node.period;
+        _link(index);
+      }
+      else {
+        node.live = true;  // may have been cleared by a cancel from the callback
+        _release(index);
+      }
+    }
+  }
+}
+
+std::uint64_t TimerWheel::GetCurrentTick() const {
+  return current_;
+}
+
+std::size_t TimerWheel::Size() const {
+  return count_;
+}
+
+//*************************************************************************************************
+// TimerService implementations
+//*************************************************************************************************
+TimerService::TimerService(const Clock& _clock, std::chrono::microseconds _resolution) :
+  clock_(_clock), resolution_(_resolution), origin_(_clock.NowMicros()), wheel_(0), running_(false) {}
+
+TimerService::~TimerService() {
+  Stop();
+}
+
+std::uint64_t TimerService::_ticks(std::chrono::microseconds delay) const {
+  // round up: a timer never fires early
+  return (delay.count() + resolution_.count() - 1) / resolution_.count();
+}
+
+TimerId TimerService::Schedule(std::chrono::microseconds delay, std::function<void()> callback,
+  std::chrono::microseconds period) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  return wheel_.Schedule(_ticks(delay), std::move(callback), _ticks(period));
+}
+
+bool TimerService::Cancel(TimerId id) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  return wheel_.Cancel(id);
+}
+
+void TimerService::Poll() {
+  std::int64_t elapsed = clock_.NowMicros() - origin_;
+  if (elapsed < 0) return;
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  wheel_.Advance(static_cast<std::uint64_t>(elapsed / resolution_.count()));
+}
+
+void TimerService::Start() {
+  std::lock_guard<std::mutex> lock(driverMutex_);
+  if (running_) return;
+  running_ = true;
+  driver_ = std::thread([this]() {
+    std::unique_lock<std::mutex> lock(driverMutex_);
+    while (running_) {
+      driverWake_.wait_for(lock, resolution_);
+      lock.unlock();
+      Poll();
+      lock.lock();
+    }
+  });
+}
+
+void TimerService::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(driverMutex_);
+    if (!running_) return;
+    running_ = false;
+  }
+  driverWake_.notify_all();
+  driver_.join();
+}
+
+const Clock& TimerService::GetClock() const {
+  return clock_;
+}
+
+//*************************************************************************************************
+// ReplayDriver implementations
+//*************************************************************************************************
+template <typename V>
+ReplayDriver<V>::ReplayDriver(ReplayClock& _clock, TimerService& _timers, std::chrono::microseconds _step) :
+  clock_(_clock), timers_(_timers), step_(_step.count()) {}
+
+template <typename V>
+void ReplayDriver<V>::ProcessAdd(V& data) {
+  clock_.Advance(step_);
+  timers_.Poll();
+}
+
+template <typename V>
+void ReplayDriver<V>::ProcessRemove(V& data) {
+  // not implemented
+}
+
+template <typename V>
+void ReplayDriver<V>::ProcessUpdate(V& data) {
+  // not implemented
+}
+
+#endif // !TIMERWHEEL_HPP
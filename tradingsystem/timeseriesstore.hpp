@@ -0,0 +1,348 @@
+/**
+* timeseriesstore.hpp
+*
+* Columnar in-memory store of time-stamped records, partitioned by time and
+* compressed column by column, with range scans by product and time
+*
+* @author: Gabo Bernardino
+*/
+
+#ifndef TIMESERIESSTORE_HPP
+#define TIMESERIESSTORE_HPP
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+* A row of a time-series store, as handed to the callbacks of a scan
+* Values are kept as fixed-point integers: GetValue scales them back
+*/
+template <std::size_t Columns>
+struct TimeSeriesRow {
+  std::int64_t time;  // nanoseconds since the epoch
+  const std::string* product;
+  std::array<std::int64_t, Columns> values;
+  const std::array<double, Columns>* scales;
+
+  double GetValue(std::size_t column) const { return values[column] / (*scales)[column]; }
+};
+
+/**
+* Time-series store
+* Rows are appended in time order and land in the partition covering their time.
+* Each partition stores its columns apart, each with its own encoding:
+*  - timestamps as the zigzag varint of their delta of delta, a byte for regular ticks
+*  - products as varint codes of a dictionary shared by all partitions
+*  - values as fixed-point integers (`decimals` per column), each as the zigzag
+*    varint of its delta to the previous value of the same product
+* A partition also knows its time range and which products it holds, so a scan
+* only decodes the partitions that can contain matching rows.
+* With a retention set, only that many partitions are kept: opening a new one
+* drops the oldest, so memory stays bounded however long the run.
+*/
+template <std::size_t Columns>
+class TimeSeriesStore {
+private:
+  struct Partition {
+    std::int64_t first = 0, last = 0;  // time range of the rows
+    std::size_t rows = 0;
+    std::string times;
+    std::string products;
+    std::array<std::string, Columns> columns;
+    std::vector<bool> holds;  // by product code
+
+    // encoder state, dropped once the partition is sealed
+    std::int64_t lastDelta = 0;
+    std::vector<std::array<std::int64_t, Columns>> lastValues;  // by product code
+  };
+
+  std::string name_;
+  std::array<std::string, Columns> columnNames_;
+  std::array<double, Columns> scales_;
+  std::chrono::nanoseconds span_;
+
+  std::vector<std::string> dictionary_;  // product code -> product
+  std::unordered_map<std::string, std::uint32_t> codes_;
+  std::deque<Partition> partitions_;
+  std::size_t rows_;
+  std::size_t retention_;  // partitions kept, 0 for all
+  std::size_t dropped_;  // rows of the partitions dropped
+  mutable std::mutex mutex_;
+
+  static void _putVarint(std::string& out, std::uint64_t value);
+  static std::uint64_t _getVarint(const std::string& in, std::size_t& cursor);
+  static std::uint64_t _zigzag(std::int64_t value);
+  static std::int64_t _unzigzag(std::uint64_t value);
+
+  // Decode the rows of a partition, calling `f(row)` for those of `code` (every code if negative) in [from, to)
+  template <typename F>
+  std::size_t _scan(const Partition& partition, long code, std::int64_t from, std::int64_t to, F& f) const;
+
+public:
+  // ctor - `_decimals` is the fixed-point precision of each column
+  TimeSeriesStore(const std::string& _name, const std::array<std::string, Columns>& _columnNames,
+    const std::array<int, Columns>& _decimals, std::chrono::nanoseconds _span = std::chrono::minutes(1));
+
+  // Keep only the last `partitions` partitions (0 keeps them all)
+  void SetRetention(std::size_t partitions);
+
+  // Append a row stamped now
+  void Append(const std::string& product, const std::array<double, Columns>& values);
+
+  // Append a row; times earlier than the last row appended are moved up to it
+  void Append(std::int64_t time, const std::string& product, const std::array<double, Columns>& values);
+
+  // Call `f(row)` for every row of `product` with `from` <= time < `to`, in time order
+  // Returns the number of rows matched; `f` must not append to the store
+  template <typename F>
+  std::size_t Scan(const std::string& product, std::int64_t from, std::int64_t to, F f) const;
+
+  // Same over every product
+  template <typename F>
+  std::size_t ScanAll(std::int64_t from, std::int64_t to, F f) const;
+
+  // Index of a column by name - Columns if there is none
+  std::size_t GetColumn(const std::string& column) const;
+
+  // Rows held, and rows dropped with their partitions past the retention
+  std::size_t GetRowCount() const;
+  std::size_t GetDroppedCount() const;
+  std::size_t GetPartitionCount() const;
+
+  // Bytes of the encoded columns, and of the same rows as plain fixed-size fields
+  std::size_t GetEncodedBytes() const;
+  std::size_t GetRawBytes() const;
+
+  // One-line summary: rows, partitions, encoded size against the plain rows, rows dropped
+  void Report(std::ostream& output) const;
+};
+
+//*************************************************************************************************
+// TimeSeriesStore implementations
+//*************************************************************************************************
+template <std::size_t Columns>
+TimeSeriesStore<Columns>::TimeSeriesStore(const std::string& _name, const std::array<std::string, Columns>& _columnNames,
+  const std::array<int, Columns>& _decimals, std::chrono::nanoseconds _span) :
+  name_(_name), columnNames_(_columnNames), span_(_span), rows_(0), retention_(0), dropped_(0)
+{
+  for (std::size_t i = 0; i < Columns; ++i) scales_[i] = std::pow(10.0, _decimals[i]);
+}
+
+template <std::size_t Columns>
+void TimeSeriesStore<Columns>::_putVarint(std::string& out, std::uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<char>(value));
+}
+
+template <std::size_t Columns>
+std::uint64_t TimeSeriesStore<Columns>::_getVarint(const std::string& in, std::size_t& cursor) {
+  std::uint64_t value = 0;
+  for (int shift = 0;; shift += 7) {
+    std::uint64_t byte = static_cast<unsigned char>(in[cursor++]);
+    value |= (byte & 0x7F) << shift;
+    if (byte < 0x80) return value;
+  }
+}
+
+template <std::size_t Columns>
+std::uint64_t TimeSeriesStore<Columns>::_zigzag(std::int64_t value) {
+  return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+}
+
+template <std::size_t Columns>
+std::int64_t TimeSeriesStore<Columns>::_unzigzag(std::uint64_t value) {
+  return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+}
+
+template <std::size_t Columns>
+void TimeSeriesStore<Columns>::SetRetention(std::size_t partitions) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  retention_ = partitions;
+}
+
+template <std::size_t Columns>
+void TimeSeriesStore<Columns>::Append(const std::string& product, const std::array<double, Columns>& values) {
+  auto now = std::chrono::system_clock::now().time_since_epoch();
+  Append(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count(), product, values);
+}
+
+template <std::size_t Columns>
+void TimeSeriesStore<Columns>::Append(std::int64_t time, const std::string& product, const std::array<double, Columns>& values) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!partitions_.empty()) time = std::max(time, partitions_.back().last);
+
+  auto found = codes_.find(product);
+  std::uint32_t code;
+  if (found != codes_.end()) code = found->second;
+  else {
+    code = static_cast<std::uint32_t>(dictionary_.size());
+    codes_.emplace(product, code);
+    dictionary_.push_back(product);
+  }
+
+  // partitions cover consecutive spans of time, aligned on the epoch
+  if (partitions_.empty() || time / span_.count() != partitions_.back().first / span_.count()) {
+    if (!partitions_.empty()) {
+      Partition& sealed = partitions_.back();
+      std::vector<std::array<std::int64_t, Columns>>().swap(sealed.lastValues);
+      sealed.times.shrink_to_fit();
+      sealed.products.shrink_to_fit();
+      for (auto& column : sealed.columns) column.shrink_to_fit();
+    }
+    partitions_.emplace_back();
+    partitions_.back().first = partitions_.back().last = time;
+    while (retention_ > 0 && partitions_.size() > retention_) {
+      rows_ -= partitions_.front().rows;
+      dropped_ += partitions_.front().rows;
+      partitions_.pop_front();
+    }
+  }
+  Partition& partition = partitions_.back();
+
+  // timestamps: the first one whole, then the change of the interval between rows
+  std::int64_t delta = time - partition.last;
+  if (partition.rows == 0) _putVarint(partition.times, _zigzag(time));
+  else _putVarint(partition.times, _zigzag(delta - partition.lastDelta));
+  partition.lastDelta = (partition.rows == 0) ? 0 : delta;
+  partition.last = time;
+
+  _putVarint(partition.products, code);
+  if (partition.holds.size() <= code) partition.holds.resize(code + 1, false);
+  if (partition.lastValues.size() <= code) partition.lastValues.resize(code + 1, std::array<std::int64_t, Columns>{});
+  partition.holds[code] = true;
+
+  std::array<std::int64_t, Columns>& last = partition.lastValues[code];
+  for (std::size_t i = 0; i < Columns; ++i) {
+    std::int64_t value = std::llround(values[i] * scales_[i]);
+    _putVarint(partition.columns[i], _zigzag(value - last[i]));
+    last[i] = value;
+  }
+  partition.rows++;
+  rows_++;
+}
+
+template <std::size_t Columns>
+template <typename F>
+std::size_t TimeSeriesStore<Columns>::_scan(const Partition& partition, long code, std::int64_t from, std::int64_t to, F& f) const {
+  std::size_t timeCursor = 0, productCursor = 0, matched = 0;
+  std::array<std::size_t, Columns> cursors{};
+  std::vector<std::array<std::int64_t, Columns>> last(partition.holds.size(), std::array<std::int64_t, Columns>{});
+  std::int64_t time = 0, delta = 0;
+
+  TimeSeriesRow<Columns> row;
+  row.scales = &scales_;
+  for (std::size_t r = 0; r < partition.rows; ++r) {
+    std::int64_t encoded = _unzigzag(_getVarint(partition.times, timeCursor));
+    if (r == 0) time = encoded;
+    else {
+      delta += encoded;
+      time += delta;
+    }
+    if (time >= to) break;  // rows are in time order
+
+    std::uint32_t product = static_cast<std::uint32_t>(_getVarint(partition.products, productCursor));
+    std::array<std::int64_t, Columns>& values = last[product];
+    for (std::size_t i = 0; i < Columns; ++i) values[i] += _unzigzag(_getVarint(partition.columns[i], cursors[i]));
+
+    if (time < from || (code >= 0 && product != static_cast<std::uint32_t>(code))) continue;
+    row.time = time;
+    row.product = &dictionary_[product];
+    row.values = values;
+    f(row);
+    matched++;
+  }
+  return matched;
+}
+
+template <std::size_t Columns>
+template <typename F>
+std::size_t TimeSeriesStore<Columns>::Scan(const std::string& product, std::int64_t from, std::int64_t to, F f) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto found = codes_.find(product);
+  if (found == codes_.end()) return 0;
+  std::uint32_t code = found->second;
+
+  std::size_t matched = 0;
+  for (const Partition& partition : partitions_) {
+    if (partition.last < from || partition.first >= to) continue;
+    if (partition.holds.size() <= code || !partition.holds[code]) continue;
+    matched += _scan(partition, code, from, to, f);
+  }
+  return matched;
+}
+
+template <std::size_t Columns>
+template <typename F>
+std::size_t TimeSeriesStore<Columns>::ScanAll(std::int64_t from, std::int64_t to, F f) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::size_t matched = 0;
+  for (const Partition& partition : partitions_) {
+    if (partition.last < from || partition.first >= to) continue;
+    matched += _scan(partition, -1, from, to, f);
+  }
+  return matched;
+}
+
+template <std::size_t Columns>
+std::size_t TimeSeriesStore<Columns>::GetColumn(const std::string& column) const {
+  return std::find(columnNames_.begin(), columnNames_.end(), column) - columnNames_.begin();
+}
+
+template <std::size_t Columns>
+std::size_t TimeSeriesStore<Columns>::GetRowCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return rows_;
+}
+
+template <std::size_t Columns>
+std::size_t TimeSeriesStore<Columns>::GetDroppedCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return dropped_;
+}
+
+template <std::size_t Columns>
+std::size_t TimeSeriesStore<Columns>::GetPartitionCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return partitions_.size();
+}
+
+template <std::size_t Columns>
+std::size_t TimeSeriesStore<Columns>::GetEncodedBytes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::size_t bytes = 0;
+  for (const Partition& partition : partitions_) {
+    bytes += partition.times.size() + partition.products.size();
+    for (const auto& column : partition.columns) bytes += column.size();
+  }
+  for (const auto& product : dictionary_) bytes += product.size() + 1;
+  return bytes;
+}
+
+template <std::size_t Columns>
+std::size_t TimeSeriesStore<Columns>::GetRawBytes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  // an 8-byte time, a 12-character CUSIP and 8 bytes per value
+  return rows_ * (8 + 12 + 8 * Columns);
+}
+
+template <std::size_t Columns>
+void TimeSeriesStore<Columns>::Report(std::ostream& output) const {
+  std::size_t encoded = GetEncodedBytes(), raw = GetRawBytes();
+  output << "Time series '" << name_ << "': " << GetRowCount() << " rows in " << GetPartitionCount() << " partitions, "
+    << encoded << " bytes encoded against " << raw << " plain ("
+    << (encoded > 0 ? static_cast<double>(raw) / encoded : 0.0) << "x), " << GetDroppedCount() << " rows dropped" << std::endl;
+}
+
+#endif // !TIMESERIESSTORE_HPP
@@ -10,10 +10,15 @@
 #include <string>
 #include <vector>
 #include "soa.hpp"
+#include "fixedstring.hpp"
 
 // Trade sides
 enum Side { BUY, SELL };
 
+// Trade identifiers and book names are stored inline
+typedef FixedString<32> TradeId;
+typedef FixedString<15> BookId;
+
 /**
  * Trade object with a price, side, and quantity on a particular book.
  * Type T is the product type.
@@ -25,20 +30,20 @@ class Trade
 public:
 
   // ctor for a trade
-  Trade(const T &_product, string _tradeId, double _price, string _book, long _quantity, Side _side);
+  Trade(const T &_product, const TradeId &_tradeId, double _price, const BookId &_book, long _quantity, Side _side);
   Trade() = default;
 
   // Get the product
   const T& GetProduct() const;
 
   // Get the trade ID
-  const string& GetTradeId() const;
+  const TradeId& GetTradeId() const;
 
   // Get the mid price
   double GetPrice() const;
 
   // Get the book
-  const string& GetBook() const;
+  const BookId& GetBook() const;
 
   // Get the quantity
   long GetQuantity() const;
@@ -48,9 +53,9 @@ public:
 
 private:
   T product;
-  string tradeId;
+  TradeId tradeId;
   double price;
-  string book;
+  BookId book;
   long quantity;
   Side side;
 
@@ -73,12 +78,10 @@ public:
 };
 
 template<typename T>
-Trade<T>::Trade(const T &_product, string _tradeId, double _price, string _book, long _quantity, Side _side) :
-  product(_product)
+Trade<T>::Trade(const T &_product, const TradeId &_tradeId, double _price, const BookId &_book, long _quantity, Side _side) :
+  product(_product), tradeId(_tradeId), book(_book)
 {
-  tradeId = _tradeId;
   price = _price;
-  book = _book;
   quantity = _quantity;
   side = _side;
 }
@@ -90,7 +93,7 @@ const T& Trade<T>::GetProduct() const
 }
 
 template<typename T>
-const string& Trade<T>::GetTradeId() const
+const TradeId& Trade<T>::GetTradeId() const
 {
   return tradeId;
 }
@@ -102,7 +105,7 @@ double Trade<T>::GetPrice() const
 }
 
 template<typename T>
-const string& Trade<T>::GetBook() const
+const BookId& Trade<T>::GetBook() const
 {
   return book;
 }
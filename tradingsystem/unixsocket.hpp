@@ -0,0 +1,245 @@
+/**
+* unixsocket.hpp
+*
+* Unix domain stream sockets carrying fixed-size binary frames:
+* an epoll server serving many clients from one thread, and a client
+*
+* @author: Gabo Bernardino
+*/
+
+#ifndef UNIXSOCKET_HPP
+#define UNIXSOCKET_HPP
+
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/**
+* Frame server
+* Listens on a socket path and serves every client from the calling thread with
+* epoll. Each readable client is drained with large recv calls, so one call
+* usually brings in many frames; complete frames are handed to the callback in
+* the order the client sent them, and the bytes of a frame cut by a recv are
+* kept until the rest arrives.
+*/
+class UnixSocketServer {
+private:
+  std::string path_;
+  std::size_t frameSize_;
+  int listener_;
+  int epoll_;
+  std::vector<char> buffer_;
+  std::unordered_map<int, std::string> partial_;  // client -> bytes of an incomplete frame
+
+  long clients_;
+  long frames_;
+  long recvs_;
+
+  void _accept();
+
+  // Read what a client sent - false once the client is gone
+  template <typename F>
+  bool _read(int client, F& on_frame);
+
+  void _drop(int client);
+
+public:
+  // ctor - binds the path, replacing a stale socket file
+  UnixSocketServer(const std::string& _path, std::size_t _frameSize, std::size_t _bufferBytes = 1 << 16);
+  ~UnixSocketServer();
+
+  UnixSocketServer(const UnixSocketServer&) = delete;
+  UnixSocketServer& operator=(const UnixSocketServer&) = delete;
+
+  // Serve clients until `stop` returns true, calling `on_frame(frame)` for every frame
+  // `stop` is checked at least every `_pollMillis`
+  template <typename F>
+  void Run(F on_frame, const std::function<bool()>& stop, int _pollMillis = 10);
+
+  long GetClientCount() const;
+  long GetFrameCount() const;
+  long GetRecvCount() const;
+};
+
+/**
+* Frame client
+* Connects to a server path; Send writes a whole batch of frames, however
+* many system calls it takes.
+*/
+class UnixSocketClient {
+private:
+  int fd_;
+
+public:
+  // ctor - throws if nothing listens on the path
+  UnixSocketClient(const std::string& _path);
+  ~UnixSocketClient();
+
+  UnixSocketClient(const UnixSocketClient&) = delete;
+  UnixSocketClient& operator=(const UnixSocketClient&) = delete;
+
+  void Send(const char* data, std::size_t bytes);
+};
+
+//*************************************************************************************************
+// UnixSocketServer implementations
+//*************************************************************************************************
+UnixSocketServer::UnixSocketServer(const std::string& _path, std::size_t _frameSize, std::size_t _bufferBytes) :
+  path_(_path), frameSize_(_frameSize), listener_(-1), epoll_(-1), buffer_(_bufferBytes), clients_(0), frames_(0), recvs_(0)
+{
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (path_.size() >= sizeof(address.sun_path)) throw std::runtime_error("socket path too long: " + path_);
+  std::strcpy(address.sun_path, path_.c_str());
+
+  listener_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (listener_ < 0) throw std::runtime_error("cannot create socket " + path_);
+  unlink(path_.c_str());
+  if (bind(listener_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || listen(listener_, 64) < 0) {
+    close(listener_);
+    throw std::runtime_error("cannot listen on " + path_);
+  }
+
+  epoll_ = epoll_create1(EPOLL_CLOEXEC);
+  epoll_event event{};
+  event.events = EPOLLIN;
+  event.data.fd = listener_;
+  if (epoll_ < 0 || epoll_ctl(epoll_, EPOLL_CTL_ADD, listener_, &event) < 0) {
+    close(listener_);
+    if (epoll_ >= 0) close(epoll_);
+    throw std::runtime_error("cannot poll " + path_);
+  }
+}
+
+UnixSocketServer::~UnixSocketServer() {
+  for (auto& [client, bytes] : partial_) close(client);
+  close(epoll_);
+  close(listener_);
+  unlink(path_.c_str());
+}
+
+void UnixSocketServer::_accept() {
+  while (true) {
+    int client = accept4(listener_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (client < 0) return;  // EAGAIN: no more pending connections
+
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLRDHUP;
+    event.data.fd = client;
+    if (epoll_ctl(epoll_, EPOLL_CTL_ADD, client, &event) < 0) {
+      close(client);
+      continue;
+    }
+    partial_[client];
+    clients_++;
+  }
+}
+
+void UnixSocketServer::_drop(int client) {
+  epoll_ctl(epoll_, EPOLL_CTL_DEL, client, nullptr);
+  close(client);
+  partial_.erase(client);
+}
+
+template <typename F>
+bool UnixSocketServer::_read(int client, F& on_frame) {
+  std::string& partial = partial_[client];
+  while (true) {
+    ssize_t n = recv(client, buffer_.data(), buffer_.size(), 0);
+    if (n == 0) return false;  // closed by the client; a trailing incomplete frame is dropped
+    if (n < 0) return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    recvs_++;
+
+    const char* data = buffer_.data();
+    const char* end = data + n;
+    // complete the frame cut by the previous recv
+    if (!partial.empty()) {
+      std::size_t take = std::min(frameSize_ - partial.size(), static_cast<std::size_t>(n));
+      partial.append(data, take);
+      data += take;
+      if (partial.size() < frameSize_) continue;
+      frames_++;
+      on_frame(partial.data());
+      partial.clear();
+    }
+    for (; data + frameSize_ <= end; data += frameSize_) {
+      frames_++;
+      on_frame(data);
+    }
+    partial.assign(data, end);
+  }
+}
+
+template <typename F>
+void UnixSocketServer::Run(F on_frame, const std::function<bool()>& stop, int _pollMillis) {
+  epoll_event events[64];
+  while (!stop()) {
+    int n = epoll_wait(epoll_, events, 64, _pollMillis);
+    for (int i = 0; i < n; ++i) {
+      int fd = events[i].data.fd;
+      if (fd == listener_) {
+        _accept();
+        continue;
+      }
+      // read first: the client may have sent its last frames right before hanging up
+      bool open = _read(fd, on_frame);
+      if (!open || (events[i].events & (EPOLLHUP | EPOLLERR))) _drop(fd);
+    }
+  }
+}
+
+long UnixSocketServer::GetClientCount() const {
+  return clients_;
+}
+
+long UnixSocketServer::GetFrameCount() const {
+  return frames_;
+}
+
+long UnixSocketServer::GetRecvCount() const {
+  return recvs_;
+}
+
+//*************************************************************************************************
+// UnixSocketClient implementations
+//*************************************************************************************************
+UnixSocketClient::UnixSocketClient(const std::string& _path) {
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (_path.size() >= sizeof(address.sun_path)) throw std::runtime_error("socket path too long: " + _path);
+  std::strcpy(address.sun_path, _path.c_str());
+
+  fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd_ < 0) throw std::runtime_error("cannot create socket");
+  if (connect(fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+    close(fd_);
+    throw std::runtime_error("nothing listens on " + _path);
+  }
+}
+
+UnixSocketClient::~UnixSocketClient() {
+  close(fd_);
+}
+
+void UnixSocketClient::Send(const char* data, std::size_t bytes) {
+  while (bytes > 0) {
+    ssize_t n = send(fd_, data, bytes, MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      throw std::runtime_error(std::string("send failed: ") + std::strerror(errno));
+    }
+    data += n;
+    bytes -= static_cast<std::size_t>(n);
+  }
+}
+
+#endif // !UNIXSOCKET_HPP
@@ -0,0 +1,627 @@
+/**
+* uringwriter.hpp
+*
+* Append-only file writer that takes records from any thread and writes them
+* from a single I/O thread with io_uring
+*
+* @author: Gabo Bernardino
+*/
+
+#ifndef URINGWRITER_HPP
+#define URINGWRITER_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include "framecodec.hpp"
+
+/**
+* io_uring file writer
+* Append only copies the record into the staging ring of its file, a single
+* producer / single consumer byte ring shared with the I/O thread without a lock:
+* the calling thread never makes a system call, and only waits when the ring is
+* full. The appends of a file must not overlap (its connector is called by one
+* flow at a time). Every flush interval the I/O thread drains the rings into a
+* set of buffers registered with the kernel, queues one fixed-buffer write per
+* buffer for all files, and submits them with a single io_uring_enter;
+* completions are collected on the next pass, which gives the buffers back. Each
+* write carries its own file offset, so the writes of a file may complete in any order.
+*
+* io_uring is set up with raw system calls (no liburing). When the kernel refuses
+* it, or io_uring_enter keeps failing, the I/O thread writes the same batches with
+* pwrite instead. A write that makes no progress is retried `maxRetries_` times,
+* then counted as failed, so Stop always returns.
+*
+* Files opened compressed are written as frames (see framecodec.hpp), compressed
+* by the I/O thread as well: a frame is cut on the last record ending within
+* `frameBytes` of data, or sooner when its data has waited `maxFrameAge_`, and at Stop.
+*/
+class UringFileWriter {
+public:
+  static constexpr int maxFiles_ = 32;
+  static constexpr std::chrono::milliseconds maxFrameAge_{ 1000 };
+  static constexpr int maxRetries_ = 8;  // of a write making no progress, or of a failed io_uring_enter
+
+private:
+  struct File {
+    int fd = -1;
+    std::string path;
+
+    // staging ring: written by the producer, read by the I/O thread
+    std::unique_ptr<char[]> ring;
+    std::size_t ringMask = 0;
+    std::atomic<std::uint64_t> head{ 0 };  // read up to, by the I/O thread
+    std::atomic<std::uint64_t> tail{ 0 };  // written up to, by the producer
+
+    std::string backlog;  // taken by the I/O thread, waiting for a free buffer
+    std::size_t backlogStart = 0;  // what is before it in `backlog` is written
+    std::uint64_t offset = 0;  // where the next write goes
+    std::uint64_t initialSize = 0;  // of the content, when opened
+
+    // compressed files only, on the I/O thread
+    bool compressed = false;
+    std::string raw;  // records not yet in a frame
+    std::size_t rawStart = 0;  // what is before it in `raw` is in frames
+    std::uint64_t rawOffset = 0;  // of `raw` in the uncompressed stream
+    std::chrono::steady_clock::time_point rawSince;
+  };
+
+  // A registered buffer and the write it carries
+  struct Buffer {
+    char* data;
+    int file;
+    std::uint64_t offset;
+    std::size_t length;
+    std::size_t done;
+    int retries;  // in a row without progress
+  };
+
+  std::array<File, maxFiles_> files_;
+  std::atomic<int> fileCount_;
+  std::mutex openMutex_;
+
+  std::size_t ringBytes_;  // of each file's staging ring
+  std::size_t bufferBytes_;
+  std::chrono::microseconds flushInterval_;
+  std::size_t frameBytes_;
+  char* memory_;
+  std::vector<Buffer> buffers_;
+  std::vector<int> free_;  // buffers not in flight
+
+  // ring, mapped from the kernel
+  int ring_;
+  bool registered_;
+  void* sqMap_;
+  std::size_t sqMapBytes_;
+  void* cqMap_;
+  std::size_t cqMapBytes_;
+  io_uring_sqe* sqes_;
+  std::size_t sqesBytes_;
+  unsigned* sqTail_;
+  unsigned* sqMask_;
+  unsigned* sqArray_;
+  unsigned* cqHead_;
+  unsigned* cqTail_;
+  unsigned* cqMask_;
+  io_uring_cqe* cqes_;
+  unsigned toSubmit_;
+  int inFlight_;
+  int enterFailures_;  // in a row
+
+  std::thread thread_;
+  std::atomic<bool> running_;
+  std::atomic<bool> stopping_;
+
+  std::atomic<std::uint64_t> records_;
+  std::atomic<std::uint64_t> stalls_;  // appends that waited for room in a ring
+  std::uint64_t bytes_;
+  std::uint64_t writes_;
+  std::uint64_t syscalls_;
+  std::uint64_t errors_;
+  std::uint64_t rawBytes_;  // taken into frames
+  std::uint64_t frames_;
+  std::uint64_t frameBytesOut_;
+
+  bool _setupRing(unsigned entries);
+  void _teardownRing();
+
+  // Queue the write of (the rest of) a buffer
+  void _queue(int buffer);
+
+  // Submit what is queued; wait for `wait` completions
+  void _enter(unsigned wait);
+
+  // Give up on io_uring: write what the buffers still hold with pwrite and carry on without the ring
+  void _abandonRing();
+
+  // Move what the producer has staged to the end of `into`
+  void _drain(File& file, std::string& into);
+
+  // Move `start` past `taken` more bytes of `data`, dropping the consumed front once it outweighs
+  // the rest: each byte is moved at most once on average, where erasing every time moves it per pass
+  static void _consume(std::string& data, std::size_t& start, std::size_t taken);
+
+  // Collect completions, resubmitting short writes
+  void _reap();
+
+  // Cut the frames of a compressed file into its backlog; `flush` frames everything
+  void _compress(File& file, bool flush);
+
+  // Move staged data to buffers and queue their writes - true if everything was taken
+  bool _collect(bool flush);
+
+  // pwrite fallback for one file
+  void _writeDirect(File& file, const char* data, std::size_t length);
+
+  void _run();
+
+public:
+  // ctor - `_buffers` buffers of `_bufferBytes` are registered with the kernel, each file stages up to `_ringBytes`
+  UringFileWriter(std::size_t _bufferBytes = 1 << 16, std::size_t _buffers = 32,
+    std::chrono::microseconds _flushInterval = std::chrono::milliseconds(1), std::size_t _frameBytes = 1 << 16,
+    std::size_t _ringBytes = 1 << 20);
+  ~UringFileWriter();
+
+  UringFileWriter(const UringFileWriter&) = delete;
+  UringFileWriter& operator=(const UringFileWriter&) = delete;
+
+  // Open a file for appending and return its handle; opening a path twice returns the same handle
+  // A compressed file is written as frames; a frame cut by a crash is dropped
+  int Open(const std::string& path, bool compressed = false);
+
+  // Size of the file's content when it was opened - uncompressed for a compressed file
+  std::uint64_t GetInitialSize(int file) const;
+
+  // Append a record to a file - never blocks on the kernel, waits for the I/O thread when the file's ring is full
+  void Append(int file, const char* data, std::size_t length);
+  void Append(int file, const std::string& record);
+
+  // Start / stop the I/O thread; Stop writes everything appended before it and waits for the writes
+  void Start();
+  void Stop();
+
+  // Is the I/O thread writing with io_uring rather than pwrite?
+  bool UsesUring() const;
+
+  std::uint64_t GetRecordCount() const;
+
+  // One-line summary: records, bytes, writes and system calls
+  void Report(std::ostream& output) const;
+};
+
+//*************************************************************************************************
+// UringFileWriter implementations
+//*************************************************************************************************
+UringFileWriter::UringFileWriter(std::size_t _bufferBytes, std::size_t _buffers, std::chrono::microseconds _flushInterval,
+  std::size_t _frameBytes, std::size_t _ringBytes) :
+  fileCount_(0), ringBytes_(4096), bufferBytes_(std::max<std::size_t>(_bufferBytes, 4096)), flushInterval_(_flushInterval),
+  frameBytes_(std::max<std::size_t>(_frameBytes, 1024)),
+  ring_(-1), registered_(false), sqMap_(MAP_FAILED), sqMapBytes_(0), cqMap_(MAP_FAILED), cqMapBytes_(0),
+  sqes_(nullptr), sqesBytes_(0), toSubmit_(0), inFlight_(0), enterFailures_(0), running_(false), stopping_(false),
+  records_(0), stalls_(0), bytes_(0), writes_(0), syscalls_(0), errors_(0), rawBytes_(0), frames_(0), frameBytesOut_(0)
+{
+  std::size_t n = std::max<std::size_t>(_buffers, 1);
+  bufferBytes_ = (bufferBytes_ + 4095) / 4096 * 4096;
+  while (ringBytes_ < _ringBytes) ringBytes_ <<= 1;  // a power of two, for the mask
+  memory_ = static_cast<char*>(std::aligned_alloc(4096, n * bufferBytes_));
+  if (memory_ == nullptr) throw std::runtime_error("cannot allocate the writer's buffers");
+  for (std::size_t i = 0; i < n; ++i) {
+    buffers_.push_back(Buffer{ memory_ + i * bufferBytes_, -1, 0, 0, 0, 0 });
+    free_.push_back(static_cast<int>(i));
+  }
+
+  if (!_setupRing(static_cast<unsigned>(n))) _teardownRing();
+}
+
+UringFileWriter::~UringFileWriter() {
+  Stop();
+  _teardownRing();
+  for (File& file : files_) if (file.fd >= 0) close(file.fd);
+  std::free(memory_);
+}
+
+bool UringFileWriter::_setupRing(unsigned entries) {
+  io_uring_params params{};
+  ring_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+  if (ring_ < 0) return false;
+
+  sqMapBytes_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cqMapBytes_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (single) sqMapBytes_ = cqMapBytes_ = std::max(sqMapBytes_, cqMapBytes_);
+
+  sqMap_ = mmap(nullptr, sqMapBytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_, IORING_OFF_SQ_RING);
+  if (sqMap_ == MAP_FAILED) return false;
+  if (!single) {
+    cqMap_ = mmap(nullptr, cqMapBytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_, IORING_OFF_CQ_RING);
+    if (cqMap_ == MAP_FAILED) return false;
+  }
+  sqesBytes_ = params.sq_entries * sizeof(io_uring_sqe);
+  void* sqes = mmap(nullptr, sqesBytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) return false;
+  sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+  char* sq = static_cast<char*>(sqMap_);
+  char* cq = single ? sq : static_cast<char*>(cqMap_);
+  sqTail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+  sqMask_ = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+  sqArray_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+  cqHead_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+  cqTail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+  cqMask_ = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+  cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+  // register the buffers, so the kernel does not map them again for every write
+  std::vector<iovec> iovecs;
+  for (const Buffer& buffer : buffers_) iovecs.push_back(iovec{ buffer.data, bufferBytes_ });
+  registered_ = syscall(__NR_io_uring_register, ring_, IORING_REGISTER_BUFFERS, iovecs.data(), iovecs.size()) == 0;
+  return true;
+}
+
+void UringFileWriter::_teardownRing() {
+  if (sqes_ != nullptr) munmap(sqes_, sqesBytes_);
+  if (cqMap_ != MAP_FAILED) munmap(cqMap_, cqMapBytes_);
+  if (sqMap_ != MAP_FAILED) munmap(sqMap_, sqMapBytes_);
+  if (ring_ >= 0) close(ring_);
+  sqes_ = nullptr;
+  cqMap_ = sqMap_ = MAP_FAILED;
+  ring_ = -1;
+}
+
+int UringFileWriter::Open(const std::string& path, bool compressed) {
+  std::lock_guard<std::mutex> lock(openMutex_);
+  int count = fileCount_.load(std::memory_order_relaxed);
+  for (int i = 0; i < count; ++i) {
+    if (files_[i].path == path) return i;
+  }
+  if (count == maxFiles_) throw std::runtime_error("too many files for the writer: " + path);
+
+  int fd = open(path.c_str(), (compressed ? O_RDWR : O_WRONLY) | O_CREAT | O_CLOEXEC, 0644);
+  struct stat info;
+  if (fd < 0 || fstat(fd, &info) < 0) {
+    if (fd >= 0) close(fd);
+    throw std::runtime_error("cannot open " + path);
+  }
+  File& file = files_[count];
+  file.fd = fd;
+  file.path = path;
+  file.ring = std::make_unique<char[]>(ringBytes_);
+  file.ringMask = ringBytes_ - 1;
+  file.offset = static_cast<std::uint64_t>(info.st_size);  // append to what is there
+  file.initialSize = file.offset;
+  file.compressed = compressed;
+  if (compressed) {
+    // carry on after the last whole frame
+    file.rawOffset = file.initialSize = FrameScan(fd, file.offset);
+    if (ftruncate(fd, static_cast<off_t>(file.offset)) != 0) {
+      close(fd);
+      file.fd = -1;
+      throw std::runtime_error("cannot repair " + path);
+    }
+  }
+  fileCount_.store(count + 1, std::memory_order_release);
+  return count;
+}
+
+std::uint64_t UringFileWriter::GetInitialSize(int file) const {
+  return files_[file].initialSize;
+}
+
+void UringFileWriter::Append(int file, const char* data, std::size_t length) {
+  File& target = files_[file];
+  bool stalled = false;
+  while (length > 0) {
+    std::uint64_t tail = target.tail.load(std::memory_order_relaxed);
+    std::size_t room = ringBytes_ - static_cast<std::size_t>(tail - target.head.load(std::memory_order_acquire));
+    if (room == 0) {
+      // the I/O thread frees the ring on its next pass
+      stalled = true;
+      std::this_thread::yield();
+      continue;
+    }
+    std::size_t n = std::min(room, length);
+    std::size_t at = static_cast<std::size_t>(tail) & target.ringMask;
+    std::size_t first = std::min(n, ringBytes_ - at);
+    std::memcpy(target.ring.get() + at, data, first);
+    std::memcpy(target.ring.get(), data + first, n - first);
+    target.tail.store(tail + n, std::memory_order_release);
+    data += n;
+    length -= n;
+  }
+  if (stalled) stalls_.fetch_add(1, std::memory_order_relaxed);
+  records_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void UringFileWriter::Append(int file, const std::string& record) {
+  Append(file, record.data(), record.size());
+}
+
+void UringFileWriter::_queue(int buffer) {
+  Buffer& b = buffers_[buffer];
+  unsigned tail = *sqTail_;
+  unsigned index = tail & *sqMask_;
+  io_uring_sqe& sqe = sqes_[index];
+  std::memset(&sqe, 0, sizeof(sqe));
+  sqe.opcode = registered_ ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+  sqe.fd = files_[b.file].fd;
+  sqe.addr = reinterpret_cast<std::uint64_t>(b.data + b.done);
+  sqe.len = static_cast<std::uint32_t>(b.length - b.done);
+  sqe.off = b.offset + b.done;
+  sqe.buf_index = static_cast<std::uint16_t>(buffer);
+  sqe.user_data = static_cast<std::uint64_t>(buffer);
+  sqArray_[index] = index;
+  __atomic_store_n(sqTail_, tail + 1, __ATOMIC_RELEASE);
+  toSubmit_++;
+  writes_++;
+}
+
+void UringFileWriter::_enter(unsigned wait) {
+  if (toSubmit_ == 0 && wait == 0) return;
+  unsigned flags = (wait > 0) ? IORING_ENTER_GETEVENTS : 0;
+  long submitted = syscall(__NR_io_uring_enter, ring_, toSubmit_, wait, flags, nullptr, 0);
+  syscalls_++;
+  if (submitted < 0) {
+    // interrupted, or out of resources for now: try again on the next pass, a few times
+    bool transient = (errno == EINTR || errno == EAGAIN || errno == EBUSY);
+    if (!transient || ++enterFailures_ > maxRetries_) _abandonRing();
+    else std::this_thread::sleep_for(flushInterval_);
+    return;
+  }
+  enterFailures_ = 0;
+  toSubmit_ -= static_cast<unsigned>(submitted);
+  inFlight_ += static_cast<int>(submitted);
+}
+
+void UringFileWriter::_abandonRing() {
+  // closing the ring cancels what it still holds; a write that went thru anyway is written again, with the same bytes
+  _teardownRing();
+  for (std::size_t i = 0; i < buffers_.size(); ++i) {
+    Buffer& b = buffers_[i];
+    if (b.file < 0 || b.done >= b.length) continue;
+    std::size_t done = b.done;
+    while (done < b.length) {
+      ssize_t n = pwrite(files_[b.file].fd, b.data + done, b.length - done, static_cast<off_t>(b.offset + done));
+      syscalls_++;
+      writes_++;
+      if (n < 0 && errno == EINTR) continue;
+      if (n <= 0) {
+        errors_++;  // the rest of this buffer is lost
+        break;
+      }
+      done += static_cast<std::size_t>(n);
+    }
+    bytes_ += done - b.done;
+    b.file = -1;
+  }
+  free_.clear();
+  for (std::size_t i = 0; i < buffers_.size(); ++i) free_.push_back(static_cast<int>(i));
+  toSubmit_ = 0;
+  inFlight_ = 0;
+}
+
+void UringFileWriter::_reap() {
+  unsigned head = *cqHead_;
+  unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+  for (; head != tail; ++head) {
+    const io_uring_cqe& cqe = cqes_[head & *cqMask_];
+    int buffer = static_cast<int>(cqe.user_data);
+    Buffer& b = buffers_[buffer];
+    inFlight_--;
+    bool transient = (cqe.res == 0 || cqe.res == -EINTR || cqe.res == -EAGAIN);
+    if (cqe.res < 0 && !transient) {
+      errors_++;  // the data of this buffer is lost
+    }
+    else if (transient && ++b.retries > maxRetries_) {
+      errors_++;  // no progress after as many tries: give the rest of the buffer up
+      bytes_ += b.done;
+    }
+    else {
+      if (cqe.res > 0) {
+        b.done += static_cast<std::size_t>(cqe.res);
+        b.retries = 0;
+      }
+      if (b.done < b.length) {
+        _queue(buffer);  // short write: the rest goes again
+        continue;
+      }
+      bytes_ += b.length;
+    }
+    b.file = -1;
+    free_.push_back(buffer);
+  }
+  __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+}
+
+void UringFileWriter::_writeDirect(File& file, const char* data, std::size_t length) {
+  std::size_t done = 0;
+  while (done < length) {
+    ssize_t n = pwrite(file.fd, data + done, length - done, static_cast<off_t>(file.offset + done));
+    syscalls_++;
+    writes_++;
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) {
+      errors_++;  // nothing written and nothing to wait for: the rest is lost
+      break;
+    }
+    done += static_cast<std::size_t>(n);
+  }
+  file.offset += length;
+  bytes_ += done;
+}
+
+void UringFileWriter::_compress(File& file, bool flush) {
+  std::size_t taken = file.rawStart;
+  while (file.raw.size() - taken >= frameBytes_) {
+    // frames end with a record, so every frame starts on a line of its own
+    std::size_t end = file.raw.rfind('\n', taken + frameBytes_ - 1);
+    std::size_t length = (end == std::string::npos || end < taken) ? frameBytes_ : end + 1 - taken;
+    std::size_t before = file.backlog.size();
+    FrameCompress(file.raw.data() + taken, length, file.rawOffset, file.backlog);
+    frameBytesOut_ += file.backlog.size() - before;
+    file.rawOffset += length;
+    taken += length;
+    frames_++;
+  }
+  bool old = std::chrono::steady_clock::now() - file.rawSince >= maxFrameAge_;
+  if (taken < file.raw.size() && (flush || old)) {
+    std::size_t before = file.backlog.size();
+    FrameCompress(file.raw.data() + taken, file.raw.size() - taken, file.rawOffset, file.backlog);
+    frameBytesOut_ += file.backlog.size() - before;
+    file.rawOffset += file.raw.size() - taken;
+    taken = file.raw.size();
+    frames_++;
+  }
+  if (taken == file.rawStart) return;
+  rawBytes_ += taken - file.rawStart;
+  _consume(file.raw, file.rawStart, taken - file.rawStart);
+  file.rawSince = std::chrono::steady_clock::now();
+}
+
+void UringFileWriter::_consume(std::string& data, std::size_t& start, std::size_t taken) {
+  start += taken;
+  if (start == data.size()) {
+    data.clear();
+    start = 0;
+  }
+  else if (start >= data.size() - start) {
+    data.erase(0, start);
+    start = 0;
+  }
+}
+
+void UringFileWriter::_drain(File& file, std::string& into) {
+  std::uint64_t head = file.head.load(std::memory_order_relaxed);
+  std::uint64_t tail = file.tail.load(std::memory_order_acquire);
+  std::size_t n = static_cast<std::size_t>(tail - head);
+  if (n == 0) return;
+  std::size_t at = static_cast<std::size_t>(head) & file.ringMask;
+  std::size_t first = std::min(n, ringBytes_ - at);
+  into.append(file.ring.get() + at, first);
+  into.append(file.ring.get(), n - first);
+  file.head.store(tail, std::memory_order_release);
+}
+
+bool UringFileWriter::_collect(bool flush) {
+  bool everything = true;
+  int count = fileCount_.load(std::memory_order_acquire);
+  for (int i = 0; i < count; ++i) {
+    File& file = files_[i];
+    if (file.compressed) {
+      if (file.raw.size() == file.rawStart && file.tail.load(std::memory_order_acquire) != file.head.load(std::memory_order_relaxed)) {
+        file.rawSince = std::chrono::steady_clock::now();
+      }
+      _drain(file, file.raw);
+    }
+    else _drain(file, file.backlog);
+    if (file.compressed && file.raw.size() > file.rawStart) _compress(file, flush);
+    if (file.backlog.size() == file.backlogStart) continue;
+
+    if (ring_ < 0) {
+      _writeDirect(file, file.backlog.data() + file.backlogStart, file.backlog.size() - file.backlogStart);
+      file.backlog.clear();
+      file.backlogStart = 0;
+      continue;
+    }
+
+    std::size_t taken = file.backlogStart;
+    while (taken < file.backlog.size() && !free_.empty()) {
+      int buffer = free_.back();
+      free_.pop_back();
+      Buffer& b = buffers_[buffer];
+      std::size_t length = std::min(bufferBytes_, file.backlog.size() - taken);
+      std::memcpy(b.data, file.backlog.data() + taken, length);
+      b.file = i;
+      b.offset = file.offset;
+      b.length = length;
+      b.done = 0;
+      b.retries = 0;
+      file.offset += length;
+      taken += length;
+      _queue(buffer);
+    }
+    _consume(file.backlog, file.backlogStart, taken - file.backlogStart);
+    if (file.backlog.size() > file.backlogStart) everything = false;
+  }
+  return everything;
+}
+
+void UringFileWriter::_run() {
+  while (true) {
+    bool stopping = stopping_.load(std::memory_order_acquire);
+    if (ring_ >= 0) _reap();
+    bool everything = _collect(stopping);
+    if (ring_ < 0) {
+      if (stopping) break;
+      std::this_thread::sleep_for(flushInterval_);
+      continue;
+    }
+
+    if (!everything) {
+      // out of buffers: submit and wait for one to come back
+      _enter(1);
+    }
+    else if (stopping) {
+      if (toSubmit_ == 0 && inFlight_ == 0) break;
+      _enter(1);
+    }
+    else {
+      _enter(0);
+      std::this_thread::sleep_for(flushInterval_);
+    }
+  }
+}
+
+void UringFileWriter::Start() {
+  if (running_.exchange(true)) return;
+  stopping_ = false;
+  thread_ = std::thread([this]() { _run(); });
+}
+
+void UringFileWriter::Stop() {
+  if (!running_.exchange(false)) return;
+  stopping_ = true;
+  thread_.join();
+}
+
+bool UringFileWriter::UsesUring() const {
+  return ring_ >= 0;
+}
+
+std::uint64_t UringFileWriter::GetRecordCount() const {
+  return records_.load(std::memory_order_relaxed);
+}
+
+void UringFileWriter::Report(std::ostream& output) const {
+  output << "File writer (" << (ring_ < 0 ? "pwrite" : (registered_ ? "io_uring, registered buffers" : "io_uring"))
+    << "): " << GetRecordCount() << " records, " << bytes_ << " bytes in " << writes_ << " writes and "
+    << syscalls_ << " system calls";
+  if (errors_ > 0) output << ", " << errors_ << " failed writes";
+  std::uint64_t stalls = stalls_.load(std::memory_order_relaxed);
+  if (stalls > 0) output << ", " << stalls << " appends waited for a full ring";
+  if (frames_ > 0) {
+    output << "; " << rawBytes_ << " bytes compressed into " << frames_ << " frames of " << frameBytesOut_ << " bytes ("
+      << static_cast<double>(rawBytes_) / std::max<std::uint64_t>(frameBytesOut_, 1) << "x)";
+  }
+  output << std::endl;
+}
+
+#endif // !URINGWRITER_HPP
@@ -10,26 +10,32 @@
 #include <unordered_map>
 #include <functional>
 #include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <string_view>
 #include "boost/algorithm/string.hpp"
 #include "products.hpp"
 #include "marketdataservice.hpp"
 
 // ************************************************************************************************
-// Function to create a bond object object based on its CUSIP
+// Function to get the bond object based on its CUSIP
+// Bonds are created once and handed out by reference afterwards
 // ************************************************************************************************
-Bond MakeBond(const std::string& cusip) {
-  
-  Bond bond;
-
-  if (cusip == "91282CJL6") bond = Bond(cusip, CUSIP, "US2Y", 0.04875, boost::gregorian::from_string("2025/11/30"));
-  if (cusip == "91282CJK8") bond = Bond(cusip, CUSIP, "US3Y", 0.04625, boost::gregorian::from_string("2026/11/15"));
-  if (cusip == "91282CJN2") bond = Bond(cusip, CUSIP, "US5Y", 0.04375, boost::gregorian::from_string("2028/11/30"));
-  if (cusip == "91282CJM4") bond = Bond(cusip, CUSIP, "US7Y", 0.04375, boost::gregorian::from_string("2030/11/30"));
-  if (cusip == "91282CJJ1") bond = Bond(cusip, CUSIP, "US10Y", 0.045, boost::gregorian::from_string("2033/11/15"));
-  if (cusip == "912810TW8") bond = Bond(cusip, CUSIP, "US20Y", 0.0475, boost::gregorian::from_string("2043/11/15"));
-  if (cusip == "912810TV0") bond = Bond(cusip, CUSIP, "US30Y", 0.0475, boost::gregorian::from_string("2053/11/15"));
-
-  return bond;
+const Bond& MakeBond(const ProductId& cusip) {
+
+  static const std::unordered_map<ProductId, Bond> bonds{
+    { "91282CJL6", Bond("91282CJL6", CUSIP, "US2Y", 0.04875, boost::gregorian::from_string("2025/11/30")) },
+    { "91282CJK8", Bond("91282CJK8", CUSIP, "US3Y", 0.04625, boost::gregorian::from_string("2026/11/15")) },
+    { "91282CJN2", Bond("91282CJN2", CUSIP, "US5Y", 0.04375, boost::gregorian::from_string("2028/11/30")) },
+    { "91282CJM4", Bond("91282CJM4", CUSIP, "US7Y", 0.04375, boost::gregorian::from_string("2030/11/30")) },
+    { "91282CJJ1", Bond("91282CJJ1", CUSIP, "US10Y", 0.045, boost::gregorian::from_string("2033/11/15")) },
+    { "912810TW8", Bond("912810TW8", CUSIP, "US20Y", 0.0475, boost::gregorian::from_string("2043/11/15")) },
+    { "912810TV0", Bond("912810TV0", CUSIP, "US30Y", 0.0475, boost::gregorian::from_string("2053/11/15")) }
+  };
+  static const Bond unknown;
+
+  auto it = bonds.find(cusip);
+  return (it != bonds.end()) ? it->second : unknown;
 }
 
 
@@ -69,22 +75,45 @@ std::unordered_map<std::string, std::vector<std::string>> BucketMap() {
 // ************************************************************************************************
 // Functions to convert price to and from fractional (256th)
 // ************************************************************************************************
-double StringToPrice(const std::string& s_price) {
-
-  std::vector<std::string> tokens;
-  boost::algorithm::split(tokens, s_price, boost::algorithm::is_any_of("-"));
-  // this splits the integer and the 'xyz' part;
-  std::string integer_str = tokens[0];
-  std::string thirtysec = tokens[1].substr(0, 2);
-  std::string eighth = tokens[1].substr(2, 3);
+// Conversion on a range of characters, e.g. a field of a memory-mapped file, without allocating
+// The field must be "<integer>-xyz": 'xy' thirty-seconds (00 to 31), then 'z' eighths of a
+// thirty-second (0 to 7, '+' standing for 4) - returns false, with the price untouched, otherwise
+bool TryStringToPrice(const char* begin, const char* end, double& price) {
+  auto digit = [](char c) { return c >= '0' && c <= '9'; };
+
+  long integer = 0;
+  const char* start = begin;
+  while (begin != end && digit(*begin) && begin - start < 9) integer = 10 * integer + (*begin++ - '0');
+  if (begin == start || end - begin != 4 || *begin != '-') return false;
+  ++begin;  // skip the '-'
+
+  if (!digit(begin[0]) || !digit(begin[1])) return false;
+  long thirtysec = 10 * (begin[0] - '0') + (begin[1] - '0');
+  if (thirtysec > 31) return false;
+  long eighth = (begin[2] == '+') ? 4 : begin[2] - '0';
+  if (begin[2] != '+' && (eighth < 0 || eighth > 7)) return false;
+
+  price = integer + thirtysec / 32. + eighth / 256.;
+  return true;
+}
 
-  if (eighth == "+") eighth = "4";
+// Same conversion - throws std::invalid_argument, naming the field, if it is malformed
+double StringToPrice(const char* begin, const char* end) {
+  double price;
+  if (!TryStringToPrice(begin, end, price)) {
+    throw std::invalid_argument("malformed price '" + std::string(begin, end) + "'");
+  }
+  return price;
+}
 
-  double integer_d = std::stod(integer_str);
-  double decimal32 = std::stod(thirtysec) / 32.; 
-  double decimal8 = std::stod(eighth) / 256.;
+double StringToPrice(const std::string& s_price) {
+  return StringToPrice(s_price.data(), s_price.data() + s_price.size());
+}
 
-  return integer_d + decimal32 + decimal8;
+// Report a field a connector cannot read - returns false, for the parser to skip the line
+bool RejectField(const char* what, const char* begin, const char* end) {
+  std::cout << "An error occurred: malformed " << what << " '" << std::string_view(begin, end - begin) << "', line skipped" << std::endl;
+  return false;
 }
 
 std::string PriceToString(const double& d_price) {
@@ -133,15 +162,15 @@ Order find_best_order(const vector<Order>& order_stack, const PricingSide& side)
 }
 
 //*************************************************************************************************
-// Function to print the current timestamp with millisecond precision
+// Functions to print a timestamp, by default the current one, with millisecond precision
 //*************************************************************************************************
-std::string PrintTimeStamp() {
-  auto current_time = std::chrono::system_clock::now();
+std::string PrintTimeStamp(std::chrono::system_clock::time_point current_time) {
   auto millisec = std::chrono::duration_cast<std::chrono::milliseconds>
     (current_time.time_since_epoch()).count() % 1000;
   // extract time in human-readable format
   auto timeT = std::chrono::system_clock::to_time_t(current_time);
-  auto local_time = *std::localtime(&timeT);
+  std::tm local_time;
+  localtime_r(&timeT, &local_time);  // reentrant: flows print from several threads
   // create the string
   std::ostringstream oss;
   oss << std::put_time(&local_time, "%Y-%m-%d %H:%M:%S.")
@@ -149,4 +178,8 @@ std::string PrintTimeStamp() {
   return oss.str();
 }
 
+std::string PrintTimeStamp() {
+  return PrintTimeStamp(std::chrono::system_clock::now());
+}
+
 #endif // !UTILS_HPP
@@ -0,0 +1,210 @@
+/**
+* workstealingpool.hpp
+*
+* Shared task pool that services submit fork-join jobs to
+* (the connectors parse the chunks of their files on it)
+*
+* @author: Gabo Bernardino
+*/
+
+#ifndef WORKSTEALINGPOOL_HPP
+#define WORKSTEALINGPOOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+* Work-stealing thread pool
+* Every worker owns a deque of tasks: it pops its own tasks from the back
+* (most recently forked, still hot in cache) and, when it runs dry, steals
+* from the front of the other workers' deques.
+* Tasks submitted from outside the pool are spread round-robin.
+*
+* ParallelFor is the fork-join entry point: it splits a range into tasks and
+* the calling thread helps running them until all are done, so it can be
+* called from a worker (nested jobs) or from any service thread.
+*/
+class WorkStealingPool {
+private:
+  struct Worker {
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+  };
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::vector<std::thread> threads_;
+  std::atomic<bool> stop_;
+  std::atomic<std::size_t> next_;  // round-robin target for external submissions
+  std::atomic<long> pending_;  // tasks queued and not yet taken
+  std::atomic<long> steals_;
+  std::mutex sleepMutex_;
+  std::condition_variable wake_;
+
+  // pool and worker index of the current thread (nullptr / -1 outside any pool)
+  inline static thread_local WorkStealingPool* owner_ = nullptr;
+  inline static thread_local int index_ = -1;
+
+  // Take a task: own deque first, then steal - false if every deque is empty
+  bool _take(int self, std::function<void()>& task);
+
+  // Take and run one task - false if there was none
+  bool _runOne(int self);
+
+  void _workerLoop(int index);
+
+public:
+  // ctor - one worker per core by default
+  WorkStealingPool(std::size_t n_threads = std::max(1u, std::thread::hardware_concurrency()));
+  ~WorkStealingPool();
+
+  // Queue a task
+  void Submit(std::function<void()> task);
+
+  // Run fn(i) for every i in [begin, end), in chunks of `grain` indices, and wait for all of them.
+  // Rethrows the first exception raised by a chunk.
+  template <typename F>
+  void ParallelFor(std::size_t begin, std::size_t end, F fn, std::size_t grain = 1);
+
+  std::size_t GetThreadCount() const;
+
+  // Number of tasks taken from another worker's deque so far
+  long GetStealCount() const;
+};
+
+//*************************************************************************************************
+// WorkStealingPool implementations
+//*************************************************************************************************
+WorkStealingPool::WorkStealingPool(std::size_t n_threads) :
+  stop_(false), next_(0), pending_(0), steals_(0)
+{
+  for (std::size_t i = 0; i < n_threads; ++i) {
+    workers_.push_back(std::make_unique<Worker>());
+  }
+  for (std::size_t i = 0; i < n_threads; ++i) {
+    threads_.emplace_back([this, i]() { _workerLoop(static_cast<int>(i)); });
+  }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+  {
+    std::lock_guard<std::mutex> lock(sleepMutex_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+  for (std::thread& thread : threads_) thread.join();
+}
+
+void WorkStealingPool::Submit(std::function<void()> task) {
+  // forked from one of our workers: keep it local, otherwise spread the load
+  int target = (owner_ == this) ? index_ : static_cast<int>(next_++ % workers_.size());
+  {
+    std::lock_guard<std::mutex> lock(workers_[target]->mutex);
+    workers_[target]->tasks.push_back(std::move(task));
+  }
+  pending_++;
+  {
+    // taking the lock orders the notify after a sleeper's check of `pending_`
+    std::lock_guard<std::mutex> lock(sleepMutex_);
+  }
+  wake_.notify_one();
+}
+
+bool WorkStealingPool::_take(int self, std::function<void()>& task) {
+  if (self >= 0) {
+    Worker& own = *workers_[self];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.tasks.empty()) {
+      task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      pending_--;
+      return true;
+    }
+  }
+
+  std::size_t n = workers_.size();
+  std::size_t start = (self >= 0) ? self + 1 : next_.load();
+  for (std::size_t k = 0; k < n; ++k) {
+    int victim = static_cast<int>((start + k) % n);
+    if (victim == self) continue;
+    Worker& other = *workers_[victim];
+    std::lock_guard<std::mutex> lock(other.mutex);
+    if (!other.tasks.empty()) {
+      task = std::move(other.tasks.front());
+      other.tasks.pop_front();
+      pending_--;
+      if (self >= 0) steals_++;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool WorkStealingPool::_runOne(int self) {
+  std::function<void()> task;
+  if (!_take(self, task)) return false;
+  task();
+  return true;
+}
+
+void WorkStealingPool::_workerLoop(int index) {
+  owner_ = this;
+  index_ = index;
+  while (true) {
+    if (_runOne(index)) continue;
+
+    std::unique_lock<std::mutex> lock(sleepMutex_);
+    wake_.wait(lock, [this]() { return stop_ || pending_ > 0; });
+    if (stop_ && pending_ <= 0) return;
+  }
+}
+
+template <typename F>
+void WorkStealingPool::ParallelFor(std::size_t begin, std::size_t end, F fn, std::size_t grain) {
+  if (begin >= end) return;
+  if (grain == 0) grain = 1;
+
+  std::size_t n_chunks = (end - begin + grain - 1) / grain;
+  std::atomic<std::size_t> remaining(n_chunks);
+  std::exception_ptr error;
+  std::mutex errorMutex;
+
+  for (std::size_t chunk = 0; chunk < n_chunks; ++chunk) {
+    std::size_t lo = begin + chunk * grain, hi = std::min(end, lo + grain);
+    Submit([&, lo, hi]() {
+      try {
+        for (std::size_t i = lo; i < hi; ++i) fn(i);
+      }
+      catch (...) {
+        std::lock_guard<std::mutex> lock(errorMutex);
+        if (!error) error = std::current_exception();
+      }
+      remaining--;
+    });
+  }
+
+  // help until the whole job is done
+  int self = (owner_ == this) ? index_ : -1;
+  while (remaining > 0) {
+    if (!_runOne(self)) std::this_thread::yield();
+  }
+
+  if (error) std::rethrow_exception(error);
+}
+
+std::size_t WorkStealingPool::GetThreadCount() const {
+  return threads_.size();
+}
+
+long WorkStealingPool::GetStealCount() const {
+  return steals_;
+}
+
+#endif // !WORKSTEALINGPOOL_HPP
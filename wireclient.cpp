@@ -0,0 +1,53 @@
+// Gabo Bernardino - stand-in for an upstream booking system and RFQ gateway pushing binary frames
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "tradingsystem/Bond/BondTradeBookingService.hpp"
+#include "tradingsystem/Bond/BondInquiryService.hpp"
+#include "tradingsystem/Bond/BondWireProtocol.hpp"
+#include "tradingsystem/unixsocket.hpp"
+
+// Encode every line of a connector file into frames
+template <typename T, typename Parse, typename Encode>
+std::vector<char> EncodeFile(const char* filename, Parse parse, Encode encode) {
+  std::vector<char> frames;
+  std::ifstream in(filename);
+  std::string line;
+  T data;
+  while (std::getline(in, line)) {
+    while (!line.empty() && (line.back() == '\r' || line.back() == ' ')) line.pop_back();
+    if (!parse(line.data(), line.data() + line.size(), data)) continue;
+    frames.resize(frames.size() + wireFrameSize);
+    encode(data, frames.data() + frames.size() - wireFrameSize);
+  }
+  return frames;
+}
+
+// Send frames `batch` at a time
+void SendFrames(const char* path, const std::vector<char>& frames, std::size_t batch) {
+  UnixSocketClient client(path);
+  for (std::size_t sent = 0; sent < frames.size(); sent += batch * wireFrameSize) {
+    client.Send(frames.data() + sent, std::min(batch * wireFrameSize, frames.size() - sent));
+  }
+  std::cout << "Sent " << frames.size() / wireFrameSize << " frames to " << path << std::endl;
+}
+
+// Usage: WireClientExe [trades file] [inquiries file] [frames per send]
+// Start `TradingSystemExe --socket` first
+int main(int argc, char* argv[]) {
+  const char* trades_file = (argc > 1) ? argv[1] : "Data/trades.txt";
+  const char* inquiries_file = (argc > 2) ? argv[2] : "Data/inquiries.txt";
+  std::size_t batch = (argc > 3) ? std::max(1, std::atoi(argv[3])) : 64;
+
+  try {
+    SendFrames(defaultTradeSocket, EncodeFile<Trade<Bond>>(trades_file, BondTradeBookingConnector::ParseLine, EncodeTrade), batch);
+    SendFrames(defaultInquirySocket, EncodeFile<Inquiry<Bond>>(inquiries_file, BondInquiryConnector::ParseLine, EncodeInquiry), batch);
+  }
+  catch (std::exception& e) {
+    std::cout << "An error occurred: " << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}